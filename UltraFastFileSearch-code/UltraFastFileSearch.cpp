@@ -378,6 +378,9 @@ using memheap_vector = uffs::memheap_vector<T, Alloc>;
 #include "src/util/com_init.hpp"
 #include "src/io/io_completion_port.hpp"
 #include "src/io/mft_reader.hpp"
+#include "src/io/mft_dump_replay.hpp"
+#include "src/io/mft_stream_replay.hpp"
+#include "src/io/ntfs_image_replay.hpp"
 
 // CDisableListViewUnnecessaryMessages and CSetRedraw extracted to src/gui/listview_hooks.hpp
 #include "src/gui/listview_hooks.hpp"
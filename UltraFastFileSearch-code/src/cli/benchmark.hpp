@@ -62,6 +62,8 @@
 #include <chrono>
 #include <iomanip>
 #include <iostream>
+#include <memory>
+#include <thread>
 #include <tchar.h>
 #include <Windows.h>
 
@@ -70,6 +72,7 @@
 // class NtfsIndex;
 // class IoCompletionPort;
 // class OverlappedNtfsMftReadPayload;
+// class MftDumpReplay;
 
 namespace uffs {
 
@@ -198,6 +201,8 @@ inline int benchmark_index_build(char drive_letter, std::ostream& OS)
     OS << "Records Processed: " << total_records << "\n";
     OS << "Name Entries: " << total_names << "\n";
     OS << "Names + Streams: " << total_names_and_streams << "\n";
+    OS << "Name Dedupe Ratio: " << std::fixed << std::setprecision(2)
+       << index->name_dedupe_ratio() << "x\n";
 
     OS << "\n=== Benchmark Results ===\n";
     OS << "Time Elapsed: " << duration.count() << " ms ("
@@ -219,9 +224,514 @@ inline int benchmark_index_build(char drive_letter, std::ostream& OS)
     return 0;
 }
 
+/**
+ * @brief Benchmarks index building from a UFFS-MFT dump file.
+ *
+ * Same measurements as benchmark_index_build(), but the records come from
+ * a memory-mapped dump (see MftDumpReplay) instead of the live volume, so
+ * the result reflects parse throughput without disk I/O noise. The file is
+ * mapped before the timer starts; page faults on first touch are included.
+ *
+ * @param dump_path  Path to a file written by --dump-mft
+ * @param OS         Output stream for results (e.g., std::cout)
+ * @return 0 on success, error code on failure
+ */
+inline int benchmark_index_from_dump(char const* dump_path, std::ostream& OS)
+{
+    OS << "\n=== Index Build Benchmark Tool (offline) ===\n";
+    OS << "Dump: " << dump_path << "\n";
+    OS << "This measures parsing + index building from a UFFS-MFT dump "
+       << "(no disk I/O)\n\n";
+
+    std::unique_ptr<MftDumpReplay> replay;
+    try {
+        replay.reset(new MftDumpReplay(dump_path));
+    } catch (std::runtime_error& ex) {
+        OS << "ERROR: Cannot read dump: " << ex.what() << "\n";
+        return ERROR_BAD_FORMAT;
+    }
+
+    intrusive_ptr<NtfsIndex> index(new NtfsIndex(replay->root_path(_T("C:\\"))), true);
+    unsigned int const threads = std::max(1U, std::thread::hardware_concurrency());
+
+    OS << "Replaying " << replay->header().record_count << " records on "
+       << threads << " threads ...\n";
+    OS.flush();
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+    clock_t tbegin = clock();
+
+    unsigned int const task_result = (*replay)(index.get(), threads);
+
+    auto end_time = std::chrono::high_resolution_clock::now();
+    clock_t tend = clock();
+
+    if (task_result != 0) {
+        OS << "ERROR: Indexing failed with error code " << task_result << "\n";
+        return static_cast<int>(task_result);
+    }
+
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+        end_time - start_time);
+    double seconds = static_cast<double>(duration.count()) / 1000.0;
+    double clock_seconds = static_cast<double>(tend - tbegin) / CLOCKS_PER_SEC;
+
+    size_t total_records = index->records_so_far();
+    size_t total_names = index->total_names();
+    size_t total_names_and_streams = index->total_names_and_streams();
+    unsigned long long mft_bytes = replay->header().original_size;
+
+    double mb_per_sec = (seconds > 0)
+        ? (static_cast<double>(mft_bytes) / (1024.0 * 1024.0)) / seconds
+        : 0;
+    double records_per_sec = (seconds > 0)
+        ? static_cast<double>(total_records) / seconds
+        : 0;
+    double names_per_sec = (seconds > 0)
+        ? static_cast<double>(total_names) / seconds
+        : 0;
+
+    OS << "\n=== Dump Information ===\n";
+    OS << "MFT Capacity: " << replay->header().record_count << " records\n";
+    OS << "MFT Record Size: " << replay->header().record_size << " bytes\n";
+    OS << "MFT Total Size: " << mft_bytes << " bytes ("
+       << (mft_bytes / (1024 * 1024)) << " MB)\n";
+
+    OS << "\n=== Index Statistics ===\n";
+    OS << "Records Processed: " << total_records << "\n";
+    OS << "Name Entries: " << total_names << "\n";
+    OS << "Names + Streams: " << total_names_and_streams << "\n";
+    OS << "Name Dedupe Ratio: " << std::fixed << std::setprecision(2)
+       << index->name_dedupe_ratio() << "x\n";
+
+    OS << "\n=== Benchmark Results ===\n";
+    OS << "Time Elapsed: " << duration.count() << " ms ("
+       << std::fixed << std::setprecision(3) << seconds << " seconds)\n";
+    OS << "CPU Time: " << std::fixed << std::setprecision(3)
+       << clock_seconds << " seconds\n";
+    OS << "Parse Speed: " << std::fixed << std::setprecision(2)
+       << mb_per_sec << " MB/s\n";
+    OS << "Record Processing: " << std::fixed << std::setprecision(0)
+       << records_per_sec << " records/sec\n";
+    OS << "Name Indexing: " << std::fixed << std::setprecision(0)
+       << names_per_sec << " names/sec\n";
+
+    OS << "\n=== Summary ===\n";
+    OS << "Indexed " << total_names << " names in "
+       << std::fixed << std::setprecision(3) << seconds << " seconds\n";
+
+    return 0;
+}
+
+/**
+ * @brief Weighs the memory --pack-names saves against the search time it costs.
+ *
+ * Builds the index of a UFFS-MFT dump twice, with the names pool as plain
+ * text and packed in LZ4 blocks (NtfsIndex::kLoadPackedNames). Each index
+ * is then walked with matches() as a name search walks it, reading the
+ * characters of every name, and as a path search does, building every
+ * path. A walk is timed as the best of three; both indexes must give the
+ * same checksum over what the walks read.
+ *
+ * @param dump_path  Path to a file written by --dump-mft
+ * @param OS         Output stream for results (e.g., std::cout)
+ * @return 0 on success, error code on failure
+ */
+inline int benchmark_names_from_dump(char const* dump_path, std::ostream& OS)
+{
+    OS << "\n=== Names Pool Benchmark Tool (offline) ===\n";
+    OS << "Dump: " << dump_path << "\n";
+    OS << "This compares names memory and search time with and without "
+       << "--pack-names\n\n";
+
+    std::unique_ptr<MftDumpReplay> replay;
+    try {
+        replay.reset(new MftDumpReplay(dump_path));
+    } catch (std::runtime_error& ex) {
+        OS << "ERROR: Cannot read dump: " << ex.what() << "\n";
+        return ERROR_BAD_FORMAT;
+    }
+
+    struct Measurement
+    {
+        size_t bytes = 0;
+        size_t names = 0;
+        unsigned long long checksum = 0;
+        double name_walk_ms = 0;
+        double path_walk_ms = 0;
+    };
+    unsigned int const threads = std::max(1U, std::thread::hardware_concurrency());
+    auto const measure = [&](unsigned int load_profile, Measurement& m) -> unsigned int
+    {
+        // Loading fixes up the records of the copy-on-write mapping in place; map the dump anew
+        MftDumpReplay build(dump_path);
+        intrusive_ptr<NtfsIndex> index(new NtfsIndex(build.root_path(_T("C:\\")), load_profile), true);
+        unsigned int const task_result = build(index.get(), threads);
+        if (task_result != 0) {
+            return task_result;
+        }
+        m.bytes = index->names_bytes();
+
+        for (bool const match_paths : { false, true }) {
+            double best = 0;
+            for (int run = 0; run != 3; ++run) {
+                std::tvstring path;
+                size_t names = 0;
+                unsigned long long checksum = 0;
+                auto const start = std::chrono::high_resolution_clock::now();
+                index->matches([&](TCHAR const* name, size_t length, bool ascii, NtfsIndex::key_type const&, size_t) {
+                    ++names;
+                    if (length) {
+                        checksum += ascii ? static_cast<unsigned char>(reinterpret_cast<char const*>(name)[length - 1])
+                                          : static_cast<unsigned long long>(name[length - 1]);
+                    }
+                    return 1;
+                }, path, match_paths, false, false);
+                double const ms = std::chrono::duration<double, std::milli>(
+                    std::chrono::high_resolution_clock::now() - start).count();
+                best = run ? std::min(best, ms) : ms;
+                m.names = names;
+                m.checksum += run ? 0 : checksum;
+            }
+            (match_paths ? m.path_walk_ms : m.name_walk_ms) = best;
+        }
+        return 0;
+    };
+
+    Measurement plain, packed;
+    OS << "Building the index with plain names ...\n";
+    OS.flush();
+    unsigned int task_result = measure(NtfsIndex::kLoadEverything, plain);
+    if (task_result == 0) {
+        OS << "Building the index with packed names ...\n";
+        OS.flush();
+        task_result = measure(NtfsIndex::kLoadPackedNames, packed);
+    }
+    if (task_result != 0) {
+        OS << "ERROR: Indexing failed with error code " << task_result << "\n";
+        return static_cast<int>(task_result);
+    }
+
+    auto const percent = [](double part, double whole) {
+        return whole > 0 ? 100.0 * part / whole : 0.0;
+    };
+    auto const per_second = [](size_t names, double ms) {
+        return ms > 0 ? static_cast<double>(names) * 1000.0 / ms : 0.0;
+    };
+
+    OS << "\n=== Names Memory ===\n";
+    OS << "Plain: " << plain.bytes << " bytes\n";
+    OS << "Packed: " << packed.bytes << " bytes ("
+       << std::fixed << std::setprecision(1)
+       << percent(static_cast<double>(plain.bytes) - static_cast<double>(packed.bytes),
+              static_cast<double>(plain.bytes))
+       << "% saved)\n";
+
+    OS << "\n=== Search Time (best of 3) ===\n";
+    OS << "Name Walk: " << std::fixed << std::setprecision(1)
+       << plain.name_walk_ms << " ms plain, " << packed.name_walk_ms << " ms packed ("
+       << percent(packed.name_walk_ms - plain.name_walk_ms, plain.name_walk_ms) << "% slower)\n";
+    OS << "Path Walk: " << std::fixed << std::setprecision(1)
+       << plain.path_walk_ms << " ms plain, " << packed.path_walk_ms << " ms packed ("
+       << percent(packed.path_walk_ms - plain.path_walk_ms, plain.path_walk_ms) << "% slower)\n";
+    OS << "Name Throughput: " << std::fixed << std::setprecision(0)
+       << per_second(plain.names, plain.name_walk_ms) << " results/sec plain, "
+       << per_second(packed.names, packed.name_walk_ms) << " results/sec packed\n";
+    OS << "Results Match: " << (plain.names == packed.names && plain.checksum == packed.checksum ? "yes" : "NO") << "\n";
+
+    OS << "\n=== Summary ===\n";
+    OS << "Packed names saved "
+       << (plain.bytes > packed.bytes ? (plain.bytes - packed.bytes) / 1024 : 0) << " KB for "
+       << std::fixed << std::setprecision(1)
+       << percent(packed.name_walk_ms - plain.name_walk_ms, plain.name_walk_ms)
+       << "% more name search time\n";
+
+    return plain.checksum == packed.checksum ? 0 : ERROR_INVALID_DATA;
+}
+
+/// What benchmark_width_from_dump() measures of one index layout.
+struct IndexWidthMeasurement
+{
+    unsigned int error = 0;          ///< Of the replay; ERROR_ARITHMETIC_OVERFLOW past the layout's ceiling
+    double build_ms = 0;
+    size_t names_bytes = 0;
+    size_t lists_bytes = 0;
+    size_t names = 0;
+    unsigned long long checksum = 0;
+    double name_walk_ms = 0;
+    double path_walk_ms = 0;
+};
+
+/**
+ * @brief Builds an @p IndexType from a UFFS-MFT dump, then times a name and a path walk over it.
+ *
+ * The dump is mapped anew: loading fixes up the records of the
+ * copy-on-write mapping in place, so a mapping replays only once.
+ *
+ * @tparam IndexType  NtfsIndex or HugeNtfsIndex
+ */
+template <class IndexType>
+inline void measure_index_width(char const* dump_path, unsigned int threads, IndexWidthMeasurement& m)
+{
+    MftDumpReplay replay(dump_path);
+    intrusive_ptr<IndexType> index(new IndexType(replay.root_path(_T("C:\\"))), true);
+    auto const start = std::chrono::high_resolution_clock::now();
+    m.error = replay(index.get(), threads);
+    m.build_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::high_resolution_clock::now() - start).count();
+    if (m.error != 0) {
+        return;
+    }
+    m.names_bytes = index->names_bytes();
+    m.lists_bytes = index->lists_bytes();
+
+    for (bool const match_paths : { false, true }) {
+        double best = 0;
+        for (int run = 0; run != 3; ++run) {
+            std::tvstring path;
+            size_t names = 0;
+            unsigned long long checksum = 0;
+            auto const walk_start = std::chrono::high_resolution_clock::now();
+            index->matches([&](TCHAR const* name, size_t length, bool ascii, typename IndexType::key_type const&, size_t) {
+                ++names;
+                if (length) {
+                    checksum += ascii ? static_cast<unsigned char>(reinterpret_cast<char const*>(name)[length - 1])
+                                      : static_cast<unsigned long long>(name[length - 1]);
+                }
+                return 1;
+            }, path, match_paths, true, false);
+            double const ms = std::chrono::duration<double, std::milli>(
+                std::chrono::high_resolution_clock::now() - walk_start).count();
+            best = run ? std::min(best, ms) : ms;
+            m.names = names;
+            m.checksum += run ? 0 : checksum;
+        }
+        (match_paths ? m.path_walk_ms : m.name_walk_ms) = best;
+    }
+}
+
+/**
+ * @brief Weighs the compact index layout against the 64-bit one of HugeNtfsIndex.
+ *
+ * Builds the index of a UFFS-MFT dump as an NtfsIndex and as a
+ * HugeNtfsIndex, one after the other, and compares build time, memory and
+ * a name and a path walk with matches() (best of three). Both indexes must
+ * give the same checksum over what the walks read.
+ *
+ * A dump whose names pool is past 2^31 characters (4 GB of UTF-16) does not
+ * fit the compact layout: that build stops with ERROR_ARITHMETIC_OVERFLOW,
+ * and only the 64-bit index is measured. The synthetic generator makes one
+ * without a volume that large (unique 200+ character UTF-16 names, about
+ * 10 GB of records):
+ *
+ * ```
+ *   uffs --generate-mft=huge.uffs --generate-mft-options=records=10000000,names=200..240,unicode=1,dos=0
+ *   uffs --benchmark-width-from=huge.uffs
+ * ```
+ *
+ * @param dump_path  Path to a file written by --dump-mft or --generate-mft
+ * @param OS         Output stream for results (e.g., std::cout)
+ * @return 0 on success, error code on failure
+ */
+inline int benchmark_width_from_dump(char const* dump_path, std::ostream& OS)
+{
+    OS << "\n=== Index Width Benchmark Tool (offline) ===\n";
+    OS << "Dump: " << dump_path << "\n";
+    OS << "This compares the compact 32-bit index layout with the 64-bit one "
+       << "of HugeNtfsIndex\n\n";
+
+    std::unique_ptr<MftDumpReplay> replay;
+    try {
+        replay.reset(new MftDumpReplay(dump_path));
+    } catch (std::runtime_error& ex) {
+        OS << "ERROR: Cannot read dump: " << ex.what() << "\n";
+        return ERROR_BAD_FORMAT;
+    }
+
+    unsigned int const threads = std::max(1U, std::thread::hardware_concurrency());
+    IndexWidthMeasurement compact, huge;
+    OS << "Building the compact index ...\n";
+    OS.flush();
+    measure_index_width<NtfsIndex>(dump_path, threads, compact);
+    if (compact.error != 0 && compact.error != ERROR_ARITHMETIC_OVERFLOW) {
+        OS << "ERROR: Indexing failed with error code " << compact.error << "\n";
+        return static_cast<int>(compact.error);
+    }
+    OS << "Building the 64-bit index ...\n";
+    OS.flush();
+    measure_index_width<HugeNtfsIndex>(dump_path, threads, huge);
+    if (huge.error != 0) {
+        OS << "ERROR: Indexing failed with error code " << huge.error << "\n";
+        return static_cast<int>(huge.error);
+    }
+
+    auto const percent = [](double part, double whole) {
+        return whole > 0 ? 100.0 * part / whole : 0.0;
+    };
+    bool const fits = compact.error == 0;
+
+    OS << "\n=== Dump Information ===\n";
+    OS << "MFT Capacity: " << replay->header().record_count << " records\n";
+    OS << "Names Pool: " << huge.names_bytes << " bytes ("
+       << (huge.names_bytes >> 20) << " MB)\n";
+    if (!fits) {
+        OS << "The names do not fit the compact layout; only the 64-bit index is measured\n";
+    }
+
+    OS << "\n=== Memory ===\n";
+    if (fits) {
+        OS << "Records and Lists: " << compact.lists_bytes << " bytes compact, "
+           << huge.lists_bytes << " bytes 64-bit (" << std::fixed << std::setprecision(1)
+           << percent(static_cast<double>(huge.lists_bytes) - static_cast<double>(compact.lists_bytes),
+                  static_cast<double>(compact.lists_bytes))
+           << "% more)\n";
+    } else {
+        OS << "Records and Lists: " << huge.lists_bytes << " bytes 64-bit\n";
+    }
+
+    OS << "\n=== Time ===\n";
+    OS << std::fixed << std::setprecision(1);
+    if (fits) {
+        OS << "Build: " << compact.build_ms << " ms compact, " << huge.build_ms << " ms 64-bit\n";
+        OS << "Name Walk (best of 3): " << compact.name_walk_ms << " ms compact, " << huge.name_walk_ms << " ms 64-bit ("
+           << percent(huge.name_walk_ms - compact.name_walk_ms, compact.name_walk_ms) << "% slower)\n";
+        OS << "Path Walk (best of 3): " << compact.path_walk_ms << " ms compact, " << huge.path_walk_ms << " ms 64-bit ("
+           << percent(huge.path_walk_ms - compact.path_walk_ms, compact.path_walk_ms) << "% slower)\n";
+        OS << "Results Match: " << (compact.names == huge.names && compact.checksum == huge.checksum ? "yes" : "NO") << "\n";
+    } else {
+        OS << "Build: " << huge.build_ms << " ms 64-bit (compact stopped after " << compact.build_ms << " ms)\n";
+        OS << "Name Walk (best of 3): " << huge.name_walk_ms << " ms 64-bit\n";
+        OS << "Path Walk (best of 3): " << huge.path_walk_ms << " ms 64-bit\n";
+    }
+
+    OS << "\n=== Summary ===\n";
+    OS << "Indexed " << huge.names << " names and streams";
+    if (fits) {
+        OS << "; the 64-bit layout took " << std::setprecision(1)
+           << percent(static_cast<double>(huge.lists_bytes) - static_cast<double>(compact.lists_bytes),
+                  static_cast<double>(compact.lists_bytes))
+           << "% more list memory\n";
+    } else {
+        OS << " past the compact layout's ceiling\n";
+    }
+
+    return !fits || (compact.names == huge.names && compact.checksum == huge.checksum) ? 0 : ERROR_INVALID_DATA;
+}
+
+/**
+ * @brief Benchmarks a periodic re-scan of an already built index.
+ *
+ * Builds the index once (untimed), then times begin_refresh() followed by
+ * a second pass of the MFT reader, which hashes every chunk and re-parses
+ * only the files in chunks that changed since the first pass. On an idle
+ * volume this is the cost of reading the MFT alone; compare it with
+ * --benchmark-index for what the re-scan saves.
+ *
+ * @param drive_letter  The drive letter to benchmark (e.g., 'C')
+ * @param OS            Output stream for results (e.g., std::cout)
+ * @return 0 on success, error code on failure
+ */
+inline int benchmark_index_refresh(char drive_letter, std::ostream& OS)
+{
+    OS << "\n=== Index Refresh Benchmark Tool ===\n";
+    OS << "Drive: " << drive_letter << ":\n";
+    OS << "This measures an MFT re-scan that re-parses only changed chunks\n\n";
+
+    TCHAR path_buf[4] = {
+        static_cast<TCHAR>(toupper(drive_letter)),
+        _T(':'),
+        _T('\\'),
+        _T('\0')
+    };
+    std::tvstring path_name(path_buf);
+
+    intrusive_ptr<NtfsIndex> index(new NtfsIndex(path_name), true);
+    IoCompletionPort iocp;
+    Handle closing_event;
+    typedef OverlappedNtfsMftReadPayload T;
+    HANDLE wait_handle = reinterpret_cast<HANDLE>(index->finished_event());
+
+    OS << "Building initial index...\n";
+    OS.flush();
+    iocp.post(0, 0, intrusive_ptr<T>(new T(iocp, index, closing_event)));
+    if (WaitForSingleObject(wait_handle, INFINITE) != WAIT_OBJECT_0) {
+        OS << "ERROR: Wait failed\n";
+        return ERROR_WAIT_1;
+    }
+    unsigned int task_result = index->get_finished();
+    if (task_result != 0) {
+        OS << "ERROR: Indexing failed with error code " << task_result << "\n";
+        if (task_result == ERROR_ACCESS_DENIED) {
+            OS << "Make sure you are running as Administrator.\n";
+        }
+        return static_cast<int>(task_result);
+    }
+    size_t const names_before = index->total_names();
+
+    OS << "Re-scanning...\n";
+    OS.flush();
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+    clock_t tbegin = clock();
+
+    try {
+        lock(index)->begin_refresh();
+    } catch (CStructured_Exception& ex) {
+        OS << "ERROR: Cannot reopen the volume (error " << ex.GetSENumber() << ")\n";
+        return static_cast<int>(ex.GetSENumber());
+    }
+    iocp.post(0, 0, intrusive_ptr<T>(new T(iocp, index, closing_event)));
+    if (WaitForSingleObject(wait_handle, INFINITE) != WAIT_OBJECT_0) {
+        OS << "ERROR: Wait failed\n";
+        return ERROR_WAIT_1;
+    }
+
+    auto end_time = std::chrono::high_resolution_clock::now();
+    clock_t tend = clock();
+
+    task_result = index->get_finished();
+    if (task_result != 0) {
+        OS << "ERROR: Re-scan failed with error code " << task_result << "\n";
+        return static_cast<int>(task_result);
+    }
+
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+        end_time - start_time);
+    double seconds = static_cast<double>(duration.count()) / 1000.0;
+    double clock_seconds = static_cast<double>(tend - tbegin) / CLOCKS_PER_SEC;
+
+    unsigned int mft_capacity = index->mft_capacity();
+    size_t refreshed = index->refreshed_files();
+    size_t names_after = index->total_names();
+
+    OS << "\n=== Re-scan Statistics ===\n";
+    OS << "MFT Capacity: " << mft_capacity << " records\n";
+    OS << "Files Re-parsed: " << refreshed << " ("
+       << std::fixed << std::setprecision(2)
+       << (mft_capacity ? 100.0 * static_cast<double>(refreshed) / mft_capacity : 0.0)
+       << "% of records)\n";
+    OS << "Name Entries: " << names_before << " -> " << names_after << "\n";
+
+    OS << "\n=== Benchmark Results ===\n";
+    OS << "Time Elapsed: " << duration.count() << " ms ("
+       << std::fixed << std::setprecision(3) << seconds << " seconds)\n";
+    OS << "CPU Time: " << std::fixed << std::setprecision(3)
+       << clock_seconds << " seconds\n";
+
+    OS << "\n=== Summary ===\n";
+    OS << "Re-scanned " << mft_capacity << " records, re-parsed " << refreshed
+       << " files in " << std::fixed << std::setprecision(3) << seconds << " seconds\n";
+
+    return 0;
+}
+
 } // namespace uffs
 
 // Expose at global scope for backward compatibility
 using uffs::benchmark_index_build;
+using uffs::benchmark_index_from_dump;
+using uffs::benchmark_names_from_dump;
+using uffs::benchmark_width_from_dump;
+using uffs::benchmark_index_refresh;
 
 #endif // UFFS_BENCHMARK_HPP
@@ -8,7 +8,7 @@
 // are already defined.
 //
 // Dependencies (provided by including translation unit):
-// - NtfsIndex, IoCompletionPort, OverlappedNtfsMftReadPayload
+// - NtfsIndex, IoCompletionPort, OverlappedNtfsMftReadPayload, MftDumpReplay, MftStreamReplay
 // - MatchOperation, Handle, intrusive_ptr
 // - NFormat, format_filetime, GetAnyErrorText
 // - get_volume_path_names, drivenames, replaceAll, removeSpaces
@@ -88,16 +88,20 @@ int main(int argc, char* argv[])
 		const std::vector<std::string>& drives = opts.drives;
 		const std::vector<std::string>& extentions = opts.extensions;
 
-		OS << "\n";
+		// A dump written to stdout must not be interleaved with status messages
+		bool const mft_to_stdout = (!opts.dumpMftDrive.empty() && opts.dumpMftOutput == "-") || opts.generateMftOutput == "-";
+		std::ostream& LOG = mft_to_stdout ? std::cerr : OS;
+
+		LOG << "\n";
 
 		// Handle --dump-mft option (raw MFT dump in UFFS-MFT format)
 		if (!opts.dumpMftDrive.empty()) {
 			char drive_letter = opts.dumpMftDrive[0];
 			if (!isalpha(drive_letter)) {
-				OS << "ERROR: Invalid drive letter: " << opts.dumpMftDrive << "\n";
+				LOG << "ERROR: Invalid drive letter: " << opts.dumpMftDrive << "\n";
 				return ERROR_BAD_ARGUMENTS;
 			}
-			return dump_raw_mft(drive_letter, opts.dumpMftOutput.c_str(), OS);
+			return dump_raw_mft(drive_letter, opts.dumpMftOutput.c_str(), opts.dumpMftCompress, LOG);
 		}
 
 		// Handle --dump-extents option (MFT extent diagnostic tool)
@@ -130,6 +134,41 @@ int main(int argc, char* argv[])
 			return benchmark_index_build(drive_letter, OS);
 		}
 
+		// Handle --benchmark-index-from option (index build from a UFFS-MFT dump)
+		if (!opts.benchmarkIndexFile.empty()) {
+			return benchmark_index_from_dump(opts.benchmarkIndexFile.c_str(), OS);
+		}
+
+		// Handle --benchmark-names-from option (packed vs. plain names pool from a UFFS-MFT dump)
+		if (!opts.benchmarkNamesFile.empty()) {
+			return benchmark_names_from_dump(opts.benchmarkNamesFile.c_str(), OS);
+		}
+
+		// Handle --benchmark-width-from option (compact vs. 64-bit index layout from a UFFS-MFT dump)
+		if (!opts.benchmarkWidthFile.empty()) {
+			return benchmark_width_from_dump(opts.benchmarkWidthFile.c_str(), OS);
+		}
+
+		// Handle --benchmark-refresh option (re-scan of an already built index)
+		if (!opts.benchmarkRefreshDrive.empty()) {
+			char drive_letter = opts.benchmarkRefreshDrive[0];
+			if (!isalpha(drive_letter)) {
+				OS << "ERROR: Invalid drive letter: " << opts.benchmarkRefreshDrive << "\n";
+				return ERROR_BAD_ARGUMENTS;
+			}
+			return benchmark_index_refresh(drive_letter, OS);
+		}
+
+		// Handle --generate-mft option (synthetic MFT for scale tests and benchmarks)
+		if (!opts.generateMftOutput.empty()) {
+			return generate_synthetic_mft(opts.generateMftOutput.c_str(), opts.generateMftOptions.c_str(), opts.dumpMftCompress, LOG);
+		}
+
+		// Handle --diff-mft option (record-level diff of two dumps)
+		if (opts.diffMftFiles.size() == 2) {
+			return diff_mft_dumps(opts.diffMftFiles[0].c_str(), opts.diffMftFiles[1].c_str(), opts.diffMftOutput.c_str(), OS);
+		}
+
 		HANDLE outHandle = 0;
 
 		// Handle output filename defaults
@@ -476,11 +515,112 @@ int main(int argc, char* argv[])
 			static std::tvstring empty;
 			empty = L"";
 
+			// Offline source: --index-from replaces the live MFT read with a UFFS-MFT dump,
+			// either a file or a stream ("-" or a named pipe) that is indexed as it arrives
+			std::unique_ptr<MftDumpReplay> dump_replay;
+			std::unique_ptr<MftStreamReplay> stream_replay;
+			if (!opts.indexFromFile.empty())
+			{
+				try
+				{
+					if (MftStreamReplay::is_stream_name(opts.indexFromFile.c_str()))
+					{
+						stream_replay.reset(new MftStreamReplay(opts.indexFromFile.c_str()));
+					}
+					else
+					{
+						dump_replay.reset(new MftDumpReplay(opts.indexFromFile.c_str()));
+					}
+				}
+				catch (std::runtime_error& ex)
+				{
+					OS << "ERROR: Cannot read " << opts.indexFromFile << ": " << ex.what() << "\n";
+					return ERROR_BAD_FORMAT;
+				}
+			}
+
+			// Offline source: --index-image reads $MFT straight out of a raw NTFS volume image
+			std::unique_ptr<NtfsImageReplay> image_replay;
+			if (!opts.indexImageFile.empty())
+			{
+				if (dump_replay || stream_replay)
+				{
+					OS << "ERROR: --index-image and --index-from cannot be combined\n";
+					return ERROR_BAD_ARGUMENTS;
+				}
+				try
+				{
+					image_replay.reset(new NtfsImageReplay(opts.indexImageFile.c_str(), opts.indexImageOffset));
+				}
+				catch (std::runtime_error& ex)
+				{
+					OS << "ERROR: Cannot read " << opts.indexImageFile << ": " << ex.what() << "\n";
+					return ERROR_BAD_FORMAT;
+				}
+			}
+
+			// Snapshot source: --index-snapshot maps a saved index and skips indexing entirely
+			intrusive_ptr<NtfsIndex> snapshot_index;
+			if (!opts.indexSnapshotFile.empty())
+			{
+				snapshot_index = new NtfsIndex(_T("C:\\"));
+				try
+				{
+					snapshot_index->open_snapshot(opts.indexSnapshotFile.c_str(), opts.verifyIndexSnapshot);
+				}
+				catch (std::runtime_error& ex)
+				{
+					OS << "ERROR: Cannot open " << opts.indexSnapshotFile << ": " << ex.what() << "\n";
+					return ERROR_BAD_FORMAT;
+				}
+			}
+
+			// Journal replay: --usn-journal patches the built index with the changes since the MFT was read
+			std::vector<UsnEvent> usn_events;
+			if (!opts.usnJournalFile.empty())
+			{
+				char const* error;
+				try
+				{
+					MappedFile const journal(opts.usnJournalFile.c_str(), MappedFile::ReadOnly);
+					error = uffs::read_usn_events(journal.data(), journal.size(), usn_events);
+				}
+				catch (std::runtime_error& ex)
+				{
+					error = ex.what();
+				}
+				if (error)
+				{
+					OS << "ERROR: Cannot read " << opts.usnJournalFile << ": " << error << "\n";
+					return ERROR_BAD_FORMAT;
+				}
+			}
+
+			// Name-only patterns are matched while the MFT is read; see ntfs_index_early.hpp
+			bool early_matches = false;
 			{
 
 				// Which DRIVES are used
 				std::vector<std::tvstring > path_names;
-				if (gotdrives)
+				if (snapshot_index)
+				{
+					path_names.push_back(snapshot_index->root_path());
+				}
+				else if (dump_replay)
+				{
+					// A dump holds exactly one volume, named after the drive it was taken from
+					path_names.push_back(dump_replay->root_path(_T("C:\\")));
+				}
+				else if (stream_replay)
+				{
+					path_names.push_back(stream_replay->root_path(_T("C:\\")));
+				}
+				else if (image_replay)
+				{
+					// An image holds exactly one volume and does not record its drive letter
+					path_names.push_back(std::tvstring(_T("C:\\")));
+				}
+				else if (gotdrives)
 				{
 					// Parse driveLetters (e.g., "C:|D:|E:") into individual wide-string paths
 					// Drive letters are ASCII, so direct char-to-wchar_t widening is safe
@@ -508,21 +648,66 @@ int main(int argc, char* argv[])
 					get_volume_path_names().swap(path_names);
 				}
 
+				// Directory totals are only computed if a size column is printed
+				bool const need_sizes = !columnsSpecified ||
+					(output_columns_flags & (COL_ALL | COL_SIZE | COL_SIZEONDISK | COL_DECENDENTS));
+
+				// Only the reader runs in the background; the replays load before the first wait
+				early_matches = !need_sizes && !matchop.is_path_pattern && !matchop.is_stream_pattern &&
+					!snapshot_index && !dump_replay && !stream_replay && !image_replay &&
+					usn_events.empty() && opts.saveIndexSnapshotFile.empty();
+
 				// Fill the queue with all the MFT to read
 				for (const auto& path_name : path_names)
 				{
 					if (matchop.prematch(path_name))
 					{
-						indices.push_back(static_cast<intrusive_ptr<NtfsIndex>>(new NtfsIndex(path_name)));
+						indices.push_back(snapshot_index ? snapshot_index : static_cast<intrusive_ptr<NtfsIndex>>(
+							new NtfsIndex(path_name, (opts.noStreams ? NtfsIndex::kLoadNoStreams : NtfsIndex::kLoadEverything) |
+								(opts.packNames ? NtfsIndex::kLoadPackedNames : NtfsIndex::kLoadEverything))));
+						if (!snapshot_index && !need_sizes)
+						{
+							indices.back()->defer_sizes();
+						}
+						if (early_matches)
+						{
+							// A copy per index; a glob matcher called as const keeps no state
+							indices.back()->match_while_loading([matcher = matchop.matcher](TCHAR const* name, size_t length)
+							{
+								return matcher.is_match(name, length);
+							});
+						}
 					}
 				}
 			}
 
+			// A snapshot holds exactly one volume
+			if (!opts.saveIndexSnapshotFile.empty() && (indices.size() != 1 || snapshot_index))
+			{
+				OS << "ERROR: --save-index-snapshot needs exactly one drive, --index-from or --index-image\n";
+				return ERROR_BAD_ARGUMENTS;
+			}
+
+			// A snapshot holds the whole index
+			if (!opts.saveIndexSnapshotFile.empty() && (opts.noStreams || opts.packNames))
+			{
+				OS << "ERROR: --save-index-snapshot cannot be combined with --no-streams or --pack-names\n";
+				return ERROR_BAD_ARGUMENTS;
+			}
+
+			// A journal belongs to exactly one volume, and snapshots are read-only
+			if (!opts.usnJournalFile.empty() && (indices.size() != 1 || snapshot_index))
+			{
+				OS << "ERROR: --usn-journal needs exactly one drive, --index-from or --index-image\n";
+				return ERROR_BAD_ARGUMENTS;
+			}
+
 			bool
 				const match_attributes = false;
 			std::vector<IoPriority> set_priorities(indices.size());
 			Handle closing_event;
 			std::vector<size_t> pending;
+			size_t early_turn = 0;
 			for (size_t i = 0; i != indices.size(); ++i)
 			{
 				if (void* const volume = indices[i]->volume())
@@ -530,9 +715,31 @@ int main(int argc, char* argv[])
 					IoPriority(reinterpret_cast<uintptr_t> (volume), winnt::IoPriorityLow).swap(set_priorities[i]);
 				}
 
-				typedef OverlappedNtfsMftReadPayload T;
-				intrusive_ptr<T> p(new T(iocp, indices[i], closing_event));
-				iocp.post(0, static_cast<uintptr_t> (i), p);
+				if (snapshot_index)
+				{
+					// Nothing to read; open_snapshot() already signaled the finished event
+				}
+				else if (dump_replay)
+				{
+					// Synchronous; the finished event is already signaled when this returns
+					(*dump_replay)(indices[i].get());
+				}
+				else if (stream_replay)
+				{
+					// Synchronous as well; returns once the writer has sent the last record
+					(*stream_replay)(indices[i].get());
+				}
+				else if (image_replay)
+				{
+					// Synchronous, like the dump replay
+					(*image_replay)(indices[i].get());
+				}
+				else
+				{
+					typedef OverlappedNtfsMftReadPayload T;
+					intrusive_ptr<T> p(new T(iocp, indices[i], closing_event));
+					iocp.post(0, static_cast<uintptr_t> (i), p);
+				}
 				pending.push_back(i);
 			}
 
@@ -547,6 +754,7 @@ int main(int argc, char* argv[])
 				HANDLE wait_handles[MAXIMUM_WAIT_OBJECTS];
 				unsigned int nwait_handles = 0;
 				intrusive_ptr<NtfsIndex> i;
+				bool early = false;
 				{
 					IoPriority
 						const raise_first_priority(*pending.begin(), set_priorities[*pending.begin()].old());
@@ -556,9 +764,15 @@ int main(int argc, char* argv[])
 					}
 
 					DWORD
-						const wait_result = WaitForMultipleObjects(nwait_handles, wait_handles, FALSE, INFINITE);
+						const wait_result = WaitForMultipleObjects(nwait_handles, wait_handles, FALSE, early_matches ? 100 : INFINITE);
 					CheckAndThrow(wait_result != WAIT_FAILED /*this is the only case in which we call GetLastError */);
-					if (wait_result >= WAIT_ABANDONED_0)
+					if (wait_result == WAIT_TIMEOUT)
+					{
+						// Still loading: print what each volume has matched so far, in turn
+						i = indices[pending[early_turn++ % pending.size()]];
+						early = true;
+					}
+					else if (wait_result >= WAIT_ABANDONED_0)
 					{
 						CppRaiseException(WAIT_ABANDONED);
 					}
@@ -579,6 +793,25 @@ int main(int argc, char* argv[])
 				OS << "Finished \tReading the MTF of " << rootstr << " in " << timelapsed1 << " seconds !\n\n" ;
 				lap = tend1; firstround = false; */
 
+				if (i && !early && !usn_events.empty() && !i->get_finished())
+				{
+					// Nothing searches the index yet, so no lock is needed
+					i->apply_usn_events(usn_events.data(), usn_events.size());
+				}
+
+				if (i && !early && !opts.saveIndexSnapshotFile.empty() && !i->get_finished())
+				{
+					try
+					{
+						i->save_snapshot(opts.saveIndexSnapshotFile.c_str());
+					}
+					catch (std::runtime_error& ex)
+					{
+						OS << "ERROR: Cannot save " << opts.saveIndexSnapshotFile << ": " << ex.what() << "\n";
+						return ERROR_WRITE_FAULT;
+					}
+				}
+
 				if (i)	// results of scan ... one at a time
 				{
 					std::tvstring
@@ -693,7 +926,10 @@ int main(int argc, char* argv[])
 					AttributesN  = L"Attributes";
 					NewLine      = L"\n";
 
-					i->matches([&](TCHAR
+					// Set while on_match() runs under the index lock; the caller writes the output afterwards
+					bool holding_lock = false;
+
+					auto const on_match = [&](TCHAR
 						const* const name2, size_t
 						const name_length, bool
 						const ascii, NtfsIndex::key_type
@@ -742,7 +978,7 @@ int main(int argc, char* argv[])
 										line_buffer += quote + ReparseN     + quote + sep;
 										line_buffer += quote + AttributesN  + quote + NewLine + NewLine;
 
-										flush_if_needed(line_buffer, false, &outHandle);
+										if (!holding_lock) flush_if_needed(line_buffer, false, &outHandle);
 
 										header = false;
 									}
@@ -822,7 +1058,7 @@ int main(int argc, char* argv[])
 
 									line_buffer += NewLine;
 
-									flush_if_needed(line_buffer, false, &outHandle);
+									if (!holding_lock) flush_if_needed(line_buffer, false, &outHandle);
 								}
 								else	// only SELECTED columns
 								{
@@ -956,7 +1192,7 @@ int main(int argc, char* argv[])
 										line_buffer.pop_back();
 										line_buffer += NewLine + NewLine;
 
-										flush_if_needed(line_buffer, false, &outHandle);
+										if (!holding_lock) flush_if_needed(line_buffer, false, &outHandle);
 
 										header = false;
 									}
@@ -991,17 +1227,18 @@ int main(int argc, char* argv[])
 										line_buffer += quote + sep;
 									}	//path only
 
+									// Only look the sizes up if printed; that keeps deferred totals deferred
 									NtfsIndex::size_info
-										const& sizeinfo = i->get_sizes(key);
+										const* const sizeinfo = output_columns_flags & (COL_SIZE | COL_SIZEONDISK | COL_DECENDENTS) ? &i->get_sizes(key) : nullptr;
 									if (output_columns_flags & COL_SIZE)
 									{
-										line_buffer += nformat(sizeinfo.length);
+										line_buffer += nformat(sizeinfo->length);
 										line_buffer += sep;
 									}
 
 									if (output_columns_flags & COL_SIZEONDISK)
 									{
-										line_buffer += nformat(sizeinfo.allocated);
+										line_buffer += nformat(sizeinfo->allocated);
 										line_buffer += sep;
 									}
 
@@ -1028,7 +1265,7 @@ int main(int argc, char* argv[])
 
 									if (output_columns_flags & COL_DECENDENTS)
 									{
-										line_buffer += nformat(static_cast<unsigned int> (sizeinfo.treesize));
+										line_buffer += nformat(static_cast<unsigned int> (sizeinfo->treesize));
 										line_buffer += sep;
 									}
 
@@ -1130,13 +1367,67 @@ int main(int argc, char* argv[])
 
 									line_buffer.pop_back();
 									line_buffer += NewLine;
-									flush_if_needed(line_buffer, false, &outHandle);
+									if (!holding_lock) flush_if_needed(line_buffer, false, &outHandle);
 								}	// else case of ALL check
 
 							}
 
 							return match || !(matchop.is_path_pattern && phigh_water_mark && *phigh_water_mark < name_length);
+						};
+
+					if (early)
+					{
+						// Only collect under the lock: the loaders wait on it in load()
+						struct EarlyMatch
+						{
+							NtfsIndex::key_type key;
+							size_t depth;
+							size_t name_begin;
+							size_t name_length;
+						};
+						std::vector<EarlyMatch> ready;
+						std::tvstring ready_names;
+						lock(i)->take_early_matches([&](TCHAR
+							const* const name2, size_t
+							const name_length, bool
+							const ascii, NtfsIndex::key_type
+							const& key, size_t
+							const depth)
+						{
+							EarlyMatch const match = { key, depth, ready_names.size(), name_length };
+							if (ascii)
+							{
+								char const* const chars = static_cast<char const*>(static_cast<void const*>(name2));
+								ready_names.insert(ready_names.end(), chars, chars + name_length);  // widened
+							}
+							else
+							{
+								ready_names.append(name2, name_length);
+							}
+							ready.push_back(match);
+						});
+
+						// Format each one under the lock, since load() may still grow what get_path() reads, and write it without
+						for (EarlyMatch const& match : ready)
+						{
+							{
+								lock_ptr<NtfsIndex> const locked(i.get());
+								holding_lock = true;
+								on_match(ready_names.data() + match.name_begin, match.name_length, false, match.key, match.depth);
+								holding_lock = false;
+							}
+							flush_if_needed(line_buffer, false, &outHandle);
+						}
+					}
+					else
+					{
+						i->matches([&](TCHAR const* const name2, size_t const name_length, bool const ascii,
+							NtfsIndex::key_type const& key, size_t const depth)
+						{
+							// Printed while loading; still descend into it
+							return i->matched_early(key.frs()) || on_match(name2, name_length, ascii, key, depth);
 						}, current_path, matchop.is_path_pattern, matchop.is_stream_pattern, match_attributes);
+					}
 
 					flush_if_needed(line_buffer, true, &outHandle);
 				}	// Any results (i)
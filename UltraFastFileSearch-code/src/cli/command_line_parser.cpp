@@ -45,6 +45,24 @@ void CommandLineParser::setupOptions(const std::string& diskDrives) {
     std::string drivesDesc = "Disk Drive(s) to search e.g. 'C:, D:' or any combination of ("
                             + diskDrives + ")\nDEFAULT: all disk drives";
     app_.add_option("--drives", opts_.drives, drivesDesc)->delimiter(',')->group("Search options");
+    app_.add_option("--index-from", opts_.indexFromFile,
+        "Search a UFFS-MFT dump file (from --dump-mft) instead of a live drive; '-' indexes a dump streamed on stdin, \\\\.\\pipe\\<name> one written to a new named pipe")->group("Search options");
+    app_.add_option("--index-image", opts_.indexImageFile,
+        "Search a raw NTFS volume image (e.g. from dd) instead of a live drive")->group("Search options");
+    app_.add_option("--index-image-offset", opts_.indexImageOffset,
+        "Byte offset of the NTFS volume within --index-image (partition start for whole-disk images)")->group("Search options");
+    app_.add_option("--index-snapshot", opts_.indexSnapshotFile,
+        "Search a saved index snapshot (from --save-index-snapshot) without reading the MFT")->group("Search options");
+    app_.add_option("--save-index-snapshot", opts_.saveIndexSnapshotFile,
+        "After indexing one drive (or --index-from, --index-image), save the index as a snapshot file")->group("Search options");
+    app_.add_flag("--verify-index-snapshot", opts_.verifyIndexSnapshot,
+        "Check every checksum of --index-snapshot before searching (reads the whole file)")->group("Search options");
+    app_.add_option("--usn-journal", opts_.usnJournalFile,
+        "Replay raw $UsnJrnl:$J data onto the index of one drive (or --index-from, --index-image) before searching")->group("Search options");
+    app_.add_flag("--no-streams", opts_.noStreams,
+        "Index files and directories only, not their alternate data streams and other attributes (uses less memory)")->group("Search options");
+    app_.add_flag("--pack-names", opts_.packNames,
+        "Keep file names compressed in memory and decode them while searching (less memory, slower searches)")->group("Search options");
 
     // Filter options
     app_.add_option("--ext", opts_.extensions,
@@ -79,7 +97,9 @@ void CommandLineParser::setupOptions(const std::string& diskDrives) {
     app_.add_option("--dump-mft", opts_.dumpMftDrive,
         "Dump raw MFT to file in UFFS-MFT format. Usage: --dump-mft=<drive_letter>")->group("Output options");
     app_.add_option("--dump-mft-out", opts_.dumpMftOutput,
-        "Output file path for raw MFT dump")->default_val("mft_dump.raw")->group("Output options");
+        "Output file path for raw MFT dump ('-' for stdout)")->default_val("mft_dump.raw")->group("Output options");
+    app_.add_flag("--dump-mft-compress", opts_.dumpMftCompress,
+        "Compress the raw MFT dump into LZ4 frames (decoded in parallel by --index-from)")->group("Output options");
     app_.add_option("--dump-extents", opts_.dumpExtentsDrive,
         "Dump MFT extent map as JSON. Usage: --dump-extents=<drive_letter>")->group("Output options");
     app_.add_option("--dump-extents-out", opts_.dumpExtentsOutput,
@@ -90,6 +110,22 @@ void CommandLineParser::setupOptions(const std::string& diskDrives) {
         "Benchmark MFT read speed (read-only). Usage: --benchmark-mft=<drive_letter>")->group("Output options");
     app_.add_option("--benchmark-index", opts_.benchmarkIndexDrive,
         "Benchmark full index build. Usage: --benchmark-index=<drive_letter>")->group("Output options");
+    app_.add_option("--benchmark-index-from", opts_.benchmarkIndexFile,
+        "Benchmark index build from a UFFS-MFT dump (no disk I/O). Usage: --benchmark-index-from=<file>")->group("Output options");
+    app_.add_option("--benchmark-names-from", opts_.benchmarkNamesFile,
+        "Compare names memory and search time with and without --pack-names on a UFFS-MFT dump. Usage: --benchmark-names-from=<file>")->group("Output options");
+    app_.add_option("--benchmark-width-from", opts_.benchmarkWidthFile,
+        "Compare the compact and the 64-bit index layouts on a UFFS-MFT dump. Usage: --benchmark-width-from=<file>")->group("Output options");
+    app_.add_option("--benchmark-refresh", opts_.benchmarkRefreshDrive,
+        "Benchmark an MFT re-scan that re-parses only changed chunks. Usage: --benchmark-refresh=<drive_letter>")->group("Output options");
+    app_.add_option("--generate-mft", opts_.generateMftOutput,
+        "Write a synthetic MFT in UFFS-MFT format (honors --dump-mft-compress). Usage: --generate-mft=<file> ('-' for stdout)")->group("Output options");
+    app_.add_option("--generate-mft-options", opts_.generateMftOptions,
+        "Synthetic MFT shape, e.g. 'records=10000000,fanout=32,shape=balanced,names=4..40,unicode=0.1,hardlinks=0.02,dos=0.3,ads=0.02,free=0.05,seed=7'")->group("Output options");
+    app_.add_option("--diff-mft", opts_.diffMftFiles,
+        "List records added, removed, renamed, moved, resized or retimed between two UFFS-MFT dumps of one volume. Usage: --diff-mft <before> <after>")->expected(2)->group("Output options");
+    app_.add_option("--diff-mft-out", opts_.diffMftOutput,
+        "Output file path for the --diff-mft CSV (default: stdout)")->default_val("")->group("Output options");
 }
 
 int CommandLineParser::parse(int argc, const char* const* argv) {
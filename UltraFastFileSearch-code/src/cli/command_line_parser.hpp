@@ -45,6 +45,15 @@ struct CommandLineOptions {
     // Search options
     std::string searchPath;
     std::vector<std::string> drives;
+    std::string indexFromFile;  // UFFS-MFT dump (file, "-" or named pipe) to search instead of a live drive
+    std::string indexImageFile;         // raw NTFS volume image to search instead of a live drive
+    uint64_t indexImageOffset = 0;      // byte offset of the volume within indexImageFile
+    std::string indexSnapshotFile;      // UFFS-IDX snapshot to search instead of building an index
+    std::string saveIndexSnapshotFile;  // write the built index to this UFFS-IDX file
+    bool verifyIndexSnapshot = false;   // verify section checksums when opening a snapshot
+    std::string usnJournalFile;         // raw $UsnJrnl:$J data to replay onto the built index
+    bool noStreams = false;             // index only unnamed $DATA and directories (NtfsIndex::kLoadNoStreams)
+    bool packNames = false;             // keep names in LZ4 blocks (NtfsIndex::kLoadPackedNames)
     
     // Filter options
     std::vector<std::string> extensions;
@@ -64,11 +73,20 @@ struct CommandLineOptions {
     // Diagnostic options
     std::string dumpMftDrive;
     std::string dumpMftOutput = "mft_dump.raw";
+    bool dumpMftCompress = false;
     std::string dumpExtentsDrive;
     std::string dumpExtentsOutput;
     bool verifyExtents = false;
     std::string benchmarkMftDrive;
     std::string benchmarkIndexDrive;
+    std::string benchmarkIndexFile;
+    std::string benchmarkNamesFile;
+    std::string benchmarkWidthFile;
+    std::string benchmarkRefreshDrive;
+    std::string generateMftOutput;
+    std::string generateMftOptions;
+    std::vector<std::string> diffMftFiles;  // two UFFS-MFT dumps: before, after
+    std::string diffMftOutput;
     
     // Metadata
     bool helpRequested = false;
@@ -8,6 +8,8 @@
 #include "mft_diagnostics.hpp"
 
 #include <windows.h>
+#include <fcntl.h>
+#include <io.h>
 #include <winioctl.h>
 #include <tchar.h>
 #include <cstdint>
@@ -19,64 +21,68 @@
 #include <iomanip>
 #include <sstream>
 #include <fstream>
+#include <iostream>
+#include <memory>
 
 // For get_retrieval_pointers
 #include "util/volume_utils.hpp"
 
+// For Handle
+#include "util/handle.hpp"
+
 // For std::tvstring
 #include "util/string_utils.hpp"
 
-namespace uffs {
+// For UffsMftHeader and UffsMftFrameWriter
+#include "io/uffs_mft_format.hpp"
+#include "io/uffs_mft_codec.hpp"
 
-// ============================================================================
-// UFFS-MFT Header structure (64 bytes)
-// ============================================================================
-#pragma pack(push, 1)
-struct UffsMftHeader {
-    char magic[8];           // "UFFS-MFT"
-    uint32_t version;        // 1
-    uint32_t flags;          // 0 = no compression
-    uint32_t record_size;    // e.g., 1024
-    uint64_t record_count;   // number of MFT records
-    uint64_t original_size;  // total bytes = record_size * record_count
-    uint64_t compressed_size;// 0 for uncompressed
-    uint8_t reserved[20];    // padding to 64 bytes
-};
-#pragma pack(pop)
-
-static_assert(sizeof(UffsMftHeader) == 64, "UffsMftHeader must be exactly 64 bytes");
+// For MftChunkReader and the bitmap-trimmed read plan
+#include "io/bitmap_utils.hpp"
+#include "io/mft_chunk_reader.hpp"
+#include "io/mft_read_plan.hpp"
+
+// For SyntheticMftGenerator
+#include "io/synthetic_mft.hpp"
+
+// For MftDumpDiff
+#include "io/mft_diff.hpp"
+
+namespace uffs {
 
 // ============================================================================
 // dump_raw_mft - Dump raw MFT to file in UFFS-MFT format
 // ============================================================================
-int dump_raw_mft(char drive_letter, const char* output_path, std::ostream& OS)
+int dump_raw_mft(char drive_letter, const char* output_path, bool compress, std::ostream& OS)
 {
     OS << "\n=== Raw MFT Dump Tool ===\n";
     OS << "Drive: " << drive_letter << ":\n";
-    OS << "Output: " << output_path << "\n\n";
+    OS << "Output: " << output_path << "\n";
+    OS << "Compression: " << (compress ? "LZ4 frames" : "none") << "\n\n";
 
     // Build volume path: \\.\X:
     std::wstring volume_path = L"\\\\.\\";
     volume_path += static_cast<wchar_t>(toupper(drive_letter));
     volume_path += L":";
 
-    // Open volume handle
-    HANDLE volume_handle = CreateFileW(
+    // Open volume handle; reads are overlapped so several stay in flight
+    HANDLE const volume_handle_value = CreateFileW(
         volume_path.c_str(),
         FILE_READ_DATA | FILE_READ_ATTRIBUTES | SYNCHRONIZE,
         FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
         nullptr,
         OPEN_EXISTING,
-        FILE_FLAG_NO_BUFFERING,
+        FILE_FLAG_NO_BUFFERING | FILE_FLAG_OVERLAPPED,
         nullptr
     );
 
-    if (volume_handle == INVALID_HANDLE_VALUE) {
+    if (volume_handle_value == INVALID_HANDLE_VALUE) {
         DWORD err = GetLastError();
         OS << "ERROR: Failed to open volume " << drive_letter << ": (error " << err << ")\n";
         OS << "Make sure you are running as Administrator.\n";
         return static_cast<int>(err);
     }
+    Handle const volume_handle(volume_handle_value);
 
     // Get NTFS volume data
     NTFS_VOLUME_DATA_BUFFER volume_data = {};
@@ -91,7 +97,6 @@ int dump_raw_mft(char drive_letter, const char* output_path, std::ostream& OS)
         nullptr
     )) {
         DWORD err = GetLastError();
-        CloseHandle(volume_handle);
         OS << "ERROR: Failed to get NTFS volume data (error " << err << ")\n";
         return static_cast<int>(err);
     }
@@ -103,29 +108,22 @@ int dump_raw_mft(char drive_letter, const char* output_path, std::ostream& OS)
     OS << "  MftValidDataLength: " << volume_data.MftValidDataLength.QuadPart << "\n";
     OS << "  MftStartLcn: " << volume_data.MftStartLcn.QuadPart << "\n\n";
 
-    // Build $MFT path for retrieval pointers
-    std::wstring mft_path = L"\\\\.\\";
-    mft_path += static_cast<wchar_t>(toupper(drive_letter));
-    mft_path += L":\\$MFT";
-
     // Get MFT extents using get_retrieval_pointers
     long long mft_size = 0;
     std::vector<std::pair<unsigned long long, long long>> ret_ptrs;
+    std::tstring mft_path_t;
+    mft_path_t = drive_letter;
+    mft_path_t += _T(":\\$MFT");
 
     try {
-        std::tstring mft_path_t;
-        mft_path_t = drive_letter;
-        mft_path_t += _T(":\\$MFT");
         ret_ptrs = get_retrieval_pointers(mft_path_t.c_str(), &mft_size,
             volume_data.MftStartLcn.QuadPart, volume_data.BytesPerFileRecordSegment);
     } catch (...) {
-        CloseHandle(volume_handle);
         OS << "ERROR: Failed to get MFT retrieval pointers\n";
         return ERROR_READ_FAULT;
     }
 
     if (ret_ptrs.empty()) {
-        CloseHandle(volume_handle);
         OS << "ERROR: No MFT extents found\n";
         return ERROR_READ_FAULT;
     }
@@ -135,145 +133,220 @@ int dump_raw_mft(char drive_letter, const char* output_path, std::ostream& OS)
 
     // Calculate record count
     uint32_t record_size = volume_data.BytesPerFileRecordSegment;
+    uint32_t cluster_size = volume_data.BytesPerCluster;
     uint64_t record_count = static_cast<uint64_t>(mft_size) / record_size;
     uint64_t total_bytes = record_count * record_size;
 
     OS << "Record Size: " << record_size << " bytes\n";
     OS << "Record Count: " << record_count << "\n";
-    OS << "Total Bytes to Write: " << total_bytes << "\n\n";
+    OS << "Total Bytes to Write: " << total_bytes << "\n";
 
-    // Open output file
-    HANDLE out_handle = CreateFileA(
-        output_path,
-        GENERIC_WRITE,
-        0,
-        nullptr,
-        CREATE_ALWAYS,
-        FILE_ATTRIBUTE_NORMAL,
-        nullptr
-    );
+    auto const start_time = std::chrono::high_resolution_clock::now();
+
+    // Read $MFT::$BITMAP the same way the indexer does, so that runs of
+    // unused records are not read. Without it every record is dumped.
+    std::vector<MftReadChunk> chunks = split_mft_extents(ret_ptrs, cluster_size, (total_bytes + cluster_size - 1) / cluster_size);
+    uint64_t records_in_use = record_count;
+    try {
+        long long bitmap_size = 0;
+        std::tstring bitmap_path_t = mft_path_t + _T("::$BITMAP");
+        std::vector<MftReadChunk> const bitmap_chunks = split_mft_extents(
+            get_retrieval_pointers(bitmap_path_t.c_str(), &bitmap_size,
+                volume_data.MftStartLcn.QuadPart, volume_data.BytesPerFileRecordSegment),
+            cluster_size, ~0ULL);
+
+        std::vector<unsigned char> bitmap(static_cast<size_t>(std::min<uint64_t>(bitmap_size, (record_count + 7) / 8)));
+        MftChunkReader bitmap_reader(volume_handle, cluster_size, bitmap_chunks);
+        for (MftChunkReader::Completed done; bitmap_reader.next(done);) {
+            uint64_t const offset = done.chunk->vcn * cluster_size;
+            if (offset < bitmap.size()) {
+                memcpy(&bitmap[static_cast<size_t>(offset)], done.data,
+                    static_cast<size_t>(std::min<uint64_t>(done.size, bitmap.size() - offset)));
+            }
+        }
+        if (record_count % 8 && bitmap.size() == (record_count + 7) / 8) {
+            bitmap.back() &= static_cast<unsigned char>((1U << (record_count % 8)) - 1);
+        }
 
-    if (out_handle == INVALID_HANDLE_VALUE) {
+        trim_unused_mft_records(chunks, bitmap, cluster_size, record_size);
+        records_in_use = bitmap_utils::count_bits_in_buffer(bitmap.data(), bitmap.size());
+    } catch (CStructured_Exception& ex) {
+        OS << "WARNING: Cannot read $MFT::$BITMAP (error " << ex.GetSENumber() << "), dumping every record\n";
+    } catch (std::exception&) {
+        OS << "WARNING: Cannot read $MFT::$BITMAP, dumping every record\n";
+    }
+
+    uint64_t bytes_to_read = 0;
+    for (MftReadChunk const& chunk : chunks) {
+        bytes_to_read += chunk.read_clusters() * cluster_size;
+    }
+    OS << "Records In Use: " << records_in_use << "\n";
+    OS << "Bytes to Read: " << bytes_to_read << " (unused records are written as zeros)\n\n";
+
+    // Open output file; "-" is stdout, e.g. to pipe the dump into --index-from=- on another host
+    Handle out_file;
+    HANDLE out_handle;
+    if (strcmp(output_path, "-") == 0) {
+        out_handle = GetStdHandle(STD_OUTPUT_HANDLE);
+    } else {
+        out_handle = CreateFileA(
+            output_path,
+            GENERIC_WRITE,
+            0,
+            nullptr,
+            CREATE_ALWAYS,
+            FILE_ATTRIBUTE_NORMAL,
+            nullptr
+        );
+        if (out_handle != INVALID_HANDLE_VALUE) {
+            Handle(out_handle).swap(out_file);
+        }
+    }
+
+    if (!Handle::valid(out_handle)) {
         DWORD err = GetLastError();
-        CloseHandle(volume_handle);
         OS << "ERROR: Failed to create output file (error " << err << ")\n";
         return static_cast<int>(err);
     }
 
-    // Write UFFS-MFT header
-    UffsMftHeader header = {};
-    memcpy(header.magic, "UFFS-MFT", 8);
-    header.version = 1;
-    header.flags = 0;  // No compression
-    header.record_size = record_size;
-    header.record_count = record_count;
-    header.original_size = total_bytes;
-    header.compressed_size = 0;
-    memset(header.reserved, 0, sizeof(header.reserved));
+    // Pipes cannot seek: no holes, no header patched at the end
+    bool const seekable = GetFileType(out_handle) == FILE_TYPE_DISK;
+
+    // Compressed dumps route record data through the parallel frame encoder,
+    // which encodes a batch of frames on worker threads while the next reads
+    // are still in flight. Uncompressed dumps leave unused records as holes
+    // of a sparse file (plain zeros if the file system cannot do sparse files).
+    UffsMftHeader header = make_uffs_mft_header(
+        record_size, record_count, static_cast<char>(toupper(drive_letter)));
+    std::unique_ptr<UffsMftFrameWriter> frame_writer;
+    if (compress) {
+        frame_writer.reset(new UffsMftFrameWriter(kUffsMftDefaultFrameSize, 0,
+            [out_handle](void const* data, size_t size) {
+                DWORD n = 0;
+                return WriteFile(out_handle, data, static_cast<DWORD>(size), &n, nullptr) && n == size;
+            }, !seekable));
+        if (!seekable) {
+            frame_writer->complete_header(header);  // frame prefixes instead of a frame index
+        }
+    } else if (seekable) {
+        (void)DeviceIoControl(out_handle, FSCTL_SET_SPARSE, nullptr, 0, nullptr, 0, &bytes_returned, nullptr);
+    }
 
+    // Write UFFS-MFT header (rewritten at the end for compressed files)
     DWORD written = 0;
     if (!WriteFile(out_handle, &header, sizeof(header), &written, nullptr) || written != sizeof(header)) {
         DWORD err = GetLastError();
-        CloseHandle(out_handle);
-        CloseHandle(volume_handle);
         OS << "ERROR: Failed to write header (error " << err << ")\n";
         return static_cast<int>(err);
     }
 
-    OS << "Reading MFT data...\n";
-
-    // Read MFT data extent by extent
     uint64_t bytes_written = 0;
-    uint64_t cluster_size = volume_data.BytesPerCluster;
-
-    // Allocate aligned read buffer (must be sector-aligned for FILE_FLAG_NO_BUFFERING)
-    size_t buffer_size = 1024 * 1024;  // 1MB buffer
-    // Align to sector size
-    buffer_size = (buffer_size / volume_data.BytesPerSector) * volume_data.BytesPerSector;
-    std::vector<unsigned char> read_buffer(buffer_size);
-
-    unsigned long long prev_vcn = 0;
-    for (size_t i = 0; i < ret_ptrs.size(); ++i) {
-        unsigned long long next_vcn = ret_ptrs[i].first;
-        long long lcn = ret_ptrs[i].second;
-
-        // Calculate cluster count for this extent
-        unsigned long long cluster_count = next_vcn - prev_vcn;
-        if (cluster_count == 0) continue;
-
-        // Calculate byte offset and length
-        long long byte_offset = lcn * static_cast<long long>(cluster_size);
-        unsigned long long byte_length = cluster_count * cluster_size;
-
-        // Read in chunks
-        unsigned long long extent_bytes_read = 0;
-        while (extent_bytes_read < byte_length && bytes_written < total_bytes) {
-            // Seek to position
-            LARGE_INTEGER seek_pos = {};
-            seek_pos.QuadPart = byte_offset + static_cast<long long>(extent_bytes_read);
-            if (!SetFilePointerEx(volume_handle, seek_pos, nullptr, FILE_BEGIN)) {
-                DWORD err = GetLastError();
-                CloseHandle(out_handle);
-                CloseHandle(volume_handle);
-                OS << "ERROR: Failed to seek (error " << err << ")\n";
-                return static_cast<int>(err);
-            }
-
-            // Calculate how much to read
-            unsigned long long remaining_in_extent = byte_length - extent_bytes_read;
-            unsigned long long remaining_total = total_bytes - bytes_written;
-            size_t to_read = static_cast<size_t>(std::min({
-                static_cast<unsigned long long>(buffer_size),
-                remaining_in_extent,
-                remaining_total
-            }));
-            // Align to sector size for reading
-            to_read = (to_read / volume_data.BytesPerSector) * volume_data.BytesPerSector;
-            if (to_read == 0) to_read = volume_data.BytesPerSector;
-
-            DWORD bytes_read = 0;
-            if (!ReadFile(volume_handle, read_buffer.data(), static_cast<DWORD>(to_read), &bytes_read, nullptr)) {
-                DWORD err = GetLastError();
-                CloseHandle(out_handle);
-                CloseHandle(volume_handle);
-                OS << "ERROR: Failed to read from volume (error " << err << ")\n";
-                return static_cast<int>(err);
-            }
+    auto const write_data = [&](void const* data, uint64_t size) -> bool {
+        size = std::min(size, total_bytes - bytes_written);
+        DWORD n = 0;
+        bool const ok = frame_writer
+            ? frame_writer->write(data, static_cast<size_t>(size))
+            : WriteFile(out_handle, data, static_cast<DWORD>(size), &n, nullptr) && n == size;
+        bytes_written += size;
+        return ok;
+    };
+    std::vector<unsigned char> const zeros(frame_writer || seekable ? 0 : 1 << 20);
+    auto const write_zeros = [&](uint64_t size) -> bool {
+        size = std::min(size, total_bytes - bytes_written);
+        LARGE_INTEGER distance = {};
+        distance.QuadPart = static_cast<long long>(size);
+        bool ok = frame_writer
+            ? frame_writer->write_zeros(size)
+            : !seekable || !!SetFilePointerEx(out_handle, distance, nullptr, FILE_CURRENT);
+        for (uint64_t left = zeros.empty() ? 0 : size; ok && left;) {
+            DWORD const n = static_cast<DWORD>(std::min<uint64_t>(left, zeros.size()));
+            DWORD done = 0;
+            ok = WriteFile(out_handle, zeros.data(), n, &done, nullptr) && done == n;
+            left -= n;
+        }
+        bytes_written += size;
+        return ok;
+    };
 
-            // Write to output (may need to trim to not exceed total_bytes)
-            size_t to_write = static_cast<size_t>(std::min(
-                static_cast<unsigned long long>(bytes_read),
-                total_bytes - bytes_written
-            ));
+    OS << "Reading MFT data...\n";
 
-            DWORD out_written = 0;
-            if (!WriteFile(out_handle, read_buffer.data(), static_cast<DWORD>(to_write), &out_written, nullptr)) {
+    uint64_t bytes_read = 0;
+    uint64_t next_progress = 100 * 1024 * 1024;
+    try {
+        MftChunkReader reader(volume_handle, cluster_size, chunks);
+        for (MftChunkReader::Completed done; reader.next(done) && bytes_written < total_bytes;) {
+            MftReadChunk const& chunk = *done.chunk;
+            bool const ok =
+                write_zeros(chunk.skip_begin * cluster_size) &&
+                write_data(done.data, done.size) &&
+                write_zeros(chunk.skip_end * cluster_size);
+            if (!ok) {
                 DWORD err = GetLastError();
-                CloseHandle(out_handle);
-                CloseHandle(volume_handle);
                 OS << "ERROR: Failed to write to output (error " << err << ")\n";
                 return static_cast<int>(err);
             }
 
-            bytes_written += out_written;
-            extent_bytes_read += bytes_read;
-
             // Progress indicator
-            if ((bytes_written % (100 * 1024 * 1024)) == 0) {
+            if (bytes_written >= next_progress) {
                 OS << "  Progress: " << (bytes_written / (1024 * 1024)) << " MB / "
                    << (total_bytes / (1024 * 1024)) << " MB\n";
+                next_progress += 100 * 1024 * 1024;
             }
         }
+        bytes_read = reader.bytes_read();
+    } catch (CStructured_Exception& ex) {
+        OS << "ERROR: Failed to read from volume (error " << ex.GetSENumber() << ")\n";
+        return static_cast<int>(ex.GetSENumber());
+    }
 
-        prev_vcn = next_vcn;
+    // Extents shorter than the valid data length: pad with unused records
+    if (!write_zeros(total_bytes - bytes_written)) {
+        DWORD err = GetLastError();
+        OS << "ERROR: Failed to write to output (error " << err << ")\n";
+        return static_cast<int>(err);
     }
 
-    CloseHandle(out_handle);
-    CloseHandle(volume_handle);
+    if (frame_writer) {
+        // Flush the last batch and append the frame index, then patch the header
+        // (a streamed file has neither: its frames carry their own sizes)
+        bool ok = frame_writer->finish();
+        if (ok && seekable) {
+            frame_writer->complete_header(header);
+            LARGE_INTEGER file_start = {};
+            ok = SetFilePointerEx(out_handle, file_start, nullptr, FILE_BEGIN) &&
+                 WriteFile(out_handle, &header, sizeof(header), &written, nullptr) &&
+                 written == sizeof(header);
+        }
+        if (!ok) {
+            DWORD err = GetLastError();
+            OS << "ERROR: Failed to finish compressed output (error " << err << ")\n";
+            return static_cast<int>(err);
+        }
+    } else if (seekable && !SetEndOfFile(out_handle)) {
+        // A trailing hole only exists once the end of file is moved past it
+        DWORD err = GetLastError();
+        OS << "ERROR: Failed to set the output size (error " << err << ")\n";
+        return static_cast<int>(err);
+    }
+
+    auto const elapsed = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start_time).count();
 
     OS << "\n=== Dump Complete ===\n";
     OS << "Total extents: " << ret_ptrs.size() << "\n";
     OS << "Total bytes written: " << bytes_written << "\n";
+    OS << "Bytes read from volume: " << bytes_read << " ("
+       << std::fixed << std::setprecision(1)
+       << (bytes_written ? 100.0 * static_cast<double>(bytes_read) / static_cast<double>(bytes_written) : 0.0)
+       << "%)\n";
+    if (frame_writer) {
+        uint64_t const compressed_size = frame_writer->compressed_size();
+        OS << "Compressed size: " << compressed_size << " bytes in "
+           << frame_writer->frames().size() << " frames ("
+           << std::fixed << std::setprecision(1)
+           << (compressed_size ? static_cast<double>(bytes_written) / compressed_size : 0.0)
+           << "x)\n";
+    }
+    OS << "Time elapsed: " << std::fixed << std::setprecision(3) << elapsed << " seconds\n";
     OS << "Record count: " << record_count << "\n";
     OS << "Output file: " << output_path << "\n";
 
@@ -711,4 +784,192 @@ int benchmark_mft_read(char drive_letter, std::ostream& OS)
     return 0;
 }
 
+// ============================================================================
+// generate_synthetic_mft - Write a synthetic MFT in UFFS-MFT format
+// ============================================================================
+int generate_synthetic_mft(const char* output_path, const char* options, bool compress, std::ostream& OS)
+{
+    OS << "\n=== Synthetic MFT Generator ===\n";
+
+    SyntheticMftOptions parsed;
+    char const* error = parse_synthetic_mft_options(options ? options : "", parsed);
+    if (!error) {
+        error = validate_synthetic_mft_options(parsed);
+    }
+    if (error) {
+        OS << "ERROR: Invalid --generate-mft-options: " << error << "\n";
+        return ERROR_BAD_ARGUMENTS;
+    }
+
+    SyntheticMftGenerator const generator(parsed);
+    OS << "Output: " << output_path << "\n";
+    OS << "Records: " << generator.record_count() << " x " << generator.record_size() << " bytes ("
+       << generator.directory_count() << " directories, "
+       << (parsed.shape == SyntheticTreeShape::Balanced ? "balanced" : "random") << " tree, fanout "
+       << parsed.fanout << ")\n";
+    OS << "Seed: " << parsed.seed << "\n";
+    OS << "Compression: " << (compress ? "LZ4 frames" : "none") << "\n\n";
+
+    // "-" is stdout, switched to binary so that no CR is inserted before LF bytes
+    std::ofstream file;
+    bool const to_stdout = strcmp(output_path, "-") == 0;
+    if (to_stdout) {
+        fflush(stdout);
+        (void)_setmode(_fileno(stdout), _O_BINARY);
+    } else {
+        file.open(output_path, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            OS << "ERROR: Failed to create output file: " << output_path << "\n";
+            return ERROR_OPEN_FAILED;
+        }
+    }
+    std::ostream& out = to_stdout ? std::cout : file;
+
+    auto const start = std::chrono::high_resolution_clock::now();
+    uint64_t const progress_step = std::max<uint64_t>(generator.record_count() / 10, 1);
+    uint64_t next_progress = progress_step;
+    bool const ok = write_synthetic_uffs_mft(generator, out, compress, 0, [&](uint64_t done) {
+        if (done >= next_progress) {
+            OS << "  Progress: " << done << " / " << generator.record_count() << " records\n";
+            next_progress = done - done % progress_step + progress_step;
+        }
+    });
+    if (to_stdout) {
+        out.flush();
+    } else {
+        file.close();
+    }
+    if (!ok || out.fail()) {
+        OS << "ERROR: Failed to write to output: " << output_path << "\n";
+        return ERROR_WRITE_FAULT;
+    }
+
+    auto const elapsed = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    OS << "\n=== Generation Complete ===\n";
+    OS << "Total bytes: " << generator.record_count() * generator.record_size() << "\n";
+    OS << "Time: " << std::fixed << std::setprecision(2) << elapsed << " s\n";
+    OS << "Output file: " << output_path << "\n";
+    OS << "Index it with: --benchmark-index-from=" << output_path << "\n";
+
+    return 0;
+}
+
+// ============================================================================
+// diff_mft_dumps - Record-level differences between two UFFS-MFT dumps
+// ============================================================================
+static std::string mft_diff_csv_name(MftRecordSummary const& summary)
+{
+    // First link only; hard links are listed in FRS order of their parents
+    if (summary.links.empty()) {
+        return std::string();
+    }
+    std::u16string const& name = summary.links.front().name;
+    std::string utf8((name.size() + 1) * 3, '\0');
+    int const cch = name.empty() ? 0 : WideCharToMultiByte(CP_UTF8, 0,
+        reinterpret_cast<wchar_t const*>(name.data()), static_cast<int>(name.size()),
+        &utf8[0], static_cast<int>(utf8.size()), nullptr, nullptr);
+    utf8.resize(static_cast<size_t>(cch));
+
+    std::string quoted = "\"";
+    for (char const c : utf8) {
+        quoted += c;
+        if (c == '"') {
+            quoted += '"';
+        }
+    }
+    return quoted + "\"";
+}
+
+static std::string mft_diff_csv_time(MftRecordSummary const& summary)
+{
+    FILETIME ft;
+    SYSTEMTIME st;
+    ft.dwLowDateTime = static_cast<DWORD>(summary.modified);
+    ft.dwHighDateTime = static_cast<DWORD>(static_cast<uint64_t>(summary.modified) >> 32);
+    if (!summary.has_times || !FileTimeToSystemTime(&ft, &st)) {
+        return std::string();
+    }
+    char text[32];
+    sprintf_s(text, "%04u-%02u-%02uT%02u:%02u:%02uZ", st.wYear, st.wMonth, st.wDay, st.wHour, st.wMinute, st.wSecond);
+    return text;
+}
+
+int diff_mft_dumps(const char* before_path, const char* after_path, const char* output_path, std::ostream& OS)
+{
+    OS << "\n=== MFT Diff ===\n";
+    OS << "Before: " << before_path << "\n";
+    OS << "After: " << after_path << "\n";
+
+    std::unique_ptr<MftDumpDiff> diff;
+    try {
+        diff.reset(new MftDumpDiff(before_path, after_path));
+    } catch (std::runtime_error& ex) {
+        OS << "ERROR: Cannot diff dumps: " << ex.what() << "\n";
+        return ERROR_BAD_FORMAT;
+    }
+
+    std::ofstream out_file;
+    if (output_path && *output_path) {
+        out_file.open(output_path, std::ios::binary | std::ios::trunc);
+        if (!out_file) {
+            OS << "ERROR: Failed to create output file: " << output_path << "\n";
+            return ERROR_OPEN_FAILED;
+        }
+    }
+    std::ostream& out = out_file.is_open() ? static_cast<std::ostream&>(out_file) : OS;
+
+    auto const start = std::chrono::high_resolution_clock::now();
+    std::vector<MftDiffEntry> entries;
+    MftDiffStats stats;
+    try {
+        stats = (*diff)(entries);
+    } catch (std::runtime_error& ex) {
+        OS << "ERROR: " << ex.what() << "\n";
+        return ERROR_INVALID_DATA;
+    }
+    auto const elapsed = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+    static char const* const change_names[] = { "added", "removed", "renamed", "moved", "resized", "retimed" };
+    out << "FRS,Change,Parent,Name,Old Parent,Old Name,Size,Old Size,Modified,Old Modified\n";
+    for (MftDiffEntry const& entry : entries) {
+        std::string change;
+        for (size_t bit = 0; bit < sizeof(change_names) / sizeof(*change_names); ++bit) {
+            if (entry.changes & (1U << bit)) {
+                change += change.empty() ? "" : "|";
+                change += change_names[bit];
+            }
+        }
+
+        MftRecordSummary const& after = entry.after;
+        MftRecordSummary const& before = entry.before;
+        auto const parent = [](MftRecordSummary const& summary) {
+            return summary.links.empty() ? std::string() : std::to_string(summary.links.front().parent);
+        };
+        auto const size = [](MftRecordSummary const& summary) {
+            return summary.has_size ? std::to_string(summary.size) : std::string();
+        };
+        out << entry.frs << ',' << change << ','
+            << parent(after) << ',' << mft_diff_csv_name(after) << ','
+            << parent(before) << ',' << mft_diff_csv_name(before) << ','
+            << size(after) << ',' << size(before) << ','
+            << mft_diff_csv_time(after) << ',' << mft_diff_csv_time(before) << '\n';
+    }
+    out.flush();
+    if (out_file.is_open() && out_file.fail()) {
+        OS << "ERROR: Failed to write to output: " << output_path << "\n";
+        return ERROR_WRITE_FAULT;
+    }
+
+    OS << "\n=== Diff Complete ===\n";
+    OS << "Records: " << stats.records << " (" << stats.free << " free in both, "
+       << stats.identical << " identical, " << stats.decoded << " decoded)\n";
+    OS << "Changed files: " << entries.size() << "\n";
+    OS << "Time: " << std::fixed << std::setprecision(2) << elapsed << " s\n";
+    if (out_file.is_open()) {
+        OS << "Output file: " << output_path << "\n";
+    }
+
+    return 0;
+}
+
 } // namespace uffs
@@ -4,8 +4,11 @@
 // These functions provide diagnostic and benchmarking capabilities for NTFS MFT.
 //
 // Implementations:
-// - dump_raw_mft, dump_mft_extents, benchmark_mft_read: mft_diagnostics.cpp
-// - benchmark_index_build: UltraFastFileSearch.cpp (depends on NtfsIndex)
+// - dump_raw_mft, dump_mft_extents, benchmark_mft_read, generate_synthetic_mft,
+//   diff_mft_dumps: mft_diagnostics.cpp
+// - benchmark_index_build, benchmark_index_from_dump, benchmark_names_from_dump,
+//   benchmark_width_from_dump:
+//   benchmark.hpp (depends on NtfsIndex)
 // ============================================================================
 
 #pragma once
@@ -20,12 +23,18 @@ namespace uffs {
 /**
  * @brief Dump raw MFT to file in UFFS-MFT format
  * 
+ * Several overlapped reads are kept in flight, and clusters holding only
+ * records marked unused in $MFT::$BITMAP are not read: they become zeros
+ * (holes of a sparse file when uncompressed).
+ * 
  * @param drive_letter The drive letter (e.g., 'C')
- * @param output_path Path to output file (or "console" for stdout)
+ * @param output_path Path to output file, or "-" for stdout (streamed layout,
+ *                    see uffs_mft_format.hpp; status then belongs on stderr)
+ * @param compress Write independently decodable LZ4 frames plus a frame index
  * @param OS Output stream for status messages
  * @return 0 on success, error code on failure
  */
-int dump_raw_mft(char drive_letter, const char* output_path, std::ostream& OS);
+int dump_raw_mft(char drive_letter, const char* output_path, bool compress, std::ostream& OS);
 
 /**
  * @brief Dump MFT extents as JSON for diagnostic purposes
@@ -47,6 +56,28 @@ int dump_mft_extents(char drive_letter, const char* output_path, bool verify_ext
  */
 int benchmark_mft_read(char drive_letter, std::ostream& OS);
 
+/**
+ * @brief Write a synthetic MFT in UFFS-MFT format
+ * 
+ * @param output_path Path to output file, or "-" for stdout
+ * @param options Comma-separated generator options (see parse_synthetic_mft_options)
+ * @param compress Write independently decodable LZ4 frames plus a frame index
+ * @param OS Output stream for status messages
+ * @return 0 on success, error code on failure
+ */
+int generate_synthetic_mft(const char* output_path, const char* options, bool compress, std::ostream& OS);
+
+/**
+ * @brief Write the record-level differences between two UFFS-MFT dumps as CSV
+ * 
+ * @param before_path Older dump of the volume
+ * @param after_path Newer dump of the same volume
+ * @param output_path Path to output file (empty for stdout)
+ * @param OS Output stream for status messages
+ * @return 0 on success, error code on failure
+ */
+int diff_mft_dumps(const char* before_path, const char* after_path, const char* output_path, std::ostream& OS);
+
 /**
  * @brief Benchmark full index building using the real UFFS async pipeline
  * 
@@ -56,13 +87,45 @@ int benchmark_mft_read(char drive_letter, std::ostream& OS);
  */
 int benchmark_index_build(char drive_letter, std::ostream& OS);
 
+/**
+ * @brief Benchmark index building from a UFFS-MFT dump (no disk I/O)
+ * 
+ * @param dump_path Path to a file written by dump_raw_mft
+ * @param OS Output stream for status messages
+ * @return 0 on success, error code on failure
+ */
+int benchmark_index_from_dump(const char* dump_path, std::ostream& OS);
+
+/**
+ * @brief Compare names memory and search time with and without packed names
+ * 
+ * @param dump_path Path to a file written by dump_raw_mft
+ * @param OS Output stream for status messages
+ * @return 0 on success, error code on failure
+ */
+int benchmark_names_from_dump(const char* dump_path, std::ostream& OS);
+
+/**
+ * @brief Compare the compact index layout with the 64-bit one of HugeNtfsIndex
+ * 
+ * @param dump_path Path to a file written by dump_raw_mft or generate_synthetic_mft
+ * @param OS Output stream for status messages
+ * @return 0 on success, error code on failure
+ */
+int benchmark_width_from_dump(const char* dump_path, std::ostream& OS);
+
 } // namespace uffs
 
 // Expose at global scope for backward compatibility
 using uffs::dump_raw_mft;
 using uffs::dump_mft_extents;
 using uffs::benchmark_mft_read;
+using uffs::generate_synthetic_mft;
+using uffs::diff_mft_dumps;
 using uffs::benchmark_index_build;
+using uffs::benchmark_index_from_dump;
+using uffs::benchmark_names_from_dump;
+using uffs::benchmark_width_from_dump;
 
 #endif // UFFS_MFT_DIAGNOSTICS_HPP
 
@@ -38,6 +38,17 @@
  * By packing these into bitfields, we reduce memory usage significantly when
  * storing millions of search result keys.
  *
+ * ## Wide Keys
+ *
+ * The key is a template on the word the three small fields share.
+ * key_type_internal is the 32-bit word above; HugeNtfsIndex uses a 64-bit
+ * word, a 12-byte key with room for many more results indices:
+ *
+ * | Word   | name_info | stream_info | index   | Size     |
+ * |--------|-----------|-------------|---------|----------|
+ * | 32-bit | 10 bits   | 13 bits     | 9 bits  | 8 bytes  |
+ * | 64-bit | 16 bits   | 24 bits     | 24 bits | 12 bytes |
+ *
  * ## Sentinel Values
  *
  * All-1s in a bitfield indicates "invalid" or "not set":
@@ -68,6 +79,7 @@
 #define UFFS_NTFS_KEY_TYPE_HPP
 
 #include <climits>
+#include <type_traits>
 #include "io/overlapped.hpp"  // for negative_one
 
 namespace uffs {
@@ -84,27 +96,30 @@ namespace uffs {
  * The key supports comparison for equality, allowing efficient lookup in
  * hash tables or sorted containers.
  *
- * @note This struct is packed to exactly 8 bytes with no padding.
+ * @tparam Word  Word the small fields share: unsigned int, or unsigned long long for HugeNtfsIndex
+ * @note The 32-bit key is packed to exactly 8 bytes with no padding.
  * @note All-1s values in bitfields are treated as "invalid" sentinels.
  */
-struct key_type_internal
+template <class Word>
+struct basic_key_type_internal
 {
 	// ========================================================================
 	// Bitfield Size Constants
 	// ========================================================================
 	// These constants define the bit allocation for each packed field.
-	// The total must equal 32 bits (sizeof(unsigned int) * CHAR_BIT).
+	// The total must equal the bits of Word.
 	//
-	// Allocation:
+	// Allocation (32-bit word):
 	//   name_info:   10 bits -> max 1023 hardlinks (all-1s = sentinel)
 	//   stream_info: 13 bits -> max 8191 streams (all-1s = sentinel)
 	//   index:        9 bits -> max 511 results per batch (all-1s = sentinel)
+	// A 64-bit word gives them 16, 24 and 24 bits.
 	// ========================================================================
 	enum
 	{
-		name_info_bits = 10,   ///< Bits for hardlink name index (max 1023)
-		stream_info_bits = 13, ///< Bits for stream index (max 8191)
-		index_bits = sizeof(unsigned int) * CHAR_BIT - (name_info_bits + stream_info_bits) ///< Remaining bits for result index (9 bits = max 511)
+		name_info_bits = sizeof(Word) > sizeof(unsigned int) ? 16 : 10,   ///< Bits for hardlink name index (max 1023)
+		stream_info_bits = sizeof(Word) > sizeof(unsigned int) ? 24 : 13, ///< Bits for stream index (max 8191)
+		index_bits = sizeof(Word) * CHAR_BIT - (name_info_bits + stream_info_bits) ///< Remaining bits for result index (9 bits = max 511)
 	};
 
 	// ========================================================================
@@ -112,8 +127,10 @@ struct key_type_internal
 	// ========================================================================
 	typedef unsigned int frs_type;         ///< File Record Segment number (32-bit)
 	typedef unsigned short name_info_type; ///< Hardlink name index
-	typedef unsigned short stream_info_type; ///< Alternate data stream index
-	typedef unsigned short index_type;     ///< Search result index
+	typedef typename std::conditional<(stream_info_bits > 16), unsigned int, unsigned short>::type
+		stream_info_type;                  ///< Alternate data stream index
+	typedef typename std::conditional<(index_bits > 16), unsigned int, unsigned short>::type
+		index_type;                        ///< Search result index
 
 	// ========================================================================
 	// Accessors
@@ -146,7 +163,7 @@ struct key_type_internal
 	 * @return Index into the file's stream list, or ~0 if invalid/sentinel
 	 * @note Returns ~0 (all bits set) if the stored value is the sentinel
 	 */
-	[[nodiscard]] name_info_type stream_info() const noexcept
+	[[nodiscard]] stream_info_type stream_info() const noexcept
 	{
 		stream_info_type const result = this->_stream_info;
 		// If all bits are set (sentinel), return ~0 for the full type
@@ -155,9 +172,9 @@ struct key_type_internal
 
 	/**
 	 * @brief Set the alternate data stream index
-	 * @param value The stream index to store (will be truncated to 13 bits)
+	 * @param value The stream index to store (will be truncated to stream_info_bits)
 	 */
-	void stream_info(name_info_type const value) noexcept
+	void stream_info(stream_info_type const value) noexcept
 	{
 		this->_stream_info = value;
 	}
@@ -176,9 +193,9 @@ struct key_type_internal
 
 	/**
 	 * @brief Set the search result index
-	 * @param value The result index to store (will be truncated to 9 bits)
+	 * @param value The result index to store (will be truncated to index_bits)
 	 */
-	void index(name_info_type const value) noexcept
+	void index(index_type const value) noexcept
 	{
 		this->_index = value;
 	}
@@ -194,7 +211,7 @@ struct key_type_internal
 	 * @param stream_info Index of the data stream (0 for main $DATA stream)
 	 * @note The result index is initialized to sentinel (~0 = not indexed)
 	 */
-	explicit key_type_internal(
+	explicit basic_key_type_internal(
 		frs_type const frs,
 		name_info_type const name_info,
 		stream_info_type const stream_info) noexcept
@@ -210,7 +227,7 @@ struct key_type_internal
 	 * @return true if FRS, name_info, and stream_info all match
 	 * @note The index field is NOT compared (it's result-specific)
 	 */
-	[[nodiscard]] bool operator==(key_type_internal const& other) const noexcept
+	[[nodiscard]] bool operator==(basic_key_type_internal const& other) const noexcept
 	{
 		return this->_frs == other._frs &&
 		       this->_name_info == other._name_info &&
@@ -221,17 +238,24 @@ private:
 	// ========================================================================
 	// Data Members (packed, no padding)
 	// ========================================================================
+	// The fields of the 32-bit key are declared unsigned short, as they always were
+	typedef typename std::conditional<(sizeof(Word) > sizeof(unsigned int)), Word, unsigned short>::type field_type;
+
 	frs_type _frs;                            ///< File Record Segment number (4 bytes)
-	name_info_type _name_info : name_info_bits;     ///< Hardlink name index (10 bits)
-	stream_info_type _stream_info : stream_info_bits; ///< Stream index (13 bits)
-	index_type _index : index_bits;           ///< Result index (9 bits)
+	field_type _name_info : name_info_bits;     ///< Hardlink name index (10 bits)
+	field_type _stream_info : stream_info_bits; ///< Stream index (13 bits)
+	field_type _index : index_bits;           ///< Result index (9 bits)
 };
 
 #pragma pack(pop)
 
+/// The compact key, NtfsIndex's.
+typedef basic_key_type_internal<unsigned int> key_type_internal;
+
 } // namespace uffs
 
 // Backward compatibility
+using uffs::basic_key_type_internal;
 using uffs::key_type_internal;
 
 #endif // UFFS_NTFS_KEY_TYPE_HPP
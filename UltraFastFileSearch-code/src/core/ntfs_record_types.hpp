@@ -19,10 +19,14 @@
  * │  ┌─────────────────────────────────────────────────────────────┐   │
  * │  │ records_data: vector<Record>                                 │   │
  * │  │   [0] Record ──┬── first_name ──► LinkInfo ──► LinkInfo     │   │
- * │  │   [1] Record   │   first_stream ──► StreamInfo ──► ...      │   │
- * │  │   ...          │   first_child ──► (index into childinfos)  │   │
+ * │  │   [1] Record   │   first_child ──► (index into childinfos)  │   │
+ * │  │   ...          │                                            │   │
  * │  └────────────────┴────────────────────────────────────────────┘   │
  * │  ┌─────────────────────────────────────────────────────────────┐   │
+ * │  │ first_streams, timestamps: one entry per record slot         │   │
+ * │  │   first_streams[slot] ──► StreamInfo ──► ...                 │   │
+ * │  └─────────────────────────────────────────────────────────────┘   │
+ * │  ┌─────────────────────────────────────────────────────────────┐   │
  * │  │ childinfos: vector<ChildInfo>                                │   │
  * │  │   Linked list of directory children                          │   │
  * │  └─────────────────────────────────────────────────────────────┘   │
@@ -32,7 +36,7 @@
  * │  └─────────────────────────────────────────────────────────────┘   │
  * │  ┌─────────────────────────────────────────────────────────────┐   │
  * │  │ streaminfos: vector<StreamInfo>                              │   │
- * │  │   Additional streams (beyond first_stream)                   │   │
+ * │  │   Additional streams (beyond the first)                      │   │
  * │  └─────────────────────────────────────────────────────────────┘   │
  * │  ┌─────────────────────────────────────────────────────────────┐   │
  * │  │ names: vector<char>                                          │   │
@@ -50,15 +54,22 @@
  *
  * ## Memory Layout
  *
- * All structures use `#pragma pack(push, 1)` to eliminate padding:
+ * All structures use `#pragma pack(push, 1)` to eliminate padding. Every
+ * type that holds a list index or a name offset is a template on the
+ * integer type of both (its index width); NameInfo, LinkInfo... are the
+ * compact 32-bit layout, which NtfsIndex uses. HugeNtfsIndex uses the
+ * 64-bit layout, for volumes whose names outgrow 31-bit offsets:
+ *
+ * | Struct     | 32-bit  | 64-bit  | Description                      |
+ * |------------|---------|---------|----------------------------------|
+ * | NameInfo   | 5 bytes | 9 bytes | Offset into names buffer + length|
+ * | LinkInfo   | 13 bytes| 21 bytes| Hardlink: next + name + parent   |
+ * | StreamInfo | 17 bytes| 25 bytes| ADS: size info + next + name     |
+ * | ChildInfo  | 10 bytes| 14 bytes| Directory child: next + FRS + idx|
+ * | Record     | 25 bytes| 37 bytes| Attributes, list heads, 1st name |
+ * | RecordTimes| 24 bytes| 24 bytes| Timestamps, in a column of their own |
  *
- * | Struct     | Size   | Description                              |
- * |------------|--------|------------------------------------------|
- * | NameInfo   | 5 bytes| Offset into names buffer + length        |
- * | LinkInfo   | 13 bytes| Hardlink: next + name + parent FRS      |
- * | StreamInfo | 17 bytes| ADS: size info + next + name + flags    |
- * | ChildInfo  | 10 bytes| Directory child: next + FRS + name idx  |
- * | Record     | 51 bytes| Full MFT record representation          |
+ * FRS numbers stay 32 bits in either layout.
  *
  * @see NtfsIndex - The main index class that uses these structures
  * @see StandardInfo - File timestamps and attributes
@@ -97,27 +108,34 @@ struct small_t
  * @details
  * Stores a reference to a filename in the packed names buffer.
  * Uses bit-packing to store both the offset and an ASCII flag in a single
- * 4-byte integer:
+ * integer of the index width:
  *
  * ```
- * _offset layout (32 bits):
+ * _offset layout (32 bits; 64 bits in the wide layout):
  * ┌────────────────────────────────────────────────────────┬───┐
- * │                    offset (31 bits)                    │ A │
+ * │                    offset (31 or 63 bits)              │ A │
  * └────────────────────────────────────────────────────────┴───┘
  *                                                           └── ASCII flag (1 bit)
  * ```
  *
  * - **Bit 0**: ASCII flag (1 = ASCII, 0 = UTF-16)
- * - **Bits 1-31**: Offset into the names buffer (divided by 2)
+ * - **Bits 1 and up**: Offset into the names buffer, in buffer elements
  *
  * The `length` field stores the character count (not byte count).
  * For ASCII names, byte count = length. For UTF-16, byte count = length * 2.
  *
+ * @tparam Index  Integer type of offsets: unsigned int, or unsigned long long for huge volumes
  * @note Offset of ~0 (all bits set) indicates "no name" / invalid.
  */
-struct NameInfo
+template <class Index>
+struct BasicNameInfo
 {
-	small_t<size_t>::type _offset; ///< Packed offset (bits 1-31) + ASCII flag (bit 0)
+	typedef Index offset_type;
+
+	/// Largest offset a name can have; the next one up is the "no name" sentinel.
+	static constexpr Index max_offset = (static_cast<Index>(~Index()) >> 1) - 1;
+
+	Index _offset; ///< Packed offset (bits 1 and up) + ASCII flag (bit 0)
 
 	/**
 	 * @brief Check if the name is stored as ASCII
@@ -134,21 +152,21 @@ struct NameInfo
 	 */
 	void ascii(bool const value) noexcept
 	{
-		this->_offset = static_cast<small_t<size_t>::type>(
-			(this->_offset & static_cast<small_t<size_t>::type>(~static_cast<small_t<size_t>::type>(1U))) |
-			(value ? 1U : small_t<size_t>::type()));
+		this->_offset = static_cast<Index>(
+			(this->_offset & static_cast<Index>(~static_cast<Index>(1U))) |
+			(value ? 1U : Index()));
 	}
 
 	/**
 	 * @brief Get the offset into the names buffer
 	 * @return Byte offset, or ~0 if invalid/no name
 	 */
-	[[nodiscard]] small_t<size_t>::type offset() const noexcept
+	[[nodiscard]] Index offset() const noexcept
 	{
-		small_t<size_t>::type result = this->_offset >> 1;
-		if (result == (static_cast<small_t<size_t>::type>(negative_one) >> 1))
+		Index result = this->_offset >> 1;
+		if (result == (static_cast<Index>(negative_one) >> 1))
 		{
-			result = static_cast<small_t<size_t>::type>(negative_one);
+			result = static_cast<Index>(negative_one);
 		}
 		return result;
 	}
@@ -157,9 +175,9 @@ struct NameInfo
 	 * @brief Set the offset into the names buffer
 	 * @param value Byte offset (will be shifted left by 1 to preserve ASCII flag)
 	 */
-	void offset(small_t<size_t>::type const value) noexcept
+	void offset(Index const value) noexcept
 	{
-		this->_offset = (value << 1) | (this->_offset & 1U);
+		this->_offset = static_cast<Index>((value << 1) | (this->_offset & 1U));
 	}
 
 	unsigned char length; ///< Character count (not byte count)
@@ -186,19 +204,20 @@ struct NameInfo
  * @note `next_entry = ~0` indicates end of list
  * @note `name.offset() = ~0` indicates no name (invalid entry)
  */
-struct LinkInfo
+template <class Index>
+struct BasicLinkInfo
 {
 	/**
 	 * @brief Default constructor - initializes to "no link" state
 	 */
-	LinkInfo() noexcept : next_entry(negative_one)
+	BasicLinkInfo() noexcept : next_entry(negative_one)
 	{
 		this->name.offset(negative_one);
 	}
 
-	typedef small_t<size_t>::type next_entry_type;
+	typedef Index next_entry_type;
 	next_entry_type next_entry; ///< Index of next LinkInfo, or ~0 for end of list
-	NameInfo name;              ///< Reference to filename in names buffer
+	BasicNameInfo<Index> name;  ///< Reference to filename in names buffer
 	unsigned int parent;        ///< FRS number of parent directory
 };
 
@@ -215,7 +234,7 @@ struct LinkInfo
  * Streams form a linked list via `next_entry`:
  *
  * ```
- * Record.first_stream ──► StreamInfo ──► StreamInfo ──► ... ──► (next_entry = ~0)
+ * first_streams[slot] ──► StreamInfo ──► StreamInfo ──► ... ──► (next_entry = ~0)
  *                            │              │
  *                            ▼              ▼
  *                          name           name
@@ -226,16 +245,17 @@ struct LinkInfo
  * @note The main $DATA stream typically has an empty name
  * @note `type_name_id = 0` for $I30:$INDEX_ROOT or $I30:$INDEX_ALLOCATION
  */
-struct StreamInfo : SizeInfo
+template <class Index>
+struct BasicStreamInfo : SizeInfo
 {
 	/**
 	 * @brief Default constructor - initializes to empty stream
 	 */
-	StreamInfo() noexcept : SizeInfo(), next_entry(), name(), type_name_id() {}
+	BasicStreamInfo() noexcept : SizeInfo(), next_entry(), name(), type_name_id() {}
 
-	typedef small_t<size_t>::type next_entry_type;
+	typedef Index next_entry_type;
 	next_entry_type next_entry; ///< Index of next StreamInfo, or ~0 for end of list
-	NameInfo name;              ///< Stream name (empty for main $DATA stream)
+	BasicNameInfo<Index> name;  ///< Stream name (empty for main $DATA stream)
 	unsigned char is_sparse : 1; ///< Stream has sparse regions (unallocated holes)
 	unsigned char is_allocated_size_accounted_for_in_main_stream : 1; ///< Size already counted in main stream
 	unsigned char type_name_id : CHAR_BIT - 2; ///< Attribute type ID (0 for $I30 index streams)
@@ -259,14 +279,15 @@ struct StreamInfo : SizeInfo
  * @note `record_number` is the FRS of the child file/directory
  * @note `name_index` is which hardlink name to use for display
  */
-struct ChildInfo
+template <class Index>
+struct BasicChildInfo
 {
 	/**
 	 * @brief Default constructor - initializes to "no child" state
 	 */
-	ChildInfo() noexcept : next_entry(negative_one), record_number(negative_one), name_index(negative_one) {}
+	BasicChildInfo() noexcept : next_entry(negative_one), record_number(negative_one), name_index(negative_one) {}
 
-	typedef small_t<size_t>::type next_entry_type;
+	typedef Index next_entry_type;
 	next_entry_type next_entry;            ///< Index of next ChildInfo, or ~0 for end of list
 	small_t<size_t>::type record_number;   ///< FRS number of the child file/directory
 	unsigned short name_index;             ///< Which hardlink name to use (index into child's names)
@@ -280,27 +301,35 @@ struct ChildInfo
  * index. It corresponds to an NTFS FILE_RECORD_SEGMENT_HEADER but is optimized
  * for search and traversal.
  *
- * ## Memory Layout (51 bytes, packed)
+ * A Record holds only what walking the tree reads: attributes, list heads
+ * and the first name. The rest of a record lives in columns of the index,
+ * indexed by the same slot as records_data:
+ *
+ * ```
+ *   records_data[slot]   Record       attributes, counts, first_child, first_name
+ *   first_streams[slot]  StreamInfo   first stream with its sizes
+ *   timestamps[slot]     RecordTimes  created, written, accessed (none with kLoadNoTimestamps)
+ * ```
+ *
+ * ## Memory Layout (25 bytes, packed; 37 in the 64-bit layout)
  *
  * ```
  * Offset  Size   Field
  * ------  -----  ------------------
- * 0       24     stdinfo (StandardInfo - timestamps + attributes)
- * 24      2      name_count
- * 26      2      stream_count
- * 28      4      first_child (index into childinfos, or ~0)
- * 32      13     first_name (embedded LinkInfo)
- * 45      17     first_stream (embedded StreamInfo)
+ * 0       4      attributes (FILE_ATTRIBUTE_* flags StandardInfo keeps)
+ * 4       2      name_count
+ * 6       2      stream_count
+ * 8       4      first_child (index into childinfos, or ~0)
+ * 12      13     first_name (embedded LinkInfo)
  * ------  -----  ------------------
- * Total:  62 bytes (approximate, depends on StandardInfo packing)
+ * Total:  25 bytes
  * ```
  *
  * ## Linked List Heads
  *
- * The Record contains the first element of each linked list inline:
  * - `first_name` - First hardlink (additional links in nameinfos vector)
- * - `first_stream` - First data stream (additional streams in streaminfos vector)
  * - `first_child` - Index to first child (for directories only)
+ * - The first stream is first_streams[slot] (additional streams in streaminfos vector)
  *
  * This optimization avoids an extra indirection for the common case of
  * files with one name and one stream.
@@ -308,29 +337,25 @@ struct ChildInfo
  * ## Usage Example
  *
  * ```cpp
- * // Access file timestamps
- * auto created = record.stdinfo.created;
- * auto attrs = record.stdinfo.attributes();
- *
  * // Iterate hardlinks
  * for (auto* link = &record.first_name; link; link = next_link(link)) {
  *     // link->name, link->parent
  * }
  *
  * // Check if directory
- * if (record.stdinfo.is_directory) {
+ * if (record.attributes & FILE_ATTRIBUTE_DIRECTORY) {
  *     // Iterate children via first_child
  * }
  * ```
  */
-struct Record
+template <class Index>
+struct BasicRecord
 {
-	StandardInfo stdinfo;                    ///< File timestamps and attributes
+	unsigned int attributes;                 ///< FILE_ATTRIBUTE_* flags, only those StandardInfo keeps
 	unsigned short name_count;               ///< Number of hardlinks (max ~1024)
 	unsigned short stream_count;             ///< Number of data streams (max ~4106)
-	ChildInfo::next_entry_type first_child;  ///< Index of first child (directories only), or ~0
-	LinkInfo first_name;                     ///< First hardlink (embedded, not a pointer)
-	StreamInfo first_stream;                 ///< First data stream (embedded, not a pointer)
+	Index first_child;                       ///< Index of first child (directories only), or ~0
+	BasicLinkInfo<Index> first_name;         ///< First hardlink (embedded, not a pointer)
 
 	/**
 	 * @brief Default constructor - initializes to empty record
@@ -338,21 +363,54 @@ struct Record
 	 * Sets all linked list heads to "empty" state (~0 for indices,
 	 * invalid offset for names).
 	 */
-	Record() noexcept
-		: stdinfo()
+	BasicRecord() noexcept
+		: attributes()
 		, name_count()
 		, stream_count()
 		, first_child(negative_one)
 		, first_name()
-		, first_stream()
 	{
-		this->first_stream.name.offset(negative_one);
-		this->first_stream.next_entry = negative_one;
 	}
+
+	/// @brief The first stream of a record that has none (its first_streams entry)
+	static BasicStreamInfo<Index> no_stream() noexcept
+	{
+		BasicStreamInfo<Index> result;
+		result.name.offset(negative_one);
+		result.next_entry = negative_one;
+		return result;
+	}
+};
+
+/**
+ * @brief Timestamps of a record, kept apart from the Record itself
+ *
+ * @details
+ * The timestamps column of the index, one per record slot. Searches read
+ * them only to display or filter them, so they stay out of the cache
+ * lines a tree walk touches, and an index loaded with kLoadNoTimestamps
+ * does not allocate them at all.
+ *
+ * @note Times are FILETIMEs, as in StandardInfo
+ */
+struct RecordTimes
+{
+	RecordTimes() noexcept : created(), written(), accessed() {}
+
+	unsigned long long created;   ///< Creation time
+	unsigned long long written;   ///< Last write time
+	unsigned long long accessed;  ///< Last access time
 };
 
 #pragma pack(pop)
 
+// The compact 32-bit layout, NtfsIndex's
+typedef BasicNameInfo<small_t<size_t>::type> NameInfo;
+typedef BasicLinkInfo<small_t<size_t>::type> LinkInfo;
+typedef BasicStreamInfo<small_t<size_t>::type> StreamInfo;
+typedef BasicChildInfo<small_t<size_t>::type> ChildInfo;
+typedef BasicRecord<small_t<size_t>::type> Record;
+
 } // namespace uffs
 
 // ============================================================================
@@ -361,9 +419,15 @@ struct Record
 // Expose types at global scope for existing code that doesn't use uffs::
 // ============================================================================
 using uffs::small_t;
+using uffs::BasicNameInfo;
+using uffs::BasicLinkInfo;
+using uffs::BasicStreamInfo;
+using uffs::BasicChildInfo;
+using uffs::BasicRecord;
 using uffs::NameInfo;
 using uffs::LinkInfo;
 using uffs::StreamInfo;
 using uffs::ChildInfo;
 using uffs::Record;
+using uffs::RecordTimes;
 
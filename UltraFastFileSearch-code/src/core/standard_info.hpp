@@ -68,7 +68,7 @@
  *
  * @see ntfs::StandardInformation - The on-disk NTFS format
  * @see file_attributes_ext.hpp - Extended attribute constants
- * @see Record - Uses StandardInfo for file metadata
+ * @see Record, RecordTimes - How the index stores it (attributes and timestamps apart)
  */
 
 #include <Windows.h>
@@ -138,6 +138,14 @@ struct StandardInfo
 		is_sparsefile      : 1,        ///< FILE_ATTRIBUTE_SPARSE_FILE
 		is_reparsepoint    : 1;        ///< FILE_ATTRIBUTE_REPARSE_POINT
 
+	/// The FILE_ATTRIBUTE_* flags that have a bit above; attributes(value) drops the rest
+	static constexpr unsigned long kKeptAttributes =
+		FILE_ATTRIBUTE_READONLY | FILE_ATTRIBUTE_ARCHIVE | FILE_ATTRIBUTE_SYSTEM | FILE_ATTRIBUTE_HIDDEN |
+		FILE_ATTRIBUTE_OFFLINE | FILE_ATTRIBUTE_NOT_CONTENT_INDEXED | FILE_ATTRIBUTE_NO_SCRUB_DATA |
+		FILE_ATTRIBUTE_INTEGRITY_STREAM | FILE_ATTRIBUTE_PINNED | FILE_ATTRIBUTE_UNPINNED |
+		FILE_ATTRIBUTE_DIRECTORY | FILE_ATTRIBUTE_COMPRESSED | FILE_ATTRIBUTE_ENCRYPTED |
+		FILE_ATTRIBUTE_SPARSE_FILE | FILE_ATTRIBUTE_REPARSE_POINT;
+
 	// ========================================================================
 	// Attribute Accessors
 	// ========================================================================
@@ -43,25 +43,37 @@
  *
  * | Structure   | Description                                      |
  * |-------------|--------------------------------------------------|
- * | Record      | Core file record (FRS, stdinfo, first link/stream)|
+ * | Record      | Core file record (attributes, first link, heads) |
+ * | RecordTimes | Timestamps of a record, in a column of their own |
  * | LinkInfo    | Hard link (name, parent FRS, name offset)        |
  * | StreamInfo  | Alternate data stream (name, size, type)         |
  * | ChildInfo   | Directory child entry (for tree traversal)       |
  *
  * ## Key Operations
  *
- * | Method          | Description                                    |
- * |-----------------|------------------------------------------------|
- * | init()          | Initialize volume handle and metadata          |
- * | load()          | Parse MFT records into index                   |
- * | matches()       | Search files matching a pattern                |
- * | get_path()      | Build full path for a file                     |
+ * | Method                | Description                                    |
+ * |-----------------------|------------------------------------------------|
+ * | init()                | Initialize volume handle and metadata          |
+ * | load()                | Parse MFT records into index                   |
+ * | matches()             | Search files matching a pattern                |
+ * | get_path()            | Build full path for a file                     |
+ * | save_snapshot()       | Write a finished index to a UFFS-IDX file      |
+ * | open_snapshot()       | Search a memory-mapped UFFS-IDX file in place  |
+ * | apply_usn_events()    | Patch a finished index from USN journal events |
+ * | begin_refresh()       | Re-scan the MFT, re-parse only changed chunks  |
+ * | defer_sizes()         | Compute directory totals on first get_sizes()  |
+ * | NtfsIndex(path, p)    | Keep only what LoadProfile p asks for          |
+ * | match_while_loading() | Report name matches before loading finishes    |
  *
  * ## Thread Safety
  *
  * - Construction and init() must be single-threaded
+ * - preload_concurrent() and parse() run concurrently on different chunks
  * - load() can be called from multiple threads (uses internal locking)
  * - matches() and get_path() are read-only and thread-safe after loading
+ * - get_sizes() of a defer_sizes() index computes the totals on first use,
+ *   once; concurrent callers wait for it
+ * - take_early_matches() must be called under the lock while loading
  * - Progress accessors (records_so_far, etc.) are atomic
  *
  * ## Usage Example
@@ -95,7 +107,18 @@
 #include <Windows.h>
 #include <tchar.h>
 #include <climits>
+#include <ctime>
+#include <exception>
+#include <filesystem>
+#include <forward_list>
+#include <fstream>
+#include <functional>
 #include <iterator>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
 #include <vector>
 #include <codecvt>
 
@@ -109,8 +132,15 @@
 #include "util/path.hpp"
 #include "util/append_directional.hpp"
 #include "util/error_utils.hpp"
+#include "util/mapped_file.hpp"
 #include "io/winnt_types.hpp"
 #include "io/io_priority.hpp"
+#include "io/uffs_index_format.hpp"
+#include "io/packed_names.hpp"
+#include "io/usn_journal.hpp"
+#include "io/mft_refresh.hpp"
+#include "io/subtree_totals.hpp"
+#include "io/mft_fixup.hpp"
 #include "util/type_traits_ext.hpp"
 #include "core/file_attributes_ext.hpp"
 #include "core/packed_file_size.hpp"
@@ -118,9 +148,10 @@
 #include "core/ntfs_record_types.hpp"
 #include "core/ntfs_key_type.hpp"
 #include "mapping_pair_iterator.hpp"
+#include "ntfs_index_fwd.hpp"
 
 /**
- * @class NtfsIndex
+ * @class BasicNtfsIndex
  * @brief In-memory index of an NTFS volume's file system structure
  *
  * @details
@@ -136,6 +167,8 @@
  *
  * ```
  * records_data:   [Record0][Record1][Record2]...
+ * first_streams:  [Stream0][Stream1][Stream2]...   same slots
+ * timestamps:     [Times0 ][Times1 ][Times2 ]...   same slots
  *                     │        │        │
  *                     v        v        v
  * nameinfos:      [Link0 ]──>[Link1 ]  [Link2 ]──>[Link3 ]
@@ -144,6 +177,13 @@
  * names:          "file1.txt\0""file2.txt\0""dir\0"...
  * ```
  *
+ * ## Index Width
+ *
+ * Name offsets and list links are of type Index. NtfsIndex is the compact
+ * unsigned int layout; HugeNtfsIndex (unsigned long long) addresses names
+ * pools and lists past 2G elements at 12 bytes more per record. FRS
+ * numbers are 32-bit in both (see ntfs_index_fwd.hpp).
+ *
  * ## FRS (File Record Segment) Numbers
  *
  * NTFS reserves the first 16 FRS numbers for system files:
@@ -165,9 +205,10 @@
  * | 12-15 | (reserved)  | Reserved for future use        |
  * | 16+ | (user files)  | User files and directories     |
  */
-class NtfsIndex : public RefCounted<NtfsIndex>
+template <class Index>
+class BasicNtfsIndex : public RefCounted<BasicNtfsIndex<Index> >
 {
-	typedef NtfsIndex this_type;
+	typedef BasicNtfsIndex this_type;
 
 public:
 	// ========================================================================
@@ -177,6 +218,23 @@ public:
 	static constexpr unsigned int kVolumeFRS = 0x00000006;     ///< $Volume metadata FRS
 	static constexpr unsigned int kFirstUserFRS = 0x00000010;  ///< First user file FRS
 
+	/**
+	 * @brief What load() keeps of each record; chosen at construction.
+	 *
+	 * A host that only matches names and paths can leave out the rest and
+	 * hold more volumes in the same memory. The accessors of data that was
+	 * left out say so (see load_profile() and get_sizes()).
+	 */
+	enum LoadProfile : unsigned int
+	{
+		kLoadEverything   = 0,
+		kLoadNoStreams    = 1U << 0,  ///< Only the unnamed $DATA and the $I30 index of a record; no ADS, $EA, $REPARSE_POINT...
+		kLoadNoTimestamps = 1U << 1,  ///< Created, written and accessed stay 0; attributes are kept
+		kLoadNoSizes      = 1U << 2,  ///< No stream sizes and no directory totals
+		kLoadNamesOnly    = kLoadNoStreams | kLoadNoTimestamps | kLoadNoSizes,
+		kLoadPackedNames  = 1U << 3,  ///< Names pool in LZ4 blocks once loading finishes, decoded on access (ntfs_index_packed_names.hpp)
+	};
+
 private:
 	// Type aliases from extracted headers
 	template <class T = void>
@@ -184,11 +242,12 @@ private:
 	typedef ::uffs::file_size_type file_size_type;
 	typedef ::uffs::StandardInfo StandardInfo;
 	typedef ::uffs::SizeInfo SizeInfo;
-	typedef ::uffs::NameInfo NameInfo;
-	typedef ::uffs::LinkInfo LinkInfo;
-	typedef ::uffs::StreamInfo StreamInfo;
-	typedef ::uffs::ChildInfo ChildInfo;
-	typedef ::uffs::Record Record;
+	typedef ::uffs::BasicNameInfo<Index> NameInfo;
+	typedef ::uffs::BasicLinkInfo<Index> LinkInfo;
+	typedef ::uffs::BasicStreamInfo<Index> StreamInfo;
+	typedef ::uffs::BasicChildInfo<Index> ChildInfo;
+	typedef ::uffs::BasicRecord<Index> Record;
+	typedef ::uffs::RecordTimes RecordTimes;
 
 	static unsigned int IsWow64Process_();
 
@@ -197,6 +256,7 @@ private:
 	friend struct std::is_scalar<LinkInfo>;
 	friend struct std::is_scalar<StreamInfo>;
 	friend struct std::is_scalar<Record>;
+	friend struct std::is_scalar<RecordTimes>;
 
 	typedef std::codecvt<std::tstring::value_type, char, int /*std::mbstate_t*/> CodeCvt;
 	typedef vector_with_fast_size<LinkInfo> LinkInfos;
@@ -204,14 +264,20 @@ private:
 	typedef vector_with_fast_size<Record> Records;
 	typedef std::vector<unsigned int> RecordsLookup;
 	typedef vector_with_fast_size<ChildInfo> ChildInfos;
+	typedef vector_with_fast_size<RecordTimes> Timestamps;
+	typedef PackedNames<std::tvstring::value_type> PackedNamePool;
+	typedef PackedNamePool::Cursor NameCursor;
 
 	mutable atomic_namespace::recursive_mutex _mutex;
 	value_initialized<clock_t> _tbegin;
 	value_initialized<bool> _init_called;
 	std::tvstring _root_path;
 	Handle _volume;
-	std::tvstring names;
+	std::tvstring names;        // with kLoadPackedNames, the names added after packed_names
+	PackedNamePool packed_names;
 	Records records_data;
+	StreamInfos first_streams;  // by record slot, like timestamps; see Record
+	Timestamps timestamps;      // empty with kLoadNoTimestamps
 	RecordsLookup records_lookup;
 	LinkInfos nameinfos;
 	StreamInfos streaminfos;
@@ -220,8 +286,18 @@ private:
 	atomic_namespace::atomic<unsigned int> _finished;
 	atomic_namespace::atomic<size_t> _total_names_and_streams;
 	value_initialized<unsigned int> _expected_records;
+	// Totals of the fragments merged so far; merge() projects the final size of each vector from them
+	struct MergedCounts
+	{
+		unsigned long long records, in_use, links, children, streams, name_chars;
+	};
+	MergedCounts _merged;
 	atomic_namespace::atomic<bool> _cancelled;
 	atomic_namespace::atomic<unsigned int> _records_so_far, _preprocessed_so_far;
+	unsigned int const _load_profile;
+	value_initialized<bool> _defer_sizes;
+	mutable atomic_namespace::atomic<bool> _sizes_pending;  // loaded, preprocess() not run yet
+	mutable std::mutex _sizes_mutex;
 	std::vector<Speed> _perf_reports_circ; // circular buffer
 	value_initialized<size_t> _perf_reports_begin;
 	atomic_namespace::spin_atomic<Speed> _perf_avg_speed;
@@ -233,32 +309,148 @@ private:
 	value_initialized<unsigned int> _mft_record_size;
 	value_initialized<unsigned int> _mft_capacity;
 
-	typedef ::uffs::key_type_internal key_type_internal;
+	// Read-only storage borrowed from a memory-mapped snapshot (open_snapshot).
+	// While set, the vectors above stay empty and const access reads from here.
+	struct SnapshotView
+	{
+		MappedFile file;
+		typename Records::value_type const* records_data;
+		size_t records_data_size;
+		typename StreamInfos::value_type const* first_streams;
+		typename Timestamps::value_type const* timestamps;
+		size_t timestamps_size;
+		RecordsLookup::value_type const* records_lookup;
+		size_t records_lookup_size;
+		std::tvstring::value_type const* names;
+		size_t names_size;
+		typename LinkInfos::value_type const* nameinfos;
+		size_t nameinfos_size;
+		typename StreamInfos::value_type const* streaminfos;
+		size_t streaminfos_size;
+		typename ChildInfos::value_type const* childinfos;
+		size_t childinfos_size;
+	};
+	std::unique_ptr<SnapshotView const> _snapshot;
 
-	// Internal helpers declared here, implemented in ntfs_index_impl.hpp
-	Records::iterator at(size_t frs, Records::iterator* existing_to_revalidate = nullptr);
+	// Hash of every $MFT::$DATA chunk as of the last completed pass, and the
+	// state of a re-scan in progress (see ntfs_index_refresh.hpp)
+	MftChunkHashes _chunk_hashes;
+	struct RefreshState
+	{
+		explicit RefreshState(unsigned int record_size) : records(record_size), reserved_clusters() {}
+		MftRefreshSet records;
+		std::vector<std::pair<unsigned long long, unsigned long long> > hashes;  // committed when the pass completes
+		long long reserved_clusters;  // as the Preprocessor saw it
+	};
+	std::unique_ptr<RefreshState> _refresh;
+	value_initialized<size_t> _refreshed_files;  // by the last finish_refresh()
 
-	template <class Me>
-	static typename propagate_const<Me, Records::value_type>::type*
-	_find(Me* me, key_type_internal::frs_type frs);
+	// Records whose names matched while loading (see ntfs_index_early.hpp)
+	struct EarlyMatches
+	{
+		enum State : unsigned char
+		{
+			kIncomplete = 0x1,  // has an $ATTRIBUTE_LIST; more names may still come
+			kTaken      = 0x2   // handed to take_early_matches()
+		};
 
-	Records::value_type* find(key_type_internal::frs_type frs);
-	Records::value_type const* find(key_type_internal::frs_type frs) const;
+		std::function<bool(TCHAR const* name, size_t length)> filter;
+		std::vector<unsigned int> pending;  // matched, not taken yet
+		std::vector<unsigned char> states;  // by FRS
 
-	ChildInfos::value_type* childinfo(Records::value_type* i);
-	ChildInfos::value_type const* childinfo(Records::value_type const* i) const;
-	ChildInfos::value_type* childinfo(ChildInfo::next_entry_type i);
-	ChildInfos::value_type const* childinfo(ChildInfo::next_entry_type i) const;
+		unsigned char state(unsigned int frs) const noexcept
+		{
+			return frs < this->states.size() ? this->states[frs] : 0;
+		}
 
-	LinkInfos::value_type* nameinfo(LinkInfo::next_entry_type i);
-	LinkInfos::value_type const* nameinfo(LinkInfo::next_entry_type i) const;
-	LinkInfos::value_type* nameinfo(Records::value_type* i);
-	LinkInfos::value_type const* nameinfo(Records::value_type const* i) const;
+		void set_state(unsigned int frs, unsigned char state)
+		{
+			if (frs >= this->states.size())
+			{
+				this->states.resize(frs + 1 + frs / 8);
+			}
+			this->states[frs] |= state;
+		}
+	};
+	std::unique_ptr<EarlyMatches> _early;
+
+	typedef ::uffs::basic_key_type_internal<Index> key_type_internal;
+
+	// Internal helpers declared here, implemented in ntfs_index_impl.hpp
+	typename Records::iterator at(size_t frs);
+	void load_record(unsigned int frs, ntfs::FILE_RECORD_SEGMENT_HEADER const* frsh);
+	typename Records::value_type const* merged_record(unsigned int frs) const;
+	bool early_match_ready(unsigned int frs, size_t& depth) const;
+
+	// Bottom-up $I30 subtree totals, computed when loading finishes or, with
+	// defer_sizes(), by the first ensure_sizes() (ntfs_index_preprocess.hpp)
+	struct Preprocessor;
+	void preprocess();
+
+	// Each name, stream and child list as one run of entries, once loading finishes (ntfs_index_compact.hpp)
+	void compact_lists();
+	typename LinkInfos::value_type const* nameinfo_at(typename Records::value_type const* fr, size_t n) const;
+	typename StreamInfos::value_type const* streaminfo_at(typename Records::value_type const* fr, size_t k) const;
+	value_initialized<bool> _lists_compact;  // cleared by anything that edits the lists
+
+	// One shared copy of each distinct name, once loading finishes (ntfs_index_intern.hpp)
+	void intern_names();
+	value_initialized<size_t> _names_before_interning, _names_after_interning;
+
+	// The characters of a name, wherever the pool keeps them (ntfs_index_packed_names.hpp)
+	void pack_names();
+	static size_t name_units(NameInfo const& name) noexcept;
+	std::tvstring::value_type const* name_chars(NameInfo const& name, NameCursor& cursor) const;
+
+	// In-place edits that keep the $I30 subtree totals consistent (ntfs_index_patch.hpp)
+	struct Patcher;
 
-	StreamInfos::value_type* streaminfo(StreamInfo::next_entry_type i);
-	StreamInfos::value_type const* streaminfo(StreamInfo::next_entry_type i) const;
-	StreamInfos::value_type* streaminfo(Records::value_type* i);
-	StreamInfos::value_type const* streaminfo(Records::value_type const* i) const;
+	template <class Me>
+	static typename propagate_const<Me, typename Records::value_type>::type*
+	_find(Me* me, typename key_type_internal::frs_type frs);
+
+	typename Records::value_type* find(typename key_type_internal::frs_type frs);
+	typename Records::value_type const* find(typename key_type_internal::frs_type frs) const;
+
+	typename ChildInfos::value_type* childinfo(typename Records::value_type* i);
+	typename ChildInfos::value_type const* childinfo(typename Records::value_type const* i) const;
+	typename ChildInfos::value_type* childinfo(typename ChildInfo::next_entry_type i);
+	typename ChildInfos::value_type const* childinfo(typename ChildInfo::next_entry_type i) const;
+
+	typename LinkInfos::value_type* nameinfo(typename LinkInfo::next_entry_type i);
+	typename LinkInfos::value_type const* nameinfo(typename LinkInfo::next_entry_type i) const;
+	typename LinkInfos::value_type* nameinfo(typename Records::value_type* i);
+	typename LinkInfos::value_type const* nameinfo(typename Records::value_type const* i) const;
+
+	typename StreamInfos::value_type* streaminfo(typename StreamInfo::next_entry_type i);
+	typename StreamInfos::value_type const* streaminfo(typename StreamInfo::next_entry_type i) const;
+	typename StreamInfos::value_type* streaminfo(typename Records::value_type* i);
+	typename StreamInfos::value_type const* streaminfo(typename Records::value_type const* i) const;
+
+	// The columns of a record (see Record)
+	typename StreamInfos::value_type* first_stream(typename Records::value_type const* i);
+	typename StreamInfos::value_type const* first_stream(typename Records::value_type const* i) const;
+	typename Timestamps::value_type* record_times(typename Records::value_type const* i);
+	void clear_record(typename Records::value_type* i);
+
+	// Storage access that works for both owned vectors and a mapped snapshot
+	typename Records::value_type* records_data_begin() noexcept;
+	typename Records::value_type const* records_data_begin() const noexcept;
+	size_t records_data_size() const noexcept;
+	typename StreamInfos::value_type* first_streams_begin() noexcept;
+	typename StreamInfos::value_type const* first_streams_begin() const noexcept;
+	typename Timestamps::value_type const* timestamps_begin() const noexcept;
+	size_t timestamps_size() const noexcept;
+	RecordsLookup::value_type const* records_lookup_begin() const noexcept;
+	size_t records_lookup_size() const noexcept;
+	std::tvstring::value_type const* names_begin() const noexcept;
+	size_t names_size() const noexcept;
+	typename LinkInfos::value_type const* nameinfos_begin() const noexcept;
+	size_t nameinfos_size() const noexcept;
+	typename StreamInfos::value_type const* streaminfos_begin() const noexcept;
+	size_t streaminfos_size() const noexcept;
+	typename ChildInfos::value_type const* childinfos_begin() const noexcept;
+	size_t childinfos_size() const noexcept;
 
 	// Forward declaration of Matcher template (defined in ntfs_index_impl.hpp)
 	template <class F>
@@ -288,8 +480,8 @@ public:
 	void set_mft_capacity(unsigned int value) noexcept;
 
 	// Construction / lifetime
-	NtfsIndex(std::tvstring value);
-	~NtfsIndex();
+	BasicNtfsIndex(std::tvstring value, unsigned int load_profile = kLoadEverything);
+	~BasicNtfsIndex();
 
 	// Initialization and lifecycle
 	[[nodiscard]] bool init_called() const noexcept;
@@ -297,13 +489,16 @@ public:
 	void set_finished(unsigned int const& result);
 
 	// Volatile helpers for lock_ptr and multi-threaded access
-	[[nodiscard]] NtfsIndex* unvolatile() volatile noexcept;
-	[[nodiscard]] NtfsIndex const* unvolatile() const volatile noexcept;
+	[[nodiscard]] BasicNtfsIndex* unvolatile() volatile noexcept;
+	[[nodiscard]] BasicNtfsIndex const* unvolatile() const volatile noexcept;
 
 	// Progress and statistics accessors
 	[[nodiscard]] size_t total_names_and_streams() const noexcept;
 	[[nodiscard]] size_t total_names_and_streams() const volatile noexcept;
 	[[nodiscard]] size_t total_names() const noexcept;
+	[[nodiscard]] double name_dedupe_ratio() const noexcept;
+	[[nodiscard]] size_t names_bytes() const noexcept;
+	[[nodiscard]] size_t lists_bytes() const noexcept;
 	[[nodiscard]] size_t expected_records() const noexcept;
 	[[nodiscard]] size_t preprocessed_so_far() const volatile noexcept;
 	[[nodiscard]] size_t preprocessed_so_far() const noexcept;
@@ -314,6 +509,7 @@ public:
 	[[nodiscard]] Speed speed() const volatile noexcept;
 	[[nodiscard]] std::tvstring const& root_path() const volatile noexcept;
 	[[nodiscard]] unsigned int get_finished() const volatile noexcept;
+	[[nodiscard]] unsigned int load_profile() const volatile noexcept;
 	[[nodiscard]] bool cancelled() const volatile noexcept;
 	void cancel() volatile noexcept;
 	[[nodiscard]] uintptr_t finished_event() const noexcept;
@@ -321,23 +517,63 @@ public:
 	// Capacity reservation
 	void reserve(unsigned int records);
 
+	// Directory totals on demand (implementation in ntfs_index_preprocess.hpp)
+	void defer_sizes() noexcept;
+	void ensure_sizes() const;
+
 	void preload_concurrent(unsigned long long virtual_offset, void* buffer, size_t size) volatile;
 
+	// Records of one chunk parsed outside the lock, then linked in by load() (ntfs_index_load.hpp)
+	struct Fragment;
+	void parse(unsigned long long virtual_offset, void const* buffer, size_t size, Fragment& fragment) const volatile;
+
 	void load(unsigned long long virtual_offset, void* buffer, size_t size,
 		unsigned long long skipped_begin, unsigned long long skipped_end);
+	void load(Fragment const& fragment, unsigned long long skipped_begin, unsigned long long skipped_end);
+
+private:
+	void parse_record(unsigned int frs, ntfs::FILE_RECORD_SEGMENT_HEADER const* frsh, Fragment& fragment) const;
+	static void require_width(size_t names, size_t entries);
+	void make_room(Fragment const& fragment);
+	void merge(Fragment const& fragment);
+	void link(Fragment const& fragment, size_t names_base);
+	void resolve_extensions();
+
+	// Attributes of extension records merged so far, linked by resolve_extensions()
+	std::unique_ptr<Fragment> _extensions;
+
+public:
 
 	void report_speed(unsigned long long const size, clock_t const tfrom, clock_t const tto);
 
+	// Persistent snapshots (implementation in ntfs_index_snapshot.hpp)
+	void save_snapshot(char const* path) const;
+	void open_snapshot(char const* path, bool verify = false);
+	[[nodiscard]] bool is_snapshot() const noexcept;
+
+	// Incremental refresh from the USN change journal (implementation in ntfs_index_usn.hpp)
+	size_t apply_usn_events(UsnEvent const* events, size_t count);
+
+	// Re-scan of the MFT that re-parses only changed chunks (implementation in ntfs_index_refresh.hpp)
+	void begin_refresh();
+	[[nodiscard]] bool refreshing() const volatile noexcept;
+	[[nodiscard]] bool chunk_changed(unsigned long long chunk_offset, unsigned long long hash);
+	bool refresh(unsigned long long virtual_offset, void* buffer, size_t size,
+		unsigned long long skipped_begin, unsigned long long skipped_end, bool changed);
+	template <class ReadRecord>
+	size_t finish_refresh(ReadRecord&& read_record);
+	[[nodiscard]] size_t refreshed_files() const noexcept;
+
 	struct file_pointers
 	{
-		Records::value_type const* record;
-		LinkInfos::value_type const* link;
-		StreamInfos::value_type const* stream;
+		typename Records::value_type const* record;
+		typename LinkInfos::value_type const* link;
+		typename StreamInfos::value_type const* stream;
 		[[nodiscard]] key_type parent() const noexcept
 		{
 			return key_type(link->parent,
-				static_cast<key_type::name_info_type>(~key_type::name_info_type()),
-				static_cast<key_type::stream_info_type>(~key_type::stream_info_type()));
+				static_cast<typename key_type::name_info_type>(~typename key_type::name_info_type()),
+				static_cast<typename key_type::stream_info_type>(~typename key_type::stream_info_type()));
 		}
 	};
 
@@ -354,13 +590,16 @@ public:
 			  size_t ascii : 1;
 		  };
 
-		  NtfsIndex
+		  BasicNtfsIndex
 			  const* index;
 		  key_type key;
 		  unsigned char state;
 		  unsigned short iteration;
 		  file_pointers ptrs;
 		  value_type_internal result;
+		  NameCursor cursor;
+		  std::forward_list<std::tvstring> kept;  // packed names yielded so far; callers keep the pointers
+		  void const* chars(NameInfo const& name);
 		  [[nodiscard]] bool is_root() const noexcept
 		  {
 			  return key.frs() == kRootFRS;
@@ -427,13 +666,13 @@ public:
 			}
 		};
 
-		explicit ParentIterator(NtfsIndex
+		explicit ParentIterator(BasicNtfsIndex
 			const* const index, key_type
 			const& key) noexcept : index(index), key(key), state(0), iteration(0) {}
 
 		[[nodiscard]] unsigned int attributes() const noexcept
 		{
-			return ptrs.record->stdinfo.attributes();
+			return ptrs.record->attributes;
 		}
 
 		[[nodiscard]] bool empty() const noexcept
@@ -483,7 +722,7 @@ public:
 
 	[[nodiscard]] size_info const& get_sizes(key_type const& key) const;
 
-	[[nodiscard]] standard_info const& get_stdinfo(unsigned int const frn) const;
+	[[nodiscard]] standard_info get_stdinfo(unsigned int const frn) const;
 
 	/// Match files/directories against a filter function.
 	/// @param func Callback invoked for each match
@@ -498,17 +737,25 @@ public:
 		Matcher<F&> matcher = {this, func, match_paths, match_streams, match_attributes, &path, 0};
 		return matcher(kRootFRS);
 	}
+
+	// Search while indexing (implementation in ntfs_index_early.hpp)
+	typedef std::function<bool(TCHAR const* name, size_t length)> NameFilter;
+	void match_while_loading(NameFilter filter);
+	template <class F>
+	size_t take_early_matches(F&& func);
+	[[nodiscard]] bool matched_early(typename key_type::frs_type frs) const noexcept;
 };
 
 // std::is_scalar specializations for NtfsIndex nested types (MSVC optimization)
 #ifdef _XMEMORY_
 namespace std
 {
-	template <> struct is_scalar<NtfsIndex::StandardInfo> : is_pod<NtfsIndex::StandardInfo> {};
-	template <> struct is_scalar<NtfsIndex::NameInfo> : is_pod<NtfsIndex::NameInfo> {};
-	template <> struct is_scalar<NtfsIndex::StreamInfo> : is_pod<NtfsIndex::StreamInfo> {};
-	template <> struct is_scalar<NtfsIndex::LinkInfo> : is_pod<NtfsIndex::LinkInfo> {};
-	template <> struct is_scalar<NtfsIndex::Record> : is_pod<NtfsIndex::Record> {};
+	template <> struct is_scalar<::uffs::StandardInfo> : is_pod<::uffs::StandardInfo> {};
+	template <class Index> struct is_scalar<::uffs::BasicNameInfo<Index> > : is_pod<::uffs::BasicNameInfo<Index> > {};
+	template <class Index> struct is_scalar<::uffs::BasicStreamInfo<Index> > : is_pod<::uffs::BasicStreamInfo<Index> > {};
+	template <class Index> struct is_scalar<::uffs::BasicLinkInfo<Index> > : is_pod<::uffs::BasicLinkInfo<Index> > {};
+	template <class Index> struct is_scalar<::uffs::BasicRecord<Index> > : is_pod<::uffs::BasicRecord<Index> > {};
+	template <> struct is_scalar<::uffs::RecordTimes> : is_pod<::uffs::RecordTimes> {};
 }
 #endif
 
@@ -29,11 +29,12 @@
  * ┌─────────────────────────────────────────────────────────────────────────┐
  * │                         RECORD STRUCTURE                                │
  * │  Record {                                                               │
- * │    stdinfo      ──► StandardInfo (timestamps, attributes)               │
+ * │    attributes   ──► FILE_ATTRIBUTE_* flags                              │
  * │    first_name   ──► LinkInfo (inline, first hard link)                  │
- * │    first_stream ──► StreamInfo (inline, default $DATA stream)           │
  * │    first_child  ──► index into childinfos[] (for directories)           │
  * │  }                                                                      │
+ * │  first_streams[slot] ──► StreamInfo (default $DATA stream)              │
+ * │  timestamps[slot]    ──► RecordTimes (created, written, accessed)       │
  * └─────────────────────────────────────────────────────────────────────────┘
  *                    │              │              │
  *                    ▼              ▼              ▼
@@ -129,7 +130,8 @@
  * @return file_pointers Structure containing record, link, and stream pointers
  * @throws std::logic_error if the key cannot be resolved
  */
-inline NtfsIndex::file_pointers NtfsIndex::get_file_pointers(key_type key) const
+template <class Index>
+inline typename BasicNtfsIndex<Index>::file_pointers BasicNtfsIndex<Index>::get_file_pointers(key_type key) const
 {
 	bool wait_for_finish = false;  // has performance penalty
 	if (wait_for_finish && WaitForSingleObject(this->_finished_event, 0) == WAIT_TIMEOUT)
@@ -142,38 +144,29 @@ inline NtfsIndex::file_pointers NtfsIndex::get_file_pointers(key_type key) const
 
 	if (~key.frs())  // Check for valid FRS (not ~0)
 	{
-		Records::value_type const* const fr = this->find(key.frs());
-
-		// Iterate through hard links to find matching name_info
-		unsigned short ji = 0;
-		for (LinkInfos::value_type const* j = this->nameinfo(fr);
-			 j;
-			 j = this->nameinfo(j->next_entry), ++ji)
+		typename Records::value_type const* const fr = this->find(key.frs());
+
+		// The sentinel (all ones) means any name, and the default stream (type_name_id == 0);
+		// others are found directly once the lists are compacted, else by a walk
+		typename key_type::name_info_type const name_info = key.name_info();
+		typename key_type::stream_info_type const stream_info = key.stream_info();
+		bool const any_name = name_info == static_cast<typename key_type::name_info_type>(~typename key_type::name_info_type());
+		bool const default_stream = stream_info == static_cast<typename key_type::stream_info_type>(~typename key_type::stream_info_type());
+		typename LinkInfos::value_type const* const j = any_name ? this->nameinfo(fr) : this->nameinfo_at(fr, name_info);
+		typename StreamInfos::value_type const* k = !j ? nullptr
+			: default_stream ? this->streaminfo(fr)
+			: this->streaminfo_at(fr, stream_info);
+		while (default_stream && k && k->type_name_id)
 		{
-			key_type::name_info_type const name_info = key.name_info();
-			if (name_info == USHRT_MAX || ji == name_info)
-			{
-				// Iterate through streams to find matching stream_info
-				unsigned short ki = 0;
-				for (StreamInfos::value_type const* k = this->streaminfo(fr);
-					 k;
-					 k = this->streaminfo(k->next_entry), ++ki)
-				{
-					key_type::stream_info_type const stream_info = key.stream_info();
-
-					// Match: USHRT_MAX means "default stream" (type_name_id == 0)
-					if (stream_info == USHRT_MAX ? !k->type_name_id : ki == stream_info)
-					{
-						result.record = fr;
-						result.link = j;
-						result.stream = k;
-						goto STOP;
-					}
-				}
-			}
+			k = this->streaminfo(k->next_entry);
 		}
 
-	STOP:
+		if (k)
+		{
+			result.record = fr;
+			result.link = j;
+			result.stream = k;
+		}
 		if (!result.record)
 		{
 			throw std::logic_error("could not find a file attribute");
@@ -197,7 +190,8 @@ inline NtfsIndex::file_pointers NtfsIndex::get_file_pointers(key_type key) const
  *
  * @see ParentIterator for the path traversal implementation
  */
-inline size_t NtfsIndex::get_path(key_type key,
+template <class Index>
+inline size_t BasicNtfsIndex<Index>::get_path(key_type key,
 	std::tvstring& result,
 	bool const name_only,
 	unsigned int* attributes) const
@@ -234,24 +228,23 @@ inline size_t NtfsIndex::get_path(key_type key,
 /**
  * @brief Returns size information for a file/stream identified by key.
  *
+ * Directory totals of a defer_sizes() index are computed by the first call.
+ *
  * @param key The key identifying the file and stream
  * @return Reference to the StreamInfo containing size data
+ * @throws std::logic_error if the index was loaded with kLoadNoSizes
  */
-inline NtfsIndex::size_info const& NtfsIndex::get_sizes(key_type const& key) const
+template <class Index>
+inline typename BasicNtfsIndex<Index>::size_info const& BasicNtfsIndex<Index>::get_sizes(key_type const& key) const
 {
-	StreamInfos::value_type const* k;
-	Records::value_type const* const fr = this->find(key.frs());
-
-	// Find the stream matching stream_info index
-	unsigned short ki = 0;
-	for (k = this->streaminfo(fr); k; k = this->streaminfo(k->next_entry), ++ki)
+	if (this->_load_profile & kLoadNoSizes)
 	{
-		if (ki == key.stream_info())
-		{
-			break;
-		}
+		throw std::logic_error("sizes were not loaded (kLoadNoSizes)");
 	}
+	this->ensure_sizes();
 
+	// Direct once the lists are compacted (ntfs_index_compact.hpp), else a walk
+	typename StreamInfos::value_type const* const k = this->streaminfo_at(this->find(key.frs()), key.stream_info());
 	assert(k);
 	return *k;
 }
@@ -259,12 +252,27 @@ inline NtfsIndex::size_info const& NtfsIndex::get_sizes(key_type const& key) con
 /**
  * @brief Returns standard information (timestamps, attributes) for a file.
  *
+ * Assembled from the record's attributes and its timestamps column.
+ * Timestamps are 0 if the index was loaded with kLoadNoTimestamps.
+ *
  * @param frn File Record Number (FRS)
- * @return Reference to the StandardInfo structure
+ * @return The StandardInfo of the file
  */
-inline NtfsIndex::standard_info const& NtfsIndex::get_stdinfo(unsigned int const frn) const
+template <class Index>
+inline typename BasicNtfsIndex<Index>::standard_info BasicNtfsIndex<Index>::get_stdinfo(unsigned int const frn) const
 {
-	return this->find(frn)->stdinfo;
+	typename Records::value_type const* const fr = this->find(frn);
+	StandardInfo result = StandardInfo();
+	result.attributes(fr->attributes);
+	if (this->timestamps_size())
+	{
+		RecordTimes const& times = *fast_subscript(this->timestamps_begin(),
+			static_cast<size_t>(fr - this->records_data_begin()));
+		result.created  = times.created;
+		result.written  = times.written;
+		result.accessed = times.accessed;
+	}
+	return result;
 }
 
 // ============================================================================
@@ -277,23 +285,29 @@ inline NtfsIndex::standard_info const& NtfsIndex::get_stdinfo(unsigned int const
  * Initializes all data structures but does not start indexing.
  * Call init() followed by the MFT reader to populate the index.
  *
- * @param value Root path of the volume (e.g., "C:\\")
+ * @param value        Root path of the volume (e.g., "C:\\")
+ * @param load_profile LoadProfile flags: what load() keeps of each record
  */
-inline NtfsIndex::NtfsIndex(std::tvstring value)
+template <class Index>
+inline BasicNtfsIndex<Index>::BasicNtfsIndex(std::tvstring value, unsigned int load_profile)
 	: _root_path(value)
 	, _finished_event(CreateEvent(nullptr, TRUE, FALSE, nullptr))  // Manual reset event
 	, _finished()
 	, _total_names_and_streams(0)
+	, _merged()
 	, _cancelled(false)
 	, _records_so_far(0)
 	, _preprocessed_so_far(0)
+	, _load_profile(load_profile)
+	, _sizes_pending(false)
 	, _perf_reports_circ(1 << 6)  // 64-entry circular buffer for speed tracking
 	, _perf_avg_speed(Speed())
 	, _reserved_clusters(0)
 {
 }
 
-inline NtfsIndex::~NtfsIndex()
+template <class Index>
+inline BasicNtfsIndex<Index>::~BasicNtfsIndex()
 {
 }
 
@@ -305,7 +319,8 @@ inline NtfsIndex::~NtfsIndex()
  * @brief Checks if init() has been called.
  * @return true if init() was called, false otherwise
  */
-inline bool NtfsIndex::init_called() const noexcept
+template <class Index>
+inline bool BasicNtfsIndex<Index>::init_called() const noexcept
 {
 	return this->_init_called;
 }
@@ -318,7 +333,8 @@ inline bool NtfsIndex::init_called() const noexcept
  *
  * @throws Windows exception if volume cannot be opened or is not NTFS
  */
-inline void NtfsIndex::init()
+template <class Index>
+inline void BasicNtfsIndex<Index>::init()
 {
 	this->_init_called = true;
 
@@ -374,7 +390,8 @@ inline void NtfsIndex::init()
  * @brief Marks indexing as finished with the given result code.
  * @param result Result code (0 = success, non-zero = error)
  */
-inline void NtfsIndex::set_finished(unsigned int const& result)
+template <class Index>
+inline void BasicNtfsIndex<Index>::set_finished(unsigned int const& result)
 {
 	SetEvent(this->_finished_event);
 	this->_finished = result;
@@ -387,15 +404,17 @@ inline void NtfsIndex::set_finished(unsigned int const& result)
 // which are used during concurrent MFT reading.
 
 /// @brief Casts away volatile qualifier for non-const access.
-inline NtfsIndex* NtfsIndex::unvolatile() volatile noexcept
+template <class Index>
+inline BasicNtfsIndex<Index>* BasicNtfsIndex<Index>::unvolatile() volatile noexcept
 {
-	return const_cast<NtfsIndex*>(this);
+	return const_cast<BasicNtfsIndex*>(this);
 }
 
 /// @brief Casts away volatile qualifier for const access.
-inline NtfsIndex const* NtfsIndex::unvolatile() const volatile noexcept
+template <class Index>
+inline BasicNtfsIndex<Index> const* BasicNtfsIndex<Index>::unvolatile() const volatile noexcept
 {
-	return const_cast<NtfsIndex const*>(this);
+	return const_cast<BasicNtfsIndex const*>(this);
 }
 
 // ============================================================================
@@ -406,67 +425,110 @@ inline NtfsIndex const* NtfsIndex::unvolatile() const volatile noexcept
 // visibility; non-volatile overloads use relaxed semantics for performance.
 
 /// @brief Returns total count of (name, stream) pairs indexed.
-inline size_t NtfsIndex::total_names_and_streams() const noexcept
+template <class Index>
+inline size_t BasicNtfsIndex<Index>::total_names_and_streams() const noexcept
 {
 	return this->_total_names_and_streams.load(atomic_namespace::memory_order_relaxed);
 }
 
 /// @brief Returns total count of (name, stream) pairs indexed (volatile).
-inline size_t NtfsIndex::total_names_and_streams() const volatile noexcept
+template <class Index>
+inline size_t BasicNtfsIndex<Index>::total_names_and_streams() const volatile noexcept
 {
 	return this->_total_names_and_streams.load(atomic_namespace::memory_order_acquire);
 }
 
 /// @brief Returns count of hard links (additional names beyond first).
-inline size_t NtfsIndex::total_names() const noexcept
+template <class Index>
+inline size_t BasicNtfsIndex<Index>::total_names() const noexcept
 {
-	return this->nameinfos.size();
+	return this->nameinfos_size();
+}
+
+/**
+ * @brief How many times smaller intern_names() made the names pool.
+ *
+ * Characters before interning per character after, e.g. 1.6 if 4 of 10
+ * characters were duplicates; 1 if the pool was not interned (loading not
+ * finished, or the index is an opened snapshot).
+ */
+template <class Index>
+inline double BasicNtfsIndex<Index>::name_dedupe_ratio() const noexcept
+{
+	size_t const before = this->_names_before_interning, after = this->_names_after_interning;
+	return after ? static_cast<double>(before) / static_cast<double>(after) : 1.0;
+}
+
+/// @brief Bytes the names pool takes, packed (kLoadPackedNames) or not.
+template <class Index>
+inline size_t BasicNtfsIndex<Index>::names_bytes() const noexcept
+{
+	return (this->_snapshot ? this->_snapshot->names_size : this->names.capacity()) * sizeof(std::tvstring::value_type) +
+		this->packed_names.bytes();
+}
+
+/// @brief Bytes the records, their columns and their name, stream and child lists take; all of them Index wide.
+template <class Index>
+inline size_t BasicNtfsIndex<Index>::lists_bytes() const noexcept
+{
+	return this->records_data.capacity() * sizeof(Record) + this->first_streams.capacity() * sizeof(StreamInfo) +
+		this->timestamps.capacity() * sizeof(RecordTimes) + this->records_lookup.capacity() * sizeof(unsigned int) +
+		this->nameinfos.capacity() * sizeof(LinkInfo) + this->streaminfos.capacity() * sizeof(StreamInfo) +
+		this->childinfos.capacity() * sizeof(ChildInfo);
 }
 
 /// @brief Returns expected number of MFT records (for progress calculation).
-inline size_t NtfsIndex::expected_records() const noexcept
+template <class Index>
+inline size_t BasicNtfsIndex<Index>::expected_records() const noexcept
 {
 	return this->_expected_records;
 }
 
 /// @brief Returns number of streams preprocessed so far (volatile).
-inline size_t NtfsIndex::preprocessed_so_far() const volatile noexcept
+template <class Index>
+inline size_t BasicNtfsIndex<Index>::preprocessed_so_far() const volatile noexcept
 {
 	return this->_preprocessed_so_far.load(atomic_namespace::memory_order_acquire);
 }
 
 /// @brief Returns number of streams preprocessed so far.
-inline size_t NtfsIndex::preprocessed_so_far() const noexcept
+template <class Index>
+inline size_t BasicNtfsIndex<Index>::preprocessed_so_far() const noexcept
 {
 	return this->_preprocessed_so_far.load(atomic_namespace::memory_order_relaxed);
 }
 
 /// @brief Returns number of MFT records processed so far (volatile).
-inline size_t NtfsIndex::records_so_far() const volatile noexcept
+template <class Index>
+inline size_t BasicNtfsIndex<Index>::records_so_far() const volatile noexcept
 {
 	return this->_records_so_far.load(atomic_namespace::memory_order_acquire);
 }
 
 /// @brief Returns number of MFT records processed so far.
-inline size_t NtfsIndex::records_so_far() const noexcept
+template <class Index>
+inline size_t BasicNtfsIndex<Index>::records_so_far() const noexcept
 {
 	return this->_records_so_far.load(atomic_namespace::memory_order_relaxed);
 }
 
 /// @brief Returns the volume handle.
-inline void* NtfsIndex::volume() const volatile noexcept
+template <class Index>
+inline void* BasicNtfsIndex<Index>::volume() const volatile noexcept
 {
 	return this->_volume.value;
 }
 
 /// @brief Returns the mutex for thread-safe access.
-inline atomic_namespace::recursive_mutex& NtfsIndex::get_mutex() const volatile noexcept
+template <class Index>
+inline atomic_namespace::recursive_mutex& BasicNtfsIndex<Index>::get_mutex() const volatile noexcept
 {
 	return this->unvolatile()->_mutex;
 }
 
 /// @brief Returns cumulative I/O speed statistics.
-inline Speed NtfsIndex::speed() const volatile noexcept
+template <class Index>
+inline Speed BasicNtfsIndex<Index>::speed() const volatile noexcept
 {
 	Speed total;
 	total = this->_perf_avg_speed.load(atomic_namespace::memory_order_acquire);
@@ -474,33 +536,45 @@ inline Speed NtfsIndex::speed() const volatile noexcept
 }
 
 /// @brief Returns the root path of the indexed volume.
-inline std::tvstring const& NtfsIndex::root_path() const volatile noexcept
+template <class Index>
+inline std::tvstring const& BasicNtfsIndex<Index>::root_path() const volatile noexcept
 {
 	return const_cast<std::tvstring const&>(this->_root_path);
 }
 
 /// @brief Returns the finish result code (0 if not finished or success).
-inline unsigned int NtfsIndex::get_finished() const volatile noexcept
+template <class Index>
+inline unsigned int BasicNtfsIndex<Index>::get_finished() const volatile noexcept
 {
 	return this->_finished.load();
 }
 
+/// @brief Returns the LoadProfile flags the index was constructed with.
+template <class Index>
+inline unsigned int BasicNtfsIndex<Index>::load_profile() const volatile noexcept
+{
+	return this->_load_profile;
+}
+
 /// @brief Returns true if indexing was cancelled.
-inline bool NtfsIndex::cancelled() const volatile noexcept
+template <class Index>
+inline bool BasicNtfsIndex<Index>::cancelled() const volatile noexcept
 {
 	this_type const* const me = this->unvolatile();
 	return me->_cancelled.load(atomic_namespace::memory_order_acquire);
 }
 
 /// @brief Requests cancellation of the indexing operation.
-inline void NtfsIndex::cancel() volatile noexcept
+template <class Index>
+inline void BasicNtfsIndex<Index>::cancel() volatile noexcept
 {
 	this_type* const me = this->unvolatile();
 	me->_cancelled.store(true, atomic_namespace::memory_order_release);
 }
 
 /// @brief Returns the Windows event handle signaled when indexing finishes.
-inline uintptr_t NtfsIndex::finished_event() const noexcept
+template <class Index>
+inline uintptr_t BasicNtfsIndex<Index>::finished_event() const noexcept
 {
 	return reinterpret_cast<uintptr_t>(this->_finished_event.value);
 }
@@ -512,29 +586,30 @@ inline uintptr_t NtfsIndex::finished_event() const noexcept
 /**
  * @brief Pre-allocates memory for the expected number of MFT records.
  *
- * Called before indexing starts to minimize reallocations during parsing.
- * The reservation sizes are based on empirical analysis of typical NTFS
- * volumes:
- * - nameinfos: records + 6.25% (for hard links)
- * - streaminfos: records / 4 (most files have 1 stream, dirs have 0)
- * - childinfos: records * 1.5 (average directory has ~1.5 children)
- * - names: records * 23 (average file name ~23 characters)
+ * Called before indexing starts, with the number of in-use records when
+ * the $MFT bitmap gives it and the number of records otherwise. Only the
+ * record tables are sized here: the FRS lookup for every record of the
+ * MFT, and one record per expected record. The name, link, stream and
+ * child vectors are sized by make_room() from what parsing finds.
  *
  * @param records Expected number of MFT records
  */
-inline void NtfsIndex::reserve(unsigned int records)
+template <class Index>
+inline void BasicNtfsIndex<Index>::reserve(unsigned int records)
 {
 	this->_expected_records = records;
 	try
 	{
 		if (this->records_lookup.size() < records)
 		{
-			this->nameinfos.reserve(records + records / 16);
-			this->streaminfos.reserve(records / 4);
-			this->childinfos.reserve(records + records / 2);
-			this->names.reserve(records * 23);
-			this->records_lookup.resize(records, ~RecordsLookup::value_type());
-			this->records_data.reserve(records + records / 4);
+			this->records_lookup.resize(std::max(records, static_cast<unsigned int>(this->_mft_capacity)),
+				~RecordsLookup::value_type());
+			this->records_data.reserve(records);
+			this->first_streams.reserve(records);
+			if (!(this->_load_profile & kLoadNoTimestamps))
+			{
+				this->timestamps.reserve(records);
+			}
 		}
 	}
 	catch (std::bad_alloc&)
@@ -565,15 +640,14 @@ inline void NtfsIndex::reserve(unsigned int records)
  * @brief Gets or creates a record entry for the given FRS.
  *
  * If the FRS doesn't exist in the lookup table, creates a new entry.
- * The existing_to_revalidate parameter handles iterator invalidation
- * when the records_data vector is resized.
+ * Creating one may move records_data and its columns, so callers hold on to slots
+ * (records_lookup values) rather than iterators across calls.
  *
  * @param frs File Record Segment number
- * @param existing_to_revalidate Optional iterator to revalidate after resize
  * @return Iterator to the record entry
  */
-inline NtfsIndex::Records::iterator NtfsIndex::at(size_t const frs,
-	Records::iterator* const existing_to_revalidate)
+template <class Index>
+inline typename BasicNtfsIndex<Index>::Records::iterator BasicNtfsIndex<Index>::at(size_t const frs)
 {
 	// Expand lookup table if needed
 	if (frs >= this->records_lookup.size())
@@ -586,17 +660,12 @@ inline NtfsIndex::Records::iterator NtfsIndex::at(size_t const frs,
 	// If slot is empty (~0), create new record entry
 	if (!~*k)
 	{
-		// Save iterator offset before potential reallocation
-		ptrdiff_t const j = (existing_to_revalidate ? *existing_to_revalidate : this->records_data.end())
-			- this->records_data.begin();
-
 		*k = static_cast<unsigned int>(this->records_data.size());
 		this->records_data.resize(this->records_data.size() + 1);
-
-		// Restore iterator after reallocation
-		if (existing_to_revalidate)
+		this->first_streams.resize(this->records_data.size(), Record::no_stream());
+		if (!(this->_load_profile & kLoadNoTimestamps))
 		{
-			*existing_to_revalidate = this->records_data.begin() + j;
+			this->timestamps.resize(this->records_data.size());
 		}
 	}
 
@@ -614,35 +683,38 @@ inline NtfsIndex::Records::iterator NtfsIndex::at(size_t const frs,
  * @param frs File Record Segment number to find
  * @return Pointer to the record, or past-end pointer if not found
  */
+template <class Index>
 template <class Me>
-inline typename propagate_const<Me, NtfsIndex::Records::value_type>::type*
-NtfsIndex::_find(Me* const me, key_type_internal::frs_type const frs)
+inline typename propagate_const<Me, typename BasicNtfsIndex<Index>::Records::value_type>::type*
+BasicNtfsIndex<Index>::_find(Me* const me, typename key_type_internal::frs_type const frs)
 {
-	typedef typename propagate_const<Me, Records::value_type>::type* pointer_type;
+	typedef typename propagate_const<Me, typename Records::value_type>::type* pointer_type;
 	pointer_type result;
 
-	if (frs < me->records_lookup.size())
+	if (frs < me->records_lookup_size())
 	{
-		RecordsLookup::value_type const islot = me->records_lookup[frs];
+		RecordsLookup::value_type const islot = me->records_lookup_begin()[frs];
 		// fast_subscript avoids 'imul' instruction for better performance
-		result = fast_subscript(me->records_data.begin(), islot);
+		result = fast_subscript(me->records_data_begin(), islot);
 	}
 	else
 	{
 		// Return past-end pointer for out-of-range FRS
-		result = me->records_data.empty() ? nullptr : &*(me->records_data.end() - 1) + 1;
+		result = me->records_data_size() ? me->records_data_begin() + me->records_data_size() : nullptr;
 	}
 	return result;
 }
 
 /// @brief Finds a record by FRS (mutable version).
-inline NtfsIndex::Records::value_type* NtfsIndex::find(key_type_internal::frs_type const frs)
+template <class Index>
+inline typename BasicNtfsIndex<Index>::Records::value_type* BasicNtfsIndex<Index>::find(typename key_type_internal::frs_type const frs)
 {
 	return this->_find(this, frs);
 }
 
 /// @brief Finds a record by FRS (const version).
-inline NtfsIndex::Records::value_type const* NtfsIndex::find(key_type_internal::frs_type const frs) const
+template <class Index>
+inline typename BasicNtfsIndex<Index>::Records::value_type const* BasicNtfsIndex<Index>::find(typename key_type_internal::frs_type const frs) const
 {
 	return this->_find(this, frs);
 }
@@ -652,27 +724,31 @@ inline NtfsIndex::Records::value_type const* NtfsIndex::find(key_type_internal::
 // ============================================================================
 
 /// @brief Gets first child of a record (mutable).
-inline NtfsIndex::ChildInfos::value_type* NtfsIndex::childinfo(Records::value_type* const i)
+template <class Index>
+inline typename BasicNtfsIndex<Index>::ChildInfos::value_type* BasicNtfsIndex<Index>::childinfo(typename Records::value_type* const i)
 {
 	return this->childinfo(i->first_child);
 }
 
 /// @brief Gets first child of a record (const).
-inline NtfsIndex::ChildInfos::value_type const* NtfsIndex::childinfo(Records::value_type const* const i) const
+template <class Index>
+inline typename BasicNtfsIndex<Index>::ChildInfos::value_type const* BasicNtfsIndex<Index>::childinfo(typename Records::value_type const* const i) const
 {
 	return this->childinfo(i->first_child);
 }
 
 /// @brief Gets child entry by index (mutable). Returns nullptr if index is ~0.
-inline NtfsIndex::ChildInfos::value_type* NtfsIndex::childinfo(ChildInfo::next_entry_type const i)
+template <class Index>
+inline typename BasicNtfsIndex<Index>::ChildInfos::value_type* BasicNtfsIndex<Index>::childinfo(typename ChildInfo::next_entry_type const i)
 {
 	return !~i ? nullptr : fast_subscript(this->childinfos.begin(), i);
 }
 
 /// @brief Gets child entry by index (const). Returns nullptr if index is ~0.
-inline NtfsIndex::ChildInfos::value_type const* NtfsIndex::childinfo(ChildInfo::next_entry_type const i) const
+template <class Index>
+inline typename BasicNtfsIndex<Index>::ChildInfos::value_type const* BasicNtfsIndex<Index>::childinfo(typename ChildInfo::next_entry_type const i) const
 {
-	return !~i ? nullptr : fast_subscript(this->childinfos.begin(), i);
+	return !~i ? nullptr : fast_subscript(this->childinfos_begin(), i);
 }
 
 // ============================================================================
@@ -682,25 +758,29 @@ inline NtfsIndex::ChildInfos::value_type const* NtfsIndex::childinfo(ChildInfo::
 // inline in the record (first_name), additional names are in nameinfos.
 
 /// @brief Gets name entry by index (mutable). Returns nullptr if index is ~0.
-inline NtfsIndex::LinkInfos::value_type* NtfsIndex::nameinfo(LinkInfo::next_entry_type const i)
+template <class Index>
+inline typename BasicNtfsIndex<Index>::LinkInfos::value_type* BasicNtfsIndex<Index>::nameinfo(typename LinkInfo::next_entry_type const i)
 {
 	return !~i ? nullptr : fast_subscript(this->nameinfos.begin(), i);
 }
 
 /// @brief Gets name entry by index (const). Returns nullptr if index is ~0.
-inline NtfsIndex::LinkInfos::value_type const* NtfsIndex::nameinfo(LinkInfo::next_entry_type const i) const
+template <class Index>
+inline typename BasicNtfsIndex<Index>::LinkInfos::value_type const* BasicNtfsIndex<Index>::nameinfo(typename LinkInfo::next_entry_type const i) const
 {
-	return !~i ? nullptr : fast_subscript(this->nameinfos.begin(), i);
+	return !~i ? nullptr : fast_subscript(this->nameinfos_begin(), i);
 }
 
 /// @brief Gets first name of a record (mutable). Returns nullptr if no name.
-inline NtfsIndex::LinkInfos::value_type* NtfsIndex::nameinfo(Records::value_type* const i)
+template <class Index>
+inline typename BasicNtfsIndex<Index>::LinkInfos::value_type* BasicNtfsIndex<Index>::nameinfo(typename Records::value_type* const i)
 {
 	return ~i->first_name.name.offset() ? &i->first_name : nullptr;
 }
 
 /// @brief Gets first name of a record (const). Returns nullptr if no name.
-inline NtfsIndex::LinkInfos::value_type const* NtfsIndex::nameinfo(Records::value_type const* const i) const
+template <class Index>
+inline typename BasicNtfsIndex<Index>::LinkInfos::value_type const* BasicNtfsIndex<Index>::nameinfo(typename Records::value_type const* const i) const
 {
 	return ~i->first_name.name.offset() ? &i->first_name : nullptr;
 }
@@ -709,33 +789,215 @@ inline NtfsIndex::LinkInfos::value_type const* NtfsIndex::nameinfo(Records::valu
 // streaminfo: Access data stream entries
 // ============================================================================
 // Files can have multiple data streams (named streams). The first/default
-// stream is stored inline in the record (first_stream), additional streams
-// are in streaminfos.
+// stream is in the first_streams column, additional streams are in
+// streaminfos.
 
 /// @brief Gets stream entry by index (mutable). Returns nullptr if index is ~0.
-inline NtfsIndex::StreamInfos::value_type* NtfsIndex::streaminfo(StreamInfo::next_entry_type const i)
+template <class Index>
+inline typename BasicNtfsIndex<Index>::StreamInfos::value_type* BasicNtfsIndex<Index>::streaminfo(typename StreamInfo::next_entry_type const i)
 {
 	return !~i ? nullptr : fast_subscript(this->streaminfos.begin(), i);
 }
 
 /// @brief Gets stream entry by index (const). Returns nullptr if index is ~0.
-inline NtfsIndex::StreamInfos::value_type const* NtfsIndex::streaminfo(StreamInfo::next_entry_type const i) const
+template <class Index>
+inline typename BasicNtfsIndex<Index>::StreamInfos::value_type const* BasicNtfsIndex<Index>::streaminfo(typename StreamInfo::next_entry_type const i) const
 {
-	return !~i ? nullptr : fast_subscript(this->streaminfos.begin(), i);
+	return !~i ? nullptr : fast_subscript(this->streaminfos_begin(), i);
 }
 
 /// @brief Gets first stream of a record (mutable). Returns nullptr if no stream.
-inline NtfsIndex::StreamInfos::value_type* NtfsIndex::streaminfo(Records::value_type* const i)
+template <class Index>
+inline typename BasicNtfsIndex<Index>::StreamInfos::value_type* BasicNtfsIndex<Index>::streaminfo(typename Records::value_type* const i)
 {
-	assert(~i->first_stream.name.offset() || (!i->first_stream.name.length && !i->first_stream.length));
-	return ~i->first_stream.name.offset() ? &i->first_stream : nullptr;
+	typename StreamInfos::value_type* const k = this->first_stream(i);
+	assert(~k->name.offset() || (!k->name.length && !k->length));
+	return ~k->name.offset() ? k : nullptr;
 }
 
 /// @brief Gets first stream of a record (const). Returns nullptr if no stream.
-inline NtfsIndex::StreamInfos::value_type const* NtfsIndex::streaminfo(Records::value_type const* const i) const
+template <class Index>
+inline typename BasicNtfsIndex<Index>::StreamInfos::value_type const* BasicNtfsIndex<Index>::streaminfo(typename Records::value_type const* const i) const
+{
+	typename StreamInfos::value_type const* const k = this->first_stream(i);
+	assert(~k->name.offset() || (!k->name.length && !k->length));
+	return ~k->name.offset() ? k : nullptr;
+}
+
+// ============================================================================
+// Record columns
+// ============================================================================
+// A Record holds what tree walks read; its first stream and its timestamps
+// are in columns indexed by the same slot (see ntfs_record_types.hpp).
+
+/// @brief The first_streams entry of a record, used or not (mutable).
+template <class Index>
+inline typename BasicNtfsIndex<Index>::StreamInfos::value_type* BasicNtfsIndex<Index>::first_stream(typename Records::value_type const* const i)
+{
+	return fast_subscript(this->first_streams_begin(), static_cast<size_t>(i - this->records_data_begin()));
+}
+
+/// @brief The first_streams entry of a record, used or not (const).
+template <class Index>
+inline typename BasicNtfsIndex<Index>::StreamInfos::value_type const* BasicNtfsIndex<Index>::first_stream(typename Records::value_type const* const i) const
+{
+	return fast_subscript(this->first_streams_begin(), static_cast<size_t>(i - this->records_data_begin()));
+}
+
+/// @brief The timestamps of a record, or nullptr if the index keeps none (kLoadNoTimestamps).
+template <class Index>
+inline typename BasicNtfsIndex<Index>::Timestamps::value_type* BasicNtfsIndex<Index>::record_times(typename Records::value_type const* const i)
+{
+	assert(!this->_snapshot);
+	return this->timestamps.empty() ? nullptr
+		: fast_subscript(this->timestamps.begin(), static_cast<size_t>(i - this->records_data_begin()));
+}
+
+/// @brief Empties a record and its columns, as at() creates it.
+template <class Index>
+inline void BasicNtfsIndex<Index>::clear_record(typename Records::value_type* const i)
+{
+	*this->first_stream(i) = Record::no_stream();
+	if (typename Timestamps::value_type* const times = this->record_times(i))
+	{
+		*times = Timestamps::value_type();
+	}
+	*i = Record();
+}
+
+// ============================================================================
+// SECTION: Storage Access
+// ============================================================================
+// Read paths (find, *info, Matcher, ParentIterator) go through these so the
+// same code can search either the vectors filled by load() or the arrays of
+// a memory-mapped snapshot. A snapshot index never loads, so the mutable
+// overload only ever sees the vectors.
+
+/// @brief First record slot (mutable; never a snapshot).
+template <class Index>
+inline typename BasicNtfsIndex<Index>::Records::value_type* BasicNtfsIndex<Index>::records_data_begin() noexcept
+{
+	assert(!this->_snapshot);
+	return this->records_data.empty() ? nullptr : &*this->records_data.begin();
+}
+
+/// @brief First record slot.
+template <class Index>
+inline typename BasicNtfsIndex<Index>::Records::value_type const* BasicNtfsIndex<Index>::records_data_begin() const noexcept
+{
+	return this->_snapshot ? this->_snapshot->records_data
+		: this->records_data.empty() ? nullptr : &*this->records_data.begin();
+}
+
+/// @brief Number of record slots.
+template <class Index>
+inline size_t BasicNtfsIndex<Index>::records_data_size() const noexcept
+{
+	return this->_snapshot ? this->_snapshot->records_data_size : this->records_data.size();
+}
+
+/// @brief First stream of the first record slot (mutable; never a snapshot).
+template <class Index>
+inline typename BasicNtfsIndex<Index>::StreamInfos::value_type* BasicNtfsIndex<Index>::first_streams_begin() noexcept
+{
+	assert(!this->_snapshot);
+	return this->first_streams.empty() ? nullptr : &*this->first_streams.begin();
+}
+
+/// @brief First stream of the first record slot; there are records_data_size() of them.
+template <class Index>
+inline typename BasicNtfsIndex<Index>::StreamInfos::value_type const* BasicNtfsIndex<Index>::first_streams_begin() const noexcept
+{
+	return this->_snapshot ? this->_snapshot->first_streams
+		: this->first_streams.empty() ? nullptr : &*this->first_streams.begin();
+}
+
+/// @brief Timestamps of the first record slot.
+template <class Index>
+inline typename BasicNtfsIndex<Index>::Timestamps::value_type const* BasicNtfsIndex<Index>::timestamps_begin() const noexcept
+{
+	return this->_snapshot ? this->_snapshot->timestamps
+		: this->timestamps.empty() ? nullptr : &*this->timestamps.begin();
+}
+
+/// @brief Number of timestamps: records_data_size(), or 0 with kLoadNoTimestamps.
+template <class Index>
+inline size_t BasicNtfsIndex<Index>::timestamps_size() const noexcept
+{
+	return this->_snapshot ? this->_snapshot->timestamps_size : this->timestamps.size();
+}
+
+/// @brief FRS -> record slot table.
+template <class Index>
+inline typename BasicNtfsIndex<Index>::RecordsLookup::value_type const* BasicNtfsIndex<Index>::records_lookup_begin() const noexcept
+{
+	return this->_snapshot ? this->_snapshot->records_lookup : this->records_lookup.data();
+}
+
+/// @brief Number of FRS entries in the lookup table.
+template <class Index>
+inline size_t BasicNtfsIndex<Index>::records_lookup_size() const noexcept
+{
+	return this->_snapshot ? this->_snapshot->records_lookup_size : this->records_lookup.size();
+}
+
+/// @brief Name character storage.
+template <class Index>
+inline std::tvstring::value_type const* BasicNtfsIndex<Index>::names_begin() const noexcept
+{
+	return this->_snapshot ? this->_snapshot->names : this->names.data();
+}
+
+/// @brief Number of name characters.
+template <class Index>
+inline size_t BasicNtfsIndex<Index>::names_size() const noexcept
+{
+	return this->_snapshot ? this->_snapshot->names_size : this->packed_names.size() + this->names.size();
+}
+
+/// @brief Additional hard links.
+template <class Index>
+inline typename BasicNtfsIndex<Index>::LinkInfos::value_type const* BasicNtfsIndex<Index>::nameinfos_begin() const noexcept
+{
+	return this->_snapshot ? this->_snapshot->nameinfos
+		: this->nameinfos.empty() ? nullptr : &*this->nameinfos.begin();
+}
+
+/// @brief Number of additional hard links.
+template <class Index>
+inline size_t BasicNtfsIndex<Index>::nameinfos_size() const noexcept
+{
+	return this->_snapshot ? this->_snapshot->nameinfos_size : this->nameinfos.size();
+}
+
+/// @brief Additional streams.
+template <class Index>
+inline typename BasicNtfsIndex<Index>::StreamInfos::value_type const* BasicNtfsIndex<Index>::streaminfos_begin() const noexcept
+{
+	return this->_snapshot ? this->_snapshot->streaminfos
+		: this->streaminfos.empty() ? nullptr : &*this->streaminfos.begin();
+}
+
+/// @brief Number of additional streams.
+template <class Index>
+inline size_t BasicNtfsIndex<Index>::streaminfos_size() const noexcept
+{
+	return this->_snapshot ? this->_snapshot->streaminfos_size : this->streaminfos.size();
+}
+
+/// @brief Directory child entries.
+template <class Index>
+inline typename BasicNtfsIndex<Index>::ChildInfos::value_type const* BasicNtfsIndex<Index>::childinfos_begin() const noexcept
+{
+	return this->_snapshot ? this->_snapshot->childinfos
+		: this->childinfos.empty() ? nullptr : &*this->childinfos.begin();
+}
+
+/// @brief Number of directory child entries.
+template <class Index>
+inline size_t BasicNtfsIndex<Index>::childinfos_size() const noexcept
 {
-	assert(~i->first_stream.name.offset() || (!i->first_stream.name.length && !i->first_stream.length));
-	return ~i->first_stream.name.offset() ? &i->first_stream : nullptr;
+	return this->_snapshot ? this->_snapshot->childinfos_size : this->childinfos.size();
 }
 
 // ============================================================================
@@ -745,73 +1007,85 @@ inline NtfsIndex::StreamInfos::value_type const* NtfsIndex::streaminfo(Records::
 // that are set during initialization and used throughout indexing.
 
 /// @brief Returns number of clusters reserved for MFT zone.
-inline long long NtfsIndex::reserved_clusters() const volatile noexcept
+template <class Index>
+inline long long BasicNtfsIndex<Index>::reserved_clusters() const volatile noexcept
 {
 	return _reserved_clusters.load(std::memory_order_relaxed);
 }
 
 /// @brief Returns starting cluster of MFT zone.
-inline long long NtfsIndex::mft_zone_start() const noexcept
+template <class Index>
+inline long long BasicNtfsIndex<Index>::mft_zone_start() const noexcept
 {
 	return _mft_zone_start;
 }
 
 /// @brief Returns ending cluster of MFT zone.
-inline long long NtfsIndex::mft_zone_end() const noexcept
+template <class Index>
+inline long long BasicNtfsIndex<Index>::mft_zone_end() const noexcept
 {
 	return _mft_zone_end;
 }
 
 /// @brief Returns cluster size in bytes (typically 4096).
-inline unsigned int NtfsIndex::cluster_size() const noexcept
+template <class Index>
+inline unsigned int BasicNtfsIndex<Index>::cluster_size() const noexcept
 {
 	return _cluster_size;
 }
 
 /// @brief Returns MFT record size in bytes (typically 1024).
-inline unsigned int NtfsIndex::mft_record_size() const volatile noexcept
+template <class Index>
+inline unsigned int BasicNtfsIndex<Index>::mft_record_size() const volatile noexcept
 {
 	return _mft_record_size;
 }
 
 /// @brief Returns total capacity of MFT in records.
-inline unsigned int NtfsIndex::mft_capacity() const volatile noexcept
+template <class Index>
+inline unsigned int BasicNtfsIndex<Index>::mft_capacity() const volatile noexcept
 {
 	return _mft_capacity;
 }
 
 /// @brief Sets number of clusters reserved for MFT zone.
-inline void NtfsIndex::set_reserved_clusters(long long value) volatile noexcept
+template <class Index>
+inline void BasicNtfsIndex<Index>::set_reserved_clusters(long long value) volatile noexcept
 {
 	_reserved_clusters.store(value, std::memory_order_relaxed);
 }
 
 /// @brief Sets starting cluster of MFT zone.
-inline void NtfsIndex::set_mft_zone_start(long long value) noexcept
+template <class Index>
+inline void BasicNtfsIndex<Index>::set_mft_zone_start(long long value) noexcept
 {
 	_mft_zone_start = value;
 }
 
 /// @brief Sets ending cluster of MFT zone.
-inline void NtfsIndex::set_mft_zone_end(long long value) noexcept
+template <class Index>
+inline void BasicNtfsIndex<Index>::set_mft_zone_end(long long value) noexcept
 {
 	_mft_zone_end = value;
 }
 
 /// @brief Sets cluster size in bytes.
-inline void NtfsIndex::set_cluster_size(unsigned int value) noexcept
+template <class Index>
+inline void BasicNtfsIndex<Index>::set_cluster_size(unsigned int value) noexcept
 {
 	_cluster_size = value;
 }
 
 /// @brief Sets MFT record size in bytes.
-inline void NtfsIndex::set_mft_record_size(unsigned int value) noexcept
+template <class Index>
+inline void BasicNtfsIndex<Index>::set_mft_record_size(unsigned int value) noexcept
 {
 	_mft_record_size = value;
 }
 
 /// @brief Sets total capacity of MFT in records.
-inline void NtfsIndex::set_mft_capacity(unsigned int value) noexcept
+template <class Index>
+inline void BasicNtfsIndex<Index>::set_mft_capacity(unsigned int value) noexcept
 {
 	_mft_capacity = value;
 }
@@ -832,7 +1106,8 @@ inline void NtfsIndex::set_mft_capacity(unsigned int value) noexcept
  *
  * @note Thread-safe via atomic operations on _perf_avg_speed.
  */
-inline void NtfsIndex::report_speed(unsigned long long const size,
+template <class Index>
+inline void BasicNtfsIndex<Index>::report_speed(unsigned long long const size,
 	clock_t const tfrom,
 	clock_t const tto)
 {
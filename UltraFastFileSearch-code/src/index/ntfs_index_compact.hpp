@@ -0,0 +1,226 @@
+/**
+ * @file ntfs_index_compact.hpp
+ * @brief Contiguous name, stream and child lists once loading finishes.
+ *
+ * load() grows every list at its head, so the entries of one list end up
+ * wherever the vector happened to end at the time; walking a directory's
+ * children, or a record's names or streams, touches a new cache line per
+ * entry. compact_lists() rewrites nameinfos, streaminfos and childinfos so
+ * that each list is one run of consecutive entries, in list order:
+ *
+ * ```
+ *   before:  first_child ──► [812] ──► [17] ──► [5530] ──► ~0
+ *   after:   first_child ──► [40]  ──► [41] ──► [42]   ──► ~0
+ * ```
+ *
+ * That is the layout of a CSR (offset + count) table - the offset is the
+ * head index and the count is name_count / stream_count - but next_entry
+ * is kept, so every walker and every in-place edit works on either layout.
+ *
+ * - Children are laid out depth first from the root, in the order
+ *   matches() and the Preprocessor visit them, so the next list a
+ *   traversal reads is usually right after the one it just finished.
+ * - Records follow the same depth-first order, and with them their
+ *   first_streams and timestamps columns; records_lookup is rewritten to
+ *   match. A walk then reads the records, and each of their columns, front
+ *   to back instead of at random.
+ * - Names and streams follow records_data, next to nothing else.
+ * - While _lists_compact holds, nameinfo_at() and streaminfo_at() find the
+ *   n-th name or stream without walking. Anything that edits the lists
+ *   (link(), the Patcher) clears it, and they walk again.
+ *
+ * List order, and with it every name_info and stream_info of a key, is
+ * unchanged; only record slots move, and nothing outside the index sees
+ * them. Entries no list reaches any more are dropped, and the vectors lose
+ * the slack load() reserved.
+ *
+ * @note This file is included by ntfs_index_impl.hpp.
+ *       Do not include this file directly.
+ *
+ * @see ntfs_index_load.hpp for where load() calls compact_lists()
+ */
+
+#ifndef UFFS_NTFS_INDEX_COMPACT_HPP
+#define UFFS_NTFS_INDEX_COMPACT_HPP
+
+#ifndef UFFS_NTFS_INDEX_IMPL_HPP
+#error "Do not include ntfs_index_compact.hpp directly. Include ntfs_index.hpp instead."
+#endif
+
+/**
+ * @brief Lays out every name, stream and child list contiguously, and the records in walk order.
+ *
+ * Call under the lock once every record is linked; load() does so when it
+ * finishes, before the Preprocessor. Each vector is rewritten into a new
+ * copy that replaces the old one before the next is started, so the peak is
+ * one extra copy of the largest of them, not of all of them.
+ */
+template <class Index>
+inline void BasicNtfsIndex<Index>::compact_lists()
+{
+	// Appends the list starting at first to compacted, in order; returns its new head
+	auto const relay = [](auto const& entries, auto& compacted, auto const first)
+	{
+		typedef typename std::remove_const<decltype(first)>::type next_entry_type;
+		next_entry_type const head = ~first ? static_cast<next_entry_type>(compacted.size()) : first;
+		for (next_entry_type i = first; ~i;)
+		{
+			auto entry = entries[i];
+			i = entry.next_entry;
+			if (~i)
+			{
+				entry.next_entry = static_cast<next_entry_type>(compacted.size() + 1);
+			}
+			compacted.push_back(entry);
+		}
+		return head;
+	};
+
+	// Child lists depth first from the root, then those of records the root does not reach
+	ChildInfos childinfos;
+	childinfos.reserve(this->childinfos.size());
+	std::vector<bool> placed(this->records_data.size());
+	std::vector<RecordsLookup::value_type> pending, order;
+	order.reserve(this->records_data.size());
+	RecordsLookup::value_type const root_slot = kRootFRS < this->records_lookup.size()
+		? this->records_lookup[kRootFRS] : ~RecordsLookup::value_type();
+	for (size_t start = 0; start <= this->records_data.size(); ++start)
+	{
+		RecordsLookup::value_type const slot = start ? static_cast<RecordsLookup::value_type>(start - 1) : root_slot;
+		if (!~slot || placed[slot])
+		{
+			continue;
+		}
+		placed[slot] = true;
+		pending.push_back(slot);
+		while (!pending.empty())
+		{
+			typename Records::value_type& fr = this->records_data[pending.back()];
+			order.push_back(pending.back());
+			pending.pop_back();
+			size_t const begin = childinfos.size();
+			fr.first_child = relay(this->childinfos, childinfos, fr.first_child);
+
+			// Pushed last to first, so the first child's list is laid out next
+			for (size_t i = childinfos.size(); i != begin;)
+			{
+				unsigned int const frs = childinfos[--i].record_number;
+				RecordsLookup::value_type const child = ~frs && frs < this->records_lookup.size()
+					? this->records_lookup[frs] : ~RecordsLookup::value_type();
+				if (~child && !placed[child])
+				{
+					placed[child] = true;
+					pending.push_back(child);
+				}
+			}
+		}
+	}
+	this->childinfos = std::move(childinfos);
+
+	// Records and their columns in the same order, so a walk reads each of them front to back
+	std::vector<RecordsLookup::value_type> moved_to(order.size());
+	for (size_t i = 0; i != order.size(); ++i)
+	{
+		moved_to[order[i]] = static_cast<RecordsLookup::value_type>(i);
+	}
+	for (RecordsLookup::value_type& slot : this->records_lookup)
+	{
+		if (~slot)
+		{
+			slot = moved_to[slot];
+		}
+	}
+	std::vector<RecordsLookup::value_type>().swap(moved_to);
+	auto const reorder = [&order](auto& column)
+	{
+		typename std::remove_reference<decltype(column)>::type reordered;
+		reordered.reserve(order.size());
+		for (RecordsLookup::value_type const slot : order)
+		{
+			reordered.push_back(column[slot]);
+		}
+		column = std::move(reordered);
+	};
+	reorder(this->records_data);
+	reorder(this->first_streams);
+	if (!this->timestamps.empty())
+	{
+		reorder(this->timestamps);
+	}
+
+	// One list vector at a time, each freed before the next is copied
+	{
+		LinkInfos nameinfos;
+		nameinfos.reserve(this->nameinfos.size());
+		for (typename Records::iterator fr = this->records_data.begin(); fr != this->records_data.end(); ++fr)
+		{
+			fr->first_name.next_entry = relay(this->nameinfos, nameinfos, fr->first_name.next_entry);
+		}
+		this->nameinfos = std::move(nameinfos);
+	}
+	{
+		StreamInfos streaminfos;
+		streaminfos.reserve(this->streaminfos.size());
+		for (typename Records::iterator fr = this->records_data.begin(); fr != this->records_data.end(); ++fr)
+		{
+			typename StreamInfos::value_type* const k = this->first_stream(&*fr);
+			k->next_entry = relay(this->streaminfos, streaminfos, k->next_entry);
+		}
+		this->streaminfos = std::move(streaminfos);
+	}
+	this->_lists_compact = true;
+}
+
+/**
+ * @brief The @p n-th name of @p fr, as the n-th step of a nameinfo() walk would find it.
+ *
+ * @return nullptr if the record has no such name
+ */
+template <class Index>
+inline typename BasicNtfsIndex<Index>::LinkInfos::value_type const* BasicNtfsIndex<Index>::nameinfo_at(typename Records::value_type const* const fr,
+	size_t const n) const
+{
+	if (this->_lists_compact)
+	{
+		if (n >= fr->name_count)
+		{
+			return nullptr;
+		}
+		return n ? this->nameinfo(static_cast<typename LinkInfo::next_entry_type>(fr->first_name.next_entry + n - 1))
+			: this->nameinfo(fr);
+	}
+	typename LinkInfos::value_type const* j = this->nameinfo(fr);
+	for (size_t i = 0; j && i != n; ++i)
+	{
+		j = this->nameinfo(j->next_entry);
+	}
+	return j;
+}
+
+/**
+ * @brief The @p k-th stream of @p fr, as the k-th step of a streaminfo() walk would find it.
+ *
+ * @return nullptr if the record has no such stream
+ */
+template <class Index>
+inline typename BasicNtfsIndex<Index>::StreamInfos::value_type const* BasicNtfsIndex<Index>::streaminfo_at(typename Records::value_type const* const fr,
+	size_t const k) const
+{
+	if (this->_lists_compact)
+	{
+		if (k >= fr->stream_count)
+		{
+			return nullptr;
+		}
+		return k ? this->streaminfo(static_cast<typename StreamInfo::next_entry_type>(this->first_stream(fr)->next_entry + k - 1))
+			: this->streaminfo(fr);
+	}
+	typename StreamInfos::value_type const* s = this->streaminfo(fr);
+	for (size_t i = 0; s && i != k; ++i)
+	{
+		s = this->streaminfo(s->next_entry);
+	}
+	return s;
+}
+
+#endif // UFFS_NTFS_INDEX_COMPACT_HPP
@@ -0,0 +1,179 @@
+/**
+ * @file ntfs_index_early.hpp
+ * @brief Search while indexing: name matches reported before loading finishes.
+ *
+ * A pattern without a path matches a name on its own, so it needs neither
+ * the whole directory tree nor the directory totals. match_while_loading()
+ * runs such a pattern over every $FILE_NAME as parse() reads it; merge()
+ * queues the records that matched, and take_early_matches() hands over
+ * those whose path can already be built:
+ *
+ * ```
+ *   parse()              any thread        name ──► filter ──► kNameMatch
+ *   merge()              under the lock    kNameMatch ──► pending
+ *   take_early_matches() under the lock    pending ──► ready ──► func() per stream
+ *                                                  └─► not yet: stays pending
+ * ```
+ *
+ * A record is ready once it and every directory up to the root have been
+ * merged with exactly one name, none of them has an $ATTRIBUTE_LIST (its
+ * extension records may still add names), and every directory on the way
+ * is one matches() descends into. Everything else, hard-linked files
+ * included, is left to matches() once loading finishes; matched_early()
+ * tells the caller which records it has already seen, so each result is
+ * reported once and the results are the same as without early matches.
+ *
+ * func is called as matches(func, path, false, false, false) would call it
+ * for the record: with the bare name and the key of each stream that is
+ * not a non-data attribute. The streams and standard information of a
+ * ready record are final; directory totals are not computed yet.
+ *
+ * @note This file is included at the end of ntfs_index_impl.hpp.
+ *       Do not include this file directly.
+ *
+ * @see ntfs_index_matcher.hpp for matches()
+ */
+
+#ifndef UFFS_NTFS_INDEX_EARLY_HPP
+#define UFFS_NTFS_INDEX_EARLY_HPP
+
+#ifndef UFFS_NTFS_INDEX_IMPL_HPP
+#error "Do not include ntfs_index_early.hpp directly. Include ntfs_index.hpp instead."
+#endif
+
+/**
+ * @brief Runs @p filter over every name parsed from now on.
+ *
+ * Call before loading starts. The filter is called from the parsing
+ * threads concurrently, so it must not change any state; a glob
+ * string_matcher called through a const reference qualifies.
+ *
+ * @param filter  Returns true for names to report early
+ */
+template <class Index>
+inline void BasicNtfsIndex<Index>::match_while_loading(NameFilter filter)
+{
+	std::unique_ptr<EarlyMatches> early(new EarlyMatches());
+	early->filter = std::move(filter);
+	this->_early = std::move(early);
+}
+
+/// @brief The record of @p frs if merge() has created it, else nullptr.
+template <class Index>
+inline typename BasicNtfsIndex<Index>::Records::value_type const* BasicNtfsIndex<Index>::merged_record(unsigned int const frs) const
+{
+	return frs < this->records_lookup_size() && ~this->records_lookup_begin()[frs] ? this->find(frs) : nullptr;
+}
+
+/**
+ * @brief True if matches() would already reach @p frs the way it will once loading finishes.
+ *
+ * @param frs    A queued record
+ * @param depth  Receives the depth matches() would pass for it
+ */
+template <class Index>
+inline bool BasicNtfsIndex<Index>::early_match_ready(unsigned int const frs, size_t& depth) const
+{
+	// A path cannot be longer than 32767 characters; deeper chains are cycles
+	size_t const max_depth = 0x4000;
+
+	depth = 0;
+	for (unsigned int f = frs;; ++depth)
+	{
+		typename Records::value_type const* const fr = this->merged_record(f);
+		if (!fr || fr->name_count != 1 || (this->_early->state(f) & EarlyMatches::kIncomplete))
+		{
+			return false;
+		}
+		if (f == kRootFRS)
+		{
+			return true;
+		}
+		if (f < kFirstUserFRS || depth == max_depth)
+		{
+			return false;
+		}
+
+		// matches() descends into a directory after visiting one of its streams
+		if (f != frs)
+		{
+			bool visited = false;
+			for (typename StreamInfos::value_type const* k = this->streaminfo(fr); k && !visited; k = this->streaminfo(k->next_entry))
+			{
+				visited = !k->type_name_id ||
+					(k->type_name_id << (CHAR_BIT / 2)) == static_cast<int>(ntfs::AttributeTypeCode::AttributeData);
+			}
+			if (!visited)
+			{
+				return false;
+			}
+		}
+		f = static_cast<unsigned int>(fr->first_name.parent);
+	}
+}
+
+/**
+ * @brief Reports the queued records that are ready, and forgets them.
+ *
+ * Call under the lock, as often as results are wanted while loading. A
+ * record that is not ready stays queued for the next call. The loaders
+ * wait while @p func runs, so it should only copy out what it needs;
+ * format and print the results after releasing the lock.
+ *
+ * @param func  Called as by matches(): (name, length, ascii, key, depth)
+ * @return Number of records reported
+ */
+template <class Index>
+template <class F>
+inline size_t BasicNtfsIndex<Index>::take_early_matches(F&& func)
+{
+	if (!this->_early)
+	{
+		return 0;
+	}
+
+	std::vector<unsigned int>& pending = this->_early->pending;
+	NameCursor cursor;
+	size_t taken = 0, kept = 0;
+	for (unsigned int const frs : pending)
+	{
+		size_t depth;
+		if (this->_early->state(frs) & EarlyMatches::kTaken)
+		{
+			continue;
+		}
+		if (!this->early_match_ready(frs, depth))
+		{
+			pending[kept++] = frs;
+			continue;
+		}
+
+		typename Records::value_type const* const fr = this->find(frs);
+		NameInfo const& name = fr->first_name.name;
+		key_type key(frs, 0, 0);
+		for (typename StreamInfos::value_type const* k = this->streaminfo(fr); k;
+			k = this->streaminfo(k->next_entry), key.stream_info(key.stream_info() + 1))
+		{
+			bool const is_attribute = k->type_name_id &&
+				(k->type_name_id << (CHAR_BIT / 2)) != static_cast<int>(ntfs::AttributeTypeCode::AttributeData);
+			if (!is_attribute)
+			{
+				func(this->name_chars(name, cursor), name.length, name.ascii(), key, depth);
+			}
+		}
+
+		this->_early->set_state(frs, EarlyMatches::kTaken);
+		++taken;
+	}
+	pending.resize(kept);
+	return taken;
+}
+
+/// @brief True if take_early_matches() has reported @p frs.
+template <class Index>
+inline bool BasicNtfsIndex<Index>::matched_early(typename key_type::frs_type const frs) const noexcept
+{
+	return this->_early && (this->_early->state(frs) & EarlyMatches::kTaken);
+}
+
+#endif // UFFS_NTFS_INDEX_EARLY_HPP
@@ -0,0 +1,150 @@
+/**
+ * @file ntfs_index_fragment.hpp
+ * @brief Fragment - the attributes of a chunk of FILE records, parsed outside the lock.
+ *
+ * parse() fills a Fragment on any thread; load() links it into the index
+ * under the lock. Defined ahead of the other implementation files because
+ * the index keeps one to park extension-record attributes in.
+ *
+ * @note This file is included at the start of ntfs_index_impl.hpp.
+ *       Do not include this file directly.
+ *
+ * @see ntfs_index_load.hpp for parse(), load() and resolve_extensions()
+ */
+
+#ifndef UFFS_NTFS_INDEX_FRAGMENT_HPP
+#define UFFS_NTFS_INDEX_FRAGMENT_HPP
+
+#ifndef UFFS_NTFS_INDEX_IMPL_HPP
+#error "Do not include ntfs_index_fragment.hpp directly. Include ntfs_index.hpp instead."
+#endif
+
+/**
+ * @brief Attributes of a run of FILE records, parsed without touching the index.
+ *
+ * parse() walks the attributes of every record of a chunk into a fragment
+ * on the calling thread; load() then links the fragment into the index
+ * under the lock. Parsing (attribute walk, mapping pairs, ASCII detection,
+ * name copies) is the expensive part and runs on as many threads as there
+ * are chunks in flight; linking is a single pass over compact entries.
+ *
+ * Names are laid out exactly as load() would append them to the index, so
+ * linking appends them in one block and relocates their offsets.
+ *
+ * Attributes of extension records do not go to attributes but are parked
+ * in extensions, together with the entries of the resident $ATTRIBUTE_LIST
+ * of base records that point to other segments. A chunk is parsed without
+ * knowing whether the base record of an extension has been seen; load()
+ * links every parked attribute in one pass once all chunks have arrived
+ * (see NtfsIndex::resolve_extensions()).
+ *
+ * A fragment can be reused; parse() clears it first.
+ */
+template <class Index>
+struct BasicNtfsIndex<Index>::Fragment
+{
+	enum Kind : unsigned char
+	{
+		kStandardInformation,
+		kFileName,
+		kStream
+	};
+
+	enum Flags : unsigned char
+	{
+		kAscii             = 0x1,   ///< Name is stored one byte per character
+		kDirectoryIndex    = 0x2,   ///< Stream is the $I30 index of a directory
+		kSparse            = 0x4,   ///< Stream is sparse
+		kNameMatch         = 0x8,   ///< kFileName: the name passed the match_while_loading() filter
+		kAttributeList     = 0x10,  ///< kStandardInformation: the record has an $ATTRIBUTE_LIST
+		kNewDirectoryIndex = 0x20   ///< kStream: the first $I30 attribute of a base record; creates the stream
+	};
+
+	/// One attribute to add to the record of frs_base, in record order.
+	struct Attribute
+	{
+		unsigned int frs_base;
+		Kind kind;
+		unsigned char name_length;
+		unsigned char type_name_id;  ///< kStream
+		unsigned char flags;
+		Index name_offset;           ///< Into names; kFileName, and kStream unless kDirectoryIndex
+		unsigned int parent;         ///< kFileName
+		union
+		{
+			StandardInfo stdinfo;    ///< kStandardInformation
+			struct
+			{
+				unsigned long long allocated, length;
+			} sizes;                 ///< kStream
+		};
+	};
+
+	/// An attribute of an extension record, waiting for its base record.
+	struct Extension
+	{
+		Attribute attribute;
+		unsigned int segment;      ///< FRS of the extension record
+		unsigned short instance;   ///< Attribute instance within the segment
+	};
+
+	/// An $ATTRIBUTE_LIST entry of a base record that points to another segment.
+	struct ListEntry
+	{
+		unsigned int frs_base;
+		unsigned int segment;
+		unsigned short instance;
+		unsigned short ordinal;    ///< Position in the list
+	};
+
+	std::vector<Attribute> attributes;
+	std::vector<Extension> extensions;
+	std::vector<ListEntry> attribute_lists;
+	std::tvstring names;
+	long long reserved_clusters;  ///< Clusters of the MFT zone found in use
+	unsigned int records;         ///< Records covered, in use or not
+
+	// What merge() will add to the index vectors, counted while parsing (see make_room())
+	unsigned int in_use;          ///< In-use records parsed
+	unsigned int links;           ///< Names beyond the first of a record: nameinfos
+	unsigned int children;        ///< Names whose parent is another record: childinfos
+	unsigned int streams;         ///< Streams beyond the first of a record: streaminfos
+
+	Fragment() : reserved_clusters(), records(), in_use(), links(), children(), streams() {}
+
+	void clear()
+	{
+		this->attributes.clear();
+		this->extensions.clear();
+		this->attribute_lists.clear();
+		this->names.clear();
+		this->reserved_clusters = 0;
+		this->records = 0;
+		this->in_use = 0;
+		this->links = 0;
+		this->children = 0;
+		this->streams = 0;
+	}
+
+	Attribute& add(unsigned int const frs_base, Kind const kind)
+	{
+		this->attributes.push_back(Attribute());
+		Attribute& result = this->attributes.back();
+		result.frs_base = frs_base;
+		result.kind = kind;
+		return result;
+	}
+
+	/// Moves the attribute added last to extensions.
+	void park(unsigned int const segment, unsigned short const instance)
+	{
+		Extension extension;
+		extension.attribute = this->attributes.back();
+		extension.segment = segment;
+		extension.instance = instance;
+		this->extensions.push_back(extension);
+		this->attributes.pop_back();
+	}
+};
+
+#endif // UFFS_NTFS_INDEX_FRAGMENT_HPP
@@ -0,0 +1,30 @@
+/**
+ * @file ntfs_index_fwd.hpp
+ * @brief Forward declarations of the index and its two widths.
+ *
+ * The index is a template on the type of its name offsets and list links
+ * (see BasicNameInfo and basic_key_type_internal):
+ *
+ * | Type           | Index              | Names pool    | Key     |
+ * |----------------|--------------------|---------------|---------|
+ * | NtfsIndex      | unsigned int       | < 2G elements | 8 bytes |
+ * | HugeNtfsIndex  | unsigned long long | < 2^63        | 12 bytes|
+ *
+ * NtfsIndex is what the CLI and the GUI use; load() stops with
+ * std::length_error if a volume outgrows it. HugeNtfsIndex is for volumes
+ * (or merged indexes) whose names, links or streams do not fit in 32 bits.
+ *
+ * Headers that only pass an index around include this one instead of
+ * ntfs_index.hpp.
+ */
+
+#ifndef UFFS_NTFS_INDEX_FWD_HPP
+#define UFFS_NTFS_INDEX_FWD_HPP
+
+template <class Index>
+class BasicNtfsIndex;
+
+typedef BasicNtfsIndex<unsigned int> NtfsIndex;             ///< The compact layout
+typedef BasicNtfsIndex<unsigned long long> HugeNtfsIndex;  ///< 64-bit name offsets and list links
+
+#endif // UFFS_NTFS_INDEX_FWD_HPP
@@ -11,7 +11,7 @@
  * The NtfsIndex class maintains an in-memory representation of the NTFS
  * Master File Table (MFT). The index is built in two phases:
  *
- * 1. **Loading Phase** (preload_concurrent + load):
+ * 1. **Loading Phase** (preload_concurrent + parse + load):
  *    - Pre-scan MFT records to determine capacity and pre-allocate vectors
  *    - Parse each MFT record, extracting attributes:
  *      - StandardInformation: timestamps, file attributes
@@ -31,7 +31,7 @@
  *                                                  │
  *                         ┌────────────────────────┼────────────────────────┐
  *                         ▼                        ▼                        ▼
- *                    first_name              first_stream             first_child
+ *                    first_name          first_streams[slot]          first_child
  *                    (LinkInfo)              (StreamInfo)             (ChildInfo)
  *                         │                        │                        │
  *                         ▼                        ▼                        ▼
@@ -49,10 +49,20 @@
  *
  * | File                        | Content                                    |
  * |-----------------------------|--------------------------------------------|
+ * | ntfs_index_fragment.hpp     | Fragment - a chunk parsed outside the lock |
  * | ntfs_index_accessors.hpp    | Constructor, destructor, accessors         |
- * | ntfs_index_load.hpp         | preload_concurrent(), load(), Preprocessor |
+ * | ntfs_index_load.hpp         | preload_concurrent(), parse(), load()      |
+ * | ntfs_index_compact.hpp      | compact_lists() - contiguous lists         |
+ * | ntfs_index_intern.hpp       | intern_names() - one copy of each name     |
+ * | ntfs_index_packed_names.hpp | pack_names(), name_chars() - LZ4 names     |
+ * | ntfs_index_preprocess.hpp   | Preprocessor - parallel directory totals   |
  * | ntfs_index_path.hpp         | ParentIterator - path reconstruction       |
  * | ntfs_index_matcher.hpp      | Matcher template - pattern matching        |
+ * | ntfs_index_early.hpp        | Early name matches while loading           |
+ * | ntfs_index_snapshot.hpp     | save_snapshot(), open_snapshot()           |
+ * | ntfs_index_patch.hpp        | Patcher - in-place edits of finished index |
+ * | ntfs_index_usn.hpp          | apply_usn_events() - journal replay        |
+ * | ntfs_index_refresh.hpp      | begin_refresh() ... finish_refresh()       |
  *
  * ## Key Concepts
  *
@@ -86,22 +96,50 @@
 // SECTION: Implementation Component Includes
 // ============================================================================
 // The implementation is split into focused files for maintainability.
-// Include order matters: accessors first, then load (contains inline
-// Preprocessor struct), then path and matcher.
+// Include order matters: Fragment and accessors first, then load and the
+// Preprocessor, then path and matcher.
+
+// The parsed-chunk type, which the index also uses as storage
+#include "ntfs_index_fragment.hpp"
 
 // Accessors, constructor, destructor, lifecycle management
 #include "ntfs_index_accessors.hpp"
 
-// Core MFT parsing: preload_concurrent() and load()
-// Note: The Preprocessor struct for directory size calculation is defined
-// inline within the load() function as an anonymous local struct.
+// Core MFT parsing: preload_concurrent(), parse() and load()
 #include "ntfs_index_load.hpp"
 
+// Contiguous name, stream and child lists once loading finishes
+#include "ntfs_index_compact.hpp"
+
+// One shared copy of each distinct name once loading finishes
+#include "ntfs_index_intern.hpp"
+
+// The names pool in LZ4 blocks (kLoadPackedNames), and the one way to read a name
+#include "ntfs_index_packed_names.hpp"
+
+// Directory totals once loading finishes: the parallel Preprocessor
+#include "ntfs_index_preprocess.hpp"
+
 // Path reconstruction via ParentIterator state machine
 #include "ntfs_index_path.hpp"
 
 // Pattern matching via Matcher template
 #include "ntfs_index_matcher.hpp"
 
+// Name matches reported while loading
+#include "ntfs_index_early.hpp"
+
+// Persistent UFFS-IDX snapshots (save / memory-map)
+#include "ntfs_index_snapshot.hpp"
+
+// In-place edits that keep directory totals exact (used by the next two)
+#include "ntfs_index_patch.hpp"
+
+// Incremental refresh from USN change journal events
+#include "ntfs_index_usn.hpp"
+
+// Periodic MFT re-scan that re-parses only changed chunks
+#include "ntfs_index_refresh.hpp"
+
 #endif // UFFS_NTFS_INDEX_IMPL_HPP
 
@@ -0,0 +1,190 @@
+/**
+ * @file ntfs_index_intern.hpp
+ * @brief One shared copy of each distinct name once loading finishes.
+ *
+ * load() appends every $FILE_NAME and stream name it links to the names
+ * pool, so a volume stores "desktop.ini", "Thumbs.db", stream names such as
+ * "Zone.Identifier" and the DLL names repeated across WinSxS once per
+ * occurrence. intern_names() rebuilds the pool with each distinct
+ * name stored once and points every NameInfo at that copy:
+ *
+ * ```
+ *   before:  names  [desktop.ini][a.txt][desktop.ini][b.txt][desktop.ini]
+ *                    ▲            ▲      ▲            ▲      ▲
+ *   after:   names  [desktop.ini][a.txt][b.txt]
+ *                    ▲  ▲  ▲      ▲      ▲
+ * ```
+ *
+ * - Two names are the same if they have the same length, the same
+ *   encoding (ascii()) and the same characters. An ASCII name and the
+ *   UTF-16 spelling of the same name are kept apart, as every reader
+ *   decodes a name by its own flag.
+ * - The names are hashed in parallel; the table is then filled on the
+ *   calling thread, in list order, so the new pool is laid out in the
+ *   order compact_lists() left the lists: each distinct name sits where a
+ *   walk first reads it.
+ * - Empty names (the $I30 index and unnamed $DATA streams) point at
+ *   offset 0, which is in range whatever the pool size.
+ * - Names only ever get appended (the Patcher's set_name()), never edited
+ *   in place, so sharing a copy is safe for every later edit.
+ *
+ * name_dedupe_ratio() reports how much smaller the pool became.
+ *
+ * @note This file is included by ntfs_index_impl.hpp.
+ *       Do not include this file directly.
+ *
+ * @see ntfs_index_load.hpp for where load() calls intern_names()
+ */
+
+#ifndef UFFS_NTFS_INDEX_INTERN_HPP
+#define UFFS_NTFS_INDEX_INTERN_HPP
+
+#ifndef UFFS_NTFS_INDEX_IMPL_HPP
+#error "Do not include ntfs_index_intern.hpp directly. Include ntfs_index.hpp instead."
+#endif
+
+/**
+ * @brief Rebuilds the names pool with one copy of each distinct name.
+ *
+ * Call under the lock after compact_lists(); load() does so when it
+ * finishes. Needs about 30 bytes per name while it runs (50 in a
+ * HugeNtfsIndex), on top of the new pool.
+ *
+ * Hashes, table slots and name indices are Index wide. A 32-bit index has
+ * fewer than 2^31 names (each still has its own copy in a pool of at most
+ * NameInfo::max_offset characters), so its table stays within 2^32 slots;
+ * a HugeNtfsIndex gets 64-bit hashes to spread names over a larger table.
+ */
+template <class Index>
+inline void BasicNtfsIndex<Index>::intern_names()
+{
+	// Every non-empty name the lists reach, in list order; empty ones go to offset 0
+	std::vector<NameInfo*> refs;
+	refs.reserve(this->nameinfos.size() + this->streaminfos.size() + this->records_data.size() * 2);
+	auto const add = [&refs](NameInfo& name)
+	{
+		if (name.length)
+		{
+			refs.push_back(&name);
+		}
+		else
+		{
+			name.offset(0);
+		}
+	};
+	for (typename Records::iterator fr = this->records_data.begin(); fr != this->records_data.end(); ++fr)
+	{
+		for (typename LinkInfos::value_type* j = this->nameinfo(&*fr); j; j = this->nameinfo(j->next_entry))
+		{
+			add(j->name);
+		}
+		for (typename StreamInfos::value_type* k = this->streaminfo(&*fr); k; k = this->streaminfo(k->next_entry))
+		{
+			add(k->name);
+		}
+	}
+
+	std::tvstring::value_type const* const old_names = this->names.data();
+	auto const bytes = [](NameInfo const& name) -> size_t
+	{
+		return name.ascii() ? name.length : name.length * sizeof(std::tvstring::value_type);
+	};
+
+	require_width(0, refs.size());
+
+	// Hashes, in parallel: each thread takes one run of names
+	std::vector<Index> hashes(refs.size());
+	auto const hash_range = [&](size_t const begin, size_t const end)
+	{
+		for (size_t i = begin; i != end; ++i)
+		{
+			NameInfo const& name = *refs[i];
+			hashes[i] = static_cast<Index>(uffs::uffs_index_checksum(old_names + name.offset(), bytes(name),
+				name.ascii() ? 1 : 0));
+		}
+	};
+	size_t const min_names_per_thread = 1U << 16;
+	size_t threads = std::thread::hardware_concurrency();
+	threads = std::max<size_t>(1, std::min(threads, refs.size() / min_names_per_thread));
+	size_t const per_thread = (refs.size() + threads - 1) / threads;
+	{
+		std::vector<std::thread> workers;
+		workers.reserve(threads);
+		for (size_t begin = per_thread; begin < refs.size(); begin += per_thread)
+		{
+			size_t const end = std::min(begin + per_thread, refs.size());
+			try
+			{
+				workers.emplace_back(hash_range, begin, end);
+			}
+			catch (std::system_error const&)
+			{
+				hash_range(begin, end);
+			}
+		}
+		hash_range(0, std::min(per_thread, refs.size()));
+		for (auto& w : workers)
+		{
+			w.join();
+		}
+	}
+
+	// First occurrence of each name, through an open-addressed table of name indices + 1
+	size_t table_size = 16;
+	while (table_size < refs.size() * 2)
+	{
+		table_size *= 2;
+	}
+	std::vector<Index> table(table_size);
+	std::vector<Index> first(refs.size());
+	size_t interned_size = 0;
+	for (size_t i = 0; i != refs.size(); ++i)
+	{
+		NameInfo const& name = *refs[i];
+		size_t slot = static_cast<size_t>(hashes[i] & (table_size - 1));
+		for (;; slot = (slot + 1) & (table_size - 1))
+		{
+			Index const seen = table[slot];
+			if (!seen)
+			{
+				table[slot] = static_cast<Index>(i + 1);
+				first[i] = static_cast<Index>(i);
+				interned_size += name_units(name);
+				break;
+			}
+			NameInfo const& other = *refs[seen - 1];
+			if (hashes[seen - 1] == hashes[i] && other.length == name.length && other.ascii() == name.ascii() &&
+				memcmp(old_names + other.offset(), old_names + name.offset(), bytes(name)) == 0)
+			{
+				first[i] = seen - 1;
+				break;
+			}
+		}
+	}
+	std::vector<Index>().swap(table);
+	std::vector<Index>().swap(hashes);
+
+	// The new pool; a repeat takes the offset its first occurrence got a moment before
+	std::tvstring interned;
+	interned.reserve(interned_size);
+	for (size_t i = 0; i != refs.size(); ++i)
+	{
+		NameInfo& name = *refs[i];
+		if (first[i] == i)
+		{
+			size_t const offset = interned.size();
+			interned.append(old_names + name.offset(), old_names + name.offset() + name_units(name));
+			name.offset(static_cast<Index>(offset));
+		}
+		else
+		{
+			name.offset(refs[first[i]]->offset());
+		}
+	}
+
+	this->_names_before_interning = this->names.size();
+	this->_names_after_interning = interned.size();
+	this->names = std::move(interned);
+}
+
+#endif // UFFS_NTFS_INDEX_INTERN_HPP
@@ -7,18 +7,28 @@
  *
  * ## Architecture Overview
  *
- * The MFT loading process has two phases:
+ * The MFT loading process has three phases:
  *
  * 1. **Preload Phase** (preload_concurrent):
  *    - Called from multiple threads concurrently
  *    - Applies multi-sector fixup to validate records
- *    - Pre-allocates vectors to avoid reallocations during load
+ *    - Grows the FRS lookup table to the highest FRS seen
  *
- * 2. **Load Phase** (load):
- *    - Called sequentially with ordered MFT chunks
- *    - Parses NTFS attributes from each record
- *    - Builds parent-child relationships
- *    - Runs preprocessor to calculate directory sizes
+ * 2. **Parse Phase** (parse):
+ *    - Called from multiple threads concurrently, without the lock
+ *    - Parses NTFS attributes of each record into a per-chunk Fragment,
+ *      counting what load() will add to each vector
+ *
+ * 3. **Load Phase** (load):
+ *    - Called under the lock, one chunk at a time
+ *    - Links the fragment into the records: names, streams, parent-child
+ *      relationships
+ *    - Parks the attributes of extension records; once every chunk is in,
+ *      links them in $ATTRIBUTE_LIST order (resolve_extensions)
+ *    - Lays every list out contiguously (compact_lists)
+ *    - Keeps one copy of each distinct name (intern_names), and with
+ *      kLoadPackedNames packs the pool into LZ4 blocks (pack_names)
+ *    - Runs preprocessor to calculate directory sizes (unless deferred)
  *
  * ## Processing Pipeline
  *
@@ -26,29 +36,39 @@
  *   MFT Reader                    NtfsIndex
  *       |                             |
  *       |  preload_concurrent()       |
+ *       |  parse()                    |
  *       |  (concurrent, unordered)    |
  *       |---------------------------->|  Fixup + pre-allocate
+ *       |                             |  Parse attributes into a Fragment
  *       |                             |
- *       |  load()                     |
- *       |  (sequential, ordered)      |
- *       |---------------------------->|  Parse attributes
+ *       |  load(fragment)             |
+ *       |  (serialized)               |
+ *       |---------------------------->|  Append names, link records
  *       |                             |  Build relationships
+ *       |                             |  Link extension records
+ *       |                             |  Compact the lists
  *       |                             |  Run preprocessor
  *       |                             |
  *       |                        [Index Ready]
  * ```
  *
+ * Linking is a single pass over compact entries, so index build time
+ * scales with the number of threads parsing rather than being capped by
+ * one thread holding the lock.
+ *
  * ## Multi-Sector Fixup
  *
  * NTFS uses a multi-sector protection scheme where the last two bytes of each
- * 512-byte sector are replaced with a sequence number. The unfixup() method
- * restores the original bytes and validates the sequence numbers match.
+ * 512-byte sector are replaced with a sequence number. mft_fixup_records()
+ * restores the original bytes of a whole buffer of records at once and
+ * validates the sequence numbers match, with SIMD where the CPU has it.
  * If validation fails, the record is marked as 'BAAD' (bad).
  *
  * ## Thread Safety
  *
- * - preload_concurrent(): Thread-safe, can be called from multiple threads
- * - load(): NOT thread-safe, must be called sequentially with ordered chunks
+ * - preload_concurrent(), parse(): Thread-safe, can be called from multiple threads
+ * - load(): NOT thread-safe, must be called under the lock. Chunks may come
+ *   in any order; replays load them in order so the result is reproducible
  *
  * @note This file is included by ntfs_index_impl.hpp.
  *       Do not include this file directly.
@@ -75,14 +95,15 @@
  * This method is called from multiple threads during the concurrent MFT
  * reading phase. It performs two critical tasks:
  *
- * 1. **Multi-sector fixup**: Validates and restores sector end bytes
+ * 1. **Multi-sector fixup**: Validates and restores sector end bytes (mft_fixup.hpp)
  * 2. **Vector pre-allocation**: Ensures vectors are sized for all FRS numbers
  *
  * @param virtual_offset Byte offset in the MFT file where this buffer starts
  * @param buffer         Pointer to the raw MFT data buffer
  * @param size           Size of the buffer in bytes
  */
-inline void NtfsIndex::preload_concurrent(unsigned long long virtual_offset,
+template <class Index>
+inline void BasicNtfsIndex<Index>::preload_concurrent(unsigned long long virtual_offset,
 	void* buffer,
 	size_t size) volatile
 {
@@ -104,37 +125,30 @@ inline void NtfsIndex::preload_concurrent(unsigned long long virtual_offset,
 	assert((1U << mft_record_size_log2) == mft_record_size && "MFT record size not a power of 2");
 	unsigned int const mft_record_size_pow2_mod_mask = mft_record_size - 1;
 
-	// Iterate through each MFT record in the buffer
-	for (size_t i = virtual_offset & mft_record_size_pow2_mod_mask
-			 ? mft_record_size - virtual_offset & mft_record_size_pow2_mod_mask
-			 : 0;
-		i + mft_record_size <= size;
-		i += mft_record_size)
-	{
-		unsigned int const frs = static_cast<unsigned int>((virtual_offset + i) >> mft_record_size_log2);
-
-		ntfs::FILE_RECORD_SEGMENT_HEADER* const frsh =
-			reinterpret_cast<ntfs::FILE_RECORD_SEGMENT_HEADER*>(&static_cast<unsigned char*>(buffer)[i]);
+	// Fix up and validate every whole record of the buffer in one batch
+	size_t const first = virtual_offset & mft_record_size_pow2_mod_mask
+		? mft_record_size - virtual_offset & mft_record_size_pow2_mod_mask
+		: 0;
+	size_t const count = first < size ? (size - first) >> mft_record_size_log2 : 0;
+	std::vector<uint64_t> valid((count + 63) / 64);
+	mft_fixup_records(&static_cast<unsigned char*>(buffer)[first], count, mft_record_size, valid.data());
 
-		// Check for 'FILE' magic (stored as 'ELIF' in little-endian)
-		if (frsh->MultiSectorHeader.Magic == 'ELIF')
+	// Find the highest base FRS among the valid records
+	for (size_t r = 0; r != count; ++r)
+	{
+		if (valid[r / 64] >> (r % 64) & 1)
 		{
-			// Apply multi-sector fixup to validate and restore sector end bytes
-			if (frsh->MultiSectorHeader.unfixup(mft_record_size))
-			{
-				unsigned int const frs_base = frsh->BaseFileRecordSegment
-					? static_cast<unsigned int>(frsh->BaseFileRecordSegment)
-					: frs;
+			size_t const i = first + (r << mft_record_size_log2);
+			unsigned int const frs = static_cast<unsigned int>((virtual_offset + i) >> mft_record_size_log2);
+			ntfs::FILE_RECORD_SEGMENT_HEADER const* const frsh =
+				reinterpret_cast<ntfs::FILE_RECORD_SEGMENT_HEADER const*>(&static_cast<unsigned char*>(buffer)[i]);
+			unsigned int const frs_base = frsh->BaseFileRecordSegment
+				? static_cast<unsigned int>(frsh->BaseFileRecordSegment)
+				: frs;
 
-				if (max_frs_plus_one < frs_base + 1)
-				{
-					max_frs_plus_one = frs_base + 1;
-				}
-			}
-			else
+			if (max_frs_plus_one < frs_base + 1)
 			{
-				// Fixup failed - mark record as bad
-				frsh->MultiSectorHeader.Magic = 'DAAB';
+				max_frs_plus_one = frs_base + 1;
 			}
 		}
 	}
@@ -147,15 +161,14 @@ inline void NtfsIndex::preload_concurrent(unsigned long long virtual_offset,
 }
 
 // ============================================================================
-// SECTION: Main MFT Parsing (load method)
+// SECTION: Record Parsing
 // ============================================================================
 
 /**
- * @brief Parses MFT records and builds the in-memory file system index.
+ * @brief Parses the attributes of one in-use, fixed-up FILE record into @p fragment.
  *
- * This is the core method that transforms raw MFT data into the searchable
- * index. It processes each MFT record, extracts NTFS attributes, and builds
- * the data structures needed for fast file searching.
+ * Only reads the record and the volume geometry, so it can run on any
+ * thread while load() holds the lock.
  *
  * ## NTFS Attribute Types Handled
  *
@@ -167,19 +180,709 @@ inline void NtfsIndex::preload_concurrent(unsigned long long virtual_offset,
  * | IndexRoot/Allocation    | Directory index (as $I30 stream)  |
  * | ReparsePoint            | Compression info (WofCompressed)  |
  *
+ * Each attribute goes straight to what its type needs through a table
+ * indexed by Type / 0x10; only $DATA is checked for $BadClus:$Bad, only
+ * the index types for the $I30 name. The mapping pairs of a non-resident
+ * attribute are decoded only if its VCN range overlaps the MFT zone.
+ *
+ * The LoadProfile of the index leaves out timestamps, sizes, or every
+ * stream but the unnamed $DATA and the $I30 index. Without the named
+ * streams, WofCompressedData is not seen, so a WOF-compressed file counts
+ * the allocation of its unnamed stream only.
+ *
+ * With match_while_loading(), every name is also run through the filter
+ * here, on the parsing thread, and merge() queues the records that match.
+ *
+ * @param frs       FRS of the record
+ * @param frsh      The record
+ * @param fragment  Receives the attributes, appended
+ */
+template <class Index>
+inline void BasicNtfsIndex<Index>::parse_record(unsigned int const frs,
+	ntfs::FILE_RECORD_SEGMENT_HEADER const* const frsh,
+	Fragment& fragment) const
+{
+	unsigned int const mft_record_size = this->_mft_record_size;
+	unsigned int const frs_base = frsh->BaseFileRecordSegment
+		? static_cast<unsigned int>(frsh->BaseFileRecordSegment)
+		: frs;
+	void const* const frsh_end = frsh->end(mft_record_size);
+
+	// An extension record's names and streams are counted as extra; whichever
+	// segment is merged first takes the record's slots, so the totals still add up
+	bool const is_base = frs_base == frs;
+	bool has_name = false, has_stream = false, has_directory_index = false;
+	size_t standard_information = ~size_t();
+	++fragment.in_use;
+
+	// What each attribute needs is looked up by Type / 0x10 rather than tested
+	// for one case after another; types past the table are plain streams
+	enum Decoder : unsigned char
+	{
+		kDecodeStream,               ///< Kept with every stream; sizes, MFT zone
+		kDecodeStandardInformation,
+		kDecodeAttributeList,        ///< Extension order, then as kDecodeStream
+		kDecodeFileName,
+		kDecodeData,                 ///< The unnamed one is always kept; $BadClus:$Bad
+		kDecodeIndex                 ///< $I30 if so named, else as kDecodeStream
+	};
+	static Decoder const decoders[] =
+	{
+		kDecodeStream,                 // 0x00
+		kDecodeStandardInformation,    // 0x10
+		kDecodeAttributeList,          // 0x20
+		kDecodeFileName,               // 0x30
+		kDecodeStream,                 // 0x40 $OBJECT_ID
+		kDecodeStream,                 // 0x50 $SECURITY_DESCRIPTOR
+		kDecodeStream,                 // 0x60 $VOLUME_NAME
+		kDecodeStream,                 // 0x70 $VOLUME_INFORMATION
+		kDecodeData,                   // 0x80
+		kDecodeIndex,                  // 0x90 $INDEX_ROOT
+		kDecodeIndex,                  // 0xA0 $INDEX_ALLOCATION
+		kDecodeIndex,                  // 0xB0 $BITMAP
+	};
+
+	bool const keep_timestamps = !(this->_load_profile & kLoadNoTimestamps);
+	bool const keep_sizes = !(this->_load_profile & kLoadNoSizes);
+	bool const keep_all_streams = !(this->_load_profile & kLoadNoStreams);
+	mapping_pair_iterator::lcn_type const mft_zone_begin = this->_mft_zone_start;
+	mapping_pair_iterator::lcn_type const mft_zone_end = this->_mft_zone_end;
+
+	// ================================================================
+	// Attribute Parsing Loop
+	// ================================================================
+	for (ntfs::ATTRIBUTE_RECORD_HEADER const* ah = frsh->begin();
+		 ah < frsh_end && ah->Type != ntfs::AttributeTypeCode::AttributeNone && ah->Type != ntfs::AttributeTypeCode::AttributeEnd;
+		 ah = ah->next())
+	{
+		size_t const attributes_before = fragment.attributes.size();
+
+		unsigned int const type = static_cast<unsigned int>(ah->Type);
+		Decoder const decoder = !(type & 0xF) && (type >> 4) < _countof(decoders) ? decoders[type >> 4] : kDecodeStream;
+		switch (decoder)
+		{
+		// ============================================================
+		// ATTRIBUTE: StandardInformation (0x10)
+		// ============================================================
+		case kDecodeStandardInformation:
+			if (ntfs::STANDARD_INFORMATION const* const fn =
+				static_cast<ntfs::STANDARD_INFORMATION const*>(ah->Resident.GetValue()))
+			{
+				standard_information = is_base ? fragment.attributes.size() : ~size_t();
+				typename Fragment::Attribute& attribute = fragment.add(frs_base, Fragment::kStandardInformation);
+				if (keep_timestamps)
+				{
+					attribute.stdinfo.created  = fn->CreationTime;
+					attribute.stdinfo.written  = fn->LastModificationTime;
+					attribute.stdinfo.accessed = fn->LastAccessTime;
+				}
+				attribute.stdinfo.attributes(fn->FileAttributes |
+					((frsh->Flags & ntfs::FRH_DIRECTORY) ? FILE_ATTRIBUTE_DIRECTORY : 0));
+			}
+			break;
+
+		// ============================================================
+		// ATTRIBUTE: FileName (0x30)
+		// ============================================================
+		case kDecodeFileName:
+			if (ntfs::FILENAME_INFORMATION const* const fn =
+				static_cast<ntfs::FILENAME_INFORMATION const*>(ah->Resident.GetValue()))
+			{
+				// Skip DOS-only names (0x02) - prefer Win32 or POSIX names
+				if (fn->Flags != 0x02 /*FILE_NAME_DOS */)
+				{
+					typename Fragment::Attribute& attribute = fragment.add(frs_base, Fragment::kFileName);
+					attribute.name_offset = static_cast<Index>(fragment.names.size());
+					attribute.name_length = static_cast<unsigned char>(fn->FileNameLength);
+					attribute.flags = append_name(fragment.names, fn->FileName, fn->FileNameLength) ? Fragment::kAscii : 0;
+					if (this->_early && this->_early->filter(fn->FileName, fn->FileNameLength))
+					{
+						attribute.flags |= Fragment::kNameMatch;
+					}
+					attribute.parent = static_cast<unsigned int>(fn->ParentDirectory);
+					if (!is_base || has_name)
+					{
+						++fragment.links;
+					}
+					if (attribute.parent != frs_base)
+					{
+						++fragment.children;
+					}
+					has_name = true;
+				}
+			}
+			break;
+
+		// ============================================================
+		// ATTRIBUTE: AttributeList (0x20)
+		// ============================================================
+		case kDecodeAttributeList:
+			// Attributes in other segments are parked by those segments; the list of
+			// the base record says in which order resolve_extensions() links them
+			if (is_base)
+			{
+				if (~standard_information)
+				{
+					fragment.attributes[standard_information].flags |= Fragment::kAttributeList;
+				}
+
+				// A non-resident list would take a read of its own; its extensions go in FRS order
+				if (!ah->IsNonResident)
+				{
+					unsigned char const* const list = static_cast<unsigned char const*>(ah->Resident.GetValue());
+					size_t const list_length = ah->Resident.ValueLength;
+					unsigned short ordinal = 0;
+					for (size_t offset = 0; list && offset + sizeof(ntfs::ATTRIBUTE_LIST) <= list_length; ++ordinal)
+					{
+						ntfs::ATTRIBUTE_LIST const* const entry = reinterpret_cast<ntfs::ATTRIBUTE_LIST const*>(list + offset);
+						if (!entry->Length)
+						{
+							break;
+						}
+
+						unsigned int const segment = static_cast<unsigned int>(entry->FileReferenceNumber & 0xFFFFFFFFFFFFULL);
+						if (segment != frs)
+						{
+							typename Fragment::ListEntry const list_entry = { frs, segment, entry->AttributeNumber, ordinal };
+							fragment.attribute_lists.push_back(list_entry);
+						}
+						offset += entry->Length;
+					}
+				}
+			}
+			[[fallthrough]];
+
+		// ============================================================
+		// ATTRIBUTES: Data, $I30 and Other Stream Types
+		// ============================================================
+		default:
+		{
+			// MFT Zone Tracking for Non-Resident Attributes (only the root's total needs it).
+			// The runs of an attribute lie within its VCN range, so one whose range
+			// misses the zone has nothing to count and its mapping pairs are not decoded
+			if (ah->IsNonResident && keep_sizes &&
+				mft_zone_begin < ah->NonResident.HighestVCN + 1 && ah->NonResident.LowestVCN < mft_zone_end)
+			{
+				mapping_pair_iterator mpi(ah,
+					reinterpret_cast<unsigned char const*>(frsh_end) -
+					reinterpret_cast<unsigned char const*>(ah));
+				for (mapping_pair_iterator::vcn_type current_vcn = mpi->next_vcn;
+					 !mpi.is_final();)
+				{
+					++mpi;
+					if (mpi->current_lcn)
+					{
+						mapping_pair_iterator::lcn_type intersect_mft_zone_begin = mft_zone_begin;
+						mapping_pair_iterator::lcn_type intersect_mft_zone_end = mft_zone_end;
+						if (intersect_mft_zone_begin < current_vcn)
+						{
+							intersect_mft_zone_begin = current_vcn;
+						}
+						if (intersect_mft_zone_end >= mpi->next_vcn)
+						{
+							intersect_mft_zone_end = mpi->next_vcn;
+						}
+						if (intersect_mft_zone_begin < intersect_mft_zone_end)
+						{
+							fragment.reserved_clusters += intersect_mft_zone_end - intersect_mft_zone_begin;
+						}
+					}
+					current_vcn = mpi->next_vcn;
+				}
+			}
+
+			// Only the first segment of a stream describes it; the rest carry more runs
+			if (ah->IsNonResident && ah->NonResident.LowestVCN)
+			{
+				break;
+			}
+
+			bool const isdir = decoder == kDecodeIndex && ah->NameLength == 4 &&
+				memcmp(ah->name(), _T("$I30"), sizeof(*ah->name()) * 4) == 0;
+			if (!isdir && !keep_all_streams && !(decoder == kDecodeData && !ah->NameLength))
+			{
+				break;
+			}
+
+			typename Fragment::Attribute& attribute = fragment.add(frs_base, Fragment::kStream);
+			attribute.name_length = isdir ? static_cast<unsigned char>(0) : ah->NameLength;
+			attribute.type_name_id = static_cast<unsigned char>(isdir ? 0 : type >> (CHAR_BIT / 2));
+			attribute.flags = isdir ? Fragment::kDirectoryIndex : 0;
+			if (!isdir)
+			{
+				attribute.name_offset = static_cast<Index>(fragment.names.size());
+				attribute.flags |= append_name(fragment.names, ah->name(), ah->NameLength) ? Fragment::kAscii : 0;
+			}
+
+			// The $I30 attributes of a directory share one stream, which the first creates
+			if (!isdir || !has_directory_index)
+			{
+				if (!is_base || has_stream)
+				{
+					++fragment.streams;
+				}
+				has_stream = true;
+				if (isdir && is_base)
+				{
+					attribute.flags |= Fragment::kNewDirectoryIndex;
+				}
+			}
+			has_directory_index = has_directory_index || isdir;
+
+			if (ah->Flags & 0x8000)
+			{
+				attribute.flags |= Fragment::kSparse;
+			}
+
+			// Size Calculation
+			if (keep_sizes)
+			{
+				if (ah->IsNonResident)
+				{
+					bool const is_badclus_bad =
+						frs_base == 0x000000000008 && decoder == kDecodeData && ah->NameLength == 4 &&
+						memcmp(ah->name(), _T("$Bad"), sizeof(*ah->name()) * 4) == 0;
+
+					attribute.sizes.allocated = ah->NonResident.CompressionUnit
+						? static_cast<unsigned long long>(ah->NonResident.CompressedSize)
+						: static_cast<unsigned long long>(is_badclus_bad
+							? ah->NonResident.InitializedSize
+							: ah->NonResident.AllocatedSize);
+					attribute.sizes.length = static_cast<unsigned long long>(is_badclus_bad
+						? ah->NonResident.InitializedSize
+						: ah->NonResident.DataSize);
+				}
+				else
+				{
+					attribute.sizes.allocated = 0;
+					attribute.sizes.length = ah->Resident.ValueLength;
+				}
+			}
+			break;
+		}
+		}
+
+		// Each case adds at most one attribute; an extension record's waits for its base
+		if (!is_base && fragment.attributes.size() != attributes_before)
+		{
+			fragment.park(frs, ah->Instance);
+		}
+	}  // end attribute loop
+}
+
+/**
+ * @brief Throws unless Index can address a names pool of @p names elements
+ * and lists of @p entries entries.
+ *
+ * A name offset is Index wide less the ASCII flag, and a list link is Index
+ * wide less the sentinel. Past that they would wrap around and point at
+ * other names, so the index stops loading instead.
+ *
+ * @throws std::length_error naming HugeNtfsIndex, which has room for any volume
+ */
+template <class Index>
+inline void BasicNtfsIndex<Index>::require_width(size_t const names, size_t const entries)
+{
+	if (names > NameInfo::max_offset || entries >= static_cast<Index>(~Index()))
+	{
+		throw std::length_error(sizeof(Index) < sizeof(unsigned long long)
+			? "volume has more names than a 32-bit index can address; load it into a HugeNtfsIndex"
+			: "volume has more names than the index can address");
+	}
+}
+
+/**
+ * @brief Makes room in the index vectors for everything @p fragment adds.
+ *
+ * Growing the vectors by doubling as they fill copies them several times,
+ * the last time when they are largest, and can leave up to half of each
+ * unused. Instead, a vector that would overflow is grown straight to the
+ * size projected from the counts of every fragment merged so far, plus a
+ * margin for the part of the volume not seen yet:
+ *
+ * ```
+ *   final size ~ merged so far / share of the volume merged so far
+ * ```
+ *
+ * The share is that of the in-use records when reserve() was given their
+ * number from the $MFT bitmap, and that of all records otherwise; the
+ * larger of the two is right in either case. The counts of a fragment are
+ * upper bounds, so merge() itself never reallocates. records_data is
+ * sized by reserve().
+ *
+ * @param fragment  The fragment about to be merged
+ */
+template <class Index>
+inline void BasicNtfsIndex<Index>::make_room(Fragment const& fragment)
+{
+	require_width(this->names_size() + fragment.names.size(),
+		std::max(std::max(this->nameinfos.size() + fragment.links, this->childinfos.size() + fragment.children),
+			this->streaminfos.size() + fragment.streams));
+
+	MergedCounts& merged = this->_merged;
+	merged.records    += fragment.records;
+	merged.in_use     += fragment.in_use;
+	merged.links      += fragment.links;
+	merged.children   += fragment.children;
+	merged.streams    += fragment.streams;
+	merged.name_chars += fragment.names.size();
+
+	double share = 0;
+	if (this->_expected_records)
+	{
+		share = std::max(share, static_cast<double>(merged.in_use) / this->_expected_records);
+	}
+	if (this->_mft_capacity)
+	{
+		share = std::max(share, static_cast<double>(merged.records) / this->_mft_capacity);
+	}
+
+	auto const grow = [share](auto& v, unsigned long long const total, size_t const added)
+	{
+		size_t const needed = v.size() + added;
+		if (needed > v.capacity())
+		{
+			// The margin shrinks as the projection firms up; growing by at least an
+			// eighth keeps a projection that creeps up from growing in tiny steps
+			size_t const projected = share > 0 && share < 1
+				? static_cast<size_t>(static_cast<double>(total) / share * (1 + 1.0 / 64 + (1 - share) / 4))
+				: 0;
+			v.reserve(std::max(std::max(needed, projected), v.capacity() + v.capacity() / 8));
+		}
+	};
+	grow(this->names, merged.name_chars, fragment.names.size());
+	grow(this->nameinfos, merged.links, fragment.links);
+	grow(this->childinfos, merged.children, fragment.children);
+	grow(this->streaminfos, merged.streams, fragment.streams);
+}
+
+/**
+ * @brief Adds the attributes of a parsed fragment to their base records.
+ *
+ * Base records are linked now; the attributes of extension records are
+ * parked in _extensions until resolve_extensions(), so linking never has
+ * to wait for, or reach back into, another chunk.
+ *
+ * @param fragment  Output of parse() or parse_record()
+ */
+template <class Index>
+inline void BasicNtfsIndex<Index>::merge(Fragment const& fragment)
+{
+	this->make_room(fragment);
+
+	// Relocate the fragment's names to the end of the index's
+	size_t const names_base = this->names_size();
+	this->names.append(fragment.names.data(), fragment.names.data() + fragment.names.size());
+
+	if (fragment.reserved_clusters)
+	{
+		this->_reserved_clusters.fetch_sub(fragment.reserved_clusters);
+	}
+
+	this->link(fragment, names_base);
+
+	if (!fragment.extensions.empty() || !fragment.attribute_lists.empty())
+	{
+		if (!this->_extensions)
+		{
+			this->_extensions.reset(new Fragment());
+		}
+		for (typename Fragment::Extension extension : fragment.extensions)
+		{
+			extension.attribute.name_offset += static_cast<Index>(names_base);
+			this->_extensions->extensions.push_back(extension);
+		}
+		this->_extensions->attribute_lists.insert(this->_extensions->attribute_lists.end(),
+			fragment.attribute_lists.begin(), fragment.attribute_lists.end());
+	}
+}
+
+/**
+ * @brief Links the attributes of @p fragment into their records, in order.
+ *
+ * Names are linked into the ChildInfo chain of their parent directory as
+ * they are seen. Records are held by slot, since creating a parent can
+ * move records_data.
+ *
+ * @param fragment    Attributes to link
+ * @param names_base  Where the fragment's names start in the index's
+ */
+template <class Index>
+inline void BasicNtfsIndex<Index>::link(Fragment const& fragment, size_t const names_base)
+{
+	// Where the $I30 stream of frs_base is: its first stream, at an index into streaminfos, or not seen yet
+	size_t const kNoDirectoryIndex = ~size_t(), kHeadDirectoryIndex = kNoDirectoryIndex - 1;
+
+	unsigned int frs_base = ~0U;
+	RecordsLookup::value_type base_slot = 0;
+	size_t directory_index = kNoDirectoryIndex;
+	this->_lists_compact = false;
+	for (typename Fragment::Attribute const& attribute : fragment.attributes)
+	{
+		if (attribute.frs_base != frs_base)
+		{
+			frs_base = attribute.frs_base;
+			this->at(frs_base);
+			base_slot = this->records_lookup[frs_base];
+			directory_index = kNoDirectoryIndex;
+		}
+
+		// The parent of a name first, as creating it can move the base record
+		typename Records::value_type* const parent = attribute.kind == Fragment::kFileName && attribute.parent != frs_base
+			? &*this->at(attribute.parent)
+			: nullptr;
+		typename Records::value_type& base_record = this->records_data[base_slot];
+
+		switch (attribute.kind)
+		{
+		case Fragment::kStandardInformation:
+			base_record.attributes = attribute.stdinfo.attributes();
+			if (RecordTimes* const times = this->record_times(&base_record))
+			{
+				times->created  = attribute.stdinfo.created;
+				times->written  = attribute.stdinfo.written;
+				times->accessed = attribute.stdinfo.accessed;
+			}
+			if ((attribute.flags & Fragment::kAttributeList) && this->_early)
+			{
+				this->_early->set_state(frs_base, EarlyMatches::kIncomplete);
+			}
+			break;
+
+		case Fragment::kFileName:
+		{
+			// Handle hard links: push existing name to linked list
+			if (this->nameinfo(&base_record))
+			{
+				size_t const link_index = this->nameinfos.size();
+				this->nameinfos.push_back(base_record.first_name);
+				base_record.first_name.next_entry = static_cast<typename LinkInfos::value_type::next_entry_type>(link_index);
+			}
+
+			LinkInfo* const info = &base_record.first_name;
+			info->name.offset(static_cast<Index>(names_base + attribute.name_offset));
+			info->name.length = attribute.name_length;
+			info->name.ascii(!!(attribute.flags & Fragment::kAscii));
+			info->parent = attribute.parent;
+
+			// Build parent-child relationship
+			// Link this file/directory to its parent directory
+			if (parent)
+			{
+				// Add new child info entry
+				size_t const child_index = this->childinfos.size();
+				this->childinfos.push_back(ChildInfo());
+				ChildInfo* const child_info = &this->childinfos.back();
+				child_info->record_number   = frs_base;
+				child_info->name_index      = base_record.name_count;
+				child_info->next_entry      = parent->first_child;
+				parent->first_child         = static_cast<typename ChildInfos::value_type::next_entry_type>(child_index);
+			}
+
+			// Every (name, stream) pair is counted once, by whichever of the two comes last
+			++base_record.name_count;
+			this->_total_names_and_streams.fetch_add(base_record.stream_count, atomic_namespace::memory_order_acq_rel);
+
+			// Queued once per record; system files are left to matches()
+			if ((attribute.flags & Fragment::kNameMatch) && frs_base >= kFirstUserFRS &&
+				(this->_early->pending.empty() || this->_early->pending.back() != frs_base))
+			{
+				this->_early->pending.push_back(frs_base);
+			}
+			break;
+		}
+
+		case Fragment::kStream:
+		{
+			bool const isdir = !!(attribute.flags & Fragment::kDirectoryIndex);
+			StreamInfo* info = nullptr;
+
+			// $I30 attributes of one directory share a stream: the one its first created
+			if (isdir && !(attribute.flags & Fragment::kNewDirectoryIndex))
+			{
+				// Only an extension record's, linked after its base, has to look the stream up
+				for (typename StreamInfos::value_type* k = directory_index == kNoDirectoryIndex ? this->streaminfo(&base_record) : nullptr;
+					k; k = this->streaminfo(k->next_entry))
+				{
+					if (k->type_name_id == attribute.type_name_id && k->name.length == attribute.name_length)
+					{
+						directory_index = k == this->first_stream(&base_record)
+							? kHeadDirectoryIndex
+							: static_cast<size_t>(k - &*this->streaminfos.begin());
+						break;
+					}
+				}
+				if (directory_index != kNoDirectoryIndex)
+				{
+					info = directory_index == kHeadDirectoryIndex
+						? this->first_stream(&base_record)
+						: &*fast_subscript(this->streaminfos.begin(), directory_index);
+				}
+			}
+
+			if (!info)
+			{
+				if (typename StreamInfos::value_type* const si = this->streaminfo(&base_record))
+				{
+					size_t const stream_index = this->streaminfos.size();
+					this->streaminfos.push_back(*si);
+					si->next_entry = static_cast<typename StreamInfo::next_entry_type>(stream_index);
+					if (directory_index == kHeadDirectoryIndex)
+					{
+						directory_index = stream_index;
+					}
+				}
+				if (isdir)
+				{
+					directory_index = kHeadDirectoryIndex;
+				}
+			}
+
+			if (!info)
+			{
+				info = this->first_stream(&base_record);
+				info->allocated = 0;
+				info->length    = 0;
+				info->bulkiness = 0;
+				info->treesize  = 0;
+				info->is_sparse = 0;
+				info->is_allocated_size_accounted_for_in_main_stream = 0;
+				info->type_name_id = attribute.type_name_id;
+				info->name.length  = attribute.name_length;
+
+				if (isdir)
+				{
+					info->name.offset(0);
+				}
+				else
+				{
+					info->name.offset(static_cast<Index>(names_base + attribute.name_offset));
+					info->name.ascii(!!(attribute.flags & Fragment::kAscii));
+				}
+
+				++base_record.stream_count;
+				this->_total_names_and_streams.fetch_add(base_record.name_count, atomic_namespace::memory_order_acq_rel);
+			}
+
+			if (attribute.flags & Fragment::kSparse)
+			{
+				info->is_sparse |= 0x1;
+			}
+
+			info->allocated += attribute.sizes.allocated;
+			info->length    += attribute.sizes.length;
+			info->bulkiness += info->allocated;
+			info->treesize = isdir;
+			break;
+		}
+		}
+	}
+}
+
+/**
+ * @brief Links the parked attributes of extension records, once every chunk has arrived.
+ *
+ * Each base record gets the attributes of its extension records in the
+ * order of its $ATTRIBUTE_LIST, so the result does not depend on the order
+ * in which chunks arrived. Attributes that a non-resident list describes,
+ * or that no list names, follow in FRS and record order. Called by load()
+ * before the Preprocessor, and by finish_refresh() for each file.
+ */
+template <class Index>
+inline void BasicNtfsIndex<Index>::resolve_extensions()
+{
+	if (!this->_extensions)
+	{
+		return;
+	}
+
+	std::unique_ptr<Fragment> const parked = std::move(this->_extensions);
+	std::vector<typename Fragment::ListEntry>& lists = parked->attribute_lists;
+	std::vector<typename Fragment::Extension>& extensions = parked->extensions;
+
+	std::sort(lists.begin(), lists.end(), [](typename Fragment::ListEntry const& a, typename Fragment::ListEntry const& b)
+	{
+		return a.frs_base != b.frs_base ? a.frs_base < b.frs_base
+			: a.segment != b.segment ? a.segment < b.segment
+			: a.instance < b.instance;
+	});
+
+	// Position in the base record's list, or after every listed attribute
+	unsigned int const unlisted = 0x10000;
+	std::vector<std::pair<unsigned int, size_t> > order(extensions.size());
+	for (size_t e = 0; e != extensions.size(); ++e)
+	{
+		typename Fragment::Extension const& extension = extensions[e];
+		typename Fragment::ListEntry const key = { extension.attribute.frs_base, extension.segment, extension.instance, 0 };
+		typename std::vector<typename Fragment::ListEntry>::const_iterator const found = std::lower_bound(lists.begin(), lists.end(), key,
+			[](typename Fragment::ListEntry const& a, typename Fragment::ListEntry const& b)
+			{
+				return a.frs_base != b.frs_base ? a.frs_base < b.frs_base
+					: a.segment != b.segment ? a.segment < b.segment
+					: a.instance < b.instance;
+			});
+		bool const listed = found != lists.end() && found->frs_base == key.frs_base &&
+			found->segment == key.segment && found->instance == key.instance;
+		order[e] = std::make_pair(listed ? found->ordinal : unlisted, e);
+	}
+
+	// A segment's attributes are parked together and in record order; keep that order among equals
+	std::stable_sort(order.begin(), order.end(),
+		[&extensions](std::pair<unsigned int, size_t> const& a, std::pair<unsigned int, size_t> const& b)
+		{
+			typename Fragment::Extension const& x = extensions[a.second];
+			typename Fragment::Extension const& y = extensions[b.second];
+			return x.attribute.frs_base != y.attribute.frs_base ? x.attribute.frs_base < y.attribute.frs_base
+				: a.first != b.first ? a.first < b.first
+				: x.segment < y.segment;
+		});
+
+	Fragment sorted;
+	sorted.attributes.reserve(order.size());
+	for (size_t e = 0; e != order.size(); ++e)
+	{
+		sorted.attributes.push_back(extensions[order[e].second].attribute);
+	}
+	this->link(sorted, 0);
+}
+
+/**
+ * @brief Adds one in-use, fixed-up FILE record to the index.
+ *
+ * @param frs   FRS of the record
+ * @param frsh  The record
+ */
+template <class Index>
+inline void BasicNtfsIndex<Index>::load_record(unsigned int const frs, ntfs::FILE_RECORD_SEGMENT_HEADER const* const frsh)
+{
+	Fragment fragment;
+	this->parse_record(frs, frsh, fragment);
+	this->merge(fragment);
+}
+
+// ============================================================================
+// SECTION: Main MFT Parsing (parse and load methods)
+// ============================================================================
+
+/**
+ * @brief Parses the in-use records of a chunk into @p fragment, without the lock.
+ *
+ * Call after preload_concurrent() on the same buffer, from any thread and
+ * concurrently with load() of other chunks; hand the fragment to load().
+ *
  * @param virtual_offset Byte offset in the MFT file where this buffer starts
- * @param buffer         Pointer to the raw MFT data buffer
+ * @param buffer         Fixed-up MFT records
  * @param size           Size of the buffer in bytes
- * @param skipped_begin  Bytes skipped at start (unused records from bitmap)
- * @param skipped_end    Bytes skipped at end (unused records from bitmap)
+ * @param fragment       Cleared, then receives the attributes of the records
  */
-inline void NtfsIndex::load(unsigned long long virtual_offset,
-	void* buffer,
+template <class Index>
+inline void BasicNtfsIndex<Index>::parse(unsigned long long virtual_offset,
+	void const* buffer,
 	size_t size,
-	unsigned long long skipped_begin,
-	unsigned long long skipped_end)
+	Fragment& fragment) const volatile
 {
-	unsigned int const mft_record_size = this->_mft_record_size;
+	BasicNtfsIndex const* const me = this->unvolatile();
+	unsigned int const mft_record_size = me->_mft_record_size;
 
 	// Calculate log2 of MFT record size for efficient division via bit shift
 	unsigned int mft_record_size_log2 = 0;
@@ -202,13 +905,7 @@ inline void NtfsIndex::load(unsigned long long virtual_offset,
 		throw std::runtime_error("Cluster size is smaller than MFT record size; split MFT records (over multiple clusters) not supported. Defragmenting your MFT may sometimes avoid this condition.");
 	}
 
-	// Account for skipped records in progress tracking
-	if (skipped_begin || skipped_end)
-	{
-		this->_records_so_far.fetch_add(static_cast<unsigned int>((skipped_begin + skipped_end) >> mft_record_size_log2));
-	}
-
-	ChildInfo const empty_child_info;
+	fragment.clear();
 
 	// ========================================================================
 	// Main MFT Record Processing Loop
@@ -217,250 +914,66 @@ inline void NtfsIndex::load(unsigned long long virtual_offset,
 			 ? mft_record_size - virtual_offset & mft_record_size_pow2_mod_mask
 			 : 0;
 		i + mft_record_size <= size;
-		i += mft_record_size,
-		this->_records_so_far.fetch_add(1, atomic_namespace::memory_order_acq_rel))
+		i += mft_record_size, ++fragment.records)
 	{
 		unsigned int const frs = static_cast<unsigned int>((virtual_offset + i) >> mft_record_size_log2);
 
-		ntfs::FILE_RECORD_SEGMENT_HEADER* const frsh =
-			reinterpret_cast<ntfs::FILE_RECORD_SEGMENT_HEADER*>(&static_cast<unsigned char*>(buffer)[i]);
+		ntfs::FILE_RECORD_SEGMENT_HEADER const* const frsh =
+			reinterpret_cast<ntfs::FILE_RECORD_SEGMENT_HEADER const*>(&static_cast<unsigned char const*>(buffer)[i]);
 
 		// Only process valid, in-use records
 		if (frsh->MultiSectorHeader.Magic == 'ELIF' && !!(frsh->Flags & ntfs::FRH_IN_USE))
 		{
-			unsigned int const frs_base = frsh->BaseFileRecordSegment
-				? static_cast<unsigned int>(frsh->BaseFileRecordSegment)
-				: frs;
-			auto base_record = this->at(frs_base);
-			void const* const frsh_end = frsh->end(mft_record_size);
-
-			// ================================================================
-			// Attribute Parsing Loop
-			// ================================================================
-			for (ntfs::ATTRIBUTE_RECORD_HEADER const* ah = frsh->begin();
-				 ah < frsh_end && ah->Type != ntfs::AttributeTypeCode::AttributeNone && ah->Type != ntfs::AttributeTypeCode::AttributeEnd;
-				 ah = ah->next())
-			{
-				switch (ah->Type)
-				{
-				// ============================================================
-				// ATTRIBUTE: StandardInformation (0x10)
-				// ============================================================
-				case ntfs::AttributeTypeCode::AttributeStandardInformation:
-					if (ntfs::STANDARD_INFORMATION const* const fn =
-						static_cast<ntfs::STANDARD_INFORMATION const*>(ah->Resident.GetValue()))
-					{
-						base_record->stdinfo.created  = fn->CreationTime;
-						base_record->stdinfo.written  = fn->LastModificationTime;
-						base_record->stdinfo.accessed = fn->LastAccessTime;
-						base_record->stdinfo.attributes(fn->FileAttributes |
-							((frsh->Flags & ntfs::FRH_DIRECTORY) ? FILE_ATTRIBUTE_DIRECTORY : 0));
-					}
-					break;
-
-				// ============================================================
-				// ATTRIBUTE: FileName (0x30)
-				// ============================================================
-				case ntfs::AttributeTypeCode::AttributeFileName:
-					if (ntfs::FILENAME_INFORMATION const* const fn =
-						static_cast<ntfs::FILENAME_INFORMATION const*>(ah->Resident.GetValue()))
-					{
-						unsigned int const frs_parent = static_cast<unsigned int>(fn->ParentDirectory);
-
-						// Skip DOS-only names (0x02) - prefer Win32 or POSIX names
-						if (fn->Flags != 0x02 /*FILE_NAME_DOS */)
-						{
-							// Handle hard links: push existing name to linked list
-							if (LinkInfos::value_type* const si = this->nameinfo(&*base_record))
-							{
-								size_t const link_index = this->nameinfos.size();
-								this->nameinfos.push_back(base_record->first_name);
-								base_record->first_name.next_entry = static_cast<LinkInfos::value_type::next_entry_type>(link_index);
-							}
-
-							LinkInfo* const info = &base_record->first_name;
-							info->name.offset(static_cast<unsigned int>(this->names.size()));
-							info->name.length = static_cast<unsigned char>(fn->FileNameLength);
-
-							bool const ascii = is_ascii(fn->FileName, fn->FileNameLength);
-							info->name.ascii(ascii);
-							info->parent = frs_parent;
-
-							append_directional(this->names, fn->FileName, fn->FileNameLength, ascii ? 1 : 0);
-
-							// Build parent-child relationship
-							// Link this file/directory to its parent directory
-							if (frs_parent != frs_base)
-							{
-								Records::iterator const parent = this->at(frs_parent, &base_record);
-
-								// Add new child info entry
-								size_t const child_index = this->childinfos.size();
-								this->childinfos.push_back(empty_child_info);
-								ChildInfo* const child_info = &this->childinfos.back();
-								child_info->record_number   = frs_base;
-								child_info->name_index      = base_record->name_count;
-								child_info->next_entry      = parent->first_child;
-								parent->first_child         = static_cast<ChildInfos::value_type::next_entry_type>(child_index);
-							}
-
-							++base_record->name_count;
-						}
-					}
-					break;
-
-				// ============================================================
-				// ATTRIBUTES: Data and Other Stream Types
-				// ============================================================
-				case ntfs::AttributeTypeCode::AttributeObjectId:
-				case ntfs::AttributeTypeCode::AttributePropertySet:
-				case ntfs::AttributeTypeCode::AttributeBitmap:
-				case ntfs::AttributeTypeCode::AttributeIndexAllocation:
-				case ntfs::AttributeTypeCode::AttributeIndexRoot:
-				case ntfs::AttributeTypeCode::AttributeData:
-				case ntfs::AttributeTypeCode::AttributeReparsePoint:
-				case ntfs::AttributeTypeCode::AttributeEA:
-				case ntfs::AttributeTypeCode::AttributeEAInformation:
-				default:
-				{
-					// MFT Zone Tracking for Non-Resident Attributes
-					if (ah->IsNonResident)
-					{
-						mapping_pair_iterator mpi(ah,
-							reinterpret_cast<unsigned char const*>(frsh_end) -
-							reinterpret_cast<unsigned char const*>(ah));
-						for (mapping_pair_iterator::vcn_type current_vcn = mpi->next_vcn;
-							 !mpi.is_final();)
-						{
-							++mpi;
-							if (mpi->current_lcn)
-							{
-								mapping_pair_iterator::lcn_type intersect_mft_zone_begin = this->_mft_zone_start;
-								mapping_pair_iterator::lcn_type intersect_mft_zone_end = this->_mft_zone_end;
-								if (intersect_mft_zone_begin < current_vcn)
-								{
-									intersect_mft_zone_begin = current_vcn;
-								}
-								if (intersect_mft_zone_end >= mpi->next_vcn)
-								{
-									intersect_mft_zone_end = mpi->next_vcn;
-								}
-								if (intersect_mft_zone_begin < intersect_mft_zone_end)
-								{
-									this->_reserved_clusters.fetch_sub(intersect_mft_zone_end - intersect_mft_zone_begin);
-								}
-							}
-							current_vcn = mpi->next_vcn;
-						}
-					}
-
-					// Stream Information Extraction
-					bool const is_primary_attribute = !(ah->IsNonResident && ah->NonResident.LowestVCN);
-					if (is_primary_attribute)
-					{
-						bool const isdir =
-							(ah->Type == ntfs::AttributeTypeCode::AttributeBitmap ||
-							 ah->Type == ntfs::AttributeTypeCode::AttributeIndexRoot ||
-							 ah->Type == ntfs::AttributeTypeCode::AttributeIndexAllocation) &&
-							ah->NameLength == 4 &&
-							memcmp(ah->name(), _T("$I30"), sizeof(*ah->name()) * 4) == 0;
-
-						unsigned char const name_length =
-							isdir ? static_cast<unsigned char>(0) : ah->NameLength;
-						unsigned char const type_name_id = static_cast<unsigned char>(
-							isdir ? 0 : static_cast<int>(ah->Type) >> (CHAR_BIT / 2));
-
-						StreamInfo* info = nullptr;
-
-						if (StreamInfos::value_type* const si = this->streaminfo(&*base_record))
-						{
-							if (isdir)
-							{
-								for (StreamInfos::value_type* k = si; k; k = this->streaminfo(k->next_entry))
-								{
-									if (k->type_name_id == type_name_id &&
-										k->name.length == name_length &&
-										(name_length == 0 ||
-										 std::equal(ah->name(),
-											ah->name() + static_cast<ptrdiff_t>(ah->NameLength),
-											this->names.begin() + static_cast<ptrdiff_t>(k->name.offset()))))
-									{
-										info = k;
-										break;
-									}
-								}
-							}
-
-							if (!info)
-							{
-								size_t const stream_index = this->streaminfos.size();
-								this->streaminfos.push_back(*si);
-								si->next_entry = static_cast<small_t<size_t>::type>(stream_index);
-							}
-						}
-
-						if (!info)
-						{
-							info = &base_record->first_stream;
-							info->allocated = 0;
-							info->length    = 0;
-							info->bulkiness = 0;
-							info->treesize  = 0;
-							info->is_sparse = 0;
-							info->is_allocated_size_accounted_for_in_main_stream = 0;
-							info->type_name_id = type_name_id;
-							info->name.length  = name_length;
-
-							if (isdir)
-							{
-								info->name.offset(0);
-							}
-							else
-							{
-								info->name.offset(static_cast<unsigned int>(this->names.size()));
-								bool const ascii = is_ascii(ah->name(), ah->NameLength);
-								info->name.ascii(ascii);
-								append_directional(this->names, ah->name(), ah->NameLength, ascii ? 1 : 0);
-							}
-
-							++base_record->stream_count;
-							this->_total_names_and_streams.fetch_add(base_record->name_count, atomic_namespace::memory_order_acq_rel);
-						}
-
-						// Size Calculation
-						bool const is_badclus_bad =
-							frs_base == 0x000000000008 && ah->NameLength == 4 &&
-							memcmp(ah->name(), _T("$Bad"), sizeof(*ah->name()) * 4) == 0;
+			me->parse_record(frs, frsh, fragment);
+		}
+	}  // end main MFT record processing loop
+}
 
-						bool const is_sparse = !!(ah->Flags & 0x8000);
-						if (is_sparse)
-						{
-							info->is_sparse |= 0x1;
-						}
+/**
+ * @brief Parses MFT records and builds the in-memory file system index.
+ *
+ * Same as parse() followed by load() of the fragment, on the calling thread.
+ *
+ * @param virtual_offset Byte offset in the MFT file where this buffer starts
+ * @param buffer         Pointer to the raw MFT data buffer
+ * @param size           Size of the buffer in bytes
+ * @param skipped_begin  Bytes skipped at start (unused records from bitmap)
+ * @param skipped_end    Bytes skipped at end (unused records from bitmap)
+ */
+template <class Index>
+inline void BasicNtfsIndex<Index>::load(unsigned long long virtual_offset,
+	void* buffer,
+	size_t size,
+	unsigned long long skipped_begin,
+	unsigned long long skipped_end)
+{
+	Fragment fragment;
+	this->parse(virtual_offset, buffer, size, fragment);
+	this->load(fragment, skipped_begin, skipped_end);
+}
 
-						info->allocated += ah->IsNonResident
-							? (ah->NonResident.CompressionUnit
-								? static_cast<file_size_type>(ah->NonResident.CompressedSize)
-								: static_cast<file_size_type>(is_badclus_bad
-									? ah->NonResident.InitializedSize
-									: ah->NonResident.AllocatedSize))
-							: 0;
-
-						info->length += ah->IsNonResident
-							? static_cast<file_size_type>(is_badclus_bad ? ah->NonResident.InitializedSize
-								: ah->NonResident.DataSize)
-							: ah->Resident.ValueLength;
-
-						info->bulkiness += info->allocated;
-						info->treesize = isdir;
-					}
+/**
+ * @brief Adds a parsed chunk to the in-memory file system index.
+ *
+ * This is the core method that turns parsed MFT records into the searchable
+ * index. It links the fragment's attributes into their records and, once
+ * every record has been seen, runs the Preprocessor over the directory tree.
+ *
+ * @param fragment       Output of parse() for the chunk
+ * @param skipped_begin  Bytes skipped at start (unused records from bitmap)
+ * @param skipped_end    Bytes skipped at end (unused records from bitmap)
+ */
+template <class Index>
+inline void BasicNtfsIndex<Index>::load(Fragment const& fragment,
+	unsigned long long skipped_begin,
+	unsigned long long skipped_end)
+{
+	this->merge(fragment);
 
-					break;
-				}  // end default case
-			}  // end switch (ah->Type)
-		}  // end attribute loop
-	}  // end record loop (IN_USE check)
-	}  // end main MFT record processing loop
+	// Account for the chunk's records, skipped ones included, in progress tracking
+	this->_records_so_far.fetch_add(fragment.records +
+		static_cast<unsigned int>((skipped_begin + skipped_end) / this->_mft_record_size),
+		atomic_namespace::memory_order_acq_rel);
 
 	// ========================================================================
 	// Post-Processing Phase
@@ -471,6 +984,17 @@ inline void NtfsIndex::load(unsigned long long virtual_offset,
 	unsigned int const records_so_far = this->_records_so_far.load(atomic_namespace::memory_order_acquire);
 	bool const finished = records_so_far >= this->_mft_capacity;
 
+	if (finished)
+	{
+		this->resolve_extensions();
+		this->compact_lists();
+		this->intern_names();
+		if (this->_load_profile & kLoadPackedNames)
+		{
+			this->pack_names();
+		}
+	}
+
 	if (finished && !this->_root_path.empty())
 	{
 		// Debug output: log memory usage statistics
@@ -487,14 +1011,22 @@ inline void NtfsIndex::load(unsigned long long virtual_offset,
 		int const nbuf = safe_stprintf(
 			buf,
 			_T("%s\trecords_data\twidth = %2u\tsize = %8I64u\tcapacity = %8I64u\n")
+			_T("%s\tfirst_streams\twidth = %2u\tsize = %8I64u\tcapacity = %8I64u\n")
+			_T("%s\ttimestamps\twidth = %2u\tsize = %8I64u\tcapacity = %8I64u\n")
 			_T("%s\trecords_lookup\twidth = %2u\tsize = %8I64u\tcapacity = %8I64u\n")
-			_T("%s\tnames\twidth = %2u\tsize = %8I64u\tcapacity = %8I64u\t%8I64u bytes wasted\n")
+			_T("%s\tnames\twidth = %2u\tsize = %8I64u\tcapacity = %8I64u\t%8I64u bytes wasted\t%.2fx deduplicated\t%8I64u bytes in total\n")
 			_T("%s\tnameinfos\twidth = %2u\tsize = %8I64u\tcapacity = %8I64u\n")
 			_T("%s\tstreaminfos\twidth = %2u\tsize = %8I64u\tcapacity = %8I64u\n")
 			_T("%s\tchildinfos\twidth = %2u\tsize = %8I64u\tcapacity = %8I64u\n"),
 			this->_root_path.c_str(), static_cast<unsigned>(sizeof(*this->records_data.begin())),
 			static_cast<unsigned long long>(this->records_data.size()),
 			static_cast<unsigned long long>(this->records_data.capacity()),
+			this->_root_path.c_str(), static_cast<unsigned>(sizeof(*this->first_streams.begin())),
+			static_cast<unsigned long long>(this->first_streams.size()),
+			static_cast<unsigned long long>(this->first_streams.capacity()),
+			this->_root_path.c_str(), static_cast<unsigned>(sizeof(*this->timestamps.begin())),
+			static_cast<unsigned long long>(this->timestamps.size()),
+			static_cast<unsigned long long>(this->timestamps.capacity()),
 			this->_root_path.c_str(), static_cast<unsigned>(sizeof(*this->records_lookup.begin())),
 			static_cast<unsigned long long>(this->records_lookup.size()),
 			static_cast<unsigned long long>(this->records_lookup.capacity()),
@@ -502,6 +1034,8 @@ inline void NtfsIndex::load(unsigned long long virtual_offset,
 			static_cast<unsigned long long>(this->names.size()),
 			static_cast<unsigned long long>(this->names.capacity()),
 			static_cast<unsigned long long>(names_wasted_chars),
+			this->name_dedupe_ratio(),
+			static_cast<unsigned long long>(this->names_bytes()),
 			this->_root_path.c_str(), static_cast<unsigned>(sizeof(*this->nameinfos.begin())),
 			static_cast<unsigned long long>(this->nameinfos.size()),
 			static_cast<unsigned long long>(this->nameinfos.capacity()),
@@ -522,188 +1056,25 @@ inline void NtfsIndex::load(unsigned long long virtual_offset,
 		// ============================================================
 		// After MFT parsing, each file knows its own size, but directories
 		// don't know the total size of their contents. The Preprocessor
-		// performs a depth-first traversal to calculate cumulative sizes.
-		//
-		// Key algorithms implemented in the Preprocessor struct below:
-		// - Bulkiness calculation (excludes children < 1% of parent)
-		// - Hard link size distribution (Accumulator pattern)
-		// - WOF compression handling (WofCompressedData streams)
-
-		struct
-		{
-			using PreprocessResult = SizeInfo;
-			NtfsIndex* me;
-			using Scratch = std::vector<unsigned long long>;
-			Scratch scratch;
-			size_t depth;
-
-			PreprocessResult operator()(Records::value_type* const fr,
-				key_type::name_info_type const name_info,
-				unsigned short const total_names)
-			{
-				size_t const old_scratch_size = scratch.size();
-				PreprocessResult result;
-
-				if (fr)
-				{
-					PreprocessResult children_size;
-					++depth;
-
-					for (ChildInfos::value_type* i = me->childinfo(fr);
-						 i && ~i->record_number;
-						 i = me->childinfo(i->next_entry))
-					{
-						Records::value_type* const fr2 = me->find(i->record_number);
-
-						if (fr2 != fr)
-						{
-							PreprocessResult const subresult = this->operator()(fr2,
-								fr2->name_count - static_cast<size_t>(1) - i->name_index,
-								fr2->name_count);
-
-							scratch.push_back(subresult.bulkiness);
-
-							children_size.length    += subresult.length;
-							children_size.allocated += subresult.allocated;
-							children_size.bulkiness += subresult.bulkiness;
-							children_size.treesize  += subresult.treesize;
-						}
-					}
-
-					--depth;
-
-					std::make_heap(scratch.begin() + static_cast<ptrdiff_t>(old_scratch_size), scratch.end());
-					unsigned long long const threshold = children_size.allocated / 100;
-
-					for (auto i = scratch.end();
-						 i != scratch.begin() + static_cast<ptrdiff_t>(old_scratch_size);)
-					{
-						std::pop_heap(scratch.begin() + static_cast<ptrdiff_t>(old_scratch_size), i);
-						--i;
-
-						if (*i < threshold)
-						{
-							break;
-						}
-
-						children_size.bulkiness = children_size.bulkiness - *i;
-					}
-
-					if (depth == 0)
-					{
-						children_size.allocated +=
-							static_cast<unsigned long long>(me->_reserved_clusters) * me->_cluster_size;
-					}
-
-					result = children_size;
-
-					// Accumulator: Fair Size Distribution for Hard Links
-					struct Accumulator
-					{
-						static unsigned long long delta_impl(unsigned long long const value,
-							unsigned short const i, unsigned short const n)
-						{
-							return value * (i + 1) / n - value * i / n;
-						}
-
-						static unsigned long long delta(unsigned long long const value,
-							unsigned short const i, unsigned short const n)
-						{
-							return n != 1
-								? (n != 2 ? delta_impl(value, i, n)
-										: (i != 1 ? delta_impl(value, ((void)(assert(i == 0)), 0), n)
-											   : delta_impl(value, i, n)))
-								: delta_impl(value, ((void)(assert(i == 0)), 0), n);
-						}
-					};
-
-					// Stream Processing and Compression Handling
-					StreamInfos::value_type* default_stream = nullptr;
-					StreamInfos::value_type* compressed_default_stream_to_merge = nullptr;
-					unsigned long long default_allocated_delta = 0;
-					unsigned long long compressed_default_allocated_delta = 0;
-
-					for (StreamInfos::value_type* k = me->streaminfo(fr); k; k = me->streaminfo(k->next_entry))
-					{
-						bool const is_data_attribute =
-							(k->type_name_id << (CHAR_BIT / 2)) ==
-							static_cast<int>(ntfs::AttributeTypeCode::AttributeData);
-
-						bool const is_default_stream = is_data_attribute && !k->name.length;
-
-						unsigned long long const allocated_delta = Accumulator::delta(
-							k->is_allocated_size_accounted_for_in_main_stream
-								? static_cast<file_size_type>(0)
-								: k->allocated,
-							name_info, total_names);
-						unsigned long long const bulkiness_delta = Accumulator::delta(
-							k->bulkiness, name_info, total_names);
-
-						if (is_default_stream)
-						{
-							default_stream = k;
-							default_allocated_delta += allocated_delta;
-						}
-
-						// WOF Compression Handling
-						bool const is_compression_reparse_point =
-							is_data_attribute && k->name.length &&
-							(k->name.ascii()
-								 ? memcmp(reinterpret_cast<char const*>(&me->names[k->name.offset()]),
-									        "WofCompressedData", 17 * sizeof(char)) == 0
-								 : memcmp(reinterpret_cast<wchar_t const*>(&me->names[k->name.offset()]),
-									        L"WofCompressedData", 17 * sizeof(wchar_t)) == 0);
-
-						unsigned long long const length_delta = Accumulator::delta(
-							is_compression_reparse_point ? static_cast<file_size_type>(0) : k->length,
-							name_info, total_names);
-
-						if (is_compression_reparse_point)
-						{
-							if (!k->is_allocated_size_accounted_for_in_main_stream)
-							{
-								compressed_default_stream_to_merge = k;
-								compressed_default_allocated_delta += allocated_delta;
-							}
-						}
-
-						result.length    += length_delta;
-						result.allocated += allocated_delta;
-						result.bulkiness += bulkiness_delta;
-						result.treesize  += 1;
-
-						if (!k->type_name_id)
-						{
-							k->length    += children_size.length;
-							k->allocated += children_size.allocated;
-							k->bulkiness += children_size.bulkiness;
-							k->treesize  += children_size.treesize;
-						}
-
-						me->_preprocessed_so_far.fetch_add(1, atomic_namespace::memory_order_acq_rel);
-					}
-
-					// Merge WOF compressed stream size into default stream
-					if (compressed_default_stream_to_merge && default_stream)
-					{
-						compressed_default_stream_to_merge->is_allocated_size_accounted_for_in_main_stream = 1;
-						default_stream->allocated += compressed_default_stream_to_merge->allocated;
-
-						result.allocated -= default_allocated_delta;
-						result.allocated -= compressed_default_allocated_delta;
-						result.allocated += Accumulator::delta(default_stream->allocated, name_info, total_names);
-					}
-				}
-
-				scratch.erase(scratch.begin() + static_cast<ptrdiff_t>(old_scratch_size), scratch.end());
-				return result;
-			}
-		} preprocessor = { this };
+		// (ntfs_index_preprocess.hpp) walks the tree bottom-up, in parallel,
+		// to calculate cumulative sizes. With defer_sizes() that is left to
+		// the first ensure_sizes().
 
 		clock_t const tbefore_preprocess = clock();
 
-		// Start preprocessing from root directory (FRS 5 = kRootFRS)
-		preprocessor(this->find(0x000000000005), 0, 1);
+		if (this->_load_profile & kLoadNoSizes)
+		{
+			// Nothing to add up
+		}
+		else if (this->_defer_sizes)
+		{
+			this->_sizes_pending.store(true, atomic_namespace::memory_order_release);
+		}
+		else
+		{
+			// Start preprocessing from root directory (FRS 5 = kRootFRS)
+			this->preprocess();
+		}
 
 		clock_t const tfinish = clock();
 
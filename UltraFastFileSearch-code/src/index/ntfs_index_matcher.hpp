@@ -145,10 +145,11 @@
 // - match_attributes: Include non-data attributes (e.g., "$INDEX_ALLOCATION")
 //
 
+template <class Index>
 template <class F>
-struct NtfsIndex::Matcher
+struct BasicNtfsIndex<Index>::Matcher
 {
-	NtfsIndex const* me;           ///< The index being searched
+	BasicNtfsIndex const* me;           ///< The index being searched
 	F func;                        ///< User callback function
 	bool match_paths;              ///< Include full paths in matching
 	bool match_streams;            ///< Include stream names in matching
@@ -157,6 +158,7 @@ struct NtfsIndex::Matcher
 	size_t basename_index_in_path; ///< Index where file name starts in path
 	NameInfo name;                 ///< Current file name info
 	size_t depth;                  ///< Current recursion depth
+	NameCursor cursor;             ///< Blocks decoded last, with kLoadPackedNames
 
 	/**
 	 * @brief Entry point: process all names of a file record.
@@ -166,17 +168,17 @@ struct NtfsIndex::Matcher
 	 *
 	 * @param frs File Record Segment number to process
 	 */
-	void operator()(key_type::frs_type const frs)
+	void operator()(typename key_type::frs_type const frs)
 	{
-		if (frs < me->records_lookup.size())
+		if (frs < me->records_lookup_size())
 		{
 			TCHAR const dirsep = getdirsep();
 			std::tvstring temp;
-			Records::value_type const* const i = me->find(frs);
+			typename Records::value_type const* const i = me->find(frs);
 
 			// Process each hard link (name) of this file
 			unsigned short ji = 0;
-			for (LinkInfos::value_type const* j = me->nameinfo(i); j; j = me->nameinfo(j->next_entry), ++ji)
+			for (typename LinkInfos::value_type const* j = me->nameinfo(i); j; j = me->nameinfo(j->next_entry), ++ji)
 			{
 				size_t const old_basename_index_in_path = basename_index_in_path;
 				basename_index_in_path = path->size();
@@ -186,7 +188,7 @@ struct NtfsIndex::Matcher
 				append_directional(temp, &dirsep, 1, 0);
 				if (!(match_paths && frs == kRootFRS))
 				{
-					append_directional(temp, &me->names[j->name.offset()], j->name.length, j->name.ascii() ? -1 : 0);
+					append_directional(temp, me->name_chars(j->name, cursor), j->name.length, j->name.ascii() ? -1 : 0);
 				}
 
 				// Process this name with all its streams
@@ -208,24 +210,24 @@ struct NtfsIndex::Matcher
 	 * @param stream_prefix Path prefix to prepend
 	 * @param stream_prefix_size Length of prefix
 	 */
-	void operator()(key_type::frs_type const frs, key_type::name_info_type const name_info,
+	void operator()(typename key_type::frs_type const frs, typename key_type::name_info_type const name_info,
 		TCHAR const stream_prefix[], size_t const stream_prefix_size)
 	{
 		bool const match_paths_or_streams = match_paths || match_streams || match_attributes;
 		bool const buffered_matching = stream_prefix_size || match_paths_or_streams;
 
 		// Skip system metadata records (except root and user files)
-		if (frs < me->records_lookup.size() && (frs == kRootFRS || frs >= kFirstUserFRS || this->match_attributes))
+		if (frs < me->records_lookup_size() && (frs == kRootFRS || frs >= kFirstUserFRS || this->match_attributes))
 		{
-			Records::value_type const* const fr = me->find(frs);
+			typename Records::value_type const* const fr = me->find(frs);
 			key_type new_key(frs, name_info, 0);
 			ptrdiff_t traverse = 0;
 
 			// Process each stream of this file
-			for (StreamInfos::value_type const* k = me->streaminfo(fr); k;
+			for (typename StreamInfos::value_type const* k = me->streaminfo(fr); k;
 				k = me->streaminfo(k->next_entry), new_key.stream_info(new_key.stream_info() + 1))
 			{
-				assert(k->name.offset() <= me->names.size());
+				assert(k->name.offset() <= me->names_size());
 
 				// Check if this is a non-data attribute
 				bool const is_attribute = k->type_name_id &&
@@ -246,7 +248,7 @@ struct NtfsIndex::Matcher
 				// Add trailing backslash for directories
 				if (match_paths_or_streams)
 				{
-					if ((fr->stdinfo.attributes() & FILE_ATTRIBUTE_DIRECTORY) && frs != kRootFRS)
+					if ((fr->attributes & FILE_ATTRIBUTE_DIRECTORY) && frs != kRootFRS)
 					{
 						path->push_back(_T('\\'));
 					}
@@ -259,7 +261,7 @@ struct NtfsIndex::Matcher
 					if (k->name.length)
 					{
 						path->push_back(_T(':'));
-						append_directional(*path, k->name.length ? &me->names[k->name.offset()] : nullptr,
+						append_directional(*path, me->name_chars(k->name, cursor),
 							k->name.length, k->name.ascii() ? -1 : 0);
 					}
 
@@ -278,18 +280,20 @@ struct NtfsIndex::Matcher
 
 				// Determine what to pass to the callback
 				bool ascii;
-				size_t name_offset, name_length;
+				TCHAR const* chars;
+				size_t name_length;
 				if (buffered_matching)
 				{
 					// Use buffered path
-					name_offset = match_paths ? 0 : static_cast<unsigned int>(basename_index_in_path);
+					size_t const name_offset = match_paths ? 0 : static_cast<unsigned int>(basename_index_in_path);
+					chars = path->data() + static_cast<ptrdiff_t>(name_offset);
 					name_length = path->size() - name_offset;
 					ascii = false;
 				}
 				else
 				{
 					// Use direct name reference (faster)
-					name_offset = name.offset();
+					chars = me->name_chars(name, cursor);
 					name_length = name.length;
 					ascii = name.ascii();
 				}
@@ -297,9 +301,7 @@ struct NtfsIndex::Matcher
 				// Call user function (skip root's default stream at top level)
 				if (frs != kRootFRS || ((depth > 0) ^ (k->type_name_id == 0)))
 				{
-					traverse += func(
-						(buffered_matching ? path->data() : &*me->names.begin()) + static_cast<ptrdiff_t>(name_offset),
-						name_length, ascii, new_key, depth);
+					traverse += func(chars, name_length, ascii, new_key, depth);
 				}
 
 				// Restore path buffer
@@ -335,7 +337,7 @@ struct NtfsIndex::Matcher
 
 				// Iterate through all children of this directory
 				unsigned short ii = 0;
-				for (ChildInfos::value_type const* i = me->childinfo(fr);
+				for (typename ChildInfos::value_type const* i = me->childinfo(fr);
 					i && ~i->record_number;
 					i = me->childinfo(i->next_entry), ++ii)
 				{
@@ -348,12 +350,12 @@ struct NtfsIndex::Matcher
 					bool process_root_after = false;
 					do
 					{
-						Records::value_type const* const fr2 = me->find(record_number);
+						typename Records::value_type const* const fr2 = me->find(record_number);
 						unsigned short ji_target = name_index;
 						unsigned short ji = 0;
 
 						// Find the hard link that points to this parent
-						for (LinkInfos::value_type const* j = me->nameinfo(fr2); j;
+						for (typename LinkInfos::value_type const* j = me->nameinfo(fr2); j;
 							j = me->nameinfo(j->next_entry), ++ji)
 						{
 							if (j->parent == frs && ji == ji_target)
@@ -361,13 +363,13 @@ struct NtfsIndex::Matcher
 								// Append child name to path
 								if (buffered_matching)
 								{
-									append_directional(*path, &me->names[j->name.offset()],
+									append_directional(*path, me->name_chars(j->name, cursor),
 										j->name.length, j->name.ascii() ? -1 : 0);
 								}
 								name = j->name;
 
 								// Recurse into child
-								this->operator()(static_cast<key_type::frs_type>(record_number), ji, nullptr, 0);
+								this->operator()(static_cast<typename key_type::frs_type>(record_number), ji, nullptr, 0);
 
 								// Remove child name from path
 								if (buffered_matching)
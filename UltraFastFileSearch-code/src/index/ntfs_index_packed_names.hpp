@@ -0,0 +1,88 @@
+/**
+ * @file ntfs_index_packed_names.hpp
+ * @brief The names pool in LZ4 blocks, for hosts that hold many volumes.
+ *
+ * With kLoadPackedNames, load() packs the interned names pool into
+ * PackedNames once loading finishes, and frees it:
+ *
+ * ```
+ *   offset:   0 ........................ packed_names.size() ........ names_size()
+ *             [ packed_names: 4 KB LZ4 blocks ][ names: added since ]
+ * ```
+ *
+ * - Offsets do not change. An offset below packed_names.size() is decoded
+ *   from its block; anything the Patcher, the USN replay or a refresh
+ *   appends later lands in names, past the packed part, as plain text.
+ * - Every reader goes through name_chars() with a cursor of its own: the
+ *   Matcher, ParentIterator, take_early_matches(), the Preprocessor and
+ *   the Patcher. The Matcher walks the pool in the order intern_names()
+ *   laid it out, so it decodes each block about once per search.
+ * - ParentIterator hands out pointers its callers keep across steps (the
+ *   result list sorts by whole paths), so it copies each packed component
+ *   out of its cursor and keeps it until the iterator goes away.
+ * - Snapshots need the whole index (kLoadEverything), so a packed index
+ *   is never saved.
+ *
+ * @note This file is included by ntfs_index_impl.hpp.
+ *       Do not include this file directly.
+ *
+ * @see packed_names.hpp for the block format
+ * @see benchmark.hpp for --benchmark-names-from, which weighs memory against match time
+ */
+
+#ifndef UFFS_NTFS_INDEX_PACKED_NAMES_HPP
+#define UFFS_NTFS_INDEX_PACKED_NAMES_HPP
+
+#ifndef UFFS_NTFS_INDEX_IMPL_HPP
+#error "Do not include ntfs_index_packed_names.hpp directly. Include ntfs_index.hpp instead."
+#endif
+
+/**
+ * @brief Moves the names pool into packed_names.
+ *
+ * Call under the lock after intern_names(); load() does so when it
+ * finishes with kLoadPackedNames.
+ */
+template <class Index>
+inline void BasicNtfsIndex<Index>::pack_names()
+{
+	this->packed_names.pack(this->names.data(), this->names.size());
+	std::tvstring().swap(this->names);
+}
+
+/// @brief Elements of the names pool that @p name takes: ASCII names hold two characters per element.
+template <class Index>
+inline size_t BasicNtfsIndex<Index>::name_units(NameInfo const& name) noexcept
+{
+	return name.ascii() ? (name.length + 1U) / 2 : name.length;
+}
+
+/**
+ * @brief The characters of @p name, for append_directional(..., ascii() ? -1 : 0).
+ *
+ * @param cursor  The caller's; a packed name stays valid until its next use
+ */
+template <class Index>
+inline std::tvstring::value_type const* BasicNtfsIndex<Index>::name_chars(NameInfo const& name, NameCursor& cursor) const
+{
+	size_t const offset = name.offset();
+	size_t const packed = this->packed_names.size();
+	return offset < packed
+		? this->packed_names.at(offset, name_units(name), cursor)
+		: this->names_begin() + static_cast<ptrdiff_t>(offset - packed);
+}
+
+/// @brief The characters of @p name, valid for as long as the iterator lives.
+template <class Index>
+inline void const* BasicNtfsIndex<Index>::ParentIterator::chars(NameInfo const& name)
+{
+	std::tvstring::value_type const* const p = this->index->name_chars(name, this->cursor);
+	if (!name.length || name.offset() >= this->index->packed_names.size())
+	{
+		return p;
+	}
+	this->kept.emplace_front(p, name_units(name));
+	return this->kept.front().data();
+}
+
+#endif // UFFS_NTFS_INDEX_PACKED_NAMES_HPP
@@ -0,0 +1,296 @@
+/**
+ * @file ntfs_index_patch.hpp
+ * @brief In-place edits of a finished NtfsIndex that keep directory totals exact.
+ *
+ * After load() the $I30 stream of each directory holds the sizes of its
+ * whole subtree (see the Preprocessor in ntfs_index_load.hpp). Anything that
+ * changes a record of a finished index - a journal event, a re-parsed MFT
+ * record - goes through NtfsIndex::Patcher:
+ *
+ * ```
+ *   detach(frs)    withdraw its share from every ancestor, unlink its ChildInfos
+ *   ...            change the record
+ *   attach(frs)    relink its ChildInfos, add its new share to every ancestor
+ * ```
+ *
+ * Shares use the same per-link split as the Preprocessor, so length,
+ * allocated and treesize stay exactly what a rebuild would produce.
+ * Bulkiness leaves out children of 1% or more of a directory's allocation,
+ * which is not additive; it is adjusted by the same deltas and is therefore
+ * an approximation until the next rebuild. The arithmetic itself is in
+ * io/subtree_totals.hpp, where it is unit-tested.
+ *
+ * @note This file is included at the end of ntfs_index_impl.hpp.
+ *       Do not include this file directly.
+ *
+ * @see ntfs_index_usn.hpp, ntfs_index_refresh.hpp for the users
+ */
+
+#ifndef UFFS_NTFS_INDEX_PATCH_HPP
+#define UFFS_NTFS_INDEX_PATCH_HPP
+
+#ifndef UFFS_NTFS_INDEX_IMPL_HPP
+#error "Do not include ntfs_index_patch.hpp directly. Include ntfs_index.hpp instead."
+#endif
+
+template <class Index>
+struct BasicNtfsIndex<Index>::Patcher
+{
+	BasicNtfsIndex* me;
+	std::vector<std::pair<unsigned int, unsigned short> > links;  // scratch: (parent, name_index)
+	NameCursor cursor;
+
+	// Edits relink lists out of order, so lookups walk them again from here on
+	explicit Patcher(BasicNtfsIndex* const me) : me(me) { me->_lists_compact = false; }
+
+	typename Records::value_type* existing(unsigned int const frs)
+	{
+		return frs < me->records_lookup.size() && ~me->records_lookup[frs]
+			? &me->records_data[me->records_lookup[frs]] : nullptr;
+	}
+
+	typename Records::value_type* live(unsigned int const frs)
+	{
+		typename Records::value_type* const fr = this->existing(frs);
+		return fr && fr->name_count ? fr : nullptr;
+	}
+
+	bool same_name(NameInfo const& name, std::u16string const& value)
+	{
+		if (name.length != value.size())
+		{
+			return false;
+		}
+		TCHAR const* const p = me->name_chars(name, this->cursor);
+		if (name.ascii())
+		{
+			char const* const a = reinterpret_cast<char const*>(p);
+			for (size_t i = 0; i != value.size(); ++i)
+			{
+				if (static_cast<unsigned char>(a[i]) != value[i])
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+		return memcmp(p, value.data(), value.size() * sizeof(TCHAR)) == 0;
+	}
+
+	void set_name(NameInfo& name, std::u16string const& value)
+	{
+		TCHAR const* const p = reinterpret_cast<TCHAR const*>(value.data());
+		size_t const length = value.size() < UCHAR_MAX ? value.size() : UCHAR_MAX;
+		require_width(me->names_size() + length, 0);
+		name.offset(static_cast<Index>(me->names_size()));
+		name.length = static_cast<unsigned char>(length);
+		name.ascii(append_name(me->names, p, length));
+	}
+
+	/// Chain position of the link (parent, name), or -1.
+	ptrdiff_t find_link(typename Records::value_type* const fr, unsigned int const parent, std::u16string const& name)
+	{
+		ptrdiff_t position = 0;
+		for (typename LinkInfos::value_type* j = me->nameinfo(fr); j; j = me->nameinfo(j->next_entry), ++position)
+		{
+			if (j->parent == parent && this->same_name(j->name, name))
+			{
+				return position;
+			}
+		}
+		return -1;
+	}
+
+	typename LinkInfos::value_type* link_at(typename Records::value_type* const fr, ptrdiff_t position)
+	{
+		typename LinkInfos::value_type* j = me->nameinfo(fr);
+		for (; j && position; --position)
+		{
+			j = me->nameinfo(j->next_entry);
+		}
+		return j;
+	}
+
+	/// True for the ::$DATA:WofCompressedData stream of a WOF-compressed file.
+	bool is_wof_stream(typename StreamInfos::value_type const* const k)
+	{
+		bool const is_data_attribute = (k->type_name_id << (CHAR_BIT / 2)) ==
+			static_cast<int>(ntfs::AttributeTypeCode::AttributeData);
+		return is_data_attribute && k->name.length == 17 &&
+			(k->name.ascii()
+				? memcmp(reinterpret_cast<char const*>(me->name_chars(k->name, this->cursor)),
+					"WofCompressedData", 17 * sizeof(char)) == 0
+				: memcmp(reinterpret_cast<wchar_t const*>(me->name_chars(k->name, this->cursor)),
+					L"WofCompressedData", 17 * sizeof(wchar_t)) == 0);
+	}
+
+	/// Folds the WofCompressedData allocation into the default stream, as the Preprocessor does.
+	void merge_wof(typename Records::value_type* const fr)
+	{
+		typename StreamInfos::value_type* default_stream = nullptr;
+		typename StreamInfos::value_type* compressed = nullptr;
+		for (typename StreamInfos::value_type* k = me->streaminfo(fr); k; k = me->streaminfo(k->next_entry))
+		{
+			if ((k->type_name_id << (CHAR_BIT / 2)) == static_cast<int>(ntfs::AttributeTypeCode::AttributeData) &&
+				!k->name.length)
+			{
+				default_stream = k;
+			}
+			else if (this->is_wof_stream(k) && !k->is_allocated_size_accounted_for_in_main_stream)
+			{
+				compressed = k;
+			}
+		}
+		if (default_stream && compressed)
+		{
+			uffs::merge_wof(*default_stream, *compressed);
+		}
+	}
+
+	/// What the Preprocessor adds to the parent of link @p name_info.
+	SizeInfo contribution(typename Records::value_type const* const fr, unsigned short const name_info)
+	{
+		SizeInfo result;
+		for (typename StreamInfos::value_type const* k = me->streaminfo(fr); k; k = me->streaminfo(k->next_entry))
+		{
+			add_link_share(result, *k, this->is_wof_stream(k), name_info, fr->name_count);
+		}
+		return result;
+	}
+
+	/// What the Preprocessor adds to the $I30 stream of @p frs for its children.
+	SizeInfo children(unsigned int const frs)
+	{
+		std::vector<SizeInfo> shares;
+		typename Records::value_type* const fr = this->existing(frs);
+		for (typename ChildInfos::value_type* i = fr ? me->childinfo(fr) : nullptr; i && ~i->record_number; i = me->childinfo(i->next_entry))
+		{
+			typename Records::value_type* const child = me->find(i->record_number);
+			if (child != fr && child->name_count)
+			{
+				shares.push_back(this->contribution(child,
+					static_cast<unsigned short>(child->name_count - 1 - i->name_index)));
+			}
+		}
+		return children_totals(shares);
+	}
+
+	/// Adds (or withdraws) @p delta to the $I30 totals of @p dir and all its ancestors.
+	void propagate(unsigned int dir, SizeInfo const& delta, bool const withdraw)
+	{
+		for (size_t steps = 0; steps != me->records_lookup.size(); ++steps)
+		{
+			typename Records::value_type* const fr = this->existing(dir);
+			if (!fr)
+			{
+				break;
+			}
+			for (typename StreamInfos::value_type* k = me->streaminfo(fr); k; k = me->streaminfo(k->next_entry))
+			{
+				if (!k->type_name_id)
+				{
+					apply_delta(*k, delta, withdraw);
+					break;
+				}
+			}
+			if (!fr->name_count || fr->first_name.parent == dir)
+			{
+				break;  // reached the root (its own parent) or a detached directory
+			}
+			dir = fr->first_name.parent;
+		}
+	}
+
+	/// Adds (or withdraws) every link's share of @p frs to its ancestors.
+	void contribute(unsigned int const frs, bool const withdraw)
+	{
+		typename Records::value_type* const fr = this->live(frs);
+		unsigned short name_info = 0;
+		for (typename LinkInfos::value_type* j = fr ? me->nameinfo(fr) : nullptr; j; j = me->nameinfo(j->next_entry), ++name_info)
+		{
+			if (j->parent != frs)
+			{
+				this->propagate(j->parent, this->contribution(fr, name_info), withdraw);
+			}
+		}
+	}
+
+	/// Removes the ChildInfo entries of every link of @p frs from their parents.
+	void unlink_children(unsigned int const frs)
+	{
+		typename Records::value_type* const fr = this->live(frs);
+		unsigned short name_info = 0;
+		for (typename LinkInfos::value_type* j = fr ? me->nameinfo(fr) : nullptr; j; j = me->nameinfo(j->next_entry), ++name_info)
+		{
+			typename Records::value_type* const parent = j->parent != frs ? this->existing(j->parent) : nullptr;
+			unsigned short const name_index = static_cast<unsigned short>(fr->name_count - 1 - name_info);
+			for (typename ChildInfo::next_entry_type* i = parent ? &parent->first_child : nullptr; i && ~*i; i = &me->childinfos[*i].next_entry)
+			{
+				ChildInfo const& child = me->childinfos[*i];
+				if (child.record_number == frs && child.name_index == name_index)
+				{
+					*i = child.next_entry;  // the entry itself is left unreferenced
+					break;
+				}
+			}
+		}
+	}
+
+	/// Adds a ChildInfo entry for every link of @p frs to its parent, as load() does.
+	void link_children(unsigned int const frs)
+	{
+		links.clear();
+		typename Records::value_type* const fr = this->live(frs);
+		unsigned short name_info = 0;
+		for (typename LinkInfos::value_type* j = fr ? me->nameinfo(fr) : nullptr; j; j = me->nameinfo(j->next_entry), ++name_info)
+		{
+			if (j->parent != frs)
+			{
+				links.push_back(std::make_pair(j->parent,
+					static_cast<unsigned short>(fr->name_count - 1 - name_info)));
+			}
+		}
+		for (size_t l = 0; l != links.size(); ++l)
+		{
+			typename Records::iterator const parent = me->at(links[l].first);  // may grow records_data
+			ChildInfo child;
+			child.record_number = frs;
+			child.name_index = links[l].second;
+			child.next_entry = parent->first_child;
+			parent->first_child = static_cast<typename ChildInfos::value_type::next_entry_type>(me->childinfos.size());
+			me->childinfos.push_back(child);
+		}
+	}
+
+	void detach(unsigned int const frs)
+	{
+		this->contribute(frs, true);
+		this->unlink_children(frs);
+	}
+
+	void attach(unsigned int const frs)
+	{
+		this->link_children(frs);
+		this->contribute(frs, false);
+	}
+
+	/// Detaches @p frs and empties its record, keeping its children.
+	void clear(unsigned int const frs)
+	{
+		this->detach(frs);
+		typename Records::value_type* const fr = this->existing(frs);
+		me->_total_names_and_streams.fetch_sub(static_cast<size_t>(fr->name_count) * fr->stream_count,
+			atomic_namespace::memory_order_acq_rel);
+		typename ChildInfos::value_type::next_entry_type const first_child = fr->first_child;
+		me->clear_record(fr);
+		fr->first_child = first_child;
+	}
+
+	void remove(unsigned int const frs)
+	{
+		this->clear(frs);
+		me->clear_record(this->existing(frs));
+	}
+};
+
+#endif // UFFS_NTFS_INDEX_PATCH_HPP
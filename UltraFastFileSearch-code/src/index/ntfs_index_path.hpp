@@ -147,7 +147,8 @@
 // The caller reverses the accumulated components to get the final path.
 //
 
-inline NtfsIndex::ParentIterator& NtfsIndex::ParentIterator::operator++()
+template <class Index>
+inline typename BasicNtfsIndex<Index>::ParentIterator& BasicNtfsIndex<Index>::ParentIterator::operator++()
 {
 #ifdef __clang__
 #pragma clang diagnostic push
@@ -212,7 +213,7 @@ inline NtfsIndex::ParentIterator& NtfsIndex::ParentIterator::operator++()
 			// State 4: Named stream (e.g., "Zone.Identifier")
 			if (ptrs.stream->name.length)
 			{
-				result.first = &index->names[ptrs.stream->name.offset()];
+				result.first = this->chars(ptrs.stream->name);
 				result.second = ptrs.stream->name.length;
 				result.ascii = ptrs.stream->name.ascii();
 				if (result.second)
@@ -243,7 +244,7 @@ inline NtfsIndex::ParentIterator& NtfsIndex::ParentIterator::operator++()
 		// State 6: File/directory name
 		if (!this->iteration || !is_root())
 		{
-			result.first = &index->names[ptrs.link->name.offset()];
+			result.first = this->chars(ptrs.link->name);
 			result.second = ptrs.link->name.length;
 			result.ascii = ptrs.link->name.ascii();
 			if (result.second)
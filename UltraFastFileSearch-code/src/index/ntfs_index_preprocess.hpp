@@ -0,0 +1,517 @@
+/**
+ * @file ntfs_index_preprocess.hpp
+ * @brief Bottom-up directory totals, computed once the last record is loaded.
+ *
+ * After MFT parsing, each file knows its own size, but directories don't
+ * know the total size of their contents. The Preprocessor walks the tree
+ * from the root in post-order and adds the totals of every directory's
+ * subtree to its $I30 stream:
+ *
+ * - Bulkiness calculation (excludes children < 1% of parent)
+ * - Hard link size distribution (Accumulator pattern)
+ * - WOF compression handling (WofCompressedData streams)
+ *
+ * ## Parallel Walk
+ *
+ * The walk keeps its own stack, so deep trees cannot overflow the call
+ * stack. On more than one core the tree is cut at the shallowest depth
+ * with enough subtrees to keep every core busy:
+ *
+ * ```
+ *   depth 0..cut-1   root ... ─┐                     (calling thread, last)
+ *                              │ results in DFS order
+ *   depth cut        [subtree] [subtree] [subtree]   (worker threads, any order)
+ * ```
+ *
+ * Every subtree is walked exactly as before, the top of the tree is then
+ * walked with each subtree's result in its place, so totals are the same
+ * as a single walk. A file with several links is visited once per link,
+ * possibly on different threads; its WofCompressedData merge, the only
+ * change a file's own visit makes, is therefore deferred until every
+ * subtree is done. A directory with several links adds its children once
+ * per visit, which depends on the order of the visits; if there is one,
+ * the whole tree is walked on the calling thread.
+ *
+ * ## Deferred Totals
+ *
+ * Searches that print no size column never read the totals, and on a
+ * large volume the walk is a noticeable part of the time to first
+ * result. An index told to defer_sizes() before loading skips the walk in
+ * load(); the first ensure_sizes(), which get_sizes() and everything that
+ * patches or saves the totals call, runs it instead. The whole tree is
+ * walked at once, as a directory's total is also part of its ancestors'.
+ *
+ * @note This file is included by ntfs_index_impl.hpp.
+ *       Do not include this file directly.
+ *
+ * @see ntfs_index_load.hpp for load(), which runs preprocess() last unless deferred
+ * @see ntfs_index_patch.hpp for keeping the totals up to date afterwards
+ */
+
+#ifndef UFFS_NTFS_INDEX_PREPROCESS_HPP
+#define UFFS_NTFS_INDEX_PREPROCESS_HPP
+
+#ifndef UFFS_NTFS_INDEX_IMPL_HPP
+#error "Do not include ntfs_index_preprocess.hpp directly. Include ntfs_index.hpp instead."
+#endif
+
+template <class Index>
+struct BasicNtfsIndex<Index>::Preprocessor
+{
+	using PreprocessResult = SizeInfo;
+
+	/// A record reached through one of its links; each link carries its own share
+	struct Visit
+	{
+		typename Records::value_type* fr;
+		typename key_type::name_info_type name_info;
+		unsigned short total_names;
+	};
+
+	/// A visit whose children are being walked
+	struct Frame
+	{
+		Visit visit;
+		typename ChildInfos::value_type* next_child;
+		PreprocessResult children_size;
+		size_t scratch_begin;
+	};
+
+	// Accumulator: Fair Size Distribution for Hard Links
+	struct Accumulator
+	{
+		static unsigned long long delta_impl(unsigned long long const value,
+			unsigned short const i, unsigned short const n)
+		{
+			return link_share(value, i, n);
+		}
+
+		static unsigned long long delta(unsigned long long const value,
+			unsigned short const i, unsigned short const n)
+		{
+			return n != 1
+				? (n != 2 ? delta_impl(value, i, n)
+						: (i != 1 ? delta_impl(value, ((void)(assert(i == 0)), 0), n)
+							   : delta_impl(value, i, n)))
+				: delta_impl(value, ((void)(assert(i == 0)), 0), n);
+		}
+	};
+
+	BasicNtfsIndex* me;
+	bool concurrent;  // other threads may visit the same files
+	std::vector<Frame> stack;
+	using Scratch = std::vector<unsigned long long>;
+	Scratch scratch;
+	std::vector<typename Records::value_type*> deferred_merges;
+	mutable NameCursor cursor;
+
+	explicit Preprocessor(BasicNtfsIndex* const me, bool const concurrent = false) : me(me), concurrent(concurrent) {}
+
+	Visit visit(typename ChildInfos::value_type const* const i) const
+	{
+		typename Records::value_type* const fr = me->find(i->record_number);
+		Visit const result = { fr,
+			static_cast<typename key_type::name_info_type>(fr->name_count - static_cast<size_t>(1) - i->name_index),
+			fr->name_count };
+		return result;
+	}
+
+	/**
+	 * @brief Whether @p k is the WofCompressedData stream of a WOF-compressed file.
+	 *
+	 * The name must be exactly "WofCompressedData". Streams whose names only
+	 * start with it are ordinary streams; comparing 17 characters of a shorter
+	 * or packed name would also read past it.
+	 */
+	bool is_compression_reparse_point(typename StreamInfos::value_type const* const k) const
+	{
+		bool const is_data_attribute =
+			(k->type_name_id << (CHAR_BIT / 2)) ==
+			static_cast<int>(ntfs::AttributeTypeCode::AttributeData);
+		return is_data_attribute && k->name.length == 17 &&
+			(k->name.ascii()
+				 ? memcmp(reinterpret_cast<char const*>(me->name_chars(k->name, this->cursor)),
+					        "WofCompressedData", 17 * sizeof(char)) == 0
+				 : memcmp(reinterpret_cast<wchar_t const*>(me->name_chars(k->name, this->cursor)),
+					        L"WofCompressedData", 17 * sizeof(wchar_t)) == 0);
+	}
+
+	/**
+	 * @brief Walks the subtree of @p top in post-order and returns its share for the parent.
+	 *
+	 * @param is_root  @p top is the root, whose total includes the reserved clusters
+	 * @param cut      Depth below @p top at which at_cut(visit) supplies the
+	 *                 result instead of a walk, or 0
+	 */
+	template <class AtCut>
+	PreprocessResult walk(Visit const& top, bool const is_root, size_t const cut, AtCut&& at_cut)
+	{
+		if (!top.fr)
+		{
+			return PreprocessResult();
+		}
+
+		stack.clear();
+		this->push(top);
+		for (;;)
+		{
+			Frame& f = stack.back();
+			if (typename ChildInfos::value_type* const i = f.next_child && ~f.next_child->record_number ? f.next_child : nullptr)
+			{
+				f.next_child = me->childinfo(i->next_entry);
+				if (me->find(i->record_number) != f.visit.fr)
+				{
+					if (stack.size() == cut)
+					{
+						this->add(f, at_cut(this->visit(i)));
+					}
+					else
+					{
+						this->push(this->visit(i));  // invalidates f
+					}
+				}
+				continue;
+			}
+
+			PreprocessResult const result = this->finish(f, is_root && stack.size() == 1);
+			stack.pop_back();
+			if (stack.empty())
+			{
+				return result;
+			}
+			this->add(stack.back(), result);
+		}
+	}
+
+	PreprocessResult walk(Visit const& top, bool const is_root)
+	{
+		return this->walk(top, is_root, 0, [](Visit const&) { return PreprocessResult(); });
+	}
+
+	/// Appends the visits at depth @p cut below @p root to @p out, in the order walk() reaches them.
+	void collect(typename Records::value_type* const root, size_t const cut, std::vector<Visit>& out)
+	{
+		std::vector<std::pair<typename Records::value_type*, typename ChildInfos::value_type*> > path(1, std::make_pair(root, me->childinfo(root)));
+		while (!path.empty())
+		{
+			typename ChildInfos::value_type* const i = path.back().second;
+			if (!i || !~i->record_number)
+			{
+				path.pop_back();
+				continue;
+			}
+			path.back().second = me->childinfo(i->next_entry);
+			typename Records::value_type* const fr2 = me->find(i->record_number);
+			if (fr2 != path.back().first)
+			{
+				if (path.size() == cut)
+				{
+					out.push_back(this->visit(i));
+				}
+				else
+				{
+					path.push_back(std::make_pair(fr2, me->childinfo(fr2)));
+				}
+			}
+		}
+	}
+
+	/// Merges the WofCompressedData streams of files whose merge was deferred.
+	void merge_deferred(std::vector<typename Records::value_type*> const& records)
+	{
+		for (size_t r = 0; r != records.size(); ++r)
+		{
+			typename StreamInfos::value_type* default_stream = nullptr;
+			typename StreamInfos::value_type* compressed_default_stream_to_merge = nullptr;
+			for (typename StreamInfos::value_type* k = me->streaminfo(records[r]); k; k = me->streaminfo(k->next_entry))
+			{
+				if ((k->type_name_id << (CHAR_BIT / 2)) == static_cast<int>(ntfs::AttributeTypeCode::AttributeData) &&
+					!k->name.length)
+				{
+					default_stream = k;
+				}
+				if (this->is_compression_reparse_point(k) && !k->is_allocated_size_accounted_for_in_main_stream)
+				{
+					compressed_default_stream_to_merge = k;
+				}
+			}
+			if (compressed_default_stream_to_merge && default_stream)
+			{
+				compressed_default_stream_to_merge->is_allocated_size_accounted_for_in_main_stream = 1;
+				default_stream->allocated += compressed_default_stream_to_merge->allocated;
+			}
+		}
+	}
+
+private:
+	void push(Visit const& visit)
+	{
+		Frame const frame = { visit, me->childinfo(visit.fr), PreprocessResult(), scratch.size() };
+		stack.push_back(frame);
+	}
+
+	void add(Frame& f, PreprocessResult const& subresult)
+	{
+		scratch.push_back(subresult.bulkiness);
+
+		f.children_size.length    += subresult.length;
+		f.children_size.allocated += subresult.allocated;
+		f.children_size.bulkiness += subresult.bulkiness;
+		f.children_size.treesize  += subresult.treesize;
+	}
+
+	/// Totals of a visit whose children are all done; updates the record's $I30 stream.
+	PreprocessResult finish(Frame& f, bool const is_root)
+	{
+		typename Records::value_type* const fr = f.visit.fr;
+		typename key_type::name_info_type const name_info = f.visit.name_info;
+		unsigned short const total_names = f.visit.total_names;
+		size_t const old_scratch_size = f.scratch_begin;
+		bool const has_children = scratch.size() != old_scratch_size || is_root;
+		PreprocessResult children_size = f.children_size;
+
+		std::make_heap(scratch.begin() + static_cast<ptrdiff_t>(old_scratch_size), scratch.end());
+		unsigned long long const threshold = children_size.allocated / 100;
+
+		for (auto i = scratch.end();
+			 i != scratch.begin() + static_cast<ptrdiff_t>(old_scratch_size);)
+		{
+			std::pop_heap(scratch.begin() + static_cast<ptrdiff_t>(old_scratch_size), i);
+			--i;
+
+			if (*i < threshold)
+			{
+				break;
+			}
+
+			children_size.bulkiness = children_size.bulkiness - *i;
+		}
+		scratch.erase(scratch.begin() + static_cast<ptrdiff_t>(old_scratch_size), scratch.end());
+
+		if (is_root)
+		{
+			children_size.allocated +=
+				static_cast<unsigned long long>(me->_reserved_clusters) * me->_cluster_size;
+		}
+
+		PreprocessResult result = children_size;
+
+		// Stream Processing and Compression Handling
+		typename StreamInfos::value_type* default_stream = nullptr;
+		typename StreamInfos::value_type* compressed_default_stream_to_merge = nullptr;
+		unsigned long long default_allocated_delta = 0;
+		unsigned long long compressed_default_allocated_delta = 0;
+		unsigned int streams = 0;
+
+		for (typename StreamInfos::value_type* k = me->streaminfo(fr); k; k = me->streaminfo(k->next_entry), ++streams)
+		{
+			bool const is_data_attribute =
+				(k->type_name_id << (CHAR_BIT / 2)) ==
+				static_cast<int>(ntfs::AttributeTypeCode::AttributeData);
+
+			bool const is_default_stream = is_data_attribute && !k->name.length;
+
+			unsigned long long const allocated_delta = Accumulator::delta(
+				k->is_allocated_size_accounted_for_in_main_stream
+					? static_cast<file_size_type>(0)
+					: k->allocated,
+				name_info, total_names);
+			unsigned long long const bulkiness_delta = Accumulator::delta(
+				k->bulkiness, name_info, total_names);
+
+			if (is_default_stream)
+			{
+				default_stream = k;
+				default_allocated_delta += allocated_delta;
+			}
+
+			// WOF Compression Handling
+			bool const is_compression_reparse_point = this->is_compression_reparse_point(k);
+
+			unsigned long long const length_delta = Accumulator::delta(
+				is_compression_reparse_point ? static_cast<file_size_type>(0) : k->length,
+				name_info, total_names);
+
+			if (is_compression_reparse_point)
+			{
+				if (!k->is_allocated_size_accounted_for_in_main_stream)
+				{
+					compressed_default_stream_to_merge = k;
+					compressed_default_allocated_delta += allocated_delta;
+				}
+			}
+
+			result.length    += length_delta;
+			result.allocated += allocated_delta;
+			result.bulkiness += bulkiness_delta;
+			result.treesize  += 1;
+
+			// Adding nothing would still race with other visits of a file
+			if (!k->type_name_id && has_children)
+			{
+				k->length    += children_size.length;
+				k->allocated += children_size.allocated;
+				k->bulkiness += children_size.bulkiness;
+				k->treesize  += children_size.treesize;
+			}
+		}
+
+		me->_preprocessed_so_far.fetch_add(streams, atomic_namespace::memory_order_acq_rel);
+
+		// Merge WOF compressed stream size into default stream
+		if (compressed_default_stream_to_merge && default_stream)
+		{
+			file_size_type merged_allocated = default_stream->allocated;
+			merged_allocated += compressed_default_stream_to_merge->allocated;
+			if (concurrent && fr->name_count > 1)
+			{
+				deferred_merges.push_back(fr);  // another link may be visited right now
+			}
+			else
+			{
+				compressed_default_stream_to_merge->is_allocated_size_accounted_for_in_main_stream = 1;
+				default_stream->allocated = merged_allocated;
+			}
+
+			result.allocated -= default_allocated_delta;
+			result.allocated -= compressed_default_allocated_delta;
+			result.allocated += Accumulator::delta(merged_allocated, name_info, total_names);
+		}
+
+		return result;
+	}
+};
+
+/**
+ * @brief Computes the directory totals of a fully loaded index.
+ *
+ * Called by load() once the last record has arrived.
+ *
+ * @throws std::bad_alloc, rethrown from whichever thread ran out of memory
+ */
+template <class Index>
+inline void BasicNtfsIndex<Index>::preprocess()
+{
+	typedef typename Preprocessor::Visit Visit;
+	typedef typename Preprocessor::PreprocessResult PreprocessResult;
+
+	typename Records::value_type* const root = this->find(kRootFRS);
+	Visit const top = { root, 0, 1 };
+	Preprocessor preprocessor(this);
+
+	unsigned int const threads = std::thread::hardware_concurrency();
+	bool concurrent = root && threads > 1;
+	for (typename Records::iterator i = this->records_data.begin(); concurrent && i != this->records_data.end(); ++i)
+	{
+		if (i->name_count > 1 && this->childinfo(&*i))
+		{
+			concurrent = false;  // a directory with several links; see the file comment
+		}
+	}
+
+	// Cut where the tree is wide enough, but not so deep that the top becomes the work
+	size_t cut = 0;
+	std::vector<Visit> tasks;
+	for (size_t depth = 1; concurrent && depth <= 8 && tasks.size() < static_cast<size_t>(threads) * 64; ++depth)
+	{
+		std::vector<Visit> level;
+		preprocessor.collect(root, depth, level);
+		if (level.size() <= tasks.size())
+		{
+			break;  // no wider further down
+		}
+		tasks.swap(level);
+		cut = depth;
+	}
+
+	if (tasks.size() < 2)
+	{
+		preprocessor.walk(top, true);
+		return;
+	}
+
+	// Walk the subtrees below the cut, each with its own stack
+	std::vector<PreprocessResult> results(tasks.size());
+	atomic_namespace::atomic<size_t> next_task(0);
+	std::mutex mutex;
+	std::exception_ptr error;
+	std::vector<typename Records::value_type*> deferred_merges;
+	{
+		std::vector<std::thread> workers;
+		auto const worker = [&]()
+		{
+			try
+			{
+				Preprocessor subtree(this, true);
+				for (size_t t; (t = next_task.fetch_add(1, atomic_namespace::memory_order_relaxed)) < tasks.size();)
+				{
+					results[t] = subtree.walk(tasks[t], false);
+				}
+				std::lock_guard<std::mutex> guard(mutex);
+				deferred_merges.insert(deferred_merges.end(), subtree.deferred_merges.begin(), subtree.deferred_merges.end());
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> guard(mutex);
+				if (!error)
+				{
+					error = std::current_exception();
+				}
+				next_task.store(tasks.size(), atomic_namespace::memory_order_relaxed);
+			}
+		};
+		workers.reserve(threads);
+		for (unsigned int t = 0; t != threads; ++t)
+		{
+			workers.emplace_back(worker);
+		}
+		for (auto& w : workers)
+		{
+			w.join();
+		}
+	}
+	if (error)
+	{
+		std::rethrow_exception(error);
+	}
+	preprocessor.merge_deferred(deferred_merges);
+
+	// The top of the tree, with the subtrees' results in the order collect() found them
+	size_t next_result = 0;
+	preprocessor.walk(top, true, cut, [&](Visit const&) { return results[next_result++]; });
+}
+
+/**
+ * @brief Leaves the directory totals to the first ensure_sizes().
+ *
+ * Must be called before loading starts.
+ */
+template <class Index>
+inline void BasicNtfsIndex<Index>::defer_sizes() noexcept
+{
+	this->_defer_sizes = true;
+}
+
+/**
+ * @brief Runs the deferred preprocess(), if load() left it pending.
+ *
+ * Cheap once the totals exist. The first caller walks the tree while
+ * any other waits, so get_sizes() can be called from several threads.
+ */
+template <class Index>
+inline void BasicNtfsIndex<Index>::ensure_sizes() const
+{
+	if (!this->_sizes_pending.load(atomic_namespace::memory_order_acquire))
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> const guard(this->_sizes_mutex);
+	if (this->_sizes_pending.load(atomic_namespace::memory_order_relaxed))
+	{
+		const_cast<BasicNtfsIndex*>(this)->preprocess();
+		this->_sizes_pending.store(false, atomic_namespace::memory_order_release);
+	}
+}
+
+#endif // UFFS_NTFS_INDEX_PREPROCESS_HPP
@@ -0,0 +1,244 @@
+/**
+ * @file ntfs_index_refresh.hpp
+ * @brief Periodic re-scan of the MFT that re-parses only chunks that changed.
+ *
+ * A finished index remembers a 64-bit hash of every $MFT::$DATA chunk it was
+ * built from. A re-scan reads the whole MFT again through the usual reader,
+ * but instead of rebuilding the index it hashes each chunk as it arrives and
+ * only re-parses the files whose records sit in chunks with a new hash:
+ *
+ * ```
+ *   begin_refresh()        reopen the volume, reset progress
+ *        │
+ *   every chunk ──► chunk_changed() ──► refresh()    stage changed records
+ *        │                                (MftRefreshSet)
+ *   last chunk ──► finish_refresh()
+ *                     ├── read the extension records that were not staged
+ *                     ├── Patcher::clear() each affected file, keeping its children
+ *                     ├── load_record() its segments again, then resolve_extensions()
+ *                     └── Patcher: restore $I30 child totals, re-add its share
+ * ```
+ *
+ * Nothing is rebuilt and the Preprocessor does not run again; directory
+ * totals are kept up to date the same way as for journal events (see
+ * ntfs_index_patch.hpp), so bulkiness is approximate until the next full
+ * load. Storage is append-only as with journal replay.
+ *
+ * The first load() of an index records its chunk hashes as they pass, so
+ * the first re-scan already re-parses only what changed since.
+ *
+ * @note This file is included at the end of ntfs_index_impl.hpp.
+ *       Do not include this file directly.
+ *
+ * @see io/mft_refresh.hpp for chunk hashes and record staging
+ * @see io/mft_reader_read_operation.hpp for where the reader hands chunks over
+ */
+
+#ifndef UFFS_NTFS_INDEX_REFRESH_HPP
+#define UFFS_NTFS_INDEX_REFRESH_HPP
+
+#ifndef UFFS_NTFS_INDEX_IMPL_HPP
+#error "Do not include ntfs_index_refresh.hpp directly. Include ntfs_index.hpp instead."
+#endif
+
+/**
+ * @brief Prepares a finished index for a re-scan by a new OverlappedNtfsMftReadPayload.
+ *
+ * Reopens the volume, which load() closed, and resets the finished event
+ * and progress; the index stays searchable until finish_refresh() patches it.
+ * An index that was not loaded through init() (a dump replay, a test) has
+ * no volume to reopen; its caller feeds the chunks from the same source.
+ *
+ * @throws std::logic_error if the index is a snapshot or has not finished loading
+ * @throws Windows exception if the volume cannot be opened
+ */
+template <class Index>
+inline void BasicNtfsIndex<Index>::begin_refresh()
+{
+	if (this->_snapshot)
+	{
+		throw std::logic_error("a mapped snapshot is read-only");
+	}
+	if (WaitForSingleObject(this->_finished_event, 0) != WAIT_OBJECT_0 || this->get_finished())
+	{
+		throw std::logic_error("index has not finished loading");
+	}
+
+	// finish_refresh() patches the totals, so they must exist
+	this->ensure_sizes();
+
+	std::unique_ptr<RefreshState> refresh(new RefreshState(this->_mft_record_size));
+	refresh->reserved_clusters = this->_reserved_clusters.load(atomic_namespace::memory_order_relaxed);
+	if (this->_init_called)
+	{
+		this->init();
+	}
+	this->_refresh.swap(refresh);
+	this->_records_so_far.store(0, atomic_namespace::memory_order_release);
+	ResetEvent(this->_finished_event);
+}
+
+/// True between begin_refresh() and the end of finish_refresh().
+template <class Index>
+inline bool BasicNtfsIndex<Index>::refreshing() const volatile noexcept
+{
+	return !!const_cast<BasicNtfsIndex const*>(this)->_refresh;
+}
+
+/**
+ * @brief Compares a chunk with the last completed pass and remembers its hash.
+ *
+ * During a re-scan the hashes are only committed by finish_refresh(), so an
+ * interrupted pass does not hide changes from the next one.
+ *
+ * @param chunk_offset  Byte offset of the chunk in $MFT::$DATA, skipped clusters included
+ * @param hash          mft_chunk_hash() of the chunk as read
+ * @return true if the chunk is new or its hash differs
+ */
+template <class Index>
+inline bool BasicNtfsIndex<Index>::chunk_changed(unsigned long long const chunk_offset, unsigned long long const hash)
+{
+	bool const changed = this->_chunk_hashes.changed(chunk_offset, hash);
+	if (this->_refresh)
+	{
+		this->_refresh->hashes.push_back(std::make_pair(chunk_offset, hash));
+	}
+	else
+	{
+		this->_chunk_hashes.set(chunk_offset, hash);
+	}
+	return changed;
+}
+
+/**
+ * @brief Stages one fixed-up chunk of a re-scan; takes the arguments of load().
+ *
+ * @param changed  What chunk_changed() returned for the chunk
+ * @return true once every record of the MFT has been seen; call finish_refresh() then
+ */
+template <class Index>
+inline bool BasicNtfsIndex<Index>::refresh(unsigned long long const virtual_offset,
+	void* const buffer,
+	size_t const size,
+	unsigned long long const skipped_begin,
+	unsigned long long const skipped_end,
+	bool const changed)
+{
+	this->_refresh->records.add_chunk(virtual_offset, static_cast<unsigned char const*>(buffer), size,
+		skipped_begin, skipped_end, changed);
+
+	unsigned int const records = static_cast<unsigned int>((skipped_begin + size + skipped_end) / this->_mft_record_size);
+	return this->_records_so_far.fetch_add(records, atomic_namespace::memory_order_acq_rel) + records >= this->_mft_capacity;
+}
+
+/**
+ * @brief Re-parses the files of changed chunks and patches them into the index.
+ *
+ * @param read_record  bool(unsigned int frs, void* record): reads one raw
+ *                     record of _mft_record_size bytes; files whose record
+ *                     cannot be read are left as they were
+ * @return Number of files re-parsed or removed
+ */
+template <class Index>
+template <class ReadRecord>
+inline size_t BasicNtfsIndex<Index>::finish_refresh(ReadRecord&& read_record)
+{
+	std::unique_ptr<RefreshState> refresh;
+	refresh.swap(this->_refresh);
+	MftRefreshSet& records = refresh->records;
+	records.finish();
+
+	// Extension records of affected files that sat in unchanged chunks
+	unsigned int const mft_record_size = this->_mft_record_size;
+	std::vector<unsigned char> record(mft_record_size);
+	std::vector<unsigned int> const missing = records.missing_records();
+	for (size_t m = 0; m != missing.size(); ++m)
+	{
+		if (read_record(missing[m], &record[0]))
+		{
+			this->preload_concurrent(static_cast<unsigned long long>(missing[m]) * mft_record_size, &record[0], record.size());
+			records.provide(missing[m], &record[0]);
+		}
+	}
+
+	Patcher patcher(this);
+
+	// The root's allocation includes the reserved clusters, which may have changed
+	long long const reserved_clusters = this->_reserved_clusters.load(atomic_namespace::memory_order_relaxed);
+	if (reserved_clusters != refresh->reserved_clusters)
+	{
+		SizeInfo delta;
+		delta.allocated = static_cast<unsigned long long>(reserved_clusters > refresh->reserved_clusters
+			? reserved_clusters - refresh->reserved_clusters
+			: refresh->reserved_clusters - reserved_clusters) * this->_cluster_size;
+		patcher.propagate(kRootFRS, delta, reserved_clusters < refresh->reserved_clusters);
+	}
+
+	size_t reloaded = 0;
+	records.for_each_base([&](unsigned int const base, MftRefreshSet::Segments const& segments)
+	{
+		SizeInfo children;
+		if (patcher.existing(base))
+		{
+			children = patcher.children(base);
+			patcher.clear(base);
+		}
+
+		bool loaded = false;
+		for (size_t s = 0; s != segments.size(); ++s)
+		{
+			ntfs::FILE_RECORD_SEGMENT_HEADER const* const frsh =
+				reinterpret_cast<ntfs::FILE_RECORD_SEGMENT_HEADER const*>(segments[s].second);
+			unsigned int const frs_base = frsh->BaseFileRecordSegment
+				? static_cast<unsigned int>(frsh->BaseFileRecordSegment)
+				: segments[s].first;
+			if (frsh->MultiSectorHeader.Magic == 'ELIF' && !!(frsh->Flags & ntfs::FRH_IN_USE) && frs_base == base)
+			{
+				this->load_record(segments[s].first, frsh);
+				loaded = true;
+			}
+		}
+		this->resolve_extensions();
+
+		if (typename Records::value_type* const fr = loaded ? patcher.existing(base) : nullptr)
+		{
+			patcher.merge_wof(fr);
+			if (base == kRootFRS)
+			{
+				children.allocated += static_cast<unsigned long long>(reserved_clusters) * this->_cluster_size;
+			}
+			for (typename StreamInfos::value_type* k = this->streaminfo(fr); k; k = this->streaminfo(k->next_entry))
+			{
+				if (!k->type_name_id)
+				{
+					k->length    += children.length;
+					k->allocated += children.allocated;
+					k->bulkiness += children.bulkiness;
+					k->treesize  += children.treesize;
+					break;
+				}
+			}
+			patcher.contribute(base, false);
+		}
+		++reloaded;
+	});
+
+	for (size_t h = 0; h != refresh->hashes.size(); ++h)
+	{
+		this->_chunk_hashes.set(refresh->hashes[h].first, refresh->hashes[h].second);
+	}
+
+	this->_refreshed_files = reloaded;
+	Handle().swap(this->_volume);
+	SetEvent(this->_finished_event);
+	return reloaded;
+}
+
+/// Files re-parsed or removed by the last completed re-scan.
+template <class Index>
+inline size_t BasicNtfsIndex<Index>::refreshed_files() const noexcept
+{
+	return this->_refreshed_files;
+}
+
+#endif // UFFS_NTFS_INDEX_REFRESH_HPP
@@ -0,0 +1,250 @@
+/**
+ * @file ntfs_index_snapshot.hpp
+ * @brief Persistent, memory-mappable snapshots of a finished NtfsIndex.
+ *
+ * Building an index means reading and parsing the whole MFT, which takes
+ * tens of seconds on volumes with tens of millions of records. A snapshot
+ * stores the finished storage arrays in a UFFS-IDX file so later runs can
+ * map it read-only and search it directly:
+ *
+ * ```
+ *   save_snapshot()                      open_snapshot()
+ *   records_data ──┐                     ┌──► SnapshotView::records_data
+ *   records_lookup ┤   ┌─────────────┐   ├──► SnapshotView::records_lookup
+ *   names ─────────┼──►│  UFFS-IDX   │───┼──► SnapshotView::names
+ *   nameinfos ─────┤   │  (mmap-able)│   ├──► ...
+ *   streaminfos ───┤   └─────────────┘   │
+ *   childinfos ────┤                     │  const accessors read through
+ *   first_streams ─┤                     └  records_data_begin() & co.
+ *   timestamps ────┘
+ * ```
+ *
+ * Opening validates the header (signature, checksum, section bounds and the
+ * element sizes of this build) and nothing else: no record is read, copied
+ * or fixed up, so the cost does not depend on the volume size. The pages
+ * are faulted in by the first search and shared with every other process
+ * that maps the same file.
+ *
+ * A snapshot is a picture of the volume at the time it was saved. It is
+ * never refreshed by itself; callers decide when to rebuild it.
+ *
+ * ## Usage
+ *
+ * ```cpp
+ * index->save_snapshot("C.uffsidx");           // after finished_event()
+ *
+ * intrusive_ptr<NtfsIndex> index(new NtfsIndex(_T("C:\\")));
+ * index->open_snapshot("C.uffsidx");           // finished_event() is signaled
+ * index->matches(...);
+ * ```
+ *
+ * @note This file is included at the end of ntfs_index_impl.hpp.
+ *       Do not include this file directly.
+ *
+ * @see io/uffs_index_format.hpp for the file layout
+ */
+
+#ifndef UFFS_NTFS_INDEX_SNAPSHOT_HPP
+#define UFFS_NTFS_INDEX_SNAPSHOT_HPP
+
+#ifndef UFFS_NTFS_INDEX_IMPL_HPP
+#error "Do not include ntfs_index_snapshot.hpp directly. Include ntfs_index.hpp instead."
+#endif
+
+/// @brief Returns true if the index searches a mapped snapshot.
+template <class Index>
+inline bool BasicNtfsIndex<Index>::is_snapshot() const noexcept
+{
+	return !!this->_snapshot;
+}
+
+/**
+ * @brief Writes the finished index to a UFFS-IDX file.
+ *
+ * The file is written under "<path>.tmp" and renamed over @p path once
+ * complete, so readers never see a partial snapshot.
+ *
+ * @param path Destination file name
+ * @throws std::logic_error if the index has not finished loading successfully,
+ *         or was loaded with a LoadProfile that leaves data out
+ * @throws std::runtime_error if the file cannot be written
+ */
+template <class Index>
+inline void BasicNtfsIndex<Index>::save_snapshot(char const* const path) const
+{
+	if (WaitForSingleObject(this->_finished_event, 0) != WAIT_OBJECT_0 || this->get_finished())
+	{
+		throw std::logic_error("index has not finished loading");
+	}
+	if (this->_load_profile != kLoadEverything)
+	{
+		throw std::logic_error("a snapshot must hold the whole index (kLoadEverything)");
+	}
+
+	// A snapshot holds the totals
+	this->ensure_sizes();
+
+	UffsIndexHeader header = uffs::make_uffs_index_header();
+	if (this->_root_path.size() >= 2 && this->_root_path[1] == _T(':') && this->_root_path[0] < 0x80)
+	{
+		header.volume_letter = static_cast<char>(this->_root_path[0]);
+	}
+	header.cluster_size = this->_cluster_size;
+	header.mft_record_size = this->_mft_record_size;
+	header.mft_capacity = this->_mft_capacity;
+	header.expected_records = this->_expected_records;
+	header.records_so_far = this->records_so_far();
+	header.preprocessed_so_far = this->preprocessed_so_far();
+	header.total_names_and_streams = this->total_names_and_streams();
+	header.reserved_clusters = this->reserved_clusters();
+	header.mft_zone_start = this->_mft_zone_start;
+	header.mft_zone_end = this->_mft_zone_end;
+	header.created_time = static_cast<uint64_t>(time(nullptr));
+
+	struct { size_t count; unsigned int element_size; void const* data; } const sections[uffs::kUffsIndexSectionCount] =
+	{
+		{ this->records_data_size(), sizeof(typename Records::value_type), this->records_data_begin() },
+		{ this->records_lookup_size(), sizeof(RecordsLookup::value_type), this->records_lookup_begin() },
+		{ this->names_size(), sizeof(std::tvstring::value_type), this->names_begin() },
+		{ this->nameinfos_size(), sizeof(typename LinkInfos::value_type), this->nameinfos_begin() },
+		{ this->streaminfos_size(), sizeof(typename StreamInfos::value_type), this->streaminfos_begin() },
+		{ this->childinfos_size(), sizeof(typename ChildInfos::value_type), this->childinfos_begin() },
+		{ this->records_data_size(), sizeof(typename StreamInfos::value_type), this->first_streams_begin() },
+		{ this->timestamps_size(), sizeof(typename Timestamps::value_type), this->timestamps_begin() },
+	};
+	void const* data[uffs::kUffsIndexSectionCount];
+	for (unsigned int i = 0; i != uffs::kUffsIndexSectionCount; ++i)
+	{
+		header.sections[i].count = sections[i].count;
+		header.sections[i].element_size = sections[i].element_size;
+		data[i] = sections[i].data;
+	}
+
+	std::string const temp_path = std::string(path) + ".tmp";
+	bool written;
+	{
+		std::ofstream out(temp_path.c_str(), std::ios::binary | std::ios::trunc);
+		written = out && uffs::write_uffs_index(out, header, data);
+	}
+
+	std::error_code ec;
+	if (written)
+	{
+		std::filesystem::rename(temp_path, path, ec);
+	}
+	if (!written || ec)
+	{
+		std::filesystem::remove(temp_path, ec);
+		throw std::runtime_error(std::string("cannot write ") + path);
+	}
+}
+
+/**
+ * @brief Maps a UFFS-IDX file and makes it the storage of this index.
+ *
+ * Must be called on a freshly constructed index instead of init()/load().
+ * On success the volume geometry and counters are restored from the
+ * snapshot, the root path is taken from its volume letter (if recorded),
+ * and the finished event is signaled with result 0.
+ *
+ * @param path    Snapshot file written by save_snapshot()
+ * @param verify  Also check every section checksum. Reads the whole file.
+ * @throws std::logic_error if the index already holds data
+ * @throws std::runtime_error if the file cannot be mapped, is not a valid
+ *         snapshot, or was written by a build with different record layouts
+ */
+template <class Index>
+inline void BasicNtfsIndex<Index>::open_snapshot(char const* const path, bool const verify)
+{
+	if (this->_init_called || this->_snapshot || !this->records_data.empty())
+	{
+		throw std::logic_error("open_snapshot() needs an empty index");
+	}
+
+	std::unique_ptr<SnapshotView> view(new SnapshotView());
+	MappedFile(path, MappedFile::ReadOnly).swap(view->file);
+	unsigned char const* const base = view->file.data();
+
+	UffsIndexHeader header;
+	if (view->file.size() < sizeof(header))
+	{
+		throw std::runtime_error("not a UFFS-IDX file (too small)");
+	}
+	memcpy(&header, base, sizeof(header));
+	if (char const* const error = uffs::validate_uffs_index_header(header, view->file.size()))
+	{
+		throw std::runtime_error(error);
+	}
+
+	static unsigned int const element_sizes[uffs::kUffsIndexSectionCount] =
+	{
+		sizeof(typename Records::value_type),
+		sizeof(RecordsLookup::value_type),
+		sizeof(std::tvstring::value_type),
+		sizeof(typename LinkInfos::value_type),
+		sizeof(typename StreamInfos::value_type),
+		sizeof(typename ChildInfos::value_type),
+		sizeof(typename StreamInfos::value_type),
+		sizeof(typename Timestamps::value_type),
+	};
+	for (unsigned int i = 0; i != uffs::kUffsIndexSectionCount; ++i)
+	{
+		if (header.sections[i].element_size != element_sizes[i])
+		{
+			throw std::runtime_error("snapshot was written by an incompatible build");
+		}
+	}
+
+	// The record columns have an entry per record slot
+	if (header.sections[uffs::kUffsIndexFirstStreams].count != header.sections[uffs::kUffsIndexRecords].count ||
+		header.sections[uffs::kUffsIndexTimestamps].count != header.sections[uffs::kUffsIndexRecords].count)
+	{
+		throw std::runtime_error("snapshot record columns do not match its records");
+	}
+
+	if (verify)
+	{
+		if (char const* const error = uffs::verify_uffs_index_sections(base, header))
+		{
+			throw std::runtime_error(error);
+		}
+	}
+
+	uffs::UffsIndexSectionEntry const* const sections = header.sections;
+	view->records_data = reinterpret_cast<typename Records::value_type const*>(base + sections[uffs::kUffsIndexRecords].offset);
+	view->records_data_size = static_cast<size_t>(sections[uffs::kUffsIndexRecords].count);
+	view->first_streams = reinterpret_cast<typename StreamInfos::value_type const*>(base + sections[uffs::kUffsIndexFirstStreams].offset);
+	view->timestamps = reinterpret_cast<typename Timestamps::value_type const*>(base + sections[uffs::kUffsIndexTimestamps].offset);
+	view->timestamps_size = static_cast<size_t>(sections[uffs::kUffsIndexTimestamps].count);
+	view->records_lookup = reinterpret_cast<RecordsLookup::value_type const*>(base + sections[uffs::kUffsIndexRecordsLookup].offset);
+	view->records_lookup_size = static_cast<size_t>(sections[uffs::kUffsIndexRecordsLookup].count);
+	view->names = reinterpret_cast<std::tvstring::value_type const*>(base + sections[uffs::kUffsIndexNames].offset);
+	view->names_size = static_cast<size_t>(sections[uffs::kUffsIndexNames].count);
+	view->nameinfos = reinterpret_cast<typename LinkInfos::value_type const*>(base + sections[uffs::kUffsIndexNameInfos].offset);
+	view->nameinfos_size = static_cast<size_t>(sections[uffs::kUffsIndexNameInfos].count);
+	view->streaminfos = reinterpret_cast<typename StreamInfos::value_type const*>(base + sections[uffs::kUffsIndexStreamInfos].offset);
+	view->streaminfos_size = static_cast<size_t>(sections[uffs::kUffsIndexStreamInfos].count);
+	view->childinfos = reinterpret_cast<typename ChildInfos::value_type const*>(base + sections[uffs::kUffsIndexChildInfos].offset);
+	view->childinfos_size = static_cast<size_t>(sections[uffs::kUffsIndexChildInfos].count);
+
+	if (header.volume_letter)
+	{
+		TCHAR const root[] = { static_cast<TCHAR>(header.volume_letter), _T(':'), _T('\\'), _T('\0') };
+		this->_root_path = root;
+	}
+	this->_cluster_size = header.cluster_size;
+	this->_mft_record_size = header.mft_record_size;
+	this->_mft_capacity = header.mft_capacity;
+	this->_expected_records = header.expected_records;
+	this->_mft_zone_start = header.mft_zone_start;
+	this->_mft_zone_end = header.mft_zone_end;
+	this->set_reserved_clusters(header.reserved_clusters);
+	this->_records_so_far.store(static_cast<unsigned int>(header.records_so_far), atomic_namespace::memory_order_relaxed);
+	this->_preprocessed_so_far.store(static_cast<unsigned int>(header.preprocessed_so_far), atomic_namespace::memory_order_relaxed);
+	this->_total_names_and_streams.store(static_cast<size_t>(header.total_names_and_streams), atomic_namespace::memory_order_relaxed);
+
+	this->_snapshot.reset(view.release());
+	this->set_finished(0);
+}
+
+#endif // UFFS_NTFS_INDEX_SNAPSHOT_HPP
@@ -0,0 +1,277 @@
+/**
+ * @file ntfs_index_usn.hpp
+ * @brief Incremental refresh of a finished NtfsIndex from USN journal events.
+ *
+ * Rebuilding an index re-reads the whole MFT. Between two rebuilds the USN
+ * change journal lists exactly what changed, so the index can be patched in
+ * place instead:
+ *
+ * ```
+ *   $J ──► read_usn_events() ──► UsnEvent[] ──► apply_usn_events()
+ *                                                 │
+ *                  ┌──────────────────────────────┼─────────────────────┐
+ *                  ▼                              ▼                     ▼
+ *          LinkInfo name/parent          ChildInfo chains        $I30 SizeInfo of
+ *          (names appended)              (unlink / relink)       every ancestor
+ * ```
+ *
+ * ## Aggregates
+ *
+ * Each event is applied as "withdraw the record's old share from every
+ * ancestor, change it, add its new share back" through NtfsIndex::Patcher
+ * (ntfs_index_patch.hpp), so directory totals stay what a rebuild would
+ * produce, except for bulkiness.
+ *
+ * ## Storage
+ *
+ * The storage arrays are append-only: renamed names and removed links leave
+ * their old entries unreferenced, and deleted records keep their slot with
+ * no names. A long replay therefore grows the index until the next rebuild.
+ *
+ * @note This file is included at the end of ntfs_index_impl.hpp.
+ *       Do not include this file directly.
+ *
+ * @see io/usn_journal.hpp for the journal parser and event model
+ * @see ntfs_index_patch.hpp for the edits that keep directory totals exact
+ */
+
+#ifndef UFFS_NTFS_INDEX_USN_HPP
+#define UFFS_NTFS_INDEX_USN_HPP
+
+#ifndef UFFS_NTFS_INDEX_IMPL_HPP
+#error "Do not include ntfs_index_usn.hpp directly. Include ntfs_index.hpp instead."
+#endif
+
+/**
+ * @brief Applies journal events to a finished index.
+ *
+ * Events must be in journal order. Events that cannot be applied (unknown
+ * records, renames of names the index never had, size changes without
+ * sizes) are skipped; replaying events that are already reflected in the
+ * index is harmless.
+ *
+ * Like load(), this mutates the index: call it through lock(index) when
+ * other threads may be searching.
+ *
+ * @param events Events from UsnEventBuilder / read_usn_events()
+ * @param count  Number of events
+ * @return Number of events applied
+ * @throws std::logic_error if the index is a snapshot or has not finished loading
+ */
+template <class Index>
+inline size_t BasicNtfsIndex<Index>::apply_usn_events(UsnEvent const* const events, size_t const count)
+{
+	static_assert(sizeof(TCHAR) == sizeof(char16_t), "USN journal names are UTF-16");
+
+	if (this->_snapshot)
+	{
+		throw std::logic_error("a mapped snapshot is read-only");
+	}
+	if (WaitForSingleObject(this->_finished_event, 0) != WAIT_OBJECT_0 || this->get_finished())
+	{
+		throw std::logic_error("index has not finished loading");
+	}
+
+	// The Patcher keeps the totals up to date, so they must exist
+	this->ensure_sizes();
+
+	struct Replayer : Patcher
+	{
+		using Patcher::Patcher;
+
+		bool create(UsnEvent const& e)
+		{
+			if (typename Records::value_type* const fr = this->live(e.frs))
+			{
+				if (this->find_link(fr, e.parent, e.name) >= 0)
+				{
+					fr->attributes = e.attributes & StandardInfo::kKeptAttributes;
+					return true;  // already indexed
+				}
+				this->remove(e.frs);  // record was reused; the delete was missed
+			}
+
+			typename Records::value_type* const fr = &*this->me->at(e.frs);
+			this->me->clear_record(fr);
+			if (RecordTimes* const times = this->me->record_times(fr))
+			{
+				times->created = e.timestamp;
+				times->written = e.timestamp;
+				times->accessed = e.timestamp;
+			}
+			fr->attributes = e.attributes & StandardInfo::kKeptAttributes;
+
+			this->set_name(fr->first_name.name, e.name);
+			fr->first_name.parent = e.parent;
+			fr->name_count = 1;
+
+			StreamInfo* const info = this->me->first_stream(fr);
+			info->name.length = 0;
+			if (e.is_directory())
+			{
+				info->type_name_id = 0;
+				info->name.offset(0);
+				info->treesize = 1;
+			}
+			else
+			{
+				info->type_name_id = static_cast<unsigned char>(
+					static_cast<int>(ntfs::AttributeTypeCode::AttributeData) >> (CHAR_BIT / 2));
+				info->name.offset(static_cast<Index>(this->me->names_size()));
+				info->name.ascii(true);
+				if (e.has_size)
+				{
+					info->length = e.length;
+					info->allocated = e.allocated;
+					info->bulkiness = e.allocated;
+				}
+			}
+			fr->stream_count = 1;
+			this->me->_total_names_and_streams.fetch_add(1, atomic_namespace::memory_order_acq_rel);
+
+			this->attach(e.frs);
+			return true;
+		}
+
+		bool rename(UsnEvent const& e)
+		{
+			typename Records::value_type* const fr = this->live(e.frs);
+			if (!fr)
+			{
+				return this->create(e);
+			}
+			if (this->find_link(fr, e.parent, e.name) >= 0)
+			{
+				return true;  // already applied
+			}
+
+			ptrdiff_t const position = ~e.old_parent
+				? this->find_link(fr, e.old_parent, e.old_name)
+				: (fr->name_count == 1 ? 0 : -1);
+			if (position < 0)
+			{
+				return false;  // the old name is not in the index
+			}
+
+			this->detach(e.frs);
+			typename LinkInfos::value_type* const j = this->link_at(this->existing(e.frs), position);
+			this->set_name(j->name, e.name);
+			j->parent = e.parent;
+			this->attach(e.frs);
+			return true;
+		}
+
+		bool link(UsnEvent const& e)
+		{
+			typename Records::value_type* fr = this->live(e.frs);
+			if (!fr)
+			{
+				return false;
+			}
+			ptrdiff_t const position = this->find_link(fr, e.parent, e.name);
+			if (position >= 0 && fr->name_count == 1)
+			{
+				return true;  // last name goes with FILE_DELETE, not here
+			}
+
+			this->detach(e.frs);
+			fr = this->existing(e.frs);
+			if (position < 0)
+			{
+				// New hard link: becomes the first name, as in load()
+				size_t const link_index = this->me->nameinfos.size();
+				this->me->nameinfos.push_back(fr->first_name);
+				fr->first_name.next_entry = static_cast<typename LinkInfos::value_type::next_entry_type>(link_index);
+				this->set_name(fr->first_name.name, e.name);
+				fr->first_name.parent = e.parent;
+				++fr->name_count;
+				this->me->_total_names_and_streams.fetch_add(fr->stream_count, atomic_namespace::memory_order_acq_rel);
+			}
+			else
+			{
+				// Removed hard link: unlink it from the chain
+				if (position == 0)
+				{
+					fr->first_name = *this->me->nameinfo(fr->first_name.next_entry);
+				}
+				else
+				{
+					typename LinkInfos::value_type* const previous = this->link_at(fr, position - 1);
+					previous->next_entry = this->me->nameinfo(previous->next_entry)->next_entry;
+				}
+				--fr->name_count;
+				this->me->_total_names_and_streams.fetch_sub(fr->stream_count, atomic_namespace::memory_order_acq_rel);
+			}
+			this->attach(e.frs);
+			return true;
+		}
+
+		bool resize(UsnEvent const& e)
+		{
+			typename Records::value_type* const fr = e.has_size ? this->live(e.frs) : nullptr;
+			typename StreamInfos::value_type* k = fr ? this->me->streaminfo(fr) : nullptr;
+			for (; k; k = this->me->streaminfo(k->next_entry))
+			{
+				if ((k->type_name_id << (CHAR_BIT / 2)) == static_cast<int>(ntfs::AttributeTypeCode::AttributeData) &&
+					!k->name.length)
+				{
+					break;
+				}
+			}
+			if (!k)
+			{
+				return false;
+			}
+
+			this->contribute(e.frs, true);
+			k->length = e.length;
+			k->allocated = e.allocated;
+			k->bulkiness = e.allocated;
+			if (RecordTimes* const times = this->me->record_times(fr))
+			{
+				times->written = e.timestamp;
+			}
+			this->contribute(e.frs, false);
+			return true;
+		}
+
+		bool apply(UsnEvent const& e)
+		{
+			switch (e.type)
+			{
+			case UsnEventType::Create:
+				return this->create(e);
+			case UsnEventType::Delete:
+				if (!this->live(e.frs))
+				{
+					return false;
+				}
+				this->remove(e.frs);
+				return true;
+			case UsnEventType::Rename:
+				return this->rename(e);
+			case UsnEventType::Link:
+				return this->link(e);
+			case UsnEventType::SizeChange:
+				return this->resize(e);
+			case UsnEventType::AttributeChange:
+				if (typename Records::value_type* const fr = this->live(e.frs))
+				{
+					fr->attributes = e.attributes & StandardInfo::kKeptAttributes;
+					return true;
+				}
+				return false;
+			}
+			return false;
+		}
+	} replayer(this);
+
+	size_t applied = 0;
+	for (size_t i = 0; i != count; ++i)
+	{
+		applied += replayer.apply(events[i]) ? 1 : 0;
+	}
+	return applied;
+}
+
+#endif // UFFS_NTFS_INDEX_USN_HPP
@@ -0,0 +1,362 @@
+/**
+ * @file lz4_block.hpp
+ * @brief Self-contained LZ4 block format encoder and decoder.
+ *
+ * Implements the LZ4 *block* format (no frame header, no checksums) so
+ * compressed UFFS-MFT frames can be produced and consumed without an
+ * external dependency. Output is byte-compatible with the reference
+ * implementation: blocks written here decode with LZ4_decompress_safe()
+ * and vice versa.
+ *
+ * ## Block Format
+ *
+ * A block is a series of sequences:
+ *
+ * ```
+ * ┌───────┬──────────────┬──────────┬────────┬────────────────┐
+ * │ token │ literal len+ │ literals │ offset │ match len+     │
+ * │ 4b|4b │ (0..n bytes) │          │ 2B LE  │ (0..n bytes)   │
+ * └───────┴──────────────┴──────────┴────────┴────────────────┘
+ * ```
+ *
+ * The high nibble of the token is the literal count and the low nibble is
+ * the match length minus 4; a nibble of 15 continues in extra bytes that
+ * are summed until one is not 255. The last sequence carries literals only.
+ *
+ * The encoder is a greedy single-probe hash matcher, the same strategy as
+ * LZ4's default "fast" level. MFT data is dominated by zero-filled unused
+ * records and repeated attribute headers, which this handles well.
+ *
+ * @note No Windows dependencies, so this header can be unit-tested.
+ *
+ * @see uffs_mft_codec.hpp for how frames use it
+ */
+
+#ifndef UFFS_LZ4_BLOCK_HPP
+#define UFFS_LZ4_BLOCK_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace uffs {
+namespace lz4 {
+
+// ============================================================================
+// Format Constants
+// ============================================================================
+
+static constexpr size_t kMinMatch = 4;          ///< Shortest encodable match
+static constexpr size_t kLastLiterals = 5;      ///< Block must end with >= 5 literals
+static constexpr size_t kMatchFindLimit = 12;   ///< No match may start in the last 12 bytes
+static constexpr size_t kMaxOffset = 65535;     ///< 16-bit back-reference window
+static constexpr unsigned int kHashLog = 16;    ///< 64K-entry match table
+static constexpr unsigned int kSkipTrigger = 6; ///< Misses before the scan step grows
+
+/// Worst-case encoded size for @p size input bytes (incompressible data).
+[[nodiscard]] constexpr size_t compress_bound(size_t size) noexcept
+{
+    return size + size / 255 + 16;
+}
+
+namespace detail {
+
+[[nodiscard]] inline uint32_t read32(unsigned char const* p) noexcept
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+[[nodiscard]] inline uint64_t read64(unsigned char const* p) noexcept
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+[[nodiscard]] inline uint32_t hash4(uint32_t v, unsigned int hash_log = kHashLog) noexcept
+{
+    return (v * 2654435761U) >> (32 - hash_log);
+}
+
+/// Length of the common prefix of @p a and @p b, not reading past @p a_limit.
+[[nodiscard]] inline size_t common_length(unsigned char const* a, unsigned char const* b,
+    unsigned char const* a_limit) noexcept
+{
+    unsigned char const* const start = a;
+    while (a + sizeof(uint64_t) <= a_limit)
+    {
+        uint64_t const diff = read64(a) ^ read64(b);
+        if (diff)
+        {
+            // Find the first differing byte (memory order)
+            while (*a == *b)
+            {
+                ++a;
+                ++b;
+            }
+            return static_cast<size_t>(a - start);
+        }
+        a += sizeof(uint64_t);
+        b += sizeof(uint64_t);
+    }
+    while (a < a_limit && *a == *b)
+    {
+        ++a;
+        ++b;
+    }
+    return static_cast<size_t>(a - start);
+}
+
+/// Writes the 255-run continuation bytes for a length nibble of 15.
+inline unsigned char* write_length(unsigned char* op, size_t remainder) noexcept
+{
+    for (; remainder >= 255; remainder -= 255)
+    {
+        *op++ = 255;
+    }
+    *op++ = static_cast<unsigned char>(remainder);
+    return op;
+}
+
+} // namespace detail
+
+/**
+ * @brief Compresses @p size bytes into LZ4 block format.
+ *
+ * @param src       Input bytes
+ * @param size      Number of input bytes
+ * @param dst       Output buffer
+ * @param capacity  Size of @p dst; compress_bound(size) always suffices
+ * @param hash_log  Log2 of the match table entries; the table is cleared on
+ *                  every call, so callers compressing many small blocks pass
+ *                  about log2 of the block size instead of kHashLog
+ * @return Number of bytes written, or 0 if @p capacity was too small
+ */
+[[nodiscard]] inline size_t compress(unsigned char const* src, size_t size,
+    unsigned char* dst, size_t capacity, unsigned int hash_log = kHashLog)
+{
+    unsigned char const* const iend = src + size;
+    unsigned char const* anchor = src;
+    unsigned char* op = dst;
+    unsigned char* const oend = dst + capacity;
+
+    if (size > kMatchFindLimit)
+    {
+        unsigned char const* const mflimit = iend - kMatchFindLimit;
+        unsigned char const* const matchlimit = iend - kLastLiterals;
+        std::vector<uint32_t> table(size_t(1) << hash_log, 0);
+
+        unsigned char const* ip = src + 1;
+        unsigned int misses = 1U << kSkipTrigger;
+        while (ip < mflimit)
+        {
+            uint32_t const sequence = detail::read32(ip);
+            uint32_t const h = detail::hash4(sequence, hash_log);
+            unsigned char const* ref = src + table[h];
+            table[h] = static_cast<uint32_t>(ip - src);
+
+            if (ref >= ip || static_cast<size_t>(ip - ref) > kMaxOffset || detail::read32(ref) != sequence)
+            {
+                // Skip faster through data that does not compress
+                ip += misses++ >> kSkipTrigger;
+                continue;
+            }
+            misses = 1U << kSkipTrigger;
+
+            // Extend the match backwards over pending literals
+            while (ip > anchor && ref > src && ip[-1] == ref[-1])
+            {
+                --ip;
+                --ref;
+            }
+
+            size_t const literals = static_cast<size_t>(ip - anchor);
+            size_t const match = kMinMatch + detail::common_length(ip + kMinMatch, ref + kMinMatch, matchlimit);
+
+            // token + literal run + literals + offset + match run
+            if (static_cast<size_t>(oend - op) < 1 + literals / 255 + 1 + literals + 2 + match / 255 + 1)
+            {
+                return 0;
+            }
+
+            unsigned char* const token = op++;
+            if (literals >= 15)
+            {
+                *token = 15 << 4;
+                op = detail::write_length(op, literals - 15);
+            }
+            else
+            {
+                *token = static_cast<unsigned char>(literals << 4);
+            }
+            memcpy(op, anchor, literals);
+            op += literals;
+
+            size_t const offset = static_cast<size_t>(ip - ref);
+            *op++ = static_cast<unsigned char>(offset);
+            *op++ = static_cast<unsigned char>(offset >> 8);
+
+            size_t const match_code = match - kMinMatch;
+            if (match_code >= 15)
+            {
+                *token |= 15;
+                op = detail::write_length(op, match_code - 15);
+            }
+            else
+            {
+                *token |= static_cast<unsigned char>(match_code);
+            }
+
+            ip += match;
+            anchor = ip;
+
+            // Seed the table inside the match so the next search has a candidate
+            if (ip < mflimit)
+            {
+                table[detail::hash4(detail::read32(ip - 2), hash_log)] = static_cast<uint32_t>(ip - 2 - src);
+            }
+        }
+    }
+
+    // Final sequence: literals only
+    size_t const literals = static_cast<size_t>(iend - anchor);
+    if (static_cast<size_t>(oend - op) < 1 + literals / 255 + 1 + literals)
+    {
+        return 0;
+    }
+    if (literals >= 15)
+    {
+        *op++ = 15 << 4;
+        op = detail::write_length(op, literals - 15);
+    }
+    else
+    {
+        *op++ = static_cast<unsigned char>(literals << 4);
+    }
+    if (literals)
+    {
+        memcpy(op, anchor, literals);  // an empty input has null pointers
+        op += literals;
+    }
+
+    return static_cast<size_t>(op - dst);
+}
+
+/**
+ * @brief Decompresses an LZ4 block whose decoded size is known exactly.
+ *
+ * Every read and write is bounds-checked, so malformed or truncated input
+ * is rejected rather than overrunning either buffer.
+ *
+ * @param src   Compressed block
+ * @param size  Size of the compressed block in bytes
+ * @param dst   Output buffer
+ * @param dst_size  Exact decoded size expected
+ * @return true if the block decoded to exactly @p dst_size bytes
+ */
+[[nodiscard]] inline bool decompress(unsigned char const* src, size_t size,
+    unsigned char* dst, size_t dst_size)
+{
+    unsigned char const* ip = src;
+    unsigned char const* const iend = src + size;
+    unsigned char* op = dst;
+    unsigned char* const oend = dst + dst_size;
+
+    for (;;)
+    {
+        if (ip >= iend)
+        {
+            return false;
+        }
+        unsigned int const token = *ip++;
+
+        // Literal run
+        size_t literals = token >> 4;
+        if (literals == 15)
+        {
+            unsigned char b;
+            do
+            {
+                if (ip >= iend)
+                {
+                    return false;
+                }
+                b = *ip++;
+                literals += b;
+            } while (b == 255);
+        }
+        if (literals > static_cast<size_t>(iend - ip) || literals > static_cast<size_t>(oend - op))
+        {
+            return false;
+        }
+        if (literals)
+        {
+            memcpy(op, ip, literals);
+            ip += literals;
+            op += literals;
+        }
+
+        if (ip == iend)
+        {
+            return op == oend;  // last sequence has no match part
+        }
+
+        // Match
+        if (iend - ip < 2)
+        {
+            return false;
+        }
+        size_t const offset = static_cast<size_t>(ip[0]) | (static_cast<size_t>(ip[1]) << 8);
+        ip += 2;
+        if (offset == 0 || offset > static_cast<size_t>(op - dst))
+        {
+            return false;
+        }
+
+        size_t match = token & 15;
+        if (match == 15)
+        {
+            unsigned char b;
+            do
+            {
+                if (ip >= iend)
+                {
+                    return false;
+                }
+                b = *ip++;
+                match += b;
+            } while (b == 255);
+        }
+        match += kMinMatch;
+        if (match > static_cast<size_t>(oend - op))
+        {
+            return false;
+        }
+
+        unsigned char const* const ref = op - offset;
+        if (offset >= match)
+        {
+            memcpy(op, ref, match);
+        }
+        else
+        {
+            // Overlapping copy (repeating pattern): the source grows in
+            // multiples of the period, so each memcpy is non-overlapping
+            for (size_t copied = 0; copied < match;)
+            {
+                size_t const chunk = (match - copied < offset + copied) ? match - copied : offset + copied;
+                memcpy(op + copied, ref, chunk);
+                copied += chunk;
+            }
+        }
+        op += match;
+    }
+}
+
+} // namespace lz4
+} // namespace uffs
+
+#endif // UFFS_LZ4_BLOCK_HPP
@@ -0,0 +1,250 @@
+/**
+ * @file mft_chunk_reader.hpp
+ * @brief Overlapped reads of a chunk plan, delivered in plan order.
+ *
+ * Keeps several chunk reads outstanding on an overlapped volume handle and
+ * hands the completed buffers to one consumer thread in $MFT order. The
+ * live reader parses chunks in whatever order the IOCP completes them;
+ * writers of a dump cannot, so each read gets its own event and the
+ * consumer waits for the oldest one while the rest stay in flight.
+ *
+ * ```
+ *   slot 0   [ read chunk 0 ]──► next() ──► consumer ──┐
+ *   slot 1   [ read chunk 1 ]                          │ reissued with
+ *   ...                                                │ chunk 0 + depth
+ *   slot N-1 [ read chunk N-1 ]◄───────────────────────┘
+ * ```
+ *
+ * Chunks with skip ranges only read their unskipped clusters; a chunk with
+ * nothing in use is delivered with a size of 0 and no I/O.
+ *
+ * ## Usage
+ *
+ * ```cpp
+ * MftChunkReader reader(volume, cluster_size, chunks);
+ * MftChunkReader::Completed done;
+ * while (reader.next(done))
+ * {
+ *     consume(*done.chunk, done.data, done.size);
+ * }
+ * ```
+ *
+ * @note The volume must be opened with FILE_FLAG_OVERLAPPED, and
+ *       FILE_FLAG_NO_BUFFERING is supported (buffers are page-aligned).
+ *       next() must always be called from the same thread.
+ *
+ * @see mft_read_plan.hpp for building the chunk plan
+ */
+
+#ifndef UFFS_MFT_CHUNK_READER_HPP
+#define UFFS_MFT_CHUNK_READER_HPP
+
+#include "mft_read_plan.hpp"
+#include "mft_reader_constants.hpp"
+
+#include "util/error_utils.hpp"
+#include "util/handle.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <vector>
+
+namespace uffs {
+
+/**
+ * @class MftChunkReader
+ * @brief Reads MftReadChunks with a fixed number of overlapped reads in flight.
+ */
+class MftChunkReader
+{
+public:
+    /// A dump has no parsing step to pace it, so it keeps more reads queued than the indexer.
+    static constexpr size_t kDefaultReadsInFlight = 4 * mft_reader_constants::kIoConcurrencyLevel;
+
+    /// A chunk whose read has completed.
+    struct Completed
+    {
+        MftReadChunk const* chunk;     ///< Entry of the plan
+        unsigned char const* data;     ///< Unskipped clusters; valid until the next call to next()
+        size_t size;                   ///< read_clusters() * cluster size
+    };
+
+    /**
+     * @brief Starts the first reads.
+     *
+     * @param volume           Overlapped volume handle
+     * @param cluster_size     Bytes per cluster
+     * @param chunks           Plan to read; must outlive the reader
+     * @param reads_in_flight  Reads kept outstanding
+     * @throws CStructured_Exception if a read cannot be issued
+     */
+    MftChunkReader(HANDLE volume, unsigned int cluster_size, std::vector<MftReadChunk> const& chunks,
+        size_t reads_in_flight = kDefaultReadsInFlight)
+        : volume_(volume)
+        , cluster_size_(cluster_size)
+        , chunks_(chunks)
+        , slots_(std::max<size_t>(1, std::min(reads_in_flight, chunks.size())))
+        , next_(0)
+        , bytes_read_(0)
+    {
+        size_t buffer_size = 0;
+        for (MftReadChunk const& chunk : chunks_)
+        {
+            buffer_size = std::max(buffer_size, static_cast<size_t>(chunk.read_clusters() * cluster_size_));
+        }
+
+        try
+        {
+            for (Slot& slot : slots_)
+            {
+                Handle(CreateEvent(nullptr, TRUE, FALSE, nullptr)).swap(slot.event);
+                if (buffer_size)
+                {
+                    slot.buffer = static_cast<unsigned char*>(
+                        VirtualAlloc(nullptr, buffer_size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+                    CheckAndThrow(!!slot.buffer);
+                }
+            }
+
+            for (size_t c = 0; c < slots_.size() && c < chunks_.size(); ++c)
+            {
+                this->issue(c);
+            }
+        }
+        catch (...)
+        {
+            this->release();
+            throw;
+        }
+    }
+
+    MftChunkReader(MftChunkReader const&) = delete;
+    MftChunkReader& operator=(MftChunkReader const&) = delete;
+
+    ~MftChunkReader()
+    {
+        this->release();
+    }
+
+    /**
+     * @brief Waits for the next chunk in plan order.
+     *
+     * Also reissues the slot of the previously returned chunk, so the
+     * previous Completed::data must no longer be in use.
+     *
+     * @param done  Receives the chunk on success
+     * @return false once every chunk has been delivered
+     * @throws CStructured_Exception if a read fails or comes back short
+     */
+    bool next(Completed& done)
+    {
+        if (next_ && next_ - 1 + slots_.size() < chunks_.size())
+        {
+            this->issue(next_ - 1 + slots_.size());
+        }
+        if (next_ == chunks_.size())
+        {
+            return false;
+        }
+
+        Slot& slot = slots_[next_ % slots_.size()];
+        if (slot.pending)
+        {
+            unsigned long transferred = 0;
+            BOOL const ok = GetOverlappedResult(volume_, &slot.overlapped, &transferred, TRUE);
+            slot.pending = false;
+            CheckAndThrow(ok);
+            if (transferred != slot.size)
+            {
+                CppRaiseException(ERROR_HANDLE_EOF);
+            }
+            bytes_read_ += transferred;
+        }
+
+        done.chunk = &chunks_[next_];
+        done.data = slot.buffer;
+        done.size = slot.size;
+        ++next_;
+        return true;
+    }
+
+    /// Bytes read from the volume so far.
+    [[nodiscard]] unsigned long long bytes_read() const noexcept { return bytes_read_; }
+
+private:
+    struct Slot
+    {
+        OVERLAPPED overlapped = {};
+        Handle event;
+        unsigned char* buffer = nullptr;
+        size_t size = 0;
+        bool pending = false;
+    };
+
+    HANDLE volume_;
+    unsigned int cluster_size_;
+    std::vector<MftReadChunk> const& chunks_;
+    std::vector<Slot> slots_;
+    size_t next_;
+    unsigned long long bytes_read_;
+
+    /// Cancels and drains outstanding reads before their buffers are released.
+    void release() noexcept
+    {
+        bool any_pending = false;
+        for (Slot const& slot : slots_)
+        {
+            any_pending |= slot.pending;
+        }
+        if (any_pending)
+        {
+            CancelIo(volume_);
+        }
+
+        for (Slot& slot : slots_)
+        {
+            if (slot.pending)
+            {
+                unsigned long transferred;
+                (void)GetOverlappedResult(volume_, &slot.overlapped, &transferred, TRUE);
+                slot.pending = false;
+            }
+            if (slot.buffer)
+            {
+                VirtualFree(slot.buffer, 0, MEM_RELEASE);
+                slot.buffer = nullptr;
+            }
+        }
+    }
+
+    void issue(size_t c)
+    {
+        MftReadChunk const& chunk = chunks_[c];
+        Slot& slot = slots_[c % slots_.size()];
+        slot.size = static_cast<size_t>(chunk.read_clusters() * cluster_size_);
+        if (!slot.size)
+        {
+            return;
+        }
+
+        long long const offset = (chunk.lcn + static_cast<long long>(chunk.skip_begin)) * static_cast<long long>(cluster_size_);
+        memset(&slot.overlapped, 0, sizeof(slot.overlapped));
+        slot.overlapped.Offset = static_cast<unsigned long>(offset);
+        slot.overlapped.OffsetHigh = static_cast<unsigned long>(offset >> (CHAR_BIT * sizeof(slot.overlapped.Offset)));
+        slot.overlapped.hEvent = slot.event.value;
+
+        if (!ReadFile(volume_, slot.buffer, static_cast<unsigned long>(slot.size), nullptr, &slot.overlapped))
+        {
+            CheckAndThrow(GetLastError() == ERROR_IO_PENDING);
+        }
+        slot.pending = true;
+    }
+};
+
+} // namespace uffs
+
+// Expose at global scope for backward compatibility
+using uffs::MftChunkReader;
+
+#endif // UFFS_MFT_CHUNK_READER_HPP
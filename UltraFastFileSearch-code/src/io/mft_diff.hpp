@@ -0,0 +1,658 @@
+/**
+ * @file mft_diff.hpp
+ * @brief Record-level diff of two UFFS-MFT dumps of the same volume.
+ *
+ * Compares two dumps record by record instead of indexing both and diffing
+ * path lists. Each FRS is looked at once, in parallel slices:
+ *
+ * ```
+ *   before slice ─┐
+ *                 ├─► in use in either? ──no──► skip (free in both)
+ *   after slice ──┘          │yes
+ *                            ▼
+ *                  bytes equal (SSE2)? ──yes──► skip (unchanged)
+ *                            │no
+ *                            ▼
+ *                  decode both copies ──► added / removed / renamed /
+ *                                          moved / resized / retimed
+ * ```
+ *
+ * Dumps do not carry $MFT::$BITMAP, so "in use" is the FILE_RECORD_IN_USE
+ * flag of each record header, which is what the bitmap mirrors. Only
+ * records whose bytes differ are fixed up and decoded, so a nightly diff of
+ * a mostly unchanged volume costs little more than reading both files.
+ *
+ * ## Extension Records
+ *
+ * Attributes that do not fit into a base record live in extension records.
+ * An extension record that changed but still belongs to the same base is
+ * reported under its base FRS; extension records that come and go as
+ * attribute lists grow and shrink are not reported by themselves.
+ *
+ * @note No Windows dependencies, so this header can be unit-tested.
+ *
+ * @see uffs_mft_format.hpp for the dump layout
+ */
+
+#ifndef UFFS_MFT_DIFF_HPP
+#define UFFS_MFT_DIFF_HPP
+
+#include "mft_reader_constants.hpp"
+#include "uffs_mft_codec.hpp"
+#include "uffs_mft_format.hpp"
+
+#include "util/mapped_file.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define UFFS_MFT_DIFF_SSE2 1
+#endif
+
+namespace uffs {
+
+// ============================================================================
+// Change Kinds
+// ============================================================================
+
+/// Bits of MftDiffEntry::changes.
+enum MftChange : uint32_t
+{
+    kMftChangeAdded   = 0x01,  ///< File record in use only after (with Removed: record reused)
+    kMftChangeRemoved = 0x02,  ///< File record in use only before
+    kMftChangeRenamed = 0x04,  ///< A hard link name changed
+    kMftChangeMoved   = 0x08,  ///< A hard link parent directory changed
+    kMftChangeResized = 0x10,  ///< Unnamed $DATA size changed
+    kMftChangeRetimed = 0x20,  ///< Created, modified or accessed time changed
+};
+
+/// Mask of the low 48 bits of a file reference (the FRS).
+static constexpr uint64_t kMftFrsMask = 0x0000FFFFFFFFFFFFULL;
+
+// ============================================================================
+// Record Summary
+// ============================================================================
+
+/// One Win32 or POSIX $FILE_NAME of a record.
+struct MftRecordLink
+{
+    uint64_t parent;        ///< Parent directory FRS
+    std::u16string name;
+
+    bool operator==(MftRecordLink const& other) const { return parent == other.parent && name == other.name; }
+    bool operator<(MftRecordLink const& other) const
+    {
+        return parent != other.parent ? parent < other.parent : name < other.name;
+    }
+};
+
+/// The parts of a FILE record the diff compares.
+struct MftRecordSummary
+{
+    bool in_use = false;            ///< In use and undamaged
+    bool directory = false;
+    uint16_t sequence = 0;
+    uint64_t base = 0;              ///< Base record FRS, 0 for base records
+    uint32_t attributes = 0;        ///< $STANDARD_INFORMATION file attributes
+    bool has_times = false;
+    int64_t created = 0;            ///< FILETIMEs from $STANDARD_INFORMATION
+    int64_t modified = 0;
+    int64_t accessed = 0;
+    bool has_size = false;          ///< Unnamed $DATA (first piece) seen
+    uint64_t size = 0;
+    uint64_t allocated = 0;
+    std::vector<MftRecordLink> links;   ///< DOS-only names excluded, sorted
+};
+
+namespace mft_diff_detail {
+
+inline uint16_t get16(unsigned char const* p) noexcept { uint16_t v; memcpy(&v, p, sizeof(v)); return v; }
+inline uint32_t get32(unsigned char const* p) noexcept { uint32_t v; memcpy(&v, p, sizeof(v)); return v; }
+inline uint64_t get64(unsigned char const* p) noexcept { uint64_t v; memcpy(&v, p, sizeof(v)); return v; }
+
+} // namespace mft_diff_detail
+
+/// True if @p record is a FILE record with the in-use flag set.
+[[nodiscard]] inline bool mft_record_in_use(unsigned char const* record) noexcept
+{
+    return memcmp(record, "FILE", 4) == 0 && (mft_diff_detail::get16(record + 0x16) & 0x0001) != 0;
+}
+
+/// Byte-wise equality of two records, 64 bytes per step where SSE2 is available.
+[[nodiscard]] inline bool mft_records_equal(unsigned char const* a, unsigned char const* b, size_t size) noexcept
+{
+    size_t i = 0;
+#ifdef UFFS_MFT_DIFF_SSE2
+    for (; i + 64 <= size; i += 64)
+    {
+        __m128i const* const x = reinterpret_cast<__m128i const*>(a + i);
+        __m128i const* const y = reinterpret_cast<__m128i const*>(b + i);
+        __m128i const e0 = _mm_cmpeq_epi8(_mm_loadu_si128(x + 0), _mm_loadu_si128(y + 0));
+        __m128i const e1 = _mm_cmpeq_epi8(_mm_loadu_si128(x + 1), _mm_loadu_si128(y + 1));
+        __m128i const e2 = _mm_cmpeq_epi8(_mm_loadu_si128(x + 2), _mm_loadu_si128(y + 2));
+        __m128i const e3 = _mm_cmpeq_epi8(_mm_loadu_si128(x + 3), _mm_loadu_si128(y + 3));
+        if (_mm_movemask_epi8(_mm_and_si128(_mm_and_si128(e0, e1), _mm_and_si128(e2, e3))) != 0xFFFF)
+        {
+            return false;
+        }
+    }
+#endif
+    return memcmp(a + i, b + i, size - i) == 0;
+}
+
+/**
+ * @brief Removes the update sequence of @p record in place and decodes it.
+ *
+ * Records that are not in use, fail the update sequence check or have a
+ * damaged attribute chain are summarized with in_use == false, so a torn
+ * write shows up as a removal rather than as garbage names.
+ */
+inline void summarize_mft_record(unsigned char* record, size_t size, MftRecordSummary& summary)
+{
+    using namespace mft_diff_detail;
+    summary = MftRecordSummary();
+    if (size < 0x30 || !mft_record_in_use(record))
+    {
+        return;
+    }
+
+    size_t const usa_offset = get16(record + 0x04);
+    size_t const usa_count = get16(record + 0x06);
+    if (!usa_count || usa_offset + 2 * usa_count > size)
+    {
+        return;
+    }
+    for (size_t i = 1; i < usa_count && i * 512 <= size; ++i)
+    {
+        unsigned char* const check = record + i * 512 - 2;
+        if (memcmp(check, record + usa_offset, 2) != 0)
+        {
+            return;
+        }
+        memcpy(check, record + usa_offset + 2 * i, 2);
+    }
+
+    summary.sequence = get16(record + 0x10);
+    summary.directory = (get16(record + 0x16) & 0x0002) != 0;
+    summary.base = get64(record + 0x20) & kMftFrsMask;
+
+    size_t const end = std::min<size_t>(size, get32(record + 0x18));
+    for (size_t offset = get16(record + 0x14); offset + 8 <= end;)
+    {
+        unsigned char const* const attr = record + offset;
+        uint32_t const type = get32(attr);
+        uint32_t const length = get32(attr + 4);
+        if (type == 0xFFFFFFFF)
+        {
+            break;
+        }
+        if (length < 0x18 || length > end - offset || (length & 7))
+        {
+            return;
+        }
+        offset += length;
+
+        bool const non_resident = attr[8] != 0;
+        bool const unnamed = attr[9] == 0;
+        uint32_t const value_length = non_resident ? 0 : get32(attr + 0x10);
+        uint32_t const value_offset = non_resident ? 0 : get16(attr + 0x14);
+        if (!non_resident && static_cast<uint64_t>(value_offset) + value_length > length)
+        {
+            continue;
+        }
+        unsigned char const* const value = attr + value_offset;
+
+        switch (type)
+        {
+        case 0x10:  // $STANDARD_INFORMATION
+            if (!non_resident && value_length >= 0x24)
+            {
+                summary.has_times = true;
+                summary.created = static_cast<int64_t>(get64(value + 0x00));
+                summary.modified = static_cast<int64_t>(get64(value + 0x08));
+                summary.accessed = static_cast<int64_t>(get64(value + 0x18));
+                summary.attributes = get32(value + 0x20);
+            }
+            break;
+        case 0x30:  // $FILE_NAME
+            if (!non_resident && value_length >= 0x42 &&
+                0x42U + 2U * value[0x40] <= value_length && value[0x41] != 2 /* DOS only */)
+            {
+                MftRecordLink link;
+                link.parent = get64(value) & kMftFrsMask;
+                link.name.resize(value[0x40]);
+                memcpy(&link.name[0], value + 0x42, link.name.size() * 2);
+                summary.links.push_back(std::move(link));
+            }
+            break;
+        case 0x80:  // $DATA
+            if (unnamed && !non_resident)
+            {
+                summary.has_size = true;
+                summary.size = value_length;
+                summary.allocated = (value_length + 7ULL) & ~7ULL;
+            }
+            else if (unnamed && length >= 0x40 && get64(attr + 0x10) == 0)
+            {
+                summary.has_size = true;
+                summary.allocated = get64(attr + 0x28);
+                summary.size = get64(attr + 0x30);
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    std::sort(summary.links.begin(), summary.links.end());
+    summary.in_use = true;
+}
+
+/// Renamed / Moved / Resized / Retimed bits between two in-use summaries.
+[[nodiscard]] inline uint32_t compare_mft_summaries(MftRecordSummary const& before, MftRecordSummary const& after)
+{
+    uint32_t changes = 0;
+    if (before.links != after.links)
+    {
+        std::vector<uint64_t> parents_before, parents_after;
+        std::vector<std::u16string> names_before, names_after;
+        for (MftRecordLink const& link : before.links)
+        {
+            parents_before.push_back(link.parent);
+            names_before.push_back(link.name);
+        }
+        for (MftRecordLink const& link : after.links)
+        {
+            parents_after.push_back(link.parent);
+            names_after.push_back(link.name);
+        }
+        std::sort(names_before.begin(), names_before.end());
+        std::sort(names_after.begin(), names_after.end());
+        if (names_before != names_after)
+        {
+            changes |= kMftChangeRenamed;
+        }
+        if (parents_before != parents_after)
+        {
+            changes |= kMftChangeMoved;
+        }
+    }
+    if (before.has_size != after.has_size || before.size != after.size)
+    {
+        changes |= kMftChangeResized;
+    }
+    if (before.has_times && after.has_times &&
+        (before.created != after.created || before.modified != after.modified || before.accessed != after.accessed))
+    {
+        changes |= kMftChangeRetimed;
+    }
+    return changes;
+}
+
+// ============================================================================
+// Diff
+// ============================================================================
+
+/// One changed file, with both decoded versions for reporting.
+struct MftDiffEntry
+{
+    uint64_t frs = 0;
+    uint32_t changes = 0;           ///< MftChange bits
+    MftRecordSummary before;        ///< in_use == false if the file is new
+    MftRecordSummary after;         ///< in_use == false if the file is gone
+};
+
+/// Record counters, summed over all slices.
+struct MftDiffStats
+{
+    uint64_t records = 0;           ///< Records looked at
+    uint64_t free = 0;              ///< Not in use in either dump
+    uint64_t identical = 0;         ///< In use in both, byte-identical
+    uint64_t decoded = 0;           ///< Bytes differed, both versions decoded
+    uint64_t reported = 0;          ///< Entries produced (before merging extensions)
+
+    MftDiffStats& operator+=(MftDiffStats const& other) noexcept
+    {
+        records += other.records;
+        free += other.free;
+        identical += other.identical;
+        decoded += other.decoded;
+        reported += other.reported;
+        return *this;
+    }
+};
+
+/**
+ * @brief Diffs @p count records starting at FRS @p first_frs.
+ *
+ * @param before, after  Raw records (update sequence still applied)
+ * @param entries        Receives one entry per changed file
+ */
+inline void diff_mft_records(unsigned char const* before, unsigned char const* after, uint64_t first_frs,
+    size_t count, uint32_t record_size, std::vector<MftDiffEntry>& entries, MftDiffStats& stats)
+{
+    std::vector<unsigned char> scratch(record_size);
+    for (size_t r = 0; r < count; ++r)
+    {
+        unsigned char const* const a = before + r * record_size;
+        unsigned char const* const b = after + r * record_size;
+        ++stats.records;
+
+        bool const a_used = mft_record_in_use(a);
+        bool const b_used = mft_record_in_use(b);
+        if (!a_used && !b_used)
+        {
+            ++stats.free;
+            continue;
+        }
+        if (a_used && b_used && mft_records_equal(a, b, record_size))
+        {
+            ++stats.identical;
+            continue;
+        }
+
+        ++stats.decoded;
+        MftDiffEntry entry;
+        entry.frs = first_frs + r;
+        memcpy(scratch.data(), a, record_size);
+        summarize_mft_record(scratch.data(), record_size, entry.before);
+        memcpy(scratch.data(), b, record_size);
+        summarize_mft_record(scratch.data(), record_size, entry.after);
+
+        bool const file_before = entry.before.in_use && !entry.before.base;
+        bool const file_after = entry.after.in_use && !entry.after.base;
+        if (file_before || file_after)
+        {
+            if (!file_before)
+            {
+                entry.changes = kMftChangeAdded;
+            }
+            else if (!file_after)
+            {
+                entry.changes = kMftChangeRemoved;
+            }
+            else if (entry.before.sequence != entry.after.sequence)
+            {
+                entry.changes = kMftChangeRemoved | kMftChangeAdded;
+            }
+            else
+            {
+                entry.changes = compare_mft_summaries(entry.before, entry.after);
+            }
+        }
+        else if (entry.before.in_use && entry.after.in_use && entry.before.base == entry.after.base)
+        {
+            // Extension record: only names and sizes live here, reported under the base
+            entry.frs = entry.before.base;
+            entry.changes = compare_mft_summaries(entry.before, entry.after) &
+                (kMftChangeRenamed | kMftChangeMoved | kMftChangeResized);
+        }
+
+        if (entry.changes)
+        {
+            ++stats.reported;
+            entries.push_back(std::move(entry));
+        }
+    }
+}
+
+/**
+ * @brief Sorts entries by FRS and folds extension-record entries into their base.
+ *
+ * Names and sizes found only in an extension record fill in the base
+ * entry's summaries, so reports show them.
+ */
+inline void merge_mft_diff_entries(std::vector<MftDiffEntry>& entries)
+{
+    std::stable_sort(entries.begin(), entries.end(),
+        [](MftDiffEntry const& x, MftDiffEntry const& y) { return x.frs < y.frs; });
+
+    size_t out = 0;
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        if (out && entries[out - 1].frs == entries[i].frs)
+        {
+            MftDiffEntry& merged = entries[out - 1];
+            MftDiffEntry& extra = entries[i];
+            merged.changes |= extra.changes;
+            for (auto side : { &MftDiffEntry::before, &MftDiffEntry::after })
+            {
+                MftRecordSummary& into = merged.*side;
+                MftRecordSummary& from = extra.*side;
+                if (into.links.empty())
+                {
+                    into.links.swap(from.links);
+                }
+                if (!into.has_size && from.has_size)
+                {
+                    into.has_size = true;
+                    into.size = from.size;
+                    into.allocated = from.allocated;
+                }
+            }
+            continue;
+        }
+        if (out != i)
+        {
+            entries[out] = std::move(entries[i]);
+        }
+        ++out;
+    }
+    entries.resize(out);
+}
+
+// ============================================================================
+// Dump Files
+// ============================================================================
+
+/**
+ * @class UffsMftRecordSource
+ * @brief Random access to the record stream of a (possibly compressed) dump.
+ */
+class UffsMftRecordSource
+{
+public:
+    /**
+     * @brief Maps and validates a dump file.
+     * @throws std::runtime_error if the file is not a valid UFFS-MFT dump
+     */
+    explicit UffsMftRecordSource(char const* path) : file_(path, MappedFile::ReadOnly)
+    {
+        if (file_.size() < sizeof(UffsMftHeader))
+        {
+            throw std::runtime_error("not a UFFS-MFT file (too small)");
+        }
+        memcpy(&header_, file_.data(), sizeof(header_));
+        if (char const* const error = validate_uffs_mft_header(header_, file_.size()))
+        {
+            throw std::runtime_error(error);
+        }
+        if (this->compressed())
+        {
+            if (char const* const error = read_uffs_mft_frame_index(file_.data(), header_, frames_))
+            {
+                throw std::runtime_error(error);
+            }
+        }
+    }
+
+    [[nodiscard]] UffsMftHeader const& header() const noexcept { return header_; }
+
+    [[nodiscard]] bool compressed() const noexcept
+    {
+        return !!(header_.flags & kUffsMftFlagLz4Frames);
+    }
+
+    /**
+     * @brief Returns bytes [offset, offset + size) of the record stream.
+     *
+     * Uncompressed ranges point into the mapping; anything else is
+     * assembled in @p scratch. Bytes past the end of the dump read as zero
+     * (records not in use).
+     * @throws std::runtime_error if a frame is corrupt
+     */
+    unsigned char const* read(uint64_t offset, size_t size, std::vector<unsigned char>& scratch) const
+    {
+        uint64_t const total = header_.original_size;
+        unsigned char const* const records = file_.data() + sizeof(UffsMftHeader);
+        if (!this->compressed() && offset + size <= total)
+        {
+            return records + offset;
+        }
+
+        scratch.assign(size, 0);
+        uint64_t const end = std::min<uint64_t>(offset + size, total);
+        if (!this->compressed())
+        {
+            if (offset < end)
+            {
+                memcpy(scratch.data(), records + offset, static_cast<size_t>(end - offset));
+            }
+            return scratch.data();
+        }
+
+        std::vector<unsigned char> frame;
+        for (uint64_t pos = offset; pos < end;)
+        {
+            uint64_t const f = pos / header_.frame_size;
+            uint64_t const frame_begin = f * header_.frame_size;
+            size_t const decoded_size = uffs_mft_frame_decoded_size(header_, f);
+            size_t const skip = static_cast<size_t>(pos - frame_begin);
+            size_t const n = static_cast<size_t>(std::min<uint64_t>(decoded_size - skip, end - pos));
+            UffsMftFrame const& entry = frames_[static_cast<size_t>(f)];
+            unsigned char* const out = scratch.data() + (pos - offset);
+
+            bool ok;
+            if (!skip && n == decoded_size)
+            {
+                ok = decode_uffs_mft_frame(file_.data() + entry.offset, entry.encoded_size, out, decoded_size);
+            }
+            else
+            {
+                frame.resize(decoded_size);
+                ok = decode_uffs_mft_frame(file_.data() + entry.offset, entry.encoded_size, frame.data(), decoded_size);
+                memcpy(out, frame.data() + skip, n);
+            }
+            if (!ok)
+            {
+                throw std::runtime_error("corrupt UFFS-MFT frame");
+            }
+            pos += n;
+        }
+        return scratch.data();
+    }
+
+private:
+    MappedFile file_;
+    UffsMftHeader header_;
+    std::vector<UffsMftFrame> frames_;
+};
+
+/**
+ * @class MftDumpDiff
+ * @brief Diffs two dumps of the same volume in parallel slices.
+ *
+ * Dumps may hold different record counts ($MFT grows); records past the
+ * end of the shorter one count as not in use.
+ */
+class MftDumpDiff
+{
+public:
+    /// Minimum bytes per slice; compressed dumps use whole frames.
+    static constexpr size_t kSliceSize =
+        static_cast<size_t>(mft_reader_constants::kDefaultReadBlockSize);
+
+    /**
+     * @throws std::runtime_error if either file is invalid or the record
+     *         sizes differ
+     */
+    MftDumpDiff(char const* before_path, char const* after_path)
+        : before_(before_path), after_(after_path)
+    {
+        if (before_.header().record_size != after_.header().record_size)
+        {
+            throw std::runtime_error("dumps have different record sizes");
+        }
+        if (before_.header().volume_letter && after_.header().volume_letter &&
+            before_.header().volume_letter != after_.header().volume_letter)
+        {
+            throw std::runtime_error("dumps were taken from different volumes");
+        }
+    }
+
+    [[nodiscard]] UffsMftHeader const& before_header() const noexcept { return before_.header(); }
+    [[nodiscard]] UffsMftHeader const& after_header() const noexcept { return after_.header(); }
+
+    /**
+     * @brief Runs the diff.
+     * @param entries  Receives the changed files, sorted by FRS
+     * @param threads  Worker threads (0 = hardware concurrency)
+     * @throws std::runtime_error on corrupt frames
+     */
+    MftDiffStats operator()(std::vector<MftDiffEntry>& entries, unsigned int threads = 0) const
+    {
+        uint32_t const record_size = before_.header().record_size;
+        // Copies: std::max must not bind references to members of the packed header
+        uint64_t const records_before = before_.header().record_count;
+        uint64_t const records_after = after_.header().record_count;
+        uint64_t const record_count = std::max(records_before, records_after);
+
+        // Whole frames of either dump, so no frame is decoded twice when frame sizes match
+        size_t slice_size = std::max<size_t>(kSliceSize - kSliceSize % record_size, record_size);
+        for (UffsMftHeader const* header : { &before_.header(), &after_.header() })
+        {
+            if (header->flags & kUffsMftFlagLz4Frames)
+            {
+                size_t const frame_size = header->frame_size;
+                slice_size = std::max(slice_size, frame_size);
+            }
+        }
+        size_t const slice_records = slice_size / record_size;
+        size_t const slice_count = static_cast<size_t>((record_count + slice_records - 1) / slice_records);
+
+        std::vector<std::vector<MftDiffEntry>> slice_entries(slice_count);
+        std::vector<MftDiffStats> slice_stats(slice_count);
+        parallel_for_each_index(slice_count, threads, [&](size_t s)
+        {
+            uint64_t const first = static_cast<uint64_t>(s) * slice_records;
+            size_t const count = static_cast<size_t>(std::min<uint64_t>(slice_records, record_count - first));
+            size_t const bytes = count * record_size;
+
+            std::vector<unsigned char> before_scratch, after_scratch;
+            unsigned char const* const before = before_.read(first * record_size, bytes, before_scratch);
+            unsigned char const* const after = after_.read(first * record_size, bytes, after_scratch);
+            diff_mft_records(before, after, first, count, record_size, slice_entries[s], slice_stats[s]);
+        });
+
+        MftDiffStats stats;
+        entries.clear();
+        for (size_t s = 0; s < slice_count; ++s)
+        {
+            stats += slice_stats[s];
+            entries.insert(entries.end(), std::make_move_iterator(slice_entries[s].begin()),
+                std::make_move_iterator(slice_entries[s].end()));
+        }
+        merge_mft_diff_entries(entries);
+        return stats;
+    }
+
+private:
+    UffsMftRecordSource before_;
+    UffsMftRecordSource after_;
+};
+
+} // namespace uffs
+
+// Expose at global scope for backward compatibility
+using uffs::MftDiffEntry;
+using uffs::MftDumpDiff;
+
+#endif // UFFS_MFT_DIFF_HPP
@@ -0,0 +1,355 @@
+/**
+ * @file mft_dump_replay.hpp
+ * @brief Offline index build from UFFS-MFT dump files.
+ *
+ * Replays a file written by `--dump-mft` into an NtfsIndex without touching
+ * a live volume. The dump is memory-mapped copy-on-write and fed straight
+ * into NtfsIndex::preload_concurrent() / NtfsIndex::load(), bypassing
+ * OverlappedNtfsMftReadPayload and the I/O completion port entirely.
+ *
+ * ## Pipeline
+ *
+ * ```
+ *   mapped dump (copy-on-write)
+ *   ┌────────┬────────┬────────┬────────┬─────
+ *   │slice 0 │slice 1 │slice 2 │slice 3 │ ...      1 MB slices (or frames)
+ *   └───┬────┴───┬────┴───┬────┴───┬────┴─────
+ *       │        │        │        │
+ *       ▼        ▼        ▼        ▼
+ *   worker threads: [decode] preload_concurrent()  (parallel, any order)
+ *                   parse()
+ *       │        │        │        │
+ *       ▼        ▼        ▼        ▼
+ *   calling thread: load(fragment)                 (sequential, in order)
+ * ```
+ *
+ * Slices use the same size as the live reader's I/O blocks, so load() sees
+ * the same chunk granularity it does in production. Loading in file order
+ * keeps the resulting index deterministic across runs, which matters when
+ * the replay is used for benchmarking or comparing parser changes.
+ *
+ * Block-compressed dumps use one slice per frame instead. Workers decode
+ * the frame into a private buffer before preloading it.
+ *
+ * Workers also parse their slice into an NtfsIndex::Fragment, so the
+ * calling thread only links fragments into the index. At most two parsed
+ * slices per worker are held at any time.
+ *
+ * ## Usage
+ *
+ * ```cpp
+ * intrusive_ptr<NtfsIndex> index(new NtfsIndex(_T("C:\\")));
+ * MftDumpReplay replay("C_mft.raw");
+ * replay(index.get());   // blocks; finished_event() is signaled on return
+ * ```
+ *
+ * @note The volume handle of the index is never opened, so init() must
+ *       not be called.
+ *
+ * @see uffs_mft_format.hpp for the file layout
+ * @see mft_stream_replay.hpp for dumps piped in on stdin
+ * @see mft_reader.hpp for the live (IOCP) reader
+ */
+
+#ifndef UFFS_MFT_DUMP_REPLAY_HPP
+#define UFFS_MFT_DUMP_REPLAY_HPP
+
+#include "mft_reader_constants.hpp"
+#include "uffs_mft_codec.hpp"
+#include "uffs_mft_format.hpp"
+
+#include "util/error_utils.hpp"
+#include "util/intrusive_ptr.hpp"
+#include "util/lock_ptr.hpp"
+#include "util/mapped_file.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "index/ntfs_index_fwd.hpp"
+
+namespace uffs {
+
+/**
+ * @class MftDumpReplay
+ * @brief Builds an NtfsIndex from a memory-mapped UFFS-MFT dump.
+ */
+class MftDumpReplay
+{
+public:
+    /// Bytes of records handed to each preload_concurrent()/parse() call.
+    static constexpr size_t kSliceSize =
+        static_cast<size_t>(mft_reader_constants::kDefaultReadBlockSize);
+
+    /// Cluster size reported to the index. Dumps do not record it; it only
+    /// scales the reserved cluster count, which is 0 for offline builds.
+    static constexpr unsigned int kAssumedClusterSize = 4096;
+
+    /**
+     * @brief Maps and validates a dump file.
+     * @throws std::runtime_error if the file cannot be mapped or is not a
+     *         valid UFFS-MFT dump
+     */
+    explicit MftDumpReplay(char const* path) : file_(path)
+    {
+        if (file_.size() < sizeof(UffsMftHeader))
+        {
+            throw std::runtime_error("not a UFFS-MFT file (too small)");
+        }
+
+        memcpy(&header_, file_.data(), sizeof(header_));
+        if (char const* const error = validate_uffs_mft_header(header_, file_.size()))
+        {
+            throw std::runtime_error(error);
+        }
+
+        if (this->compressed())
+        {
+            // A piped dump saved to a file did not know its size when the header was written
+            if ((header_.flags & kUffsMftFlagFramePrefixes) && !header_.compressed_size)
+            {
+                header_.compressed_size = file_.size() - sizeof(UffsMftHeader);
+            }
+            if (char const* const error = read_uffs_mft_frame_index(file_.data(), header_, frames_))
+            {
+                throw std::runtime_error(error);
+            }
+        }
+    }
+
+    [[nodiscard]] UffsMftHeader const& header() const noexcept { return header_; }
+
+    /// Root path of the volume the dump was taken from (e.g. "C:\"), or
+    /// @p fallback if the dump does not record it.
+    [[nodiscard]] std::tvstring root_path(TCHAR const* fallback) const
+    {
+        if (!header_.volume_letter)
+        {
+            return std::tvstring(fallback);
+        }
+
+        TCHAR const path[] = { static_cast<TCHAR>(header_.volume_letter), _T(':'), _T('\\'), _T('\0') };
+        return std::tvstring(path);
+    }
+
+    /**
+     * @brief Replays every record into @p index.
+     *
+     * Configures the index geometry from the header, pre-sizes it, then
+     * runs the slice pipeline. The index's finished event is signaled on
+     * return, with get_finished() holding 0 or the error code.
+     *
+     * @tparam IndexType  NtfsIndex or HugeNtfsIndex
+     * @param index    Freshly constructed, empty index
+     * @param threads  Number of preload workers (0 = hardware concurrency)
+     * @return 0 on success, ERROR_ARITHMETIC_OVERFLOW if the volume is too
+     *         large for the index width, another error code on failure
+     */
+    template <class IndexType>
+    unsigned int operator()(IndexType* index, unsigned int threads = 0)
+    {
+        unsigned int error_code = 0;
+        try
+        {
+            this->replay(index, threads);
+        }
+        catch (CStructured_Exception& ex)
+        {
+            error_code = ex.GetSENumber();
+        }
+        catch (std::bad_alloc&)
+        {
+            error_code = ERROR_NOT_ENOUGH_MEMORY;
+        }
+        catch (std::length_error&)
+        {
+            error_code = ERROR_ARITHMETIC_OVERFLOW;  // names past the index width (see HugeNtfsIndex)
+        }
+        catch (std::exception&)
+        {
+            error_code = ERROR_INVALID_DATA;
+        }
+
+        // load() signals completion once the last record is counted; make
+        // sure waiters are released on errors and for empty dumps as well.
+        if (error_code || !header_.record_count)
+        {
+            index->set_finished(error_code);
+        }
+
+        return error_code;
+    }
+
+private:
+    MappedFile file_;
+    UffsMftHeader header_;
+    std::vector<UffsMftFrame> frames_;
+
+    [[nodiscard]] bool compressed() const noexcept
+    {
+        return !!(header_.flags & kUffsMftFlagLz4Frames);
+    }
+
+    template <class IndexType>
+    void replay(IndexType* index, unsigned int threads)
+    {
+        unsigned int const record_count = static_cast<unsigned int>(header_.record_count);
+
+        // Geometry normally comes from FSCTL_GET_NTFS_VOLUME_DATA.
+        // The MFT zone and reserved clusters are unknown offline and left at 0.
+        index->set_mft_record_size(header_.record_size);
+        index->set_mft_capacity(record_count);
+        index->set_cluster_size(kAssumedClusterSize);
+        index->reserve(record_count);
+
+        // Uncompressed dumps are sliced straight out of the mapping.
+        // Compressed dumps use one slice per frame, decoded by the worker
+        // into a private buffer that is released once the slice is parsed.
+        unsigned char* const records = file_.data() + sizeof(UffsMftHeader);
+        size_t const total_size = static_cast<size_t>(header_.original_size);
+        size_t const slice_size = this->compressed()
+            ? header_.frame_size
+            : kSliceSize - kSliceSize % header_.record_size;
+        size_t const slice_count = (total_size + slice_size - 1) / slice_size;
+
+        if (!threads)
+        {
+            threads = std::max(1U, std::thread::hardware_concurrency());
+        }
+        threads = static_cast<unsigned int>(std::min<size_t>(threads, slice_count));
+
+        // Bound parsed-but-not-loaded slices to a few per worker;
+        // slice s is parsed into fragment s % window
+        size_t const window = static_cast<size_t>(threads) * 2;
+        std::vector<typename IndexType::Fragment> fragments(window);
+
+        std::mutex mutex;
+        std::condition_variable slice_ready, slice_loaded;
+        std::vector<bool> preloaded(slice_count);
+        std::exception_ptr worker_error;
+        std::atomic<size_t> next_slice(0);
+        size_t next_to_load = 0;
+        bool stop = false;
+
+        auto const worker = [&]()
+        {
+            for (size_t s; (s = next_slice.fetch_add(1, std::memory_order_relaxed)) < slice_count;)
+            {
+                {
+                    std::unique_lock<std::mutex> guard(mutex);
+                    slice_loaded.wait(guard, [&]() { return stop || s < next_to_load + window; });
+                    if (stop)
+                    {
+                        return;
+                    }
+                }
+
+                size_t const offset = s * slice_size;
+                size_t const size = std::min(slice_size, total_size - offset);
+                try
+                {
+                    unsigned char* data = records + offset;
+                    std::unique_ptr<unsigned char[]> buffer;
+                    if (this->compressed())
+                    {
+                        UffsMftFrame const& frame = frames_[s];
+                        buffer.reset(new unsigned char[size]);
+                        if (!decode_uffs_mft_frame(file_.data() + frame.offset, frame.encoded_size, buffer.get(), size))
+                        {
+                            throw std::runtime_error("corrupt UFFS-MFT frame");
+                        }
+                        data = buffer.get();
+                    }
+
+                    // Fragment s % window is owned by this worker until marked ready
+                    IndexType volatile* const shared = index;
+                    shared->preload_concurrent(offset, data, size);
+                    shared->parse(offset, data, size, fragments[s % window]);
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> guard(mutex);
+                    if (!worker_error)
+                    {
+                        worker_error = std::current_exception();
+                    }
+                }
+
+                {
+                    std::lock_guard<std::mutex> guard(mutex);
+                    preloaded[s] = true;
+                }
+                slice_ready.notify_all();
+            }
+        };
+
+        std::vector<std::thread> workers;
+        workers.reserve(threads);
+
+        // Stop and join workers on every exit path, including exceptions from load()
+        struct JoinAll
+        {
+            std::vector<std::thread>& workers;
+            std::mutex& mutex;
+            std::condition_variable& slice_loaded;
+            bool& stop;
+
+            ~JoinAll()
+            {
+                {
+                    std::lock_guard<std::mutex> guard(mutex);
+                    stop = true;
+                }
+                slice_loaded.notify_all();
+                for (auto& w : workers)
+                {
+                    w.join();
+                }
+            }
+        } const join_all = { workers, mutex, slice_loaded, stop };
+
+        for (unsigned int t = 0; t < threads; ++t)
+        {
+            workers.emplace_back(worker);
+        }
+
+        for (size_t s = 0; s < slice_count; ++s)
+        {
+            {
+                std::unique_lock<std::mutex> guard(mutex);
+                slice_ready.wait(guard, [&]() { return preloaded[s] || worker_error; });
+                if (worker_error)
+                {
+                    std::rethrow_exception(worker_error);
+                }
+            }
+
+            if (index->cancelled())
+            {
+                CppRaiseException(ERROR_CANCELLED);
+            }
+
+            lock(index)->load(fragments[s % window], 0, 0);
+
+            {
+                std::lock_guard<std::mutex> guard(mutex);
+                next_to_load = s + 1;
+            }
+            slice_loaded.notify_all();
+        }
+    }
+};
+
+} // namespace uffs
+
+// Expose at global scope for backward compatibility
+using uffs::MftDumpReplay;
+
+#endif // UFFS_MFT_DUMP_REPLAY_HPP
@@ -0,0 +1,285 @@
+/**
+ * @file mft_fixup.hpp
+ * @brief Batched multi-sector fixup and validation of FILE records.
+ *
+ * NTFS protects every 512-byte sector of a FILE record by replacing its
+ * last two bytes with the update sequence number (USN) and saving the
+ * original bytes in the update sequence array (USA) of the header:
+ *
+ * ```
+ *   0x00 "FILE"  0x04 USAOffset  0x06 USACount
+ *   USAOffset:  USN  tail[1]  tail[2] ... tail[USACount - 1]
+ *   512 * i - 2: USN   → must match, is replaced by tail[i]
+ * ```
+ *
+ * Undoing this touches every sector of the $MFT, so with a cached MFT it
+ * is one of the larger costs of building the index. The kernels here fix
+ * up a run of consecutive records and return a bit per record that says
+ * whether it is a valid FILE record:
+ *
+ * | Kernel  | How                                                          |
+ * |---------|--------------------------------------------------------------|
+ * | kScalar | One record at a time, as MULTI_SECTOR_HEADER::unfixup()      |
+ * | kAvx2   | Eight records at a time; each sector tail is one gather      |
+ *
+ * mft_fixup_kernel() picks the fastest kernel the CPU supports, once.
+ * Records whose USA is not the usual one (USACount = sectors + 1, inside
+ * the first sector) are left to the scalar kernel by kAvx2, so both give
+ * identical results on any input.
+ *
+ * A FILE record whose sector tails do not match the USN is renamed
+ * 'BAAD', as NTFS itself does for torn writes. Other records are left as
+ * they are.
+ *
+ * @note No Windows dependencies, so this header can be unit-tested.
+ *
+ * @see ntfs_index_load.hpp for NtfsIndex::preload_concurrent, the user
+ */
+
+#ifndef UFFS_MFT_FIXUP_HPP
+#define UFFS_MFT_FIXUP_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define UFFS_MFT_FIXUP_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC accepts AVX2 intrinsics in any function; GCC and Clang need them enabled per function
+#if defined(UFFS_MFT_FIXUP_X86) && (defined(__GNUC__) || defined(__clang__))
+#define UFFS_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define UFFS_TARGET_AVX2
+#endif
+
+namespace uffs {
+
+enum class MftFixupKernel
+{
+    kScalar,
+    kAvx2,
+};
+
+namespace mft_fixup_detail {
+
+constexpr uint32_t kFileMagic = 0x454C4946;  // "FILE"
+constexpr uint32_t kBaadMagic = 0x44414142;  // "BAAD"
+constexpr size_t kSectorSize = 512;
+
+inline uint16_t get16(unsigned char const* p) noexcept { uint16_t v; memcpy(&v, p, sizeof(v)); return v; }
+inline uint32_t get32(unsigned char const* p) noexcept { uint32_t v; memcpy(&v, p, sizeof(v)); return v; }
+inline void put32(unsigned char* p, uint32_t v) noexcept { memcpy(p, &v, sizeof(v)); }
+
+/// Fixes up one record whose magic is FILE; true if every sector tail matched.
+inline bool unfixup(unsigned char* record, size_t record_size) noexcept
+{
+    size_t const usa_offset = get16(record + 4);
+    size_t const usa_count = get16(record + 6);
+    if (usa_offset + usa_count * 2 > record_size)
+    {
+        return false;  // a USA outside the record cannot be right
+    }
+
+    unsigned char const* const usa = record + usa_offset;
+    bool result = true;
+    for (size_t i = 1; i < usa_count && i * kSectorSize <= record_size; ++i)
+    {
+        unsigned char* const check = record + i * kSectorSize - 2;
+        result &= memcmp(check, usa, 2) == 0;
+        memcpy(check, usa + i * 2, 2);
+    }
+    return result;
+}
+
+/// Scalar kernel for one record; sets its bit in @p valid_mask if valid.
+inline bool fixup_one(unsigned char* record, size_t record_size, size_t index, uint64_t* valid_mask) noexcept
+{
+    if (get32(record) != kFileMagic)
+    {
+        return false;
+    }
+    if (!unfixup(record, record_size))
+    {
+        put32(record, kBaadMagic);
+        return false;
+    }
+    valid_mask[index / 64] |= uint64_t(1) << (index % 64);
+    return true;
+}
+
+inline size_t fixup_scalar(unsigned char* records, size_t count, size_t record_size, uint64_t* valid_mask) noexcept
+{
+    size_t valid = 0;
+    for (size_t r = 0; r != count; ++r)
+    {
+        valid += fixup_one(records + r * record_size, record_size, r, valid_mask);
+    }
+    return valid;
+}
+
+#ifdef UFFS_MFT_FIXUP_X86
+UFFS_TARGET_AVX2
+inline size_t fixup_avx2(unsigned char* records, size_t count, size_t record_size, uint64_t* valid_mask) noexcept
+{
+    int const stride = static_cast<int>(record_size);
+    int const sectors = static_cast<int>(record_size / kSectorSize);
+    __m256i const lanes = _mm256_setr_epi32(0, stride, 2 * stride, 3 * stride, 4 * stride, 5 * stride, 6 * stride, 7 * stride);
+    __m256i const low16 = _mm256_set1_epi32(0xFFFF);
+    __m256i const file_magic = _mm256_set1_epi32(static_cast<int>(kFileMagic));
+    __m256i const usual_count = _mm256_set1_epi32(sectors + 1);
+    // The USA must end before the first tail, so no gathered value is overwritten by the fixup
+    __m256i const usa_offset_limit = _mm256_set1_epi32(static_cast<int>(kSectorSize) - 2 * (sectors + 1) + 1);
+
+    size_t valid = 0;
+    size_t r = 0;
+    for (; r + 8 <= count; r += 8)
+    {
+        unsigned char* const batch = records + r * record_size;
+        int const* const base = reinterpret_cast<int const*>(batch);
+
+        // Header: magic, then USAOffset and USACount as one dword
+        __m256i const magic = _mm256_i32gather_epi32(base, lanes, 1);
+        __m256i const usa = _mm256_i32gather_epi32(base, _mm256_add_epi32(lanes, _mm256_set1_epi32(4)), 1);
+        __m256i const usa_offset = _mm256_and_si256(usa, low16);
+        __m256i const usa_count = _mm256_srli_epi32(usa, 16);
+        __m256i const is_file = _mm256_cmpeq_epi32(magic, file_magic);
+        __m256i const fast = _mm256_and_si256(is_file, _mm256_and_si256(
+            _mm256_cmpeq_epi32(usa_count, usual_count), _mm256_cmpgt_epi32(usa_offset_limit, usa_offset)));
+
+        // Compare every sector tail with the USN of its record; other lanes read their magic, in bounds
+        __m256i const usn = _mm256_and_si256(_mm256_i32gather_epi32(base,
+            _mm256_add_epi32(lanes, _mm256_and_si256(usa_offset, fast)), 1), low16);
+        __m256i matched = fast;
+        for (int i = 1; i <= sectors; ++i)
+        {
+            __m256i const tail = _mm256_srli_epi32(_mm256_i32gather_epi32(base,
+                _mm256_add_epi32(lanes, _mm256_set1_epi32(i * static_cast<int>(kSectorSize) - 4)), 1), 16);
+            matched = _mm256_and_si256(matched, _mm256_cmpeq_epi32(tail, usn));
+        }
+
+        unsigned int const fast_lanes = static_cast<unsigned int>(_mm256_movemask_ps(_mm256_castsi256_ps(fast)));
+        unsigned int const matched_lanes = static_cast<unsigned int>(_mm256_movemask_ps(_mm256_castsi256_ps(matched)));
+        unsigned int const file_lanes = static_cast<unsigned int>(_mm256_movemask_ps(_mm256_castsi256_ps(is_file)));
+
+        for (unsigned int j = 0; j != 8; ++j)
+        {
+            unsigned char* const record = batch + j * record_size;
+            if (!(fast_lanes >> j & 1))
+            {
+                if (file_lanes >> j & 1)
+                {
+                    valid += fixup_one(record, record_size, r + j, valid_mask);
+                }
+                continue;
+            }
+
+            // Put the saved bytes back, whether or not the record turned out torn
+            unsigned char const* const saved = record + get16(record + 4) + 2;
+            for (int i = 1; i <= sectors; ++i)
+            {
+                memcpy(record + i * kSectorSize - 2, saved + (i - 1) * 2, 2);
+            }
+            if (matched_lanes >> j & 1)
+            {
+                valid_mask[(r + j) / 64] |= uint64_t(1) << ((r + j) % 64);
+                ++valid;
+            }
+            else
+            {
+                put32(record, kBaadMagic);
+            }
+        }
+    }
+    for (; r != count; ++r)
+    {
+        valid += fixup_one(records + r * record_size, record_size, r, valid_mask);
+    }
+    return valid;
+}
+
+/// True if the CPU and the OS support AVX2.
+inline bool cpu_has_avx2() noexcept
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+    {
+        return false;
+    }
+    __cpuid(info, 1);
+    bool const osxsave = (info[2] & (1 << 27)) != 0;
+    bool const avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 6) != 6)
+    {
+        return false;  // the OS does not save the YMM registers
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+#endif
+
+} // namespace mft_fixup_detail
+
+/// The fastest kernel this CPU supports; detected on first use.
+[[nodiscard]] inline MftFixupKernel mft_fixup_kernel() noexcept
+{
+#ifdef UFFS_MFT_FIXUP_X86
+    static MftFixupKernel const kernel = mft_fixup_detail::cpu_has_avx2() ? MftFixupKernel::kAvx2 : MftFixupKernel::kScalar;
+    return kernel;
+#else
+    return MftFixupKernel::kScalar;
+#endif
+}
+
+/// True if @p kernel can run on this CPU.
+[[nodiscard]] inline bool mft_fixup_kernel_supported(MftFixupKernel kernel) noexcept
+{
+    return kernel == MftFixupKernel::kScalar || mft_fixup_kernel() == kernel;
+}
+
+/**
+ * @brief Fixes up @p count consecutive records and validates them.
+ *
+ * @param records      First record; fixed up in place
+ * @param count        Number of records
+ * @param record_size  Bytes per record, a multiple of 512
+ * @param valid_mask   (count + 63) / 64 words; bit r is set if record r is
+ *                     a FILE record whose sector tails all matched
+ * @param kernel       Kernel to use; must be mft_fixup_kernel_supported()
+ * @return Number of valid records
+ */
+inline size_t mft_fixup_records(void* records, size_t count, size_t record_size, uint64_t* valid_mask,
+    MftFixupKernel kernel = mft_fixup_kernel()) noexcept
+{
+    memset(valid_mask, 0, (count + 63) / 64 * sizeof(uint64_t));
+    unsigned char* const bytes = static_cast<unsigned char*>(records);
+#ifdef UFFS_MFT_FIXUP_X86
+    if (kernel == MftFixupKernel::kAvx2)
+    {
+        return mft_fixup_detail::fixup_avx2(bytes, count, record_size, valid_mask);
+    }
+#else
+    (void)kernel;
+#endif
+    return mft_fixup_detail::fixup_scalar(bytes, count, record_size, valid_mask);
+}
+
+} // namespace uffs
+
+// Expose at global scope for backward compatibility
+using uffs::MftFixupKernel;
+using uffs::mft_fixup_kernel;
+using uffs::mft_fixup_kernel_supported;
+using uffs::mft_fixup_records;
+
+#endif // UFFS_MFT_FIXUP_HPP
@@ -0,0 +1,137 @@
+/**
+ * @file mft_read_plan.hpp
+ * @brief Splits $MFT extents into read chunks with unused records trimmed.
+ *
+ * The same two steps the live reader performs in
+ * OverlappedNtfsMftReadPayload::build_chunk_list_from_extents() and
+ * ReadOperation::calculate_all_skip_ranges(), as free functions over plain
+ * values so that readers without an NtfsIndex (raw images, --dump-mft)
+ * produce identical chunks.
+ *
+ * ```
+ *   extents ──split_mft_extents()──► chunks ──trim_unused_mft_records()──► chunks
+ *   (next VCN, LCN)                  ≤ 1 MB      $MFT::$BITMAP             skip_begin / skip_end
+ * ```
+ *
+ * ## Usage
+ *
+ * ```cpp
+ * std::vector<MftReadChunk> chunks = split_mft_extents(extents, cluster_size, limit);
+ * trim_unused_mft_records(chunks, bitmap, cluster_size, record_size);
+ * ```
+ *
+ * @see mft_reader_init.hpp for the live equivalent
+ */
+
+#ifndef UFFS_MFT_READ_PLAN_HPP
+#define UFFS_MFT_READ_PLAN_HPP
+
+#include "bitmap_utils.hpp"
+#include "mft_reader_constants.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace uffs {
+
+/**
+ * @brief One contiguous run of $MFT::$DATA clusters to read.
+ *
+ * Mirrors the live reader's ChunkDescriptor: skip_begin/skip_end count
+ * clusters at either end that hold only records marked unused in
+ * $MFT::$BITMAP and need not be read.
+ */
+struct MftReadChunk
+{
+    unsigned long long vcn;            ///< First cluster within $MFT::$DATA
+    long long lcn;                     ///< First cluster on the volume
+    unsigned long long cluster_count;  ///< Clusters covered by the chunk
+    unsigned long long skip_begin;     ///< Leading clusters not read
+    unsigned long long skip_end;       ///< Trailing clusters not read
+
+    [[nodiscard]] unsigned long long read_clusters() const noexcept
+    {
+        return cluster_count - skip_begin - skip_end;
+    }
+};
+
+/// (next VCN, LCN) pairs, the layout get_retrieval_pointers() returns.
+using MftExtentMap = std::vector<std::pair<unsigned long long, long long>>;
+
+/**
+ * @brief Splits an extent map into chunks of at most @p max_read bytes.
+ *
+ * Chunks never span two extents. Nothing at or beyond VCN @p limit is
+ * included, so the clusters past the last valid record are not read.
+ *
+ * @param extents       Extent map of the stream
+ * @param cluster_size  Bytes per cluster
+ * @param limit         Clusters to cover (pass ~0ULL for the whole map)
+ * @param max_read      Largest chunk in bytes
+ */
+[[nodiscard]] inline std::vector<MftReadChunk> split_mft_extents(
+    MftExtentMap const& extents,
+    unsigned int cluster_size,
+    unsigned long long limit,
+    unsigned long long max_read = mft_reader_constants::kDefaultReadBlockSize)
+{
+    unsigned long long const max_clusters_per_chunk = 1 + (max_read - 1) / cluster_size;
+
+    std::vector<MftReadChunk> chunks;
+    unsigned long long current_vcn = 0;
+    for (auto const& extent : extents)
+    {
+        unsigned long long const extent_starting_vcn = current_vcn;
+        unsigned long long const extent_ending_vcn = std::min(extent.first, limit);
+        while (current_vcn < extent_ending_vcn)
+        {
+            MftReadChunk chunk = {};
+            chunk.vcn = current_vcn;
+            chunk.lcn = extent.second + static_cast<long long>(current_vcn - extent_starting_vcn);
+            chunk.cluster_count = std::min(extent_ending_vcn - current_vcn, max_clusters_per_chunk);
+            chunks.push_back(chunk);
+            current_vcn += chunk.cluster_count;
+        }
+        current_vcn = extent.first;
+    }
+    return chunks;
+}
+
+/**
+ * @brief Sets the skip ranges of $MFT::$DATA chunks from $MFT::$BITMAP.
+ *
+ * Only whole clusters of unused records at either end of a chunk are
+ * skipped; a chunk with no record in use is skipped entirely.
+ *
+ * @param chunks        Chunks from split_mft_extents()
+ * @param bitmap        One bit per record; records past its end count as unused
+ * @param cluster_size  Bytes per cluster
+ * @param record_size   Bytes per file record segment
+ */
+inline void trim_unused_mft_records(
+    std::vector<MftReadChunk>& chunks,
+    std::vector<unsigned char> const& bitmap,
+    unsigned int cluster_size,
+    unsigned int record_size)
+{
+    for (MftReadChunk& chunk : chunks)
+    {
+        size_t const first_record = static_cast<size_t>(chunk.vcn * cluster_size / record_size);
+        size_t const record_count = static_cast<size_t>(chunk.cluster_count * cluster_size / record_size);
+        size_t const skip_records_begin =
+            bitmap_utils::find_first_set_bit(bitmap, first_record, record_count);
+        size_t const skip_records_end =
+            bitmap_utils::find_last_set_bit(bitmap, first_record, record_count, skip_records_begin);
+        chunk.skip_begin = static_cast<unsigned long long>(skip_records_begin) * record_size / cluster_size;
+        chunk.skip_end = static_cast<unsigned long long>(skip_records_end) * record_size / cluster_size;
+    }
+}
+
+} // namespace uffs
+
+// Expose at global scope for backward compatibility
+using uffs::MftReadChunk;
+
+#endif // UFFS_MFT_READ_PLAN_HPP
@@ -23,6 +23,7 @@
 #include "mft_reader_constants.hpp"
 #include "mft_reader_types.hpp"
 #include "bitmap_utils.hpp"
+#include "mft_refresh.hpp"
 
 // I/O infrastructure
 #include "overlapped.hpp"
@@ -46,7 +47,7 @@
 // FORWARD DECLARATIONS
 // ============================================================================
 
-class NtfsIndex;
+#include "index/ntfs_index_fwd.hpp"
 
 // ============================================================================
 // CLASS: OverlappedNtfsMftReadPayload
@@ -234,6 +235,18 @@ public:
      */
     virtual void preopen() {}
 
+    /**
+     * @brief Reads one raw MFT record synchronously, bypassing the IOCP.
+     *
+     * Used by a re-scan for the few records it needs outside the chunks
+     * being processed (see NtfsIndex::finish_refresh()).
+     *
+     * @param frs     Record number
+     * @param record  Receives mft_record_size() bytes, not yet fixed up
+     * @return false if the record lies outside $MFT::$DATA or was not read in full
+     */
+    bool read_mft_record(unsigned int frs, void* record) const;
+
 private:
     // ========================================================================
     // PRIVATE HELPER METHODS (implemented after class definition)
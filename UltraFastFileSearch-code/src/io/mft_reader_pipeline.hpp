@@ -7,6 +7,7 @@
  * - try_issue_bitmap_read(): Attempts to issue a bitmap chunk read
  * - try_issue_data_read(): Attempts to issue a data chunk read
  * - issue_chunk_read(): Issues an async read for a specific chunk
+ * - read_mft_record(): Reads a single record synchronously
  *
  * ## Pipeline Architecture
  *
@@ -262,4 +263,52 @@ inline void OverlappedNtfsMftReadPayload::issue_chunk_read(
 }
 
 
+/**
+ * @brief Reads one raw MFT record synchronously, bypassing the IOCP.
+ *
+ * The volume handle is associated with the IOCP, so the read uses its own
+ * event with the low bit set, which keeps the completion from being queued
+ * to the port.
+ *
+ * @param frs     Record number
+ * @param record  Receives mft_record_size() bytes
+ * @return false if the record lies outside $MFT::$DATA or was not read in full
+ * @throws CStructured_Exception if the read fails
+ */
+inline bool OverlappedNtfsMftReadPayload::read_mft_record(unsigned int frs, void* record) const
+{
+    const unsigned int record_size = index_->mft_record_size();
+    const unsigned long long virtual_offset = static_cast<unsigned long long>(frs) * record_size;
+
+    for (const ChunkDescriptor& chunk : data_chunks_)
+    {
+        const unsigned long long chunk_begin = chunk.vcn * cluster_size_;
+        const unsigned long long chunk_end = chunk_begin + chunk.cluster_count * cluster_size_;
+        if (virtual_offset < chunk_begin || virtual_offset + record_size > chunk_end)
+        {
+            continue;
+        }
+
+        const long long physical_offset =
+            chunk.lcn * static_cast<long long>(cluster_size_) + static_cast<long long>(virtual_offset - chunk_begin);
+
+        Handle event(CreateEvent(nullptr, TRUE, FALSE, nullptr));
+        OVERLAPPED overlapped = {};
+        overlapped.Offset = static_cast<unsigned long>(physical_offset);
+        overlapped.OffsetHigh = static_cast<unsigned long>(physical_offset >> (CHAR_BIT * sizeof(overlapped.Offset)));
+        overlapped.hEvent = reinterpret_cast<HANDLE>(reinterpret_cast<uintptr_t>(event.value) | 1);
+
+        void* const volume = index_->volume();
+        if (!ReadFile(volume, record, record_size, nullptr, &overlapped))
+        {
+            CheckAndThrow(GetLastError() == ERROR_IO_PENDING);
+        }
+        unsigned long transferred = 0;
+        CheckAndThrow(GetOverlappedResult(volume, &overlapped, &transferred, TRUE));
+        return transferred == record_size;
+    }
+
+    return false;
+}
+
 #endif // UFFS_MFT_READER_PIPELINE_HPP
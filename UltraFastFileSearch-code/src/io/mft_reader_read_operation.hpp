@@ -376,8 +376,8 @@ public:
      *    - Calculate skip ranges for all data chunks
      *
      * ## For Data Chunks:
-     * 1. Call preload_concurrent() for parallel pre-processing
-     * 2. Call load() to parse records and update index
+     * 1. Call preload_concurrent() and parse() for parallel pre-processing
+     * 2. Call load() to link the parsed records into the index
      *
      * @param size  Number of bytes read
      * @param key   Unused (IOCP completion key)
@@ -559,8 +559,10 @@ private:
      * @brief Processes a completed data chunk.
      *
      * Steps:
-     * 1. Call preload_concurrent() for parallel pre-processing
-     * 2. Call load() to parse MFT records and update index
+     * 1. Hash the chunk as read, for NtfsIndex::chunk_changed()
+     * 2. Call preload_concurrent() and parse() for parallel pre-processing
+     * 3. Call load() to link the parsed records into the index, or during a
+     *    re-scan refresh(), and finish_refresh() after the last chunk
      *
      * @param parent  Parent payload (for shared state)
      * @param buffer  Raw MFT record data from disk
@@ -573,16 +575,34 @@ private:
     {
         const unsigned long long chunk_virtual_offset = voffset();
 
+        // Hash before the fixup rewrites the sector ends
+        const uint64_t hash = mft_chunk_hash(buffer, size, skipped_begin(), skipped_end());
+
         // Pre-process in parallel (e.g., validate record signatures)
         parent->index_->preload_concurrent(chunk_virtual_offset, buffer, size);
 
-        // Parse records and update index (requires lock)
-        lock(parent->index_)->load(
-            chunk_virtual_offset,
-            buffer,
-            size,
-            skipped_begin(),
-            skipped_end());
+        // Parse in parallel as well; a re-scan stages raw records instead
+        NtfsIndex::Fragment fragment;
+        const bool refreshing = parent->index_->refreshing();
+        if (!refreshing)
+        {
+            parent->index_->parse(chunk_virtual_offset, buffer, size, fragment);
+        }
+
+        // Link the records into the index (requires lock)
+        lock_ptr<NtfsIndex> const index(parent->index_.get());
+        const bool changed = index->chunk_changed(chunk_virtual_offset - skipped_begin(), hash);
+        if (!refreshing)
+        {
+            index->load(fragment, skipped_begin(), skipped_end());
+        }
+        else if (index->refresh(chunk_virtual_offset, buffer, size, skipped_begin(), skipped_end(), changed))
+        {
+            index->finish_refresh([parent](unsigned int frs, void* record)
+            {
+                return parent->read_mft_record(frs, record);
+            });
+        }
     }
 };
 
@@ -0,0 +1,373 @@
+/**
+ * @file mft_refresh.hpp
+ * @brief Chunk hashes and record staging for re-scanning a loaded $MFT.
+ *
+ * A re-scan reads the whole $MFT again, but most of it has not changed
+ * since the last pass. Every data chunk is hashed as it arrives and
+ * compared with the hash from the previous pass; only records of chunks
+ * whose hash differs are handed to the index again:
+ *
+ * ```
+ *   chunk ──mft_chunk_hash()──► MftChunkHashes: same as last pass?
+ *                                   │yes                    │no
+ *                                   ▼                       ▼
+ *                       keep only the FRS → base     keep every record,
+ *                       map of multi-record files    mark their bases
+ *                                   │                       │
+ *                                   └──► MftRefreshSet ◄────┘
+ *                                            │ finish()
+ *                                            ▼
+ *                      base records to re-parse, with all their segments
+ * ```
+ *
+ * ## Extension Records
+ *
+ * A file whose attributes do not fit into one record is spread over a base
+ * record and extension records that may sit in other chunks. Re-parsing
+ * such a file needs every one of its records, including the ones in
+ * unchanged chunks. Those are not kept during the pass (that would mean
+ * holding every extension record of the volume); only their FRS and base
+ * are remembered, and missing_records() lists the few that have to be read
+ * again once the affected files are known.
+ *
+ * A record that was never read because its chunk is unchanged and it
+ * belongs to a single-record file is never re-parsed: whatever makes such
+ * a file change also rewrites its base record.
+ *
+ * @note No Windows dependencies, so this header can be unit-tested.
+ *
+ * @see index/ntfs_index_refresh.hpp for how the index applies a re-scan
+ */
+
+#ifndef UFFS_MFT_REFRESH_HPP
+#define UFFS_MFT_REFRESH_HPP
+
+#include "uffs_index_format.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace uffs {
+
+// ============================================================================
+// Chunk Hashes
+// ============================================================================
+
+/**
+ * @brief 64-bit hash of one $MFT::$DATA chunk as read from the volume.
+ *
+ * The skip ranges are part of the hash: a record at the edge of a chunk
+ * that is freed moves the skip range without necessarily changing the
+ * bytes that are still read.
+ *
+ * @param data           Bytes read (before the update sequence is removed)
+ * @param size           Bytes read
+ * @param skipped_begin  Bytes of the chunk not read before @p data
+ * @param skipped_end    Bytes of the chunk not read after @p data
+ */
+[[nodiscard]] inline uint64_t mft_chunk_hash(void const* data, size_t size,
+    unsigned long long skipped_begin, unsigned long long skipped_end) noexcept
+{
+    unsigned long long const skips[2] = { skipped_begin, skipped_end };
+    return uffs_index_checksum(data, size, uffs_index_checksum(skips, sizeof(skips)));
+}
+
+/**
+ * @class MftChunkHashes
+ * @brief Hash of every data chunk of the last completed pass, by chunk offset.
+ *
+ * Chunks are keyed by their byte offset within $MFT::$DATA. A chunk whose
+ * offset is not known (the $MFT grew or was defragmented) counts as changed.
+ */
+class MftChunkHashes
+{
+public:
+    /// True unless @p hash is what the chunk at @p chunk_offset hashed to last time.
+    [[nodiscard]] bool changed(unsigned long long chunk_offset, uint64_t hash) const
+    {
+        auto const i = hashes_.find(chunk_offset);
+        return i == hashes_.end() || i->second != hash;
+    }
+
+    void set(unsigned long long chunk_offset, uint64_t hash)
+    {
+        hashes_[chunk_offset] = hash;
+    }
+
+    [[nodiscard]] size_t size() const noexcept { return hashes_.size(); }
+
+private:
+    std::unordered_map<unsigned long long, uint64_t> hashes_;
+};
+
+// ============================================================================
+// Record Staging
+// ============================================================================
+
+/**
+ * @class MftRefreshSet
+ * @brief Collects the records of one re-scan and works out what to re-parse.
+ *
+ * Records must already have their update sequence removed; records that
+ * failed the check are expected to no longer carry the 'FILE' signature
+ * (NtfsIndex::preload_concurrent marks them 'BAAD'), so they count as free.
+ *
+ * ## Usage
+ *
+ * ```cpp
+ * MftRefreshSet set(record_size);
+ * set.add_chunk(offset, data, size, skipped_begin, skipped_end, changed);  // every chunk
+ * set.finish();
+ * for (unsigned int frs : set.missing_records())
+ * {
+ *     set.provide(frs, read_record(frs));
+ * }
+ * set.for_each_base([](unsigned int base, MftRefreshSet::Segments const& segments) { ... });
+ * ```
+ */
+class MftRefreshSet
+{
+public:
+    /// (FRS, record bytes) of every segment of a file, ascending by FRS.
+    using Segments = std::vector<std::pair<unsigned int, unsigned char const*>>;
+
+    explicit MftRefreshSet(unsigned int record_size)
+        : record_size_(record_size)
+    {
+    }
+
+    /**
+     * @brief Stages the records of one data chunk.
+     *
+     * Arguments are those of NtfsIndex::load(). Records of a changed chunk
+     * are all kept and their files marked for re-parsing, including the
+     * skipped records, which are free. Of an unchanged chunk only the
+     * extension records and the base records with an $ATTRIBUTE_LIST are
+     * noted, without their bytes.
+     */
+    void add_chunk(unsigned long long virtual_offset, unsigned char const* data, size_t size,
+        unsigned long long skipped_begin, unsigned long long skipped_end, bool changed)
+    {
+        if (changed)
+        {
+            changed_.emplace_back(static_cast<unsigned int>((virtual_offset - skipped_begin) / record_size_),
+                static_cast<unsigned int>((virtual_offset + size + skipped_end) / record_size_));
+        }
+
+        for (size_t i = static_cast<size_t>((record_size_ - virtual_offset % record_size_) % record_size_);
+            i + record_size_ <= size; i += record_size_)
+        {
+            unsigned char const* const record = data + i;
+            if (memcmp(record, "FILE", 4) != 0 || !(get16(record + 0x16) & 0x0001))
+            {
+                continue;
+            }
+
+            Segment segment = {};
+            segment.frs = static_cast<unsigned int>((virtual_offset + i) / record_size_);
+            segment.offset = kNoBytes;
+            segment.base = static_cast<unsigned int>(get64(record + 0x20) & 0x0000FFFFFFFFFFFFULL);
+            if (!segment.base)
+            {
+                segment.base = segment.frs;
+            }
+
+            if (changed)
+            {
+                segment.offset = bytes_.size();
+                bytes_.insert(bytes_.end(), record, record + record_size_);
+            }
+            else if (segment.base == segment.frs && !has_attribute_list(record))
+            {
+                continue;  // single-record file in an unchanged chunk
+            }
+            segments_.push_back(segment);
+        }
+    }
+
+    /// Sorts what was staged; call once after the last add_chunk().
+    void finish()
+    {
+        std::sort(changed_.begin(), changed_.end());
+        std::sort(segments_.begin(), segments_.end(), [](Segment const& a, Segment const& b)
+        {
+            return a.base != b.base ? a.base < b.base : a.frs < b.frs;
+        });
+
+        bases_.clear();
+        for (auto const& range : changed_)
+        {
+            for (unsigned int frs = range.first; frs < range.second; ++frs)
+            {
+                bases_.push_back(frs);
+            }
+        }
+        for (Segment const& segment : segments_)
+        {
+            if (segment.offset != kNoBytes && segment.base != segment.frs)
+            {
+                bases_.push_back(segment.base);  // extension record changed, base may not have
+            }
+        }
+        std::sort(bases_.begin(), bases_.end());
+        bases_.erase(std::unique(bases_.begin(), bases_.end()), bases_.end());
+    }
+
+    /// FRS of records that re-parsing needs but whose bytes were not kept.
+    [[nodiscard]] std::vector<unsigned int> missing_records() const
+    {
+        std::vector<unsigned int> result;
+        this->walk([&](unsigned int, Segment const* begin, Segment const* end)
+        {
+            for (Segment const* s = begin; s != end; ++s)
+            {
+                if (s->offset == kNoBytes)
+                {
+                    result.push_back(s->frs);
+                }
+            }
+        });
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+    /// Supplies one of missing_records(); @p record must be fixed up.
+    void provide(unsigned int frs, unsigned char const* record)
+    {
+        size_t const offset = bytes_.size();
+        bytes_.insert(bytes_.end(), record, record + record_size_);
+        for (Segment& segment : segments_)
+        {
+            if (segment.frs == frs && segment.offset == kNoBytes)
+            {
+                segment.offset = offset;
+            }
+        }
+    }
+
+    /**
+     * @brief Calls fn(base, segments) for every file to re-parse, ascending.
+     *
+     * Segments are empty when the base record is now free, is damaged or has
+     * become an extension record of another file, i.e. the file is gone.
+     * Files with a record that is still missing are left out.
+     */
+    template <class F>
+    void for_each_base(F&& fn) const
+    {
+        Segments segments;
+        this->walk([&](unsigned int base, Segment const* begin, Segment const* end)
+        {
+            segments.clear();
+            for (Segment const* s = begin; s != end; ++s)
+            {
+                if (s->offset == kNoBytes)
+                {
+                    return;
+                }
+                segments.emplace_back(s->frs, &bytes_[s->offset]);
+            }
+            fn(base, static_cast<Segments const&>(segments));
+        });
+    }
+
+    /// Number of files that for_each_base() visits or skips; valid after finish().
+    [[nodiscard]] size_t base_count() const noexcept { return bases_.size(); }
+
+private:
+    static constexpr size_t kNoBytes = ~static_cast<size_t>(0);
+
+    struct Segment
+    {
+        unsigned int frs;
+        unsigned int base;
+        size_t offset;  ///< Into bytes_, or kNoBytes
+    };
+
+    unsigned int record_size_;
+    std::vector<std::pair<unsigned int, unsigned int>> changed_;  ///< [first FRS, end FRS) of changed chunks
+    std::vector<Segment> segments_;
+    std::vector<unsigned int> bases_;
+    std::vector<unsigned char> bytes_;
+
+    static uint16_t get16(unsigned char const* p) noexcept { uint16_t v; memcpy(&v, p, sizeof(v)); return v; }
+    static uint32_t get32(unsigned char const* p) noexcept { uint32_t v; memcpy(&v, p, sizeof(v)); return v; }
+    static uint64_t get64(unsigned char const* p) noexcept { uint64_t v; memcpy(&v, p, sizeof(v)); return v; }
+
+    bool has_attribute_list(unsigned char const* record) const noexcept
+    {
+        size_t const end = std::min<size_t>(record_size_, get32(record + 0x18));
+        for (size_t offset = get16(record + 0x14); offset + 8 <= end;)
+        {
+            uint32_t const type = get32(record + offset);
+            uint32_t const length = get32(record + offset + 4);
+            if (type == 0x20)
+            {
+                return true;
+            }
+            if (type == 0xFFFFFFFF || type > 0x20 || length < 0x18 || length > end - offset)
+            {
+                break;  // attributes are sorted by type
+            }
+            offset += length;
+        }
+        return false;
+    }
+
+    /// Calls fn(base, first, last) with the staged segments of every base to re-parse.
+    template <class F>
+    void walk(F&& fn) const
+    {
+        for (unsigned int const base : bases_)
+        {
+            auto const range = std::equal_range(segments_.begin(), segments_.end(), Segment{ 0, base, 0 },
+                [](Segment const& a, Segment const& b) { return a.base < b.base; });
+            Segment const* const begin = segments_.data() + (range.first - segments_.begin());
+            Segment const* const end = segments_.data() + (range.second - segments_.begin());
+
+            // The base record itself decides whether the file still exists
+            if (find_frs(begin, end, base))
+            {
+                fn(base, begin, end);
+            }
+            else if (this->in_changed_chunk(base))
+            {
+                fn(base, end, end);  // free, damaged or now an extension record
+            }
+            // else: neither re-read nor noted, i.e. an unchanged single-record file
+        }
+    }
+
+    static bool find_frs(Segment const* begin, Segment const* end, unsigned int frs) noexcept
+    {
+        for (Segment const* s = begin; s != end; ++s)
+        {
+            if (s->frs == frs)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool in_changed_chunk(unsigned int frs) const noexcept
+    {
+        auto const i = std::upper_bound(changed_.begin(), changed_.end(),
+            std::make_pair(frs, ~0U));
+        return i != changed_.begin() && frs < (i - 1)->second;
+    }
+};
+
+} // namespace uffs
+
+// Expose at global scope for backward compatibility
+using uffs::mft_chunk_hash;
+using uffs::MftChunkHashes;
+using uffs::MftRefreshSet;
+
+#endif // UFFS_MFT_REFRESH_HPP
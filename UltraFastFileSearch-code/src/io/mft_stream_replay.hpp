@@ -0,0 +1,407 @@
+/**
+ * @file mft_stream_replay.hpp
+ * @brief Index build from a UFFS-MFT dump arriving on stdin or a named pipe.
+ *
+ * The streaming counterpart of MftDumpReplay: the dump is never staged on
+ * disk and never seeked, so a collection agent can pipe an MFT straight
+ * into the indexing host:
+ *
+ * ```
+ *   ssh host uffs --dump-mft=C --dump-mft-out=- --dump-mft-compress | uffs --index-from=- *.dll
+ * ```
+ *
+ * Transfer, decoding and parsing overlap instead of running in sequence:
+ *
+ * ```
+ *   reader thread:   next() next() next() ...              (stream order)
+ *                      │      │      │
+ *                      ▼      ▼      ▼
+ *   worker threads:  [decode] preload_concurrent() parse() (parallel, any order)
+ *                      │      │      │
+ *                      ▼      ▼      ▼
+ *   calling thread:  load(fragment)                        (in order)
+ * ```
+ *
+ * At most two slices per worker are in flight between the reader and
+ * load(), so memory use does not depend on the size of the MFT. load()
+ * runs the Preprocessor once the last record has arrived, exactly as it
+ * does for the other sources.
+ *
+ * Only streamable dumps can be read: uncompressed ones, and compressed
+ * ones with frame prefixes, which `--dump-mft` and `--generate-mft` write
+ * whenever their output cannot seek.
+ *
+ * ## Sources
+ *
+ * | --index-from        | Reads from                                            |
+ * |---------------------|-------------------------------------------------------|
+ * | `-`                 | stdin                                                 |
+ * | `\\.\pipe\<name>`   | a new named pipe; waits for one writer to connect     |
+ *
+ * @note The volume handle of the index is never opened, so init() must
+ *       not be called.
+ *
+ * @see uffs_mft_format.hpp for the streamed layout
+ * @see mft_dump_replay.hpp for dump files
+ */
+
+#ifndef UFFS_MFT_STREAM_REPLAY_HPP
+#define UFFS_MFT_STREAM_REPLAY_HPP
+
+#include "mft_reader_constants.hpp"
+#include "uffs_mft_codec.hpp"
+#include "uffs_mft_format.hpp"
+
+#include "util/error_utils.hpp"
+#include "util/handle.hpp"
+#include "util/intrusive_ptr.hpp"
+#include "util/lock_ptr.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "index/ntfs_index_fwd.hpp"
+
+namespace uffs {
+
+/**
+ * @class MftStreamReplay
+ * @brief Builds an NtfsIndex from a UFFS-MFT dump read front to back.
+ */
+class MftStreamReplay
+{
+public:
+    /// Bytes of records per slice of an uncompressed stream.
+    static constexpr size_t kSliceSize =
+        static_cast<size_t>(mft_reader_constants::kDefaultReadBlockSize);
+
+    /// Cluster size reported to the index (see MftDumpReplay).
+    static constexpr unsigned int kAssumedClusterSize = 4096;
+
+    /// True if @p name is a stream source rather than a dump file.
+    [[nodiscard]] static bool is_stream_name(char const* name) noexcept
+    {
+        return strcmp(name, "-") == 0 || _strnicmp(name, "\\\\.\\pipe\\", 9) == 0;
+    }
+
+    /**
+     * @brief Opens the source and reads the header.
+     *
+     * Blocks until the header has arrived, which for a named pipe includes
+     * waiting for the writer to connect.
+     *
+     * @param name  `-` or `\\.\pipe\<name>`
+     * @throws std::runtime_error if the source cannot be opened or does not
+     *         start with a streamable UFFS-MFT header
+     */
+    explicit MftStreamReplay(char const* name) : input_(nullptr)
+    {
+        try
+        {
+            if (strcmp(name, "-") == 0)
+            {
+                input_ = GetStdHandle(STD_INPUT_HANDLE);
+                CheckAndThrow(Handle::valid(input_));
+            }
+            else
+            {
+                HANDLE const pipe = CreateNamedPipeA(name, PIPE_ACCESS_INBOUND,
+                    PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT, 1, 0, 1 << 20, 0, nullptr);
+                CheckAndThrow(pipe != INVALID_HANDLE_VALUE);
+                Handle(pipe).swap(pipe_);
+                CheckAndThrow(ConnectNamedPipe(pipe_, nullptr) || GetLastError() == ERROR_PIPE_CONNECTED);
+                input_ = pipe_;
+            }
+
+            reader_.reset(new UffsMftStreamReader(
+                [this](void* data, size_t size) { return this->read(data, size); }, kSliceSize));
+        }
+        catch (CStructured_Exception& ex)
+        {
+            throw std::runtime_error("cannot read the stream (error " + std::to_string(ex.GetSENumber()) + ")");
+        }
+    }
+
+    [[nodiscard]] UffsMftHeader const& header() const noexcept { return reader_->header(); }
+
+    /// Root path of the volume the dump was taken from, or @p fallback.
+    [[nodiscard]] std::tvstring root_path(TCHAR const* fallback) const
+    {
+        if (!this->header().volume_letter)
+        {
+            return std::tvstring(fallback);
+        }
+
+        TCHAR const path[] = { static_cast<TCHAR>(this->header().volume_letter), _T(':'), _T('\\'), _T('\0') };
+        return std::tvstring(path);
+    }
+
+    /**
+     * @brief Reads the rest of the stream into @p index.
+     *
+     * Same contract as MftDumpReplay::operator(): the index's finished
+     * event is signaled on return, with get_finished() holding 0 or the
+     * error code. Can be called once.
+     *
+     * @tparam IndexType  NtfsIndex or HugeNtfsIndex
+     * @param index    Freshly constructed, empty index
+     * @param threads  Number of decode/preload workers (0 = hardware concurrency)
+     * @return 0 on success, ERROR_ARITHMETIC_OVERFLOW if the volume is too
+     *         large for the index width, another error code on failure
+     */
+    template <class IndexType>
+    unsigned int operator()(IndexType* index, unsigned int threads = 0)
+    {
+        unsigned int error_code = 0;
+        try
+        {
+            this->replay(index, threads);
+        }
+        catch (CStructured_Exception& ex)
+        {
+            error_code = ex.GetSENumber();
+        }
+        catch (std::bad_alloc&)
+        {
+            error_code = ERROR_NOT_ENOUGH_MEMORY;
+        }
+        catch (std::length_error&)
+        {
+            error_code = ERROR_ARITHMETIC_OVERFLOW;  // names past the index width (see HugeNtfsIndex)
+        }
+        catch (std::exception&)
+        {
+            error_code = ERROR_INVALID_DATA;
+        }
+
+        if (error_code || !this->header().record_count)
+        {
+            index->set_finished(error_code);
+        }
+
+        return error_code;
+    }
+
+private:
+    Handle pipe_;
+    HANDLE input_;  // stdin is borrowed, the pipe is owned by pipe_
+    std::unique_ptr<UffsMftStreamReader> reader_;
+
+    size_t read(void* data, size_t size)
+    {
+        DWORD n = 0;
+        if (!ReadFile(input_, data, static_cast<DWORD>(std::min<size_t>(size, 1U << 30)), &n, nullptr))
+        {
+            DWORD const error = GetLastError();
+            if (error != ERROR_BROKEN_PIPE && error != ERROR_HANDLE_EOF)
+            {
+                CppRaiseException(error);
+            }
+        }
+        return n;
+    }
+
+    template <class IndexType>
+    void replay(IndexType* index, unsigned int threads)
+    {
+        typedef UffsMftStreamReader::Slice Slice;
+        unsigned int const record_count = static_cast<unsigned int>(this->header().record_count);
+
+        // Geometry normally comes from FSCTL_GET_NTFS_VOLUME_DATA; see MftDumpReplay
+        index->set_mft_record_size(this->header().record_size);
+        index->set_mft_capacity(record_count);
+        index->set_cluster_size(kAssumedClusterSize);
+        index->reserve(record_count);
+
+        if (!threads)
+        {
+            threads = std::max(1U, std::thread::hardware_concurrency());
+        }
+
+        // Slice s lives in slot s % window from being read until it is loaded
+        size_t const window = static_cast<size_t>(threads) * 2;
+        std::vector<Slice> slots(window);
+        std::vector<typename IndexType::Fragment> fragments(window);
+        std::vector<bool> preloaded(window);
+
+        std::mutex mutex;
+        std::condition_variable slice_read, slice_ready, slice_loaded;
+        std::exception_ptr error;
+        size_t read_count = 0, next_to_decode = 0, next_to_load = 0;
+        bool end_of_stream = false;
+        bool stop = false;
+
+        auto const fail = [&]()
+        {
+            {
+                std::lock_guard<std::mutex> guard(mutex);
+                if (!error)
+                {
+                    error = std::current_exception();
+                }
+            }
+            slice_ready.notify_all();
+        };
+
+        auto const reader = [&]()
+        {
+            try
+            {
+                for (size_t s = 0;; ++s)
+                {
+                    {
+                        std::unique_lock<std::mutex> guard(mutex);
+                        slice_loaded.wait(guard, [&]() { return stop || s < next_to_load + window; });
+                        if (stop)
+                        {
+                            return;
+                        }
+                    }
+
+                    // The slot is free: slice s - window has been loaded
+                    bool const more = reader_->next(slots[s % window]);
+                    {
+                        std::lock_guard<std::mutex> guard(mutex);
+                        if (more)
+                        {
+                            read_count = s + 1;
+                        }
+                        else
+                        {
+                            end_of_stream = true;
+                        }
+                    }
+                    slice_read.notify_all();
+                    slice_ready.notify_all();
+                    if (!more)
+                    {
+                        return;
+                    }
+                }
+            }
+            catch (...)
+            {
+                fail();
+            }
+        };
+
+        auto const worker = [&]()
+        {
+            for (;;)
+            {
+                size_t s;
+                {
+                    std::unique_lock<std::mutex> guard(mutex);
+                    slice_read.wait(guard, [&]() { return stop || error || end_of_stream || next_to_decode < read_count; });
+                    if (stop || error || next_to_decode == read_count)
+                    {
+                        return;
+                    }
+                    s = next_to_decode++;
+                }
+
+                try
+                {
+                    Slice& slice = slots[s % window];
+                    UffsMftStreamReader::decode(slice);
+                    IndexType volatile* const shared = index;
+                    shared->preload_concurrent(slice.offset, slice.bytes.data(), slice.bytes.size());
+                    shared->parse(slice.offset, slice.bytes.data(), slice.bytes.size(), fragments[s % window]);
+                }
+                catch (...)
+                {
+                    fail();
+                }
+
+                {
+                    std::lock_guard<std::mutex> guard(mutex);
+                    preloaded[s % window] = true;
+                }
+                slice_ready.notify_all();
+            }
+        };
+
+        std::vector<std::thread> workers;
+        workers.reserve(threads + 1);
+
+        // Stop and join every thread on every exit path. The reader may be
+        // blocked in ReadFile() on a pipe that never delivers; cancel that read.
+        struct JoinAll
+        {
+            std::vector<std::thread>& workers;
+            std::mutex& mutex;
+            std::condition_variable& slice_read;
+            std::condition_variable& slice_loaded;
+            bool& stop;
+
+            ~JoinAll()
+            {
+                {
+                    std::lock_guard<std::mutex> guard(mutex);
+                    stop = true;
+                }
+                slice_read.notify_all();
+                slice_loaded.notify_all();
+                if (!workers.empty())
+                {
+                    CancelSynchronousIo(static_cast<HANDLE>(workers.front().native_handle()));
+                }
+                for (auto& w : workers)
+                {
+                    w.join();
+                }
+            }
+        } const join_all = { workers, mutex, slice_read, slice_loaded, stop };
+
+        workers.emplace_back(reader);
+        for (unsigned int t = 0; t < threads; ++t)
+        {
+            workers.emplace_back(worker);
+        }
+
+        for (size_t s = 0;; ++s)
+        {
+            {
+                std::unique_lock<std::mutex> guard(mutex);
+                slice_ready.wait(guard, [&]() { return preloaded[s % window] || error || (end_of_stream && s == read_count); });
+                if (error)
+                {
+                    std::rethrow_exception(error);
+                }
+                if (!preloaded[s % window])
+                {
+                    break;  // every record has been loaded
+                }
+            }
+
+            if (index->cancelled())
+            {
+                CppRaiseException(ERROR_CANCELLED);
+            }
+
+            lock(index)->load(fragments[s % window], 0, 0);
+
+            {
+                std::lock_guard<std::mutex> guard(mutex);
+                preloaded[s % window] = false;
+                next_to_load = s + 1;
+            }
+            slice_loaded.notify_all();
+        }
+    }
+};
+
+} // namespace uffs
+
+// Expose at global scope for backward compatibility
+using uffs::MftStreamReplay;
+
+#endif // UFFS_MFT_STREAM_REPLAY_HPP
@@ -0,0 +1,577 @@
+/**
+ * @file ntfs_image.hpp
+ * @brief Raw NTFS volume image reader that locates $MFT without Windows APIs.
+ *
+ * The live reader asks the file system where $MFT lives
+ * (FSCTL_GET_NTFS_VOLUME_DATA, FSCTL_GET_RETRIEVAL_POINTERS). A dd image of
+ * an NTFS volume has no file system driver behind it, so NtfsImage derives
+ * the same information from the on-disk structures:
+ *
+ * ```
+ *   $Boot (sector 0)            cluster size, record size, $MFT start LCN
+ *        │
+ *        ▼
+ *   $MFT record 0               unnamed $DATA / $BITMAP run lists
+ *        │                      (+ $ATTRIBUTE_LIST extension records)
+ *        ▼
+ *   $MFT::$BITMAP               which records are in use
+ *        │
+ *        ▼
+ *   read_plan()                 1 MB chunks with unused records trimmed
+ * ```
+ *
+ * Only the NTFS structure definitions in ntfs_types.hpp and
+ * mapping_pair_iterator are shared with the live reader; all I/O goes
+ * through a std::ifstream, so the reader also works on images copied to
+ * non-Windows forensic hosts.
+ *
+ * ## Fragmented $MFT
+ *
+ * When $MFT has too many extents for record 0, its run list is split over
+ * several attribute records listed in an $ATTRIBUTE_LIST. The extension
+ * records are themselves part of $MFT, so they are read through the
+ * extents known so far until every listed record has been found.
+ *
+ * ## Usage
+ *
+ * ```cpp
+ * NtfsImage image("volume.dd");
+ * std::vector<unsigned char> buffer;
+ * for (MftReadChunk const& chunk : image.read_plan())
+ * {
+ *     buffer.resize(chunk.read_clusters() * image.cluster_size());
+ *     image.read_chunk(chunk, buffer.data());
+ * }
+ * ```
+ *
+ * @note Reads are not synchronized; use one NtfsImage per thread.
+ *
+ * @see ntfs_image_replay.hpp for building an NtfsIndex from an image
+ * @see mft_reader_init.hpp for the live equivalent
+ */
+
+#ifndef UFFS_NTFS_IMAGE_HPP
+#define UFFS_NTFS_IMAGE_HPP
+
+#include "mft_read_plan.hpp"
+#include "mft_reader_constants.hpp"
+
+#include "core/ntfs_types.hpp"
+#include "index/mapping_pair_iterator.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace uffs {
+
+/**
+ * @class NtfsImage
+ * @brief Locates and reads $MFT in a raw NTFS volume image.
+ */
+class NtfsImage
+{
+public:
+    /// (next VCN, LCN) pairs, the same layout get_retrieval_pointers() returns.
+    using ExtentMap = MftExtentMap;
+
+    /**
+     * @brief Opens an image and bootstraps $MFT from its boot sector.
+     * @param path           Image file (a single volume, or a whole disk)
+     * @param volume_offset  Byte offset of the volume within the file,
+     *                       e.g. the partition start of a whole-disk image
+     * @throws std::runtime_error if the file cannot be read or is not a
+     *         consistent NTFS volume
+     */
+    explicit NtfsImage(char const* path, unsigned long long volume_offset = 0)
+        : file_(path, std::ios::in | std::ios::binary), volume_offset_(volume_offset)
+    {
+        if (!file_)
+        {
+            throw std::runtime_error("cannot open image");
+        }
+
+        this->read_boot_sector();
+        this->read_mft_attributes();
+        this->read_mft_bitmap();
+    }
+
+    [[nodiscard]] unsigned int cluster_size() const noexcept { return cluster_size_; }
+    [[nodiscard]] unsigned int mft_record_size() const noexcept { return record_size_; }
+    [[nodiscard]] unsigned int mft_capacity() const noexcept { return mft_capacity_; }
+    [[nodiscard]] long long mft_lcn() const noexcept { return mft_lcn_; }
+    [[nodiscard]] unsigned long long total_clusters() const noexcept { return total_clusters_; }
+    [[nodiscard]] unsigned long long volume_serial_number() const noexcept { return serial_; }
+
+    /// Extents of $MFT::$DATA, covering at least mft_capacity() records.
+    [[nodiscard]] ExtentMap const& mft_data_extents() const noexcept { return data_.extents; }
+
+    /// Extents of $MFT::$BITMAP (empty if the bitmap is resident).
+    [[nodiscard]] ExtentMap const& mft_bitmap_extents() const noexcept { return bitmap_.extents; }
+
+    /// One bit per record, (mft_capacity() + 7) / 8 bytes.
+    [[nodiscard]] std::vector<unsigned char> const& mft_bitmap() const noexcept { return bitmap_bits_; }
+
+    /**
+     * @brief Splits $MFT::$DATA into chunks of at most @p max_read bytes.
+     *
+     * Chunks stop after the cluster holding the last valid record and
+     * carry the skip ranges computed from the bitmap; see mft_read_plan.hpp.
+     */
+    [[nodiscard]] std::vector<MftReadChunk> read_plan(
+        unsigned long long max_read = mft_reader_constants::kDefaultReadBlockSize) const
+    {
+        unsigned long long const limit =
+            (static_cast<unsigned long long>(mft_capacity_) * record_size_ + cluster_size_ - 1) / cluster_size_;
+        std::vector<MftReadChunk> chunks = split_mft_extents(data_.extents, cluster_size_, limit, max_read);
+        trim_unused_mft_records(chunks, bitmap_bits_, cluster_size_, record_size_);
+        return chunks;
+    }
+
+    /**
+     * @brief Reads the unskipped clusters of @p chunk.
+     * @param buffer  At least chunk.read_clusters() * cluster_size() bytes
+     * @return Number of bytes read
+     */
+    size_t read_chunk(MftReadChunk const& chunk, void* buffer)
+    {
+        size_t const size = static_cast<size_t>(chunk.read_clusters() * cluster_size_);
+        if (size)
+        {
+            this->read(static_cast<unsigned long long>(chunk.lcn + static_cast<long long>(chunk.skip_begin)) * cluster_size_,
+                buffer, size);
+        }
+        return size;
+    }
+
+    /**
+     * @brief Reads @p size bytes at volume byte @p offset.
+     * @throws std::runtime_error if the image ends before offset + size
+     */
+    void read(unsigned long long offset, void* buffer, size_t size)
+    {
+        file_.clear();
+        file_.seekg(static_cast<std::streamoff>(volume_offset_ + offset));
+        file_.read(static_cast<char*>(buffer), static_cast<std::streamsize>(size));
+        if (!file_ || static_cast<size_t>(file_.gcount()) != size)
+        {
+            throw std::runtime_error("image is truncated");
+        }
+    }
+
+private:
+    /// One attribute record of a (possibly split) non-resident attribute.
+    struct Piece
+    {
+        long long lowest_vcn;
+        long long next_vcn;
+        ExtentMap runs;
+    };
+
+    /// Unnamed $DATA or $BITMAP of $MFT, collected from all its records.
+    struct Stream
+    {
+        std::vector<Piece> pieces;
+        ExtentMap extents;                     ///< Pieces merged from VCN 0
+        std::vector<unsigned char> resident;   ///< Value, if resident
+        bool is_resident = false;
+        bool has_sizes = false;                ///< Sizes seen (piece at VCN 0)
+        unsigned long long allocated_size = 0;
+        unsigned long long data_size = 0;
+        unsigned long long initialized_size = 0;
+    };
+
+    static constexpr unsigned long long kFrsMask = 0x0000FFFFFFFFFFFFULL;
+
+    std::ifstream file_;
+    unsigned long long volume_offset_;
+    unsigned int cluster_size_ = 0;
+    unsigned int record_size_ = 0;
+    unsigned int mft_capacity_ = 0;
+    long long mft_lcn_ = 0;
+    unsigned long long total_clusters_ = 0;
+    unsigned long long serial_ = 0;
+    Stream data_;
+    Stream bitmap_;
+    std::vector<unsigned char> bitmap_bits_;
+
+    [[noreturn]] static void corrupt(char const* what)
+    {
+        throw std::runtime_error(what);
+    }
+
+    void read_boot_sector()
+    {
+        unsigned char sector[sizeof(ntfs::BootSector)];
+        this->read(0, sector, sizeof(sector));
+        ntfs::BootSector boot;
+        memcpy(&boot, sector, sizeof(boot));
+
+        if (memcmp(boot.Oem, "NTFS    ", sizeof(boot.Oem)) != 0)
+        {
+            corrupt("not an NTFS volume (use --index-image-offset for whole-disk images)");
+        }
+        if (sector[510] != 0x55 || sector[511] != 0xAA)
+        {
+            corrupt("boot sector signature is missing");
+        }
+
+        unsigned int const sector_size = boot.BytesPerSector;
+        if (sector_size < 256 || sector_size > 4096 || (sector_size & (sector_size - 1)))
+        {
+            corrupt("boot sector has an invalid sector size");
+        }
+
+        // Values above 0x80 encode 2^(256 - n) sectors, used for clusters of 128 KB and up
+        unsigned int const spc_shift = boot.SectorsPerCluster > 0x80 ? 256U - boot.SectorsPerCluster : 0;
+        unsigned int const sectors_per_cluster = spc_shift ? (spc_shift < 16 ? 1U << spc_shift : 0) : boot.SectorsPerCluster;
+        if (!sectors_per_cluster || (sectors_per_cluster & (sectors_per_cluster - 1)) ||
+            sectors_per_cluster * sector_size > (2U << 20))
+        {
+            corrupt("boot sector has an invalid cluster size");
+        }
+        cluster_size_ = sectors_per_cluster * sector_size;
+
+        // Positive values count clusters, negative ones are a power of two
+        int const cpr = boot.ClustersPerFileRecordSegment;
+        unsigned long long const record_size = cpr >= 0
+            ? static_cast<unsigned long long>(cpr) * cluster_size_
+            : (-cpr < 31 ? 1ULL << -cpr : 0);
+        if (record_size < 512 || record_size > (64U << 10) || (record_size & (record_size - 1)))
+        {
+            corrupt("boot sector has an invalid file record size");
+        }
+        record_size_ = static_cast<unsigned int>(record_size);
+
+        total_clusters_ = boot.TotalSectors > 0 ? static_cast<unsigned long long>(boot.TotalSectors) / sectors_per_cluster : 0;
+        mft_lcn_ = boot.MftStartLcn;
+        if (mft_lcn_ <= 0 || static_cast<unsigned long long>(mft_lcn_) >= total_clusters_)
+        {
+            corrupt("$MFT start cluster is outside the volume");
+        }
+        serial_ = static_cast<unsigned long long>(boot.VolumeSerialNumber);
+    }
+
+    /// Reads [offset, offset + size) of a non-resident stream through @p extents.
+    /// @return false if part of the range is not covered by the extents
+    bool read_mapped(ExtentMap const& extents, unsigned long long offset, void* buffer, size_t size)
+    {
+        unsigned char* out = static_cast<unsigned char*>(buffer);
+        unsigned long long extent_starting_vcn = 0;
+        for (auto const& extent : extents)
+        {
+            if (!size)
+            {
+                break;
+            }
+
+            unsigned long long const begin = extent_starting_vcn * cluster_size_;
+            unsigned long long const end = extent.first * cluster_size_;
+            if (offset >= begin && offset < end)
+            {
+                size_t const n = static_cast<size_t>(std::min<unsigned long long>(size, end - offset));
+                this->read(static_cast<unsigned long long>(extent.second) * cluster_size_ + (offset - begin), out, n);
+                out += n;
+                offset += n;
+                size -= n;
+            }
+            extent_starting_vcn = extent.first;
+        }
+        return !size;
+    }
+
+    /// Reads and unfixes FILE record @p frs through the $MFT extents known so far.
+    /// @return false if the record is not mapped yet
+    bool read_record(unsigned long long frs, std::vector<unsigned char>& record)
+    {
+        record.resize(record_size_);
+        if (!this->read_mapped(data_.extents, frs * record_size_, record.data(), record.size()))
+        {
+            return false;
+        }
+
+        auto* const frsh = reinterpret_cast<ntfs::FileRecordSegmentHeader*>(record.data());
+        if (frsh->MultiSectorHeader.Magic != 'ELIF' ||
+            static_cast<size_t>(frsh->MultiSectorHeader.USAOffset) + frsh->MultiSectorHeader.USACount * 2U > record.size() ||
+            !frsh->MultiSectorHeader.unfixup(record.size()))
+        {
+            corrupt("$MFT record is damaged");
+        }
+        if (!(frsh->Flags & ntfs::FRH_IN_USE) || frsh->FirstAttributeOffset >= record.size())
+        {
+            corrupt("$MFT record is not in use");
+        }
+        return true;
+    }
+
+    /// Decodes the run list of one non-resident attribute record into @p stream.
+    void add_piece(Stream& stream, ntfs::AttributeRecordHeader const* ah)
+    {
+        if (ah->Length < offsetof(ntfs::AttributeRecordHeader, NonResident) + offsetof(
+                ntfs::AttributeRecordHeader::NonResidentData, CompressedSize) ||
+            ah->NonResident.MappingPairsOffset >= ah->Length ||
+            ah->NonResident.LowestVCN < 0 || ah->NonResident.HighestVCN < ah->NonResident.LowestVCN - 1)
+        {
+            corrupt("$MFT attribute header is damaged");
+        }
+
+        Piece piece = { ah->NonResident.LowestVCN, ah->NonResident.HighestVCN + 1, ExtentMap() };
+        mapping_pair_iterator mpi(ah, ah->Length);
+        for (mapping_pair_iterator::vcn_type current_vcn = mpi->next_vcn; !mpi.is_final(); current_vcn = mpi->next_vcn)
+        {
+            ++mpi;
+            if (mpi->next_vcn <= current_vcn || mpi->current_lcn <= 0 ||
+                static_cast<unsigned long long>(mpi->current_lcn + (mpi->next_vcn - current_vcn)) > total_clusters_)
+            {
+                corrupt("$MFT run list is damaged or sparse");
+            }
+            piece.runs.emplace_back(static_cast<unsigned long long>(mpi->next_vcn), mpi->current_lcn);
+        }
+        if ((piece.runs.empty() ? piece.lowest_vcn : static_cast<long long>(piece.runs.back().first)) != piece.next_vcn)
+        {
+            corrupt("$MFT run list does not match its VCN range");
+        }
+
+        if (piece.lowest_vcn == 0)
+        {
+            stream.has_sizes = true;
+            stream.allocated_size = static_cast<unsigned long long>(ah->NonResident.AllocatedSize);
+            stream.data_size = static_cast<unsigned long long>(ah->NonResident.DataSize);
+            stream.initialized_size = static_cast<unsigned long long>(ah->NonResident.InitializedSize);
+        }
+        stream.pieces.push_back(std::move(piece));
+    }
+
+    /// Rebuilds stream.extents from the pieces that are contiguous from VCN 0.
+    /// @return true if every piece was used
+    static bool merge_pieces(Stream& stream)
+    {
+        std::sort(stream.pieces.begin(), stream.pieces.end(),
+            [](Piece const& a, Piece const& b) { return a.lowest_vcn < b.lowest_vcn; });
+
+        stream.extents.clear();
+        long long next_vcn = 0;
+        size_t used = 0;
+        for (Piece const& piece : stream.pieces)
+        {
+            if (piece.lowest_vcn != next_vcn)
+            {
+                break;
+            }
+            stream.extents.insert(stream.extents.end(), piece.runs.begin(), piece.runs.end());
+            next_vcn = piece.next_vcn;
+            ++used;
+        }
+        return used == stream.pieces.size();
+    }
+
+    /**
+     * @brief Collects the unnamed $DATA and $BITMAP attributes of one $MFT record.
+     * @param list  Receives the $ATTRIBUTE_LIST value (base record only)
+     * @return true if the record has an $ATTRIBUTE_LIST
+     */
+    bool collect_attributes(std::vector<unsigned char> const& record, std::vector<unsigned char>* list)
+    {
+        auto const* const frsh = reinterpret_cast<ntfs::FileRecordSegmentHeader const*>(record.data());
+        unsigned char const* const frsh_end = static_cast<unsigned char const*>(frsh->end(record.size()));
+        bool has_list = false;
+
+        for (ntfs::AttributeRecordHeader const* ah = frsh->begin();; ah = ah->next())
+        {
+            unsigned char const* const p = reinterpret_cast<unsigned char const*>(ah);
+            if (p + sizeof(ah->Type) > frsh_end || ah->Type == ntfs::AttributeTypeCode::AttributeEnd)
+            {
+                break;
+            }
+            if (p + offsetof(ntfs::AttributeRecordHeader, Resident) > frsh_end ||
+                ah->Length < offsetof(ntfs::AttributeRecordHeader, Resident) + sizeof(ah->Resident) ||
+                ah->Length > static_cast<size_t>(frsh_end - p))
+            {
+                corrupt("$MFT attribute chain is damaged");
+            }
+            if (ah->NameLength)
+            {
+                continue;
+            }
+
+            Stream* stream = nullptr;
+            switch (ah->Type)
+            {
+            case ntfs::AttributeTypeCode::AttributeData: stream = &data_; break;
+            case ntfs::AttributeTypeCode::AttributeBitmap: stream = &bitmap_; break;
+            case ntfs::AttributeTypeCode::AttributeAttributeList:
+                if (list)
+                {
+                    has_list = true;
+                    this->read_value(ah, *list);
+                }
+                break;
+            default: break;
+            }
+
+            if (stream && ah->IsNonResident)
+            {
+                this->add_piece(*stream, ah);
+            }
+            else if (stream)
+            {
+                this->read_value(ah, stream->resident);
+                stream->is_resident = true;
+                stream->has_sizes = true;
+                stream->data_size = stream->initialized_size = stream->resident.size();
+            }
+        }
+        return has_list;
+    }
+
+    /// Reads the whole value of a resident or non-resident attribute.
+    void read_value(ntfs::AttributeRecordHeader const* ah, std::vector<unsigned char>& value)
+    {
+        if (!ah->IsNonResident)
+        {
+            if (static_cast<size_t>(ah->Resident.ValueOffset) + ah->Resident.ValueLength > ah->Length)
+            {
+                corrupt("$MFT resident attribute is damaged");
+            }
+            unsigned char const* const begin = static_cast<unsigned char const*>(ah->Resident.GetValue());
+            value.assign(begin, begin + ah->Resident.ValueLength);
+            return;
+        }
+
+        Stream stream;
+        this->add_piece(stream, ah);
+        if (stream.initialized_size > stream.allocated_size || stream.allocated_size > (64ULL << 20))
+        {
+            corrupt("$MFT attribute size is implausible");
+        }
+        merge_pieces(stream);
+        value.assign(static_cast<size_t>(stream.data_size), 0);
+        if (!this->read_mapped(stream.extents, 0, value.data(),
+                static_cast<size_t>(std::min(stream.initialized_size, stream.data_size))))
+        {
+            corrupt("$MFT attribute runs are shorter than its size");
+        }
+    }
+
+    /// FRS numbers of the extension records holding unnamed $DATA or $BITMAP pieces.
+    static std::vector<unsigned long long> extension_records(std::vector<unsigned char> const& list)
+    {
+        std::vector<unsigned long long> result;
+        size_t const min_entry = offsetof(ntfs::AttributeList, AlignmentOrReserved);
+        for (size_t offset = 0; offset + min_entry <= list.size();)
+        {
+            ntfs::AttributeList entry = {};
+            memcpy(&entry, &list[offset], std::min(sizeof(entry), list.size() - offset));
+            if (entry.Length < min_entry || entry.Length > list.size() - offset)
+            {
+                corrupt("$MFT attribute list is damaged");
+            }
+
+            unsigned long long const frs = entry.FileReferenceNumber & kFrsMask;
+            if (!entry.NameLength && frs &&
+                (entry.AttributeType == ntfs::AttributeTypeCode::AttributeData ||
+                 entry.AttributeType == ntfs::AttributeTypeCode::AttributeBitmap) &&
+                std::find(result.begin(), result.end(), frs) == result.end())
+            {
+                result.push_back(frs);
+            }
+            offset += entry.Length;
+        }
+        return result;
+    }
+
+    void read_mft_attributes()
+    {
+        // Record 0 starts at the boot sector's LCN; map just enough to read it
+        data_.extents.emplace_back((record_size_ + cluster_size_ - 1) / cluster_size_, mft_lcn_);
+
+        std::vector<unsigned char> record;
+        std::vector<unsigned char> list;
+        this->read_record(0, record);
+        std::vector<unsigned long long> pending;
+        if (this->collect_attributes(record, &list))
+        {
+            pending = extension_records(list);
+        }
+        merge_pieces(data_);
+
+        // Extension records live in $MFT itself: each one read may map more of it
+        while (!pending.empty())
+        {
+            size_t const before = pending.size();
+            for (size_t i = 0; i < pending.size();)
+            {
+                if (!this->read_record(pending[i], record))
+                {
+                    ++i;
+                    continue;
+                }
+                if ((reinterpret_cast<ntfs::FileRecordSegmentHeader const*>(record.data())->BaseFileRecordSegment &
+                        kFrsMask) != 0)
+                {
+                    corrupt("$MFT extension record belongs to another file");
+                }
+                this->collect_attributes(record, nullptr);
+                merge_pieces(data_);
+                pending.erase(pending.begin() + static_cast<ptrdiff_t>(i));
+            }
+            if (pending.size() == before)
+            {
+                corrupt("$MFT extension record is outside the mapped extents");
+            }
+        }
+
+        if (data_.is_resident || !data_.has_sizes || !merge_pieces(data_) || data_.extents.empty())
+        {
+            corrupt("$MFT::$DATA run list is incomplete");
+        }
+        if (!bitmap_.has_sizes || (!bitmap_.is_resident && !merge_pieces(bitmap_)))
+        {
+            corrupt("$MFT::$BITMAP is missing or incomplete");
+        }
+
+        unsigned long long const mapped = data_.extents.back().first * cluster_size_;
+        unsigned long long const capacity = std::min(data_.initialized_size, mapped) / record_size_;
+        if (!capacity || capacity > UINT_MAX)
+        {
+            corrupt("$MFT size is implausible");
+        }
+        mft_capacity_ = static_cast<unsigned int>(capacity);
+    }
+
+    void read_mft_bitmap()
+    {
+        size_t const bytes = (static_cast<size_t>(mft_capacity_) + 7) / 8;
+        if (bitmap_.is_resident)
+        {
+            bitmap_bits_ = bitmap_.resident;
+        }
+        else
+        {
+            // Bits beyond the initialized size read as zero, like the rest of the stream
+            size_t const stored = static_cast<size_t>(
+                std::min<unsigned long long>(std::min(bitmap_.initialized_size, bitmap_.data_size), bytes));
+            bitmap_bits_.assign(stored, 0);
+            if (!this->read_mapped(bitmap_.extents, 0, bitmap_bits_.data(), stored))
+            {
+                corrupt("$MFT::$BITMAP runs are shorter than its size");
+            }
+        }
+        bitmap_bits_.resize(bytes, 0);
+        if (mft_capacity_ % 8)
+        {
+            bitmap_bits_.back() &= static_cast<unsigned char>((1U << (mft_capacity_ % 8)) - 1);
+        }
+    }
+};
+
+} // namespace uffs
+
+// Expose at global scope for backward compatibility
+using uffs::NtfsImage;
+
+#endif // UFFS_NTFS_IMAGE_HPP
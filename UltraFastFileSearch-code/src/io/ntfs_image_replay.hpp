@@ -0,0 +1,263 @@
+/**
+ * @file ntfs_image_replay.hpp
+ * @brief Offline index build from a raw NTFS volume image.
+ *
+ * Feeds the $MFT of a dd-style image into an NtfsIndex the same way the
+ * live reader does: NtfsImage supplies the geometry, the $MFT::$BITMAP and
+ * a chunk list with unused records trimmed, and the chunks are passed to
+ * NtfsIndex::preload_concurrent() / NtfsIndex::load() with the same
+ * virtual offsets and skipped byte counts as OverlappedNtfsMftReadPayload.
+ *
+ * ## Pipeline
+ *
+ * ```
+ *   image file
+ *       │  sequential reads, unused clusters skipped
+ *       ▼
+ *   reader thread: read_chunk() + preload_concurrent()
+ *       │  at most kWindow chunks ahead
+ *       ▼
+ *   calling thread: load()                    (in $MFT order)
+ * ```
+ *
+ * Images usually sit on spinning disks or network shares, so one thread
+ * reads the chunks strictly in order while the calling thread parses the
+ * previous ones.
+ *
+ * ## Usage
+ *
+ * ```cpp
+ * intrusive_ptr<NtfsIndex> index(new NtfsIndex(_T("C:\\")));
+ * NtfsImageReplay replay("volume.dd");
+ * replay(index.get());   // blocks; finished_event() is signaled on return
+ * ```
+ *
+ * @note The volume handle of the index is never opened, so init() must
+ *       not be called.
+ *
+ * @see ntfs_image.hpp for how $MFT is located
+ * @see mft_dump_replay.hpp for the UFFS-MFT equivalent
+ */
+
+#ifndef UFFS_NTFS_IMAGE_REPLAY_HPP
+#define UFFS_NTFS_IMAGE_REPLAY_HPP
+
+#include "bitmap_utils.hpp"
+#include "mft_reader_constants.hpp"
+#include "ntfs_image.hpp"
+
+#include "util/error_utils.hpp"
+#include "util/intrusive_ptr.hpp"
+#include "util/lock_ptr.hpp"
+
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "index/ntfs_index_fwd.hpp"
+
+namespace uffs {
+
+/**
+ * @class NtfsImageReplay
+ * @brief Builds an NtfsIndex from the $MFT of a raw NTFS image.
+ */
+class NtfsImageReplay
+{
+public:
+    /// Chunks read ahead of load(), as many as the live reader keeps in flight.
+    static constexpr size_t kWindow = 2 * mft_reader_constants::kIoConcurrencyLevel;
+
+    /**
+     * @brief Opens an image and locates its $MFT.
+     * @throws std::runtime_error if the image is not a readable NTFS volume
+     */
+    explicit NtfsImageReplay(char const* path, unsigned long long volume_offset = 0)
+        : image_(path, volume_offset)
+    {
+    }
+
+    [[nodiscard]] NtfsImage const& image() const noexcept { return image_; }
+
+    /**
+     * @brief Replays every in-use record into @p index.
+     *
+     * The index's finished event is signaled on return, with
+     * get_finished() holding 0 or the error code.
+     *
+     * @tparam IndexType  NtfsIndex or HugeNtfsIndex
+     * @param index  Freshly constructed, empty index
+     * @return 0 on success, ERROR_ARITHMETIC_OVERFLOW if the volume is too
+     *         large for the index width, another error code on failure
+     */
+    template <class IndexType>
+    unsigned int operator()(IndexType* index)
+    {
+        unsigned int error_code = 0;
+        try
+        {
+            this->replay(index);
+        }
+        catch (CStructured_Exception& ex)
+        {
+            error_code = ex.GetSENumber();
+        }
+        catch (std::bad_alloc&)
+        {
+            error_code = ERROR_NOT_ENOUGH_MEMORY;
+        }
+        catch (std::length_error&)
+        {
+            error_code = ERROR_ARITHMETIC_OVERFLOW;  // names past the index width (see HugeNtfsIndex)
+        }
+        catch (std::exception&)
+        {
+            error_code = ERROR_INVALID_DATA;
+        }
+
+        if (error_code)
+        {
+            index->set_finished(error_code);
+        }
+
+        return error_code;
+    }
+
+private:
+    NtfsImage image_;
+
+    template <class IndexType>
+    void replay(IndexType* index)
+    {
+        unsigned int const cluster_size = image_.cluster_size();
+        std::vector<unsigned char> const& bitmap = image_.mft_bitmap();
+
+        // Geometry normally comes from FSCTL_GET_NTFS_VOLUME_DATA.
+        // The MFT zone and reserved clusters are not recorded on disk and left at 0.
+        index->set_mft_record_size(image_.mft_record_size());
+        index->set_mft_capacity(image_.mft_capacity());
+        index->set_cluster_size(cluster_size);
+        index->reserve(bitmap_utils::count_bits_in_buffer(bitmap.data(), bitmap.size()));
+
+        std::vector<MftReadChunk> const chunks = image_.read_plan();
+
+        std::mutex mutex;
+        std::condition_variable chunk_ready, chunk_loaded;
+        std::vector<std::unique_ptr<unsigned char[]>> buffers(chunks.size());
+        std::vector<bool> ready(chunks.size());
+        std::exception_ptr reader_error;
+        size_t next_to_load = 0;
+        bool stop = false;
+
+        auto const reader = [&]()
+        {
+            for (size_t c = 0; c < chunks.size(); ++c)
+            {
+                {
+                    std::unique_lock<std::mutex> guard(mutex);
+                    chunk_loaded.wait(guard, [&]() { return stop || c < next_to_load + kWindow; });
+                    if (stop)
+                    {
+                        return;
+                    }
+                }
+
+                try
+                {
+                    MftReadChunk const& chunk = chunks[c];
+                    size_t const size = static_cast<size_t>(chunk.read_clusters() * cluster_size);
+                    std::unique_ptr<unsigned char[]> buffer(new unsigned char[size ? size : 1]);
+                    image_.read_chunk(chunk, buffer.get());
+                    if (size)
+                    {
+                        static_cast<IndexType volatile*>(index)->preload_concurrent(
+                            (chunk.vcn + chunk.skip_begin) * cluster_size, buffer.get(), size);
+                    }
+
+                    std::lock_guard<std::mutex> guard(mutex);
+                    buffers[c] = std::move(buffer);
+                    ready[c] = true;
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> guard(mutex);
+                    reader_error = std::current_exception();
+                }
+                chunk_ready.notify_all();
+                if (reader_error)
+                {
+                    return;
+                }
+            }
+        };
+
+        std::thread thread;
+
+        // Stop and join the reader on every exit path, including exceptions from load()
+        struct JoinReader
+        {
+            std::thread& thread;
+            std::mutex& mutex;
+            std::condition_variable& chunk_loaded;
+            bool& stop;
+
+            ~JoinReader()
+            {
+                {
+                    std::lock_guard<std::mutex> guard(mutex);
+                    stop = true;
+                }
+                chunk_loaded.notify_all();
+                if (thread.joinable())
+                {
+                    thread.join();
+                }
+            }
+        } const join_reader = { thread, mutex, chunk_loaded, stop };
+
+        thread = std::thread(reader);
+
+        for (size_t c = 0; c < chunks.size(); ++c)
+        {
+            {
+                std::unique_lock<std::mutex> guard(mutex);
+                chunk_ready.wait(guard, [&]() { return ready[c] || reader_error; });
+                if (!ready[c])
+                {
+                    std::rethrow_exception(reader_error);
+                }
+            }
+
+            if (index->cancelled())
+            {
+                CppRaiseException(ERROR_CANCELLED);
+            }
+
+            MftReadChunk const& chunk = chunks[c];
+            lock(index)->load(
+                (chunk.vcn + chunk.skip_begin) * cluster_size,
+                buffers[c].get(),
+                static_cast<size_t>(chunk.read_clusters() * cluster_size),
+                chunk.skip_begin * cluster_size,
+                chunk.skip_end * cluster_size);
+
+            {
+                std::lock_guard<std::mutex> guard(mutex);
+                buffers[c].reset();
+                next_to_load = c + 1;
+            }
+            chunk_loaded.notify_all();
+        }
+    }
+};
+
+} // namespace uffs
+
+// Expose at global scope for backward compatibility
+using uffs::NtfsImageReplay;
+
+#endif // UFFS_NTFS_IMAGE_REPLAY_HPP
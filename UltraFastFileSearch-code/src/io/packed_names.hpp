@@ -0,0 +1,208 @@
+/**
+ * @file packed_names.hpp
+ * @brief A names pool kept as independently decodable LZ4 blocks.
+ *
+ * The index addresses every name by its offset into one character pool.
+ * PackedNames keeps such a pool in 4 KB blocks, each an LZ4 block of its
+ * own, so a reader decodes only the block a name lives in:
+ *
+ * ```
+ *   pool      [ block 0: 2048 chars ][ block 1: 2048 chars ][ block 2 ]...
+ *                  │ lz4                  │ lz4                │ raw
+ *   packed    [ 1.3 KB ][ 1.1 KB ][ 4 KB ]...        starts: 0, 1331, 2475, ...
+ *
+ *   at(offset, count, cursor) ──► block offset / 2048 ──► cursor slot block % 16
+ * ```
+ *
+ * - Every block is its own LZ4 window, so the earlier names of a block
+ *   are the dictionary of the later ones. Sibling names are laid out next
+ *   to each other, and share most of their extensions and prefixes.
+ * - A Cursor keeps the last 16 blocks it decoded, one per slot (block
+ *   number modulo 16), each with the next block when a name runs across
+ *   its end. A reader going through the pool in order, as the Matcher
+ *   does, decodes each block once; interned repeats that point back at a
+ *   recent block find it still decoded.
+ * - A pointer from at() is valid until the next at() with the same cursor.
+ * - Blocks that do not compress are stored raw, as UFFS-MFT frames are.
+ *
+ * @note No Windows dependencies, so this header can be unit-tested.
+ *
+ * @see lz4_block.hpp for the block codec
+ */
+
+#ifndef UFFS_PACKED_NAMES_HPP
+#define UFFS_PACKED_NAMES_HPP
+
+#include "lz4_block.hpp"
+#include "uffs_mft_codec.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace uffs {
+
+/**
+ * @class PackedNames
+ * @brief A read-only character pool in independently decodable LZ4 blocks.
+ *
+ * @tparam Char  Element type of the pool (TCHAR for the index)
+ */
+template <class Char>
+class PackedNames
+{
+public:
+    static constexpr size_t kBlockChars = 4096 / sizeof(Char);  ///< 4 KB of pool per block
+    static constexpr unsigned int kHashLog = 12;                ///< LZ4 match table for a 4 KB block
+
+    static constexpr size_t kCursorSlots = 16;                  ///< Blocks a Cursor keeps decoded
+
+    /// The blocks one reader has decoded; one per reader (thread, iterator).
+    class Cursor
+    {
+        friend class PackedNames;
+        struct Slot
+        {
+            std::vector<Char> decoded;   // up to two consecutive blocks
+            size_t block = ~size_t();    // first block in decoded
+            size_t blocks = 0;           // blocks in decoded
+        };
+        Slot slots_[kCursorSlots];       // block b goes to slot b % kCursorSlots
+    };
+
+    /**
+     * @brief Replaces the contents with the @p count characters at @p chars.
+     *
+     * @param threads  Threads to compress on; 0 for one per core
+     */
+    void pack(Char const* const chars, size_t const count, unsigned int const threads = 0)
+    {
+        size_t const blocks = (count + kBlockChars - 1) / kBlockChars;
+        std::vector<std::vector<unsigned char> > encoded(blocks);
+        parallel_for_each_index(blocks, threads, [&](size_t const b)
+        {
+            unsigned char const* const raw = reinterpret_cast<unsigned char const*>(chars + b * kBlockChars);
+            size_t const size = block_chars(b, count) * sizeof(Char);
+            std::vector<unsigned char>& out = encoded[b];
+            out.resize(lz4::compress_bound(size));
+            size_t const n = lz4::compress(raw, size, out.data(), out.size(), kHashLog);
+            if (n && n < size)
+            {
+                out.resize(n);
+            }
+            else
+            {
+                out.assign(raw, raw + size);  // incompressible: store raw
+            }
+        });
+
+        size_t total = 0;
+        for (auto const& block : encoded)
+        {
+            total += block.size();
+        }
+        std::vector<unsigned char> packed;
+        std::vector<size_t> starts;
+        packed.reserve(total);
+        starts.reserve(blocks + 1);
+        for (auto& block : encoded)
+        {
+            starts.push_back(packed.size());
+            packed.insert(packed.end(), block.begin(), block.end());
+            std::vector<unsigned char>().swap(block);
+        }
+        starts.push_back(packed.size());
+
+        this->packed_.swap(packed);
+        this->starts_.swap(starts);
+        this->size_ = count;
+    }
+
+    /// Number of characters in the pool.
+    [[nodiscard]] size_t size() const noexcept
+    {
+        return this->size_;
+    }
+
+    /// Bytes the pool takes: the blocks and where each one starts.
+    [[nodiscard]] size_t bytes() const noexcept
+    {
+        return this->packed_.capacity() + this->starts_.capacity() * sizeof(size_t);
+    }
+
+    /**
+     * @brief The @p count characters at @p offset, decoded through @p cursor.
+     *
+     * @param count  At most kBlockChars + 1, so the range touches two blocks at most
+     * @return Pointer valid until the next call with @p cursor
+     * @throws std::out_of_range if the range is outside the pool or too long
+     * @throws std::runtime_error if a block does not decode (memory corruption)
+     */
+    [[nodiscard]] Char const* at(size_t const offset, size_t const count, Cursor& cursor) const
+    {
+        static Char const empty[1] = {};
+        if (!count)
+        {
+            return empty;
+        }
+
+        size_t const block = offset / kBlockChars;
+        size_t const last = (offset + count - 1) / kBlockChars;
+        if (offset + count > this->size_ || last - block > 1)
+        {
+            throw std::out_of_range("packed names range");
+        }
+        typename Cursor::Slot& slot = cursor.slots_[block % kCursorSlots];
+        if (slot.block != block)
+        {
+            slot.blocks = 0;
+            slot.block = block;
+        }
+        while (slot.blocks <= last - block)
+        {
+            this->decode(block + slot.blocks, slot);
+            ++slot.blocks;
+        }
+        return slot.decoded.data() + (offset - block * kBlockChars);
+    }
+
+private:
+    std::vector<unsigned char> packed_;  // the blocks back to back
+    std::vector<size_t> starts_;         // where each block starts in packed_, then the end
+    size_t size_ = 0;
+
+    static size_t block_chars(size_t const b, size_t const count) noexcept
+    {
+        return std::min(kBlockChars, count - b * kBlockChars);
+    }
+
+    /// Decodes block @p b behind the blocks @p slot already holds.
+    void decode(size_t const b, typename Cursor::Slot& slot) const
+    {
+        if (slot.decoded.empty())
+        {
+            slot.decoded.resize(2 * kBlockChars);
+        }
+        unsigned char* const out = reinterpret_cast<unsigned char*>(slot.decoded.data() + slot.blocks * kBlockChars);
+        unsigned char const* const encoded = this->packed_.data() + this->starts_[b];
+        size_t const encoded_size = this->starts_[b + 1] - this->starts_[b];
+        size_t const size = block_chars(b, this->size_) * sizeof(Char);
+        if (encoded_size == size)
+        {
+            memcpy(out, encoded, size);
+        }
+        else if (!lz4::decompress(encoded, encoded_size, out, size))
+        {
+            throw std::runtime_error("packed names block does not decode");
+        }
+    }
+};
+
+} // namespace uffs
+
+// Expose at global scope for backward compatibility
+using uffs::PackedNames;
+
+#endif // UFFS_PACKED_NAMES_HPP
@@ -0,0 +1,156 @@
+/**
+ * @file subtree_totals.hpp
+ * @brief The arithmetic of directory totals: per-link shares, children sums, deltas.
+ *
+ * The $I30 stream of every directory holds the sizes of its whole subtree.
+ * The Preprocessor computes them in one walk; NtfsIndex::Patcher keeps them
+ * up to date when a finished index changes, by withdrawing a file's old
+ * share from every ancestor and adding its new one:
+ *
+ * ```
+ *   file with n links ──add_link_share()──► share of link i, per stream
+ *                                              │
+ *   directory: children_totals(shares) ◄───────┘   bulkiness: drop >= 1%
+ *                                              │
+ *   edit: apply_delta(ancestor $I30, share, withdraw) up to the root
+ * ```
+ *
+ * - A value split over n links gives link i `value * (i + 1) / n - value * i / n`,
+ *   so the shares of all links add up to the value exactly.
+ * - A WofCompressedData stream adds no length; its allocation is merged
+ *   into the default stream once (merge_wof()) and then counts only there.
+ * - Bulkiness leaves out children of 1% or more of a directory's
+ *   allocation. That is not additive, so patched bulkiness is an
+ *   approximation until the next rebuild; length, allocated and treesize
+ *   stay exact.
+ *
+ * The functions are templates on the size and stream types, so the index
+ * passes its SizeInfo and StreamInfo and the tests pass plain structs with
+ * the same members.
+ *
+ * @note No Windows dependencies, so this header can be unit-tested.
+ *
+ * @see index/ntfs_index_preprocess.hpp and index/ntfs_index_patch.hpp for the users
+ */
+
+#ifndef UFFS_SUBTREE_TOTALS_HPP
+#define UFFS_SUBTREE_TOTALS_HPP
+
+#include <cstddef>
+#include <vector>
+
+namespace uffs {
+
+/**
+ * @brief The part of @p value that link @p i of @p n carries.
+ *
+ * @param value  Size of the file
+ * @param i      Link, 0 .. n-1
+ * @param n      Number of links of the file
+ */
+[[nodiscard]] inline unsigned long long link_share(unsigned long long const value,
+    unsigned short const i, unsigned short const n) noexcept
+{
+    return value * (i + 1) / n - value * i / n;
+}
+
+/**
+ * @brief Adds what stream @p k of a file passes to the parent of link @p i of @p n.
+ *
+ * A directory's $I30 stream (type_name_id 0) passes its treesize, which
+ * already counts the subtree; every other stream counts as one.
+ *
+ * @param to      Share of the link so far
+ * @param k       The stream, with length, allocated, bulkiness, treesize,
+ *                type_name_id and is_allocated_size_accounted_for_in_main_stream
+ * @param is_wof  @p k is the WofCompressedData stream of its file
+ */
+template <class Sizes, class Stream>
+inline void add_link_share(Sizes& to, Stream const& k, bool const is_wof,
+    unsigned short const i, unsigned short const n)
+{
+    to.length += link_share(is_wof ? 0ULL : static_cast<unsigned long long>(k.length), i, n);
+    to.allocated += link_share(k.is_allocated_size_accounted_for_in_main_stream
+        ? 0ULL : static_cast<unsigned long long>(k.allocated), i, n);
+    to.bulkiness += link_share(static_cast<unsigned long long>(k.bulkiness), i, n);
+    to.treesize += k.type_name_id ? 1U : static_cast<unsigned int>(k.treesize);
+}
+
+/**
+ * @brief What a directory's $I30 stream adds for its children.
+ *
+ * @param shares  Share of each link that has the directory as its parent
+ * @return Their sum, with bulkiness leaving out shares of 1% or more of the allocation
+ */
+template <class Sizes>
+[[nodiscard]] inline Sizes children_totals(std::vector<Sizes> const& shares)
+{
+    Sizes result = Sizes();
+    for (size_t s = 0; s != shares.size(); ++s)
+    {
+        result.length += shares[s].length;
+        result.allocated += shares[s].allocated;
+        result.bulkiness += shares[s].bulkiness;
+        result.treesize += shares[s].treesize;
+    }
+
+    unsigned long long const threshold = static_cast<unsigned long long>(result.allocated) / 100;
+    for (size_t s = 0; s != shares.size(); ++s)
+    {
+        if (static_cast<unsigned long long>(shares[s].bulkiness) >= threshold)
+        {
+            result.bulkiness -= shares[s].bulkiness;
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief Adds @p delta to the totals @p total, or withdraws it.
+ */
+template <class Sizes, class Delta>
+inline void apply_delta(Sizes& total, Delta const& delta, bool const withdraw)
+{
+    if (withdraw)
+    {
+        total.length -= delta.length;
+        total.allocated -= delta.allocated;
+        total.bulkiness -= delta.bulkiness;
+        total.treesize -= delta.treesize;
+    }
+    else
+    {
+        total.length += delta.length;
+        total.allocated += delta.allocated;
+        total.bulkiness += delta.bulkiness;
+        total.treesize += delta.treesize;
+    }
+}
+
+/**
+ * @brief Folds the allocation of a WofCompressedData stream into the default stream, once.
+ *
+ * @return true if @p wof had not been merged before
+ */
+template <class Stream>
+inline bool merge_wof(Stream& default_stream, Stream& wof)
+{
+    if (wof.is_allocated_size_accounted_for_in_main_stream)
+    {
+        return false;
+    }
+    wof.is_allocated_size_accounted_for_in_main_stream = 1;
+    default_stream.allocated += wof.allocated;
+    return true;
+}
+
+} // namespace uffs
+
+// Expose at global scope for backward compatibility
+using uffs::link_share;
+using uffs::add_link_share;
+using uffs::children_totals;
+using uffs::apply_delta;
+using uffs::merge_wof;
+
+#endif // UFFS_SUBTREE_TOTALS_HPP
@@ -0,0 +1,1268 @@
+/**
+ * @file synthetic_mft.hpp
+ * @brief Deterministic generator of synthetic NTFS MFTs in UFFS-MFT format.
+ *
+ * Produces FILE record segments that NtfsIndex parses exactly like records
+ * read from a real volume, so load(), the preprocessor and the matcher can
+ * be measured at any scale without shipping customer MFTs around.
+ *
+ * ## What Gets Generated
+ *
+ * | FRS       | Contents                                                   |
+ * |-----------|------------------------------------------------------------|
+ * | 0 - 11    | $MFT ... $Extend metafiles, root directory at FRS 5        |
+ * | 12 - 23   | Formatted but unused (reserved, as on a fresh volume)      |
+ * | 24 - N-1  | User tree: directories first, then interleaved files       |
+ *
+ * Every in-use record carries:
+ * - `$STANDARD_INFORMATION` (72-byte NTFS 3.x form)
+ * - one Win32 `$FILE_NAME`, plus optionally a DOS 8.3 name and a second
+ *   hard link in another directory
+ * - an unnamed `$DATA` stream, resident for small files and non-resident
+ *   with real mapping pairs (one or two runs) otherwise
+ * - optionally a resident `Zone.Identifier` alternate data stream
+ * - for directories, `$I30` `$INDEX_ROOT`, and `$INDEX_ALLOCATION` plus
+ *   `$BITMAP` when the directory is too large for the root alone
+ *
+ * Records are protected with a proper update sequence array, so
+ * `MULTI_SECTOR_HEADER::unfixup()` succeeds on every one of them.
+ *
+ * ## Tree Shape
+ *
+ * User records are numbered as tree nodes m = 1, 2, ... (node 0 is the
+ * root). The first D = (nodes - 1) / fanout + 1 nodes are directories.
+ * A node's parent depends only on its number:
+ *
+ * - **balanced**: parent(m) = (m - 1) / fanout, a complete fanout-ary tree
+ * - **random**:   parent(m) is a random node in [0, (m - 1) / fanout], which
+ *   gives a skewed tree with a few very large and many small directories
+ *
+ * Either way every record can be produced on its own, so generation runs on
+ * all cores and the output only depends on the options, never on the
+ * thread count. Names end with the node number in base 36, which keeps
+ * them unique within each directory.
+ *
+ * ## Usage
+ *
+ * ```cpp
+ * SyntheticMftOptions options;
+ * parse_synthetic_mft_options("records=10000000,fanout=32,unicode=0.1", options);
+ * SyntheticMftGenerator generator(options);
+ * std::ofstream out("synthetic.uffs", std::ios::binary);
+ * write_synthetic_uffs_mft(generator, out, true);  // LZ4 frames
+ * ```
+ *
+ * @note No Windows dependencies, so this header can be unit-tested.
+ *
+ * @see uffs_mft_format.hpp for the file layout
+ * @see mft_dump_replay.hpp for building an index from the output
+ */
+
+#ifndef UFFS_SYNTHETIC_MFT_HPP
+#define UFFS_SYNTHETIC_MFT_HPP
+
+#include "uffs_mft_codec.hpp"
+#include "uffs_mft_format.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace uffs {
+
+// ============================================================================
+// Options
+// ============================================================================
+
+/// How parents are assigned to generated nodes.
+enum class SyntheticTreeShape
+{
+    Balanced,   ///< Complete fanout-ary tree
+    Random,     ///< Random parent among the earlier directories
+};
+
+/**
+ * @brief Knobs of the synthetic MFT generator.
+ *
+ * The defaults resemble a typical Windows system volume.
+ */
+struct SyntheticMftOptions
+{
+    uint64_t record_count = 1 << 20;        ///< Total records, metafiles included
+    uint32_t record_size = 1024;            ///< 1024 or 4096
+    uint32_t cluster_size = 4096;           ///< Used for allocation sizes and runs
+    uint64_t seed = 1;                      ///< Same seed, same output
+    SyntheticTreeShape shape = SyntheticTreeShape::Random;
+    uint32_t fanout = 16;                   ///< Average children per directory
+    uint32_t name_length_min = 4;           ///< Shortest name stem in characters
+    uint32_t name_length_max = 24;          ///< Longest name stem in characters
+    double unicode_ratio = 0.05;            ///< Names with non-ASCII characters
+    double hardlink_ratio = 0.01;           ///< Files with a second hard link
+    double dos_name_ratio = 0.3;            ///< Long names that also get an 8.3 name
+    double ads_ratio = 0.02;                ///< Files with a Zone.Identifier stream
+    double free_ratio = 0.0;                ///< File records left not in use
+    uint64_t max_file_size = 1ULL << 32;    ///< File sizes are log-uniform below this
+};
+
+/// First record number of the user tree (0 - 23 are reserved by NTFS).
+static constexpr uint32_t kSyntheticFirstUserRecord = 24;
+
+/// FRS of the root directory.
+static constexpr uint32_t kSyntheticRootRecord = 5;
+
+/**
+ * @brief Parses a comma-separated `key=value` list into @p options.
+ *
+ * Keys: records, record_size, cluster_size, seed, shape (balanced|random),
+ * fanout, names (min..max), unicode, hardlinks, dos, ads, free, max_size.
+ * Unmentioned options keep their current values.
+ *
+ * @return nullptr on success, otherwise a description of the problem
+ */
+[[nodiscard]] inline char const* parse_synthetic_mft_options(std::string const& spec, SyntheticMftOptions& options)
+{
+    auto const parse_u64 = [](std::string const& s, uint64_t& out)
+    {
+        char* end = nullptr;
+        out = strtoull(s.c_str(), &end, 0);
+        return !s.empty() && *end == '\0';
+    };
+    auto const parse_ratio = [](std::string const& s, double& out)
+    {
+        char* end = nullptr;
+        out = strtod(s.c_str(), &end);
+        return !s.empty() && *end == '\0' && out >= 0.0 && out <= 1.0;
+    };
+
+    SyntheticMftOptions result = options;
+    for (size_t begin = 0; begin < spec.size();)
+    {
+        size_t end = spec.find(',', begin);
+        if (end == std::string::npos)
+        {
+            end = spec.size();
+        }
+        std::string const item = spec.substr(begin, end - begin);
+        begin = end + 1;
+        if (item.empty())
+        {
+            continue;
+        }
+
+        size_t const eq = item.find('=');
+        if (eq == std::string::npos)
+        {
+            return "expected key=value";
+        }
+        std::string const key = item.substr(0, eq);
+        std::string const value = item.substr(eq + 1);
+
+        uint64_t n = 0;
+        bool ok = true;
+        if (key == "records")
+        {
+            ok = parse_u64(value, result.record_count);
+        }
+        else if (key == "record_size")
+        {
+            ok = parse_u64(value, n);
+            result.record_size = static_cast<uint32_t>(n);
+        }
+        else if (key == "cluster_size")
+        {
+            ok = parse_u64(value, n);
+            result.cluster_size = static_cast<uint32_t>(n);
+        }
+        else if (key == "seed")
+        {
+            ok = parse_u64(value, result.seed);
+        }
+        else if (key == "shape")
+        {
+            ok = value == "balanced" || value == "random";
+            result.shape = value == "balanced" ? SyntheticTreeShape::Balanced : SyntheticTreeShape::Random;
+        }
+        else if (key == "fanout")
+        {
+            ok = parse_u64(value, n) && n <= UINT32_MAX;
+            result.fanout = static_cast<uint32_t>(n);
+        }
+        else if (key == "names")
+        {
+            size_t const dots = value.find("..");
+            uint64_t lo = 0, hi = 0;
+            ok = dots != std::string::npos &&
+                parse_u64(value.substr(0, dots), lo) && parse_u64(value.substr(dots + 2), hi) &&
+                hi <= UINT32_MAX;
+            result.name_length_min = static_cast<uint32_t>(lo);
+            result.name_length_max = static_cast<uint32_t>(hi);
+        }
+        else if (key == "unicode")
+        {
+            ok = parse_ratio(value, result.unicode_ratio);
+        }
+        else if (key == "hardlinks")
+        {
+            ok = parse_ratio(value, result.hardlink_ratio);
+        }
+        else if (key == "dos")
+        {
+            ok = parse_ratio(value, result.dos_name_ratio);
+        }
+        else if (key == "ads")
+        {
+            ok = parse_ratio(value, result.ads_ratio);
+        }
+        else if (key == "free")
+        {
+            ok = parse_ratio(value, result.free_ratio);
+        }
+        else if (key == "max_size")
+        {
+            ok = parse_u64(value, result.max_file_size);
+        }
+        else
+        {
+            return "unknown option";
+        }
+
+        if (!ok)
+        {
+            return "invalid option value";
+        }
+    }
+
+    options = result;
+    return nullptr;
+}
+
+/**
+ * @brief Checks that @p options describe an MFT the generator can produce.
+ *
+ * @return nullptr if usable, otherwise a description of the problem
+ */
+[[nodiscard]] inline char const* validate_synthetic_mft_options(SyntheticMftOptions const& options)
+{
+    if (options.record_size != 1024 && options.record_size != 4096)
+    {
+        return "record size must be 1024 or 4096";
+    }
+    if (options.cluster_size < options.record_size || options.cluster_size > (1U << 21) ||
+        (options.cluster_size & (options.cluster_size - 1)) != 0)
+    {
+        return "cluster size must be a power of two, at least the record size";
+    }
+    if (options.record_count <= kSyntheticFirstUserRecord || options.record_count > UINT32_MAX)
+    {
+        return "record count must be between 25 and 2^32 - 1";
+    }
+    if (options.fanout < 2)
+    {
+        return "fanout must be at least 2";
+    }
+    if (options.name_length_min < 1 || options.name_length_min > options.name_length_max ||
+        options.name_length_max > 200)
+    {
+        return "name lengths must satisfy 1 <= min <= max <= 200";
+    }
+    return nullptr;
+}
+
+// ============================================================================
+// Record Description
+// ============================================================================
+
+/// What the generator put into one record (after fitting it into the record).
+struct SyntheticMftRecordInfo
+{
+    bool in_use = false;
+    bool directory = false;
+    uint32_t parent = 0;             ///< Parent FRS of the primary name
+    unsigned int link_count = 0;     ///< Non-DOS $FILE_NAME attributes
+    unsigned int stream_count = 0;   ///< Streams NtfsIndex reports ($I30 counts once)
+    uint64_t data_size = 0;          ///< Size of the unnamed $DATA stream
+};
+
+namespace synthetic_detail {
+
+/// splitmix64: tiny, fast and good enough to drive every random decision.
+struct Rng
+{
+    uint64_t state;
+
+    explicit Rng(uint64_t seed) noexcept : state(seed) {}
+
+    uint64_t next() noexcept
+    {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    uint64_t below(uint64_t n) noexcept
+    {
+        return n ? next() % n : 0;
+    }
+
+    bool chance(double p) noexcept
+    {
+        return static_cast<double>(next() >> 11) * (1.0 / 9007199254740992.0) < p;
+    }
+};
+
+inline void put16(unsigned char* p, uint16_t v) noexcept { memcpy(p, &v, sizeof(v)); }
+inline void put32(unsigned char* p, uint32_t v) noexcept { memcpy(p, &v, sizeof(v)); }
+inline void put64(unsigned char* p, uint64_t v) noexcept { memcpy(p, &v, sizeof(v)); }
+
+[[nodiscard]] constexpr uint32_t align8(uint32_t v) noexcept { return (v + 7) & ~7U; }
+
+// Attribute type codes (see ntfs_types.hpp; duplicated to stay Windows-free)
+static constexpr uint32_t kStandardInformation = 0x10;
+static constexpr uint32_t kFileName = 0x30;
+static constexpr uint32_t kData = 0x80;
+static constexpr uint32_t kIndexRoot = 0x90;
+static constexpr uint32_t kIndexAllocation = 0xA0;
+static constexpr uint32_t kBitmap = 0xB0;
+
+static constexpr uint32_t kResidentHeaderSize = 0x18;
+static constexpr uint32_t kNonResidentHeaderSize = 0x40;
+static constexpr uint32_t kStandardInformationSize = 72;
+static constexpr uint32_t kFileNameFixedSize = 66;
+static constexpr uint32_t kIndexRootValueSize = 48;   // INDEX_ROOT + INDEX_HEADER + end entry
+static constexpr uint32_t kIndexBlockSize = 4096;
+static constexpr uint32_t kIndexEntryOverhead = 0x52 + 6;
+static constexpr uint32_t kMaxRuns = 2;
+static constexpr uint32_t kMaxMappingPairsSize = kMaxRuns * 17 + 1;
+
+static constexpr uint64_t kFiletime2015 = 130645440000000000ULL;
+static constexpr uint64_t kTenYears = 3652ULL * 24 * 3600 * 10000000;
+
+static constexpr uint32_t kAttributeArchive = 0x20;
+static constexpr uint32_t kAttributeHidden = 0x02;
+static constexpr uint32_t kAttributeSystem = 0x04;
+static constexpr uint32_t kAttributeIndexPresent = 0x10000000;
+
+static constexpr uint8_t kNamespaceWin32 = 0x01;
+static constexpr uint8_t kNamespaceDos = 0x02;
+static constexpr uint8_t kNamespaceWin32AndDos = 0x03;
+
+/// Encodes runs as NTFS mapping pairs; returns the number of bytes written.
+inline uint32_t encode_mapping_pairs(uint64_t const* lengths, int64_t const* lcns, bool sparse,
+    uint32_t count, unsigned char* out) noexcept
+{
+    // Smallest signed little-endian encoding of v
+    auto const put_signed = [](unsigned char* p, int64_t v) -> uint32_t
+    {
+        uint32_t n = 0;
+        for (;;)
+        {
+            p[n++] = static_cast<unsigned char>(v);
+            int64_t const rest = v >> 8;
+            bool const sign = (p[n - 1] & 0x80) != 0;
+            if ((rest == 0 && !sign) || (rest == -1 && sign))
+            {
+                return n;
+            }
+            v = rest;
+        }
+    };
+
+    uint32_t pos = 0;
+    int64_t previous_lcn = 0;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        unsigned char* const header = &out[pos++];
+        uint32_t const v = put_signed(&out[pos], static_cast<int64_t>(lengths[i]));
+        pos += v;
+        uint32_t l = 0;
+        if (!sparse)
+        {
+            l = put_signed(&out[pos], lcns[i] - previous_lcn);
+            pos += l;
+            previous_lcn = lcns[i];
+        }
+        *header = static_cast<unsigned char>((l << 4) | v);
+    }
+    out[pos++] = 0;
+    return pos;
+}
+
+/// One attribute planned for a record, written by SyntheticMftGenerator::emit.
+struct Attribute
+{
+    enum Kind { StandardInformation, FileName, Data, IndexRoot, IndexBitmap };
+
+    Kind kind;
+    uint32_t type;
+    char const* name;               // ASCII, nullptr if unnamed
+    bool non_resident;
+    uint16_t flags;                 // 0x8000 = sparse
+    unsigned int link;              // FileName: index into Plan::names
+    uint64_t size;                  // value length / data size
+    uint64_t allocated;             // non-resident only
+    uint64_t initialized;           // non-resident only
+    uint32_t run_count;             // non-resident only
+    uint64_t run_lengths[kMaxRuns];
+    int64_t run_lcns[kMaxRuns];
+    bool large_index;               // IndexRoot: $INDEX_ALLOCATION follows
+    bool optional;
+    bool dropped;
+
+    [[nodiscard]] uint32_t name_length() const noexcept
+    {
+        return name ? static_cast<uint32_t>(strlen(name)) : 0;
+    }
+
+    [[nodiscard]] uint32_t on_disk_size() const noexcept
+    {
+        uint32_t const header = (non_resident ? kNonResidentHeaderSize : kResidentHeaderSize) + 2 * name_length();
+        return non_resident
+            ? align8(align8(header) + 1 + run_count * 17)   // mapping pairs upper bound
+            : align8(align8(header) + static_cast<uint32_t>(size));
+    }
+};
+
+/// A file name as stored in $FILE_NAME.
+struct Name
+{
+    uint16_t chars[255];
+    uint8_t length;
+    uint8_t flags;
+    uint32_t parent;
+};
+
+/// Everything decided about one record before it is written.
+struct Plan
+{
+    bool in_use = false;
+    bool directory = false;
+    uint32_t attributes = 0;
+    uint64_t times[4] = {};
+    Name names[3];
+    unsigned int name_count = 0;
+    Attribute attrs[10];
+    unsigned int attr_count = 0;
+    uint64_t data_size = 0;
+    uint64_t data_allocated = 0;
+    uint16_t usn = 1;
+
+    /// Bytes the attributes need, end marker excluded.
+    [[nodiscard]] uint32_t used() const noexcept
+    {
+        uint32_t total = 0;
+        for (unsigned int i = 0; i < attr_count; ++i)
+        {
+            total += attrs[i].dropped ? 0 : attrs[i].on_disk_size();
+        }
+        return total;
+    }
+};
+
+} // namespace synthetic_detail
+
+// ============================================================================
+// Generator
+// ============================================================================
+
+/**
+ * @class SyntheticMftGenerator
+ * @brief Produces the raw record stream of a synthetic $MFT.
+ *
+ * Stateless after construction: generate() and describe() may be called
+ * from any number of threads at once.
+ */
+class SyntheticMftGenerator
+{
+public:
+    /// @throws std::invalid_argument if the options are not usable
+    explicit SyntheticMftGenerator(SyntheticMftOptions const& options)
+        : options_(options)
+    {
+        if (char const* const error = validate_synthetic_mft_options(options))
+        {
+            throw std::invalid_argument(error);
+        }
+        nodes_ = options.record_count - kSyntheticFirstUserRecord + 1;
+        directories_ = (nodes_ - 1) / options.fanout + 1;
+        volume_clusters_ = std::max<uint64_t>(options.record_count * 64, 1ULL << 20);
+        mft_lcn_ = (3ULL << 30) / options.cluster_size;
+    }
+
+    [[nodiscard]] SyntheticMftOptions const& options() const noexcept { return options_; }
+    [[nodiscard]] uint64_t record_count() const noexcept { return options_.record_count; }
+    [[nodiscard]] uint32_t record_size() const noexcept { return options_.record_size; }
+
+    /// Directories in the user tree, root included.
+    [[nodiscard]] uint64_t directory_count() const noexcept { return directories_; }
+
+    /// Parent FRS of the primary name of record @p frs.
+    [[nodiscard]] uint32_t parent_of(uint64_t frs) const noexcept
+    {
+        if (frs < kSyntheticFirstUserRecord)
+        {
+            return kSyntheticRootRecord;
+        }
+        uint64_t const m = node_of(frs);
+        uint64_t const last = (m - 1) / options_.fanout;
+        uint64_t const parent = options_.shape == SyntheticTreeShape::Balanced
+            ? last
+            : rng_for(frs, 1).below(last + 1);
+        return frs_of(parent);
+    }
+
+    /// What record @p frs contains.
+    [[nodiscard]] SyntheticMftRecordInfo describe(uint64_t frs) const
+    {
+        synthetic_detail::Plan plan;
+        this->make_plan(frs, plan);
+
+        SyntheticMftRecordInfo info;
+        info.in_use = plan.in_use;
+        info.directory = plan.directory;
+        info.data_size = plan.data_size;
+        if (plan.name_count)
+        {
+            info.parent = plan.names[0].parent;
+        }
+        for (unsigned int i = 0; i < plan.name_count; ++i)
+        {
+            info.link_count += plan.names[i].flags != synthetic_detail::kNamespaceDos;
+        }
+        bool index_counted = false;
+        for (unsigned int i = 0; i < plan.attr_count; ++i)
+        {
+            synthetic_detail::Attribute const& a = plan.attrs[i];
+            if (a.dropped || a.kind == synthetic_detail::Attribute::StandardInformation ||
+                a.kind == synthetic_detail::Attribute::FileName)
+            {
+                continue;
+            }
+            bool const is_i30 = a.name && strcmp(a.name, "$I30") == 0;
+            if (!is_i30 || !index_counted)
+            {
+                ++info.stream_count;
+            }
+            index_counted |= is_i30;
+        }
+        return info;
+    }
+
+    /**
+     * @brief Writes @p count records starting at @p first_frs.
+     *
+     * @param out  record_size() * count bytes
+     */
+    void generate(uint64_t first_frs, size_t count, unsigned char* out) const
+    {
+        synthetic_detail::Plan plan;
+        for (size_t i = 0; i < count; ++i)
+        {
+            unsigned char* const record = out + i * options_.record_size;
+            memset(record, 0, options_.record_size);
+            this->make_plan(first_frs + i, plan);
+            this->emit(first_frs + i, plan, record);
+        }
+    }
+
+private:
+    SyntheticMftOptions options_;
+    uint64_t nodes_;
+    uint64_t directories_;
+    uint64_t volume_clusters_;
+    uint64_t mft_lcn_;
+
+    [[nodiscard]] uint64_t node_of(uint64_t frs) const noexcept
+    {
+        return frs == kSyntheticRootRecord ? 0 : frs - kSyntheticFirstUserRecord + 1;
+    }
+
+    [[nodiscard]] uint32_t frs_of(uint64_t node) const noexcept
+    {
+        return static_cast<uint32_t>(node ? node - 1 + kSyntheticFirstUserRecord : kSyntheticRootRecord);
+    }
+
+    /// Independent random stream for each (record, purpose) pair.
+    [[nodiscard]] synthetic_detail::Rng rng_for(uint64_t frs, uint64_t purpose) const noexcept
+    {
+        synthetic_detail::Rng mix(options_.seed ^ (frs * 0xD6E8FEB86659FD93ULL) ^ (purpose << 56));
+        return synthetic_detail::Rng(mix.next());
+    }
+
+    /// Expected number of children of directory node @p m (drives $I30 size).
+    [[nodiscard]] uint64_t expected_children(uint64_t m) const noexcept
+    {
+        if (options_.shape == SyntheticTreeShape::Random)
+        {
+            return options_.fanout;
+        }
+        uint64_t const first = m * options_.fanout + 1;
+        uint64_t const last = std::min(first + options_.fanout, nodes_);
+        return first < last ? last - first : 0;
+    }
+
+    // ------------------------------------------------------------------------
+    // Planning
+    // ------------------------------------------------------------------------
+
+    static void set_ascii_name(synthetic_detail::Name& name, char const* text, uint8_t flags, uint32_t parent)
+    {
+        name.length = static_cast<uint8_t>(strlen(text));
+        for (uint8_t i = 0; i < name.length; ++i)
+        {
+            name.chars[i] = static_cast<unsigned char>(text[i]);
+        }
+        name.flags = flags;
+        name.parent = parent;
+    }
+
+    /// Turns @p a into a non-resident attribute with one or two runs covering @p size bytes.
+    void make_non_resident(synthetic_detail::Attribute& a, synthetic_detail::Rng& rng, uint64_t size) const
+    {
+        uint64_t const clusters = (size + options_.cluster_size - 1) / options_.cluster_size;
+        a.non_resident = true;
+        a.size = size;
+        a.initialized = size;
+        a.allocated = clusters * options_.cluster_size;
+        a.run_count = clusters ? (clusters > 16 && rng.chance(0.2) ? 2 : 1) : 0;
+        uint64_t remaining = clusters;
+        for (uint32_t r = 0; r < a.run_count; ++r)
+        {
+            a.run_lengths[r] = r + 1 == a.run_count ? remaining : remaining / 2;
+            a.run_lcns[r] = static_cast<int64_t>(rng.below(
+                volume_clusters_ > remaining ? volume_clusters_ - remaining : 1));
+            remaining -= a.run_lengths[r];
+        }
+    }
+
+    synthetic_detail::Attribute& add_non_resident(synthetic_detail::Plan& plan, synthetic_detail::Rng& rng,
+        uint32_t type, char const* name, uint64_t size, bool optional) const
+    {
+        synthetic_detail::Attribute& a = add_attribute(plan, synthetic_detail::Attribute::Data, type, name, optional);
+        make_non_resident(a, rng, size);
+        return a;
+    }
+
+    static synthetic_detail::Attribute& add_attribute(synthetic_detail::Plan& plan,
+        synthetic_detail::Attribute::Kind kind, uint32_t type, char const* name, bool optional)
+    {
+        synthetic_detail::Attribute& a = plan.attrs[plan.attr_count++];
+        a = synthetic_detail::Attribute();
+        a.kind = kind;
+        a.type = type;
+        a.name = name;
+        a.optional = optional;
+        return a;
+    }
+
+    static synthetic_detail::Attribute& add_resident(synthetic_detail::Plan& plan,
+        synthetic_detail::Attribute::Kind kind, uint32_t type, char const* name, uint64_t size, bool optional)
+    {
+        synthetic_detail::Attribute& a = add_attribute(plan, kind, type, name, optional);
+        a.size = size;
+        return a;
+    }
+
+    static void add_file_name(synthetic_detail::Plan& plan, unsigned int link, bool optional)
+    {
+        using namespace synthetic_detail;
+        add_resident(plan, Attribute::FileName, kFileName, nullptr,
+            kFileNameFixedSize + 2 * plan.names[link].length, optional).link = link;
+    }
+
+    /// $I30 attributes for a directory expected to hold @p children entries.
+    void add_index(synthetic_detail::Plan& plan, synthetic_detail::Rng& rng, uint64_t children) const
+    {
+        using namespace synthetic_detail;
+        uint64_t const average_entry = align8(kIndexEntryOverhead +
+            options_.name_length_min + options_.name_length_max);
+        uint64_t const bytes = children * average_entry;
+        bool const large = bytes > 256;
+        add_resident(plan, Attribute::IndexRoot, kIndexRoot, "$I30", kIndexRootValueSize, false).large_index = large;
+        if (large)
+        {
+            uint64_t const blocks = (bytes * 4 / 3 + kIndexBlockSize - 1) / kIndexBlockSize;
+            add_non_resident(plan, rng, kIndexAllocation, "$I30", blocks * kIndexBlockSize, false);
+            add_resident(plan, Attribute::IndexBitmap, kBitmap, "$I30", align8(static_cast<uint32_t>((blocks + 7) / 8)), false);
+        }
+    }
+
+    void plan_metafile(uint64_t frs, synthetic_detail::Plan& plan, synthetic_detail::Rng& rng) const
+    {
+        using namespace synthetic_detail;
+        static char const* const names[] = {
+            "$MFT", "$MFTMirr", "$LogFile", "$Volume", "$AttrDef", ".",
+            "$Bitmap", "$Boot", "$BadClus", "$Secure", "$UpCase", "$Extend",
+        };
+
+        if (frs >= sizeof(names) / sizeof(*names))
+        {
+            plan.in_use = false;   // reserved records 12 - 23
+            return;
+        }
+
+        plan.in_use = true;
+        plan.directory = frs == kSyntheticRootRecord || frs == 11;
+        plan.attributes = kAttributeHidden | kAttributeSystem;
+        set_ascii_name(plan.names[0], names[frs], kNamespaceWin32AndDos, kSyntheticRootRecord);
+        add_file_name(plan, plan.name_count++, false);
+
+        uint64_t const volume_bytes = volume_clusters_ * options_.cluster_size;
+        switch (frs)
+        {
+        case 0:
+        {
+            Attribute& data = add_non_resident(plan, rng, kData, nullptr,
+                options_.record_count * options_.record_size, false);
+            data.run_count = 1;
+            data.run_lcns[0] = static_cast<int64_t>(mft_lcn_);
+            data.run_lengths[0] = data.allocated / options_.cluster_size;
+            add_non_resident(plan, rng, kBitmap, nullptr, align8(static_cast<uint32_t>(
+                std::min<uint64_t>((options_.record_count + 7) / 8, UINT32_MAX - 7))), false);
+            break;
+        }
+        case 1: add_non_resident(plan, rng, kData, nullptr, 4 * options_.record_size, false); break;
+        case 2: add_non_resident(plan, rng, kData, nullptr, 64ULL << 20, false); break;
+        case 3: add_resident(plan, Attribute::Data, kData, nullptr, 0, false); break;
+        case 4: add_non_resident(plan, rng, kData, nullptr, 2560, false); break;
+        case 6: add_non_resident(plan, rng, kData, nullptr, (volume_clusters_ + 7) / 8, false); break;
+        case 7:
+        {
+            Attribute& data = add_non_resident(plan, rng, kData, nullptr, 8192, false);
+            data.run_count = 1;
+            data.run_lcns[0] = 0;
+            break;
+        }
+        case 8:
+        {
+            add_resident(plan, Attribute::Data, kData, nullptr, 0, false);
+            Attribute& bad = add_non_resident(plan, rng, kData, "$Bad", volume_bytes, false);
+            bad.flags = 0x8000;
+            bad.initialized = 0;
+            bad.run_count = 1;
+            bad.run_lengths[0] = volume_clusters_;
+            break;
+        }
+        case 9: add_non_resident(plan, rng, kData, "$SDS", 256 * 1024, false); break;
+        case 10: add_non_resident(plan, rng, kData, nullptr, 128 * 1024, false); break;
+        case kSyntheticRootRecord: add_index(plan, rng, expected_children(0) + 11); break;
+        case 11: add_index(plan, rng, 0); break;
+        }
+    }
+
+    void plan_name(synthetic_detail::Plan& plan, synthetic_detail::Rng& rng, uint64_t m) const
+    {
+        using namespace synthetic_detail;
+        static char const alphabet[] = "abcdefghijklmnopqrstuvwxyz0123456789_- ";
+        static char const* const extensions[] = {
+            "txt", "dll", "exe", "jpg", "png", "cpp", "h", "log", "dat", "xml",
+            "json", "pdf", "docx", "mui", "manifest", "cat", "sys", "ini", "cab", "js",
+        };
+        static uint16_t const unicode[] = {
+            0x00E9, 0x00FC, 0x00DF, 0x00F1, 0x0416, 0x03A9, 0x65E5, 0x672C, 0x4E2D, 0xAC00,
+        };
+
+        char id[16];
+        unsigned int id_length = 0;
+        for (uint64_t v = m; v || !id_length; v /= 36)
+        {
+            id[id_length++] = "0123456789abcdefghijklmnopqrstuvwxyz"[v % 36];
+        }
+        std::reverse(id, id + id_length);
+
+        // Triangular distribution between min and max
+        uint32_t const span = options_.name_length_max - options_.name_length_min + 1;
+        uint32_t const stem = options_.name_length_min +
+            static_cast<uint32_t>((rng.below(span) + rng.below(span)) / 2);
+
+        Name& name = plan.names[plan.name_count++];
+        name.length = 0;
+        for (uint32_t i = 0; i + id_length < stem; ++i)
+        {
+            // No leading or trailing blanks, like names created through Win32
+            char c = alphabet[rng.below(sizeof(alphabet) - 1)];
+            name.chars[name.length++] = static_cast<unsigned char>(c == ' ' && i == 0 ? 'x' : c);
+        }
+        unsigned int const prefix = name.length;
+        for (unsigned int i = 0; i < id_length; ++i)
+        {
+            name.chars[name.length++] = static_cast<unsigned char>(id[i]);
+        }
+
+        bool const unicode_name = rng.chance(options_.unicode_ratio);
+        if (unicode_name)
+        {
+            if (!prefix)
+            {
+                memmove(&name.chars[1], &name.chars[0], name.length * sizeof(*name.chars));
+                ++name.length;
+                name.chars[0] = unicode[rng.below(sizeof(unicode) / sizeof(*unicode))];
+            }
+            else
+            {
+                for (uint64_t k = 1 + rng.below(3); k; --k)
+                {
+                    name.chars[rng.below(prefix)] = unicode[rng.below(sizeof(unicode) / sizeof(*unicode))];
+                }
+            }
+        }
+
+        unsigned int const stem_length = name.length;
+        char const* ext = nullptr;
+        if (!plan.directory && rng.chance(0.85))
+        {
+            ext = extensions[rng.below(sizeof(extensions) / sizeof(*extensions))];
+            name.chars[name.length++] = '.';
+            for (char const* e = ext; *e; ++e)
+            {
+                name.chars[name.length++] = static_cast<unsigned char>(*e);
+            }
+        }
+
+        bool const short_name = stem_length <= 8 && (!ext || strlen(ext) <= 3) && !unicode_name;
+        name.flags = short_name ? kNamespaceWin32AndDos : kNamespaceWin32;
+        name.parent = this->parent_of(frs_of(m));
+
+        // 8.3 alias: first six stem characters, "~1" and the extension
+        if (!short_name && rng.chance(options_.dos_name_ratio))
+        {
+            Name& dos = plan.names[plan.name_count++];
+            dos.length = 0;
+            for (unsigned int i = 0; i < stem_length && dos.length < 6; ++i)
+            {
+                uint16_t const c = name.chars[i];
+                if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9'))
+                {
+                    dos.chars[dos.length++] = static_cast<uint16_t>(c >= 'a' ? c - 'a' + 'A' : c);
+                }
+            }
+            if (!dos.length)
+            {
+                dos.chars[dos.length++] = 'X';
+            }
+            dos.chars[dos.length++] = '~';
+            dos.chars[dos.length++] = '1';
+            if (ext)
+            {
+                dos.chars[dos.length++] = '.';
+                for (unsigned int i = 0; ext[i] && i < 3; ++i)
+                {
+                    dos.chars[dos.length++] = static_cast<uint16_t>(ext[i] - 'a' + 'A');
+                }
+            }
+            dos.flags = kNamespaceDos;
+            dos.parent = name.parent;
+            name.flags = kNamespaceWin32;
+        }
+    }
+
+    void plan_user(uint64_t frs, synthetic_detail::Plan& plan, synthetic_detail::Rng& rng) const
+    {
+        using namespace synthetic_detail;
+        uint64_t const m = node_of(frs);
+        plan.directory = m < directories_;
+        plan.in_use = plan.directory || !rng.chance(options_.free_ratio);
+        plan.attributes = plan.directory ? 0 : kAttributeArchive;
+        if (rng.chance(0.01))
+        {
+            plan.attributes |= kAttributeHidden;
+        }
+
+        this->plan_name(plan, rng, m);
+        add_file_name(plan, 0, false);
+        if (plan.name_count > 1)
+        {
+            add_file_name(plan, 1, true);
+        }
+
+        // Second hard link: same name, some other directory
+        if (!plan.directory && rng.chance(options_.hardlink_ratio))
+        {
+            Name& link = plan.names[plan.name_count];
+            link = plan.names[0];
+            link.flags = kNamespaceWin32;
+            link.parent = frs_of(rng.below(directories_));
+            add_file_name(plan, plan.name_count++, true);
+        }
+
+        if (plan.directory)
+        {
+            add_index(plan, rng, expected_children(m));
+            return;
+        }
+
+        // Log-uniform file size: as many tiny files as huge ones per octave
+        unsigned int bits = 0;
+        while (bits < 63 && (2ULL << bits) <= options_.max_file_size)
+        {
+            ++bits;
+        }
+        uint64_t const size = rng.below(1ULL << rng.below(bits + 1));
+        if (size <= 600 && rng.chance(0.9))
+        {
+            // Falls back to non-resident in fit() if the record is full
+            add_resident(plan, Attribute::Data, kData, nullptr, size, false);
+        }
+        else
+        {
+            add_non_resident(plan, rng, kData, nullptr, size, false);
+        }
+
+        if (rng.chance(options_.ads_ratio))
+        {
+            add_resident(plan, Attribute::Data, kData, "Zone.Identifier", 26, true);
+        }
+    }
+
+    /// Moves resident data out, then drops optional attributes, until the record fits.
+    void fit(synthetic_detail::Plan& plan, synthetic_detail::Rng& rng) const
+    {
+        using namespace synthetic_detail;
+        uint32_t const usa_count = options_.record_size / 512 + 1;
+        uint32_t const capacity = options_.record_size - align8(0x30 + 2 * usa_count) - 8;
+
+        for (unsigned int i = 0; i < plan.attr_count && plan.used() > capacity; ++i)
+        {
+            Attribute& a = plan.attrs[i];
+            if (a.kind == Attribute::Data && !a.non_resident && !a.name && a.size)
+            {
+                make_non_resident(a, rng, a.size);
+            }
+        }
+        for (unsigned int i = plan.attr_count; i-- > 0 && plan.used() > capacity;)
+        {
+            plan.attrs[i].dropped = plan.attrs[i].optional;
+        }
+
+        // Names whose $FILE_NAME was dropped are gone too
+        unsigned int kept = 0;
+        for (unsigned int i = 0; i < plan.attr_count; ++i)
+        {
+            Attribute& a = plan.attrs[i];
+            if (a.kind == Attribute::FileName)
+            {
+                if (a.dropped)
+                {
+                    continue;
+                }
+                plan.names[kept] = plan.names[a.link];
+                a.link = kept++;
+            }
+        }
+        plan.name_count = kept;
+    }
+
+    void make_plan(uint64_t frs, synthetic_detail::Plan& plan) const
+    {
+        using namespace synthetic_detail;
+        plan = Plan();
+
+        Rng rng = rng_for(frs, 0);
+        plan.usn = static_cast<uint16_t>(rng.below(0xFFFE) + 1);
+        plan.times[0] = kFiletime2015 + rng.below(kTenYears);
+        plan.times[1] = plan.times[0] + rng.below(kTenYears / 4);
+        plan.times[2] = plan.times[1];
+        plan.times[3] = plan.times[1] + rng.below(kTenYears / 4);
+
+        add_resident(plan, Attribute::StandardInformation, kStandardInformation, nullptr, kStandardInformationSize, false);
+
+        if (frs < kSyntheticFirstUserRecord)
+        {
+            this->plan_metafile(frs, plan, rng);
+        }
+        else
+        {
+            this->plan_user(frs, plan, rng);
+        }
+
+        if (!plan.in_use && frs < kSyntheticFirstUserRecord)
+        {
+            plan.attr_count = 0;    // reserved: formatted but empty
+            return;
+        }
+
+        this->fit(plan, rng);
+
+        for (unsigned int i = 0; i < plan.attr_count; ++i)
+        {
+            Attribute const& a = plan.attrs[i];
+            if (!a.dropped && a.kind == Attribute::Data && a.type == kData && !a.name)
+            {
+                plan.data_size = a.size;
+                plan.data_allocated = a.non_resident ? a.allocated : 0;
+            }
+        }
+
+        // NTFS keeps attributes sorted by type code
+        std::stable_sort(plan.attrs, plan.attrs + plan.attr_count,
+            [](Attribute const& a, Attribute const& b) { return a.type < b.type; });
+    }
+
+    // ------------------------------------------------------------------------
+    // Emission
+    // ------------------------------------------------------------------------
+
+    void emit(uint64_t frs, synthetic_detail::Plan const& plan, unsigned char* record) const
+    {
+        using namespace synthetic_detail;
+        uint32_t const usa_count = options_.record_size / 512 + 1;
+        uint32_t const first_attribute = align8(0x30 + 2 * usa_count);
+
+        memcpy(record, "FILE", 4);
+        put16(record + 0x04, 0x30);                             // USAOffset
+        put16(record + 0x06, static_cast<uint16_t>(usa_count)); // USACount
+        put64(record + 0x08, 0);                                // LSN
+        put16(record + 0x10, 1);                                // SequenceNumber
+        put16(record + 0x14, static_cast<uint16_t>(first_attribute));
+        put32(record + 0x1C, options_.record_size);             // BytesAllocated
+        put32(record + 0x2C, static_cast<uint32_t>(frs));       // SegmentNumberLower
+
+        uint32_t pos = first_attribute;
+        uint16_t instance = 0;
+        for (unsigned int i = 0; i < plan.attr_count; ++i)
+        {
+            Attribute const& a = plan.attrs[i];
+            if (!a.dropped)
+            {
+                pos += this->emit_attribute(frs, plan, a, instance++, record + pos);
+            }
+        }
+
+        put32(record + pos, 0xFFFFFFFF);                        // AttributeEnd
+        pos += 8;
+        put16(record + 0x12, static_cast<uint16_t>(std::count_if(plan.names, plan.names + plan.name_count,
+            [](Name const& n) { return n.flags != kNamespaceDos; })));
+        put16(record + 0x16, static_cast<uint16_t>((plan.in_use ? 0x1 : 0) | (plan.directory ? 0x2 : 0)));
+        put32(record + 0x18, pos);                              // BytesInUse
+        put16(record + 0x28, instance);                         // NextAttributeNumber
+
+        // Update sequence: the last word of each sector moves into the USA
+        put16(record + 0x30, plan.usn);
+        for (uint32_t i = 1; i < usa_count; ++i)
+        {
+            unsigned char* const check = record + i * 512 - 2;
+            memcpy(record + 0x30 + 2 * i, check, 2);
+            put16(check, plan.usn);
+        }
+    }
+
+    uint32_t emit_attribute(uint64_t frs, synthetic_detail::Plan const& plan,
+        synthetic_detail::Attribute const& a, uint16_t instance, unsigned char* p) const
+    {
+        using namespace synthetic_detail;
+        uint32_t const name_length = a.name_length();
+        uint32_t const header_size = a.non_resident ? kNonResidentHeaderSize : kResidentHeaderSize;
+
+        put32(p + 0x00, a.type);
+        p[0x08] = a.non_resident ? 1 : 0;
+        p[0x09] = static_cast<unsigned char>(name_length);
+        put16(p + 0x0A, static_cast<uint16_t>(name_length ? header_size : 0));
+        put16(p + 0x0C, a.flags);
+        put16(p + 0x0E, instance);
+        for (uint32_t i = 0; i < name_length; ++i)
+        {
+            put16(p + header_size + 2 * i, static_cast<unsigned char>(a.name[i]));
+        }
+        uint32_t const body = align8(header_size + 2 * name_length);
+
+        if (a.non_resident)
+        {
+            uint64_t const clusters = a.allocated / options_.cluster_size;
+            put64(p + 0x10, 0);                                                // LowestVCN
+            put64(p + 0x18, clusters - 1);                                     // HighestVCN
+            put16(p + 0x20, static_cast<uint16_t>(body));                      // MappingPairsOffset
+            put64(p + 0x28, a.allocated);
+            put64(p + 0x30, a.size);
+            put64(p + 0x38, a.initialized);
+            uint32_t const runs = encode_mapping_pairs(a.run_lengths, a.run_lcns, (a.flags & 0x8000) != 0,
+                a.run_count, p + body);
+            uint32_t const length = align8(body + runs);
+            put32(p + 0x04, length);
+            return length;
+        }
+
+        unsigned char* const value = p + body;
+        uint32_t value_length = static_cast<uint32_t>(a.size);
+        switch (a.kind)
+        {
+        case Attribute::StandardInformation:
+            for (int t = 0; t < 4; ++t)
+            {
+                put64(value + 8 * t, plan.times[t]);
+            }
+            put32(value + 0x20, plan.attributes);
+            put32(value + 0x34, 0x100 + static_cast<uint32_t>(frs % 64));  // SecurityId
+            break;
+
+        case Attribute::FileName:
+        {
+            Name const& name = plan.names[a.link];
+            value_length = kFileNameFixedSize + 2 * name.length;
+            put64(value + 0x00, name.parent | (1ULL << 48));                // ParentDirectory, seq 1
+            for (int t = 0; t < 4; ++t)
+            {
+                put64(value + 0x08 + 8 * t, plan.times[t]);
+            }
+            put64(value + 0x28, plan.data_allocated);
+            put64(value + 0x30, plan.data_size);
+            put32(value + 0x38, plan.attributes | (plan.directory ? kAttributeIndexPresent : 0));
+            value[0x40] = name.length;
+            value[0x41] = name.flags;
+            for (unsigned int i = 0; i < name.length; ++i)
+            {
+                put16(value + 0x42 + 2 * i, name.chars[i]);
+            }
+            p[0x16] = 1;                                                    // indexed
+            break;
+        }
+
+        case Attribute::Data:
+            if (a.name)
+            {
+                memcpy(value, "[ZoneTransfer]\r\nZoneId=3\r\n", value_length);
+            }
+            else
+            {
+                // Cheap but not trivially compressible contents
+                Rng fill = rng_for(frs, 2);
+                for (uint32_t i = 0; i < value_length; i += 8)
+                {
+                    uint64_t const v = fill.next();
+                    memcpy(value + i, &v, std::min<uint32_t>(8, value_length - i));
+                }
+            }
+            break;
+
+        case Attribute::IndexRoot:
+            put32(value + 0x00, kFileName);                                 // indexed attribute type
+            put32(value + 0x04, 1);                                         // COLLATION_FILE_NAME
+            put32(value + 0x08, kIndexBlockSize);
+            value[0x0C] = static_cast<unsigned char>(kIndexBlockSize / options_.cluster_size
+                ? kIndexBlockSize / options_.cluster_size : 1);
+            put32(value + 0x10, 0x10);                                      // FirstIndexEntry
+            put32(value + 0x14, 0x20);                                      // FirstFreeByte
+            put32(value + 0x18, 0x20);                                      // BytesAvailable
+            value[0x1C] = a.large_index ? 1 : 0;                            // has $INDEX_ALLOCATION
+            put16(value + 0x28, 0x10);                                      // end entry: length
+            put32(value + 0x2C, 0x2 | (a.large_index ? 0x1 : 0));           // last (+ has subnode)
+            break;
+
+        case Attribute::IndexBitmap:
+            value[0] = 1;
+            break;
+        }
+
+        put32(p + 0x10, value_length);
+        put16(p + 0x14, static_cast<uint16_t>(body));
+        uint32_t const length = align8(body + value_length);
+        put32(p + 0x04, length);
+        return length;
+    }
+};
+
+// ============================================================================
+// File Output
+// ============================================================================
+
+/**
+ * @brief Writes a complete UFFS-MFT file for @p generator to @p out.
+ *
+ * Records are generated on @p threads threads (0 = all cores). With
+ * @p compress the output uses LZ4 frames, exactly like
+ * `--dump-mft --dump-mft-compress`. On a seekable stream the header is
+ * rewritten once the compressed size is known; otherwise (a pipe) frames
+ * get size prefixes so the file can be read as a stream.
+ *
+ * @param progress  Called with the number of records written so far
+ * @return false if writing to @p out failed
+ */
+[[nodiscard]] inline bool write_synthetic_uffs_mft(SyntheticMftGenerator const& generator, std::ostream& out,
+    bool compress, unsigned int threads = 0,
+    std::function<void(uint64_t records_done)> const& progress = std::function<void(uint64_t)>())
+{
+    if (!threads)
+    {
+        threads = std::max(1U, std::thread::hardware_concurrency());
+    }
+
+    UffsMftHeader header = make_uffs_mft_header(generator.record_size(), generator.record_count(), 0);
+    std::streampos const start = out.tellp();
+    bool const seekable = start != std::streampos(-1);
+    out.clear();  // tellp() on a pipe may set failbit
+
+    UffsMftFrameWriter::Sink const sink = [&out](void const* data, size_t size)
+    {
+        return !!out.write(static_cast<char const*>(data), static_cast<std::streamsize>(size));
+    };
+    std::unique_ptr<UffsMftFrameWriter> writer;
+    if (compress)
+    {
+        writer.reset(new UffsMftFrameWriter(kUffsMftDefaultFrameSize, threads, sink, !seekable));
+        if (!seekable)
+        {
+            writer->complete_header(header);
+        }
+    }
+
+    if (!out.write(reinterpret_cast<char const*>(&header), sizeof(header)))
+    {
+        return false;
+    }
+
+    // One 1 MB slice per thread per batch, generated in parallel, written in order
+    size_t const slice_records = (1U << 20) / generator.record_size();
+    std::vector<unsigned char> batch(slice_records * generator.record_size() * threads);
+    uint64_t const total = generator.record_count();
+    for (uint64_t first = 0; first < total;)
+    {
+        size_t const count = static_cast<size_t>(std::min<uint64_t>(total - first, slice_records * threads));
+        parallel_for_each_index((count + slice_records - 1) / slice_records, threads, [&](size_t i)
+        {
+            size_t const begin = i * slice_records;
+            generator.generate(first + begin, std::min(slice_records, count - begin),
+                batch.data() + begin * generator.record_size());
+        });
+
+        size_t const bytes = count * generator.record_size();
+        if (writer ? !writer->write(batch.data(), bytes) : !sink(batch.data(), bytes))
+        {
+            return false;
+        }
+        first += count;
+        if (progress)
+        {
+            progress(first);
+        }
+    }
+
+    if (writer && !writer->finish())
+    {
+        return false;
+    }
+    if (writer && seekable)
+    {
+        writer->complete_header(header);
+        std::streampos const end = out.tellp();
+        out.seekp(start);
+        out.write(reinterpret_cast<char const*>(&header), sizeof(header));
+        out.seekp(end);
+    }
+    return !!out.flush();
+}
+
+} // namespace uffs
+
+// Expose at global scope for backward compatibility
+using uffs::SyntheticMftGenerator;
+using uffs::SyntheticMftOptions;
+
+#endif // UFFS_SYNTHETIC_MFT_HPP
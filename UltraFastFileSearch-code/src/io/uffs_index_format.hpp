@@ -0,0 +1,390 @@
+/**
+ * @file uffs_index_format.hpp
+ * @brief On-disk layout of UFFS-IDX index snapshot files.
+ *
+ * A UFFS-IDX file is a finished NtfsIndex written out as-is: the eight
+ * storage arrays (records, FRS lookup, names, links, streams, children,
+ * and the first-stream and timestamp columns of the records) are stored
+ * back to back, each starting on a page boundary, behind a
+ * fixed 512-byte header. Every cross-reference inside the arrays is an
+ * index or an offset, never a pointer, so the file is position independent
+ * and can be memory-mapped read-only and searched in place: opening a
+ * snapshot costs one header check, not a parse, and every process mapping
+ * the same file shares the same physical pages.
+ *
+ * ## File Layout (version 2)
+ *
+ * ```
+ * Offset 0         512   4096                                        EOF
+ * ┌───────────────┬────┬─────────┬──────────┬───────┬─────┬─────────┐
+ * │ UffsIndex-    │pad │ records │ records_ │ names │ ... │ time-   │
+ * │ Header        │    │         │ lookup   │       │     │ stamps  │
+ * └───────────────┴────┴─────────┴──────────┴───────┴─────┴─────────┘
+ *                       each section starts on a 4 KB boundary
+ * ```
+ *
+ * The header carries a section table (offset, element count, element size
+ * and checksum per array) and the volume geometry and counters the index
+ * reports once loading has finished. The element sizes let a reader reject
+ * snapshots written by a build with a different record layout or TCHAR.
+ *
+ * ## Integrity
+ *
+ * The header is covered by its own checksum and is always verified. Each
+ * section has an independent 64-bit checksum (XXH64) that readers may
+ * verify on demand; doing so touches every page, which is exactly the
+ * cost a snapshot exists to avoid, so it is opt-in. Writers produce the
+ * file under a temporary name and rename it into place, so a reader never
+ * observes a half-written snapshot.
+ *
+ * @note No Windows dependencies, so this header can be unit-tested.
+ * @note Snapshots are little-endian and not portable between builds whose
+ *       record structures differ; the element sizes guard against that.
+ *
+ * @see ntfs_index_snapshot.hpp for NtfsIndex::save_snapshot / open_snapshot
+ */
+
+#ifndef UFFS_UFFS_INDEX_FORMAT_HPP
+#define UFFS_UFFS_INDEX_FORMAT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+
+namespace uffs {
+
+// ============================================================================
+// Format Constants
+// ============================================================================
+
+/// File signature stored in UffsIndexHeader::magic (not NUL-terminated).
+static constexpr char kUffsIndexMagic[8] = { 'U', 'F', 'F', 'S', '-', 'I', 'D', 'X' };
+
+/// Current format version written by NtfsIndex::save_snapshot.
+static constexpr uint32_t kUffsIndexVersion = 2;
+
+/// Every section starts on a multiple of this (one page on all targets).
+static constexpr uint64_t kUffsIndexSectionAlignment = 4096;
+
+/// Section numbers, in file order.
+enum UffsIndexSection : uint32_t
+{
+    kUffsIndexRecords = 0,       ///< NtfsIndex::records_data
+    kUffsIndexRecordsLookup,     ///< NtfsIndex::records_lookup (FRS -> slot)
+    kUffsIndexNames,             ///< NtfsIndex::names (TCHAR or packed ASCII)
+    kUffsIndexNameInfos,         ///< NtfsIndex::nameinfos (extra hard links)
+    kUffsIndexStreamInfos,       ///< NtfsIndex::streaminfos (extra streams)
+    kUffsIndexChildInfos,        ///< NtfsIndex::childinfos (directory children)
+    kUffsIndexFirstStreams,      ///< NtfsIndex::first_streams (first stream of each record)
+    kUffsIndexTimestamps,        ///< NtfsIndex::timestamps (timestamps of each record)
+    kUffsIndexSectionCount
+};
+
+// ============================================================================
+// UFFS-IDX Header structure (512 bytes)
+// ============================================================================
+#pragma pack(push, 1)
+struct UffsIndexSectionEntry
+{
+    uint64_t offset;         // file offset, multiple of kUffsIndexSectionAlignment
+    uint64_t count;          // number of elements
+    uint32_t element_size;   // sizeof one element as written
+    uint32_t reserved;       // 0
+    uint64_t checksum;       // uffs_index_checksum of the section bytes
+};
+
+struct UffsIndexHeader
+{
+    char magic[8];                       // "UFFS-IDX"
+    uint32_t version;                    // 2
+    uint32_t flags;                      // 0
+    uint32_t header_size;                // sizeof(UffsIndexHeader)
+    char volume_letter;                  // source drive letter ('C'), 0 if unknown
+    uint8_t reserved0[3];
+    uint32_t cluster_size;               // volume geometry, as NtfsIndex reports it
+    uint32_t mft_record_size;
+    uint32_t mft_capacity;
+    uint32_t expected_records;
+    uint64_t records_so_far;             // progress counters at save time
+    uint64_t preprocessed_so_far;
+    uint64_t total_names_and_streams;
+    int64_t reserved_clusters;
+    int64_t mft_zone_start;
+    int64_t mft_zone_end;
+    uint64_t created_time;               // seconds since 1970-01-01 UTC, informational
+    UffsIndexSectionEntry sections[kUffsIndexSectionCount];
+    uint8_t reserved[152];               // padding to 512 bytes
+    uint64_t header_checksum;            // checksum of every byte before this field
+};
+#pragma pack(pop)
+
+static_assert(sizeof(UffsIndexSectionEntry) == 32, "UffsIndexSectionEntry must be exactly 32 bytes");
+static_assert(sizeof(UffsIndexHeader) == 512, "UffsIndexHeader must be exactly 512 bytes");
+
+// ============================================================================
+// Checksum (XXH64)
+// ============================================================================
+
+namespace index_format_detail {
+
+static constexpr uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+static constexpr uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+static constexpr uint64_t kPrime3 = 0x165667B19E3779F9ULL;
+static constexpr uint64_t kPrime4 = 0x85EBCA77C2B2AE63ULL;
+static constexpr uint64_t kPrime5 = 0x27D4EB2F165667C5ULL;
+
+inline uint64_t rotl(uint64_t x, int r) noexcept { return (x << r) | (x >> (64 - r)); }
+
+inline uint64_t read64(unsigned char const* p) noexcept
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint32_t read32(unsigned char const* p) noexcept
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint64_t xxh_round(uint64_t acc, uint64_t input) noexcept
+{
+    return rotl(acc + input * kPrime2, 31) * kPrime1;
+}
+
+inline uint64_t merge(uint64_t acc, uint64_t lane) noexcept
+{
+    return (acc ^ xxh_round(0, lane)) * kPrime1 + kPrime4;
+}
+
+} // namespace index_format_detail
+
+/**
+ * @brief 64-bit checksum of a byte range (XXH64, little-endian).
+ *
+ * Runs at memory bandwidth on current hardware, so verifying a section
+ * costs about as much as reading it once.
+ */
+[[nodiscard]] inline uint64_t uffs_index_checksum(void const* data, size_t size, uint64_t seed = 0) noexcept
+{
+    using namespace index_format_detail;
+    unsigned char const* p = static_cast<unsigned char const*>(data);
+    unsigned char const* const end = p + size;
+    uint64_t h;
+
+    if (size >= 32)
+    {
+        uint64_t v1 = seed + kPrime1 + kPrime2, v2 = seed + kPrime2, v3 = seed, v4 = seed - kPrime1;
+        for (unsigned char const* const limit = end - 32; p <= limit; p += 32)
+        {
+            v1 = xxh_round(v1, read64(p));
+            v2 = xxh_round(v2, read64(p + 8));
+            v3 = xxh_round(v3, read64(p + 16));
+            v4 = xxh_round(v4, read64(p + 24));
+        }
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        h = merge(merge(merge(merge(h, v1), v2), v3), v4);
+    }
+    else
+    {
+        h = seed + kPrime5;
+    }
+
+    h += static_cast<uint64_t>(size);
+    for (; end - p >= 8; p += 8)
+    {
+        h = rotl(h ^ xxh_round(0, read64(p)), 27) * kPrime1 + kPrime4;
+    }
+    if (end - p >= 4)
+    {
+        h = rotl(h ^ (read32(p) * kPrime1), 23) * kPrime2 + kPrime3;
+        p += 4;
+    }
+    for (; p < end; ++p)
+    {
+        h = rotl(h ^ (*p * kPrime5), 11) * kPrime1;
+    }
+
+    h ^= h >> 33;
+    h *= kPrime2;
+    h ^= h >> 29;
+    h *= kPrime3;
+    h ^= h >> 32;
+    return h;
+}
+
+// ============================================================================
+// Header helpers
+// ============================================================================
+
+/// Byte size of a section as described by its table entry.
+[[nodiscard]] inline uint64_t uffs_index_section_size(UffsIndexSectionEntry const& section) noexcept
+{
+    return section.count * section.element_size;
+}
+
+/// Checksum over the header bytes that precede UffsIndexHeader::header_checksum.
+[[nodiscard]] inline uint64_t uffs_index_header_checksum(UffsIndexHeader const& header) noexcept
+{
+    return uffs_index_checksum(&header, offsetof(UffsIndexHeader, header_checksum));
+}
+
+/// Builds an empty header with the signature, version and size filled in.
+[[nodiscard]] inline UffsIndexHeader make_uffs_index_header()
+{
+    UffsIndexHeader header = {};
+    memcpy(header.magic, kUffsIndexMagic, sizeof(header.magic));
+    header.version = kUffsIndexVersion;
+    header.header_size = sizeof(UffsIndexHeader);
+    return header;
+}
+
+/**
+ * @brief Assigns page-aligned file offsets to every section.
+ *
+ * Uses the count and element_size already stored in the section table.
+ *
+ * @return Total file size implied by the layout
+ */
+inline uint64_t layout_uffs_index_sections(UffsIndexHeader& header) noexcept
+{
+    uint64_t offset = sizeof(UffsIndexHeader);
+    for (UffsIndexSectionEntry& section : header.sections)
+    {
+        offset = (offset + kUffsIndexSectionAlignment - 1) & ~(kUffsIndexSectionAlignment - 1);
+        section.offset = offset;
+        offset += uffs_index_section_size(section);
+    }
+    return offset;
+}
+
+/**
+ * @brief Checks a header read from a file of the given size.
+ *
+ * Validates the signature, version, header checksum and that every section
+ * is aligned, in order, non-overlapping and inside the file. Section
+ * contents are checked separately by verify_uffs_index_sections().
+ *
+ * @param header     Header as read from offset 0
+ * @param file_size  Total size of the file in bytes (header included)
+ * @return nullptr if the header is usable, otherwise a short description
+ *         of the first problem found
+ */
+[[nodiscard]] inline char const* validate_uffs_index_header(
+    UffsIndexHeader const& header,
+    uint64_t file_size)
+{
+    if (file_size < sizeof(UffsIndexHeader) ||
+        memcmp(header.magic, kUffsIndexMagic, sizeof(header.magic)) != 0)
+    {
+        return "not a UFFS-IDX file (bad signature)";
+    }
+
+    if (header.version != kUffsIndexVersion || header.header_size != sizeof(UffsIndexHeader))
+    {
+        return "unsupported UFFS-IDX version";
+    }
+
+    if (header.header_checksum != uffs_index_header_checksum(header))
+    {
+        return "UFFS-IDX header checksum mismatch";
+    }
+
+    if (header.flags != 0)
+    {
+        return "unsupported UFFS-IDX flags";
+    }
+
+    uint64_t previous_end = sizeof(UffsIndexHeader);
+    for (UffsIndexSectionEntry const& section : header.sections)
+    {
+        if (!section.element_size || section.count > UINT64_MAX / section.element_size)
+        {
+            return "invalid UFFS-IDX section size";
+        }
+
+        uint64_t const size = uffs_index_section_size(section);
+        if (section.offset % kUffsIndexSectionAlignment != 0 || section.offset < previous_end ||
+            section.offset > file_size || size > file_size - section.offset)
+        {
+            return "UFFS-IDX section lies outside the file";
+        }
+
+        previous_end = section.offset + size;
+    }
+
+    return nullptr;
+}
+
+/**
+ * @brief Verifies the checksum of every section.
+ *
+ * @param base    Start of the mapped file
+ * @param header  Header that passed validate_uffs_index_header()
+ * @return nullptr if every section matches, otherwise a description
+ */
+[[nodiscard]] inline char const* verify_uffs_index_sections(
+    void const* base,
+    UffsIndexHeader const& header)
+{
+    for (UffsIndexSectionEntry const& section : header.sections)
+    {
+        unsigned char const* const data = static_cast<unsigned char const*>(base) + section.offset;
+        if (uffs_index_checksum(data, static_cast<size_t>(uffs_index_section_size(section))) != section.checksum)
+        {
+            return "UFFS-IDX section checksum mismatch";
+        }
+    }
+
+    return nullptr;
+}
+
+/**
+ * @brief Writes a complete snapshot to @p out.
+ *
+ * Lays out the sections, checksums them, seals the header and writes the
+ * header, padding and section data in file order. @p header must have the
+ * count and element_size of every section set; everything else in the
+ * section table is filled in here.
+ *
+ * @param out       Binary output stream positioned at offset 0
+ * @param header    Header to complete and write
+ * @param sections  Start of each section's data, indexed by UffsIndexSection
+ * @return true on success, false if the stream failed
+ */
+inline bool write_uffs_index(
+    std::ostream& out,
+    UffsIndexHeader& header,
+    void const* const (&sections)[kUffsIndexSectionCount])
+{
+    layout_uffs_index_sections(header);
+    for (uint32_t i = 0; i != kUffsIndexSectionCount; ++i)
+    {
+        header.sections[i].checksum = uffs_index_checksum(sections[i],
+            static_cast<size_t>(uffs_index_section_size(header.sections[i])));
+    }
+    header.header_checksum = uffs_index_header_checksum(header);
+
+    static char const padding[kUffsIndexSectionAlignment] = {};
+    out.write(reinterpret_cast<char const*>(&header), sizeof(header));
+    uint64_t written = sizeof(header);
+    for (uint32_t i = 0; i != kUffsIndexSectionCount && out; ++i)
+    {
+        UffsIndexSectionEntry const& section = header.sections[i];
+        out.write(padding, static_cast<std::streamsize>(section.offset - written));
+        out.write(static_cast<char const*>(sections[i]), static_cast<std::streamsize>(uffs_index_section_size(section)));
+        written = section.offset + uffs_index_section_size(section);
+    }
+
+    return !!out.flush();
+}
+
+} // namespace uffs
+
+// Expose at global scope for backward compatibility
+using uffs::UffsIndexHeader;
+
+#endif // UFFS_UFFS_INDEX_FORMAT_HPP
@@ -0,0 +1,534 @@
+/**
+ * @file uffs_mft_codec.hpp
+ * @brief Parallel frame encoder/decoder for block-compressed UFFS-MFT files.
+ *
+ * Splits a record stream into independent frames (see uffs_mft_format.hpp)
+ * and encodes or decodes them on all cores:
+ *
+ * ```
+ *   raw records ──► batch of N frames ──► N threads: encode_uffs_mft_frame()
+ *                                          │
+ *                                          ▼
+ *                         sink (in order): frame 0 | frame 1 | ...
+ *                                          │
+ *                                    finish(): frame index
+ * ```
+ *
+ * Frames that are entirely zero (unused MFT records that were never
+ * written) are not stored at all; other frames are LZ4 blocks, or raw bytes
+ * when compression would not shrink them.
+ *
+ * Memory use of the writer is bounded by one batch: frame_size x threads
+ * raw bytes plus their encoded copies.
+ *
+ * UffsMftStreamReader reads the streamed layout back from a pipe, handing
+ * out one frame at a time to be decoded wherever the caller likes.
+ *
+ * @note No Windows dependencies, so this header can be unit-tested.
+ *
+ * @see uffs_mft_format.hpp for the file layout
+ * @see lz4_block.hpp for the block codec
+ */
+
+#ifndef UFFS_UFFS_MFT_CODEC_HPP
+#define UFFS_UFFS_MFT_CODEC_HPP
+
+#include "lz4_block.hpp"
+#include "uffs_mft_format.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace uffs {
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+/**
+ * @brief Runs fn(i) for i in [0, count) on up to @p threads threads.
+ *
+ * The calling thread takes part. The first exception thrown by any call is
+ * rethrown after all threads have finished.
+ */
+template <class F>
+inline void parallel_for_each_index(size_t count, unsigned int threads, F&& fn)
+{
+    if (!threads)
+    {
+        threads = std::max(1U, std::thread::hardware_concurrency());
+    }
+    threads = static_cast<unsigned int>(std::min<size_t>(threads, count));
+
+    std::atomic<size_t> next(0);
+    std::exception_ptr error;
+    std::atomic<bool> failed(false);
+
+    auto const run = [&]()
+    {
+        for (size_t i; !failed.load(std::memory_order_relaxed) &&
+             (i = next.fetch_add(1, std::memory_order_relaxed)) < count;)
+        {
+            try
+            {
+                fn(i);
+            }
+            catch (...)
+            {
+                if (!failed.exchange(true))
+                {
+                    error = std::current_exception();
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned int t = 1; t < threads; ++t)
+    {
+        workers.emplace_back(run);
+    }
+    run();
+    for (auto& w : workers)
+    {
+        w.join();
+    }
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+/// True if all @p size bytes at @p data are zero.
+[[nodiscard]] inline bool is_all_zero(unsigned char const* data, size_t size) noexcept
+{
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+    {
+        uint64_t v;
+        memcpy(&v, data + i, sizeof(v));
+        if (v)
+        {
+            return false;
+        }
+    }
+    for (; i < size; ++i)
+    {
+        if (data[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// ============================================================================
+// Single Frame Encode / Decode
+// ============================================================================
+
+/**
+ * @brief Encodes one frame.
+ *
+ * @param raw   Decoded frame bytes
+ * @param size  Decoded frame size
+ * @param out   Receives the encoded bytes (empty for an all-zero frame)
+ */
+inline void encode_uffs_mft_frame(unsigned char const* raw, size_t size, std::vector<unsigned char>& out)
+{
+    out.clear();
+    if (is_all_zero(raw, size))
+    {
+        return;
+    }
+
+    out.resize(lz4::compress_bound(size));
+    size_t const encoded = lz4::compress(raw, size, out.data(), out.size());
+    if (encoded && encoded < size)
+    {
+        out.resize(encoded);
+    }
+    else
+    {
+        out.assign(raw, raw + size);  // incompressible: store raw
+    }
+}
+
+/**
+ * @brief Decodes one frame.
+ *
+ * @param encoded       Encoded frame bytes
+ * @param encoded_size  UffsMftFrame::encoded_size
+ * @param out           Output buffer of @p decoded_size bytes
+ * @param decoded_size  uffs_mft_frame_decoded_size() for this frame
+ * @return false if the frame is corrupt
+ */
+[[nodiscard]] inline bool decode_uffs_mft_frame(unsigned char const* encoded, size_t encoded_size,
+    unsigned char* out, size_t decoded_size)
+{
+    if (encoded_size == 0)
+    {
+        memset(out, 0, decoded_size);
+        return true;
+    }
+
+    if (encoded_size == decoded_size)
+    {
+        memcpy(out, encoded, decoded_size);
+        return true;
+    }
+
+    return lz4::decompress(encoded, encoded_size, out, decoded_size);
+}
+
+/**
+ * @brief Reads and validates the frame index of a block-compressed file.
+ *
+ * Files with frame prefixes have no index; it is rebuilt by walking the
+ * prefixes, which must all lie within compressed_size bytes.
+ *
+ * @param file       Start of the file (header at offset 0)
+ * @param header     Header that passed validate_uffs_mft_header(), with
+ *                   compressed_size filled in for prefixed files
+ * @param frames     Receives one entry per frame
+ * @return nullptr on success, otherwise a description of the problem
+ */
+[[nodiscard]] inline char const* read_uffs_mft_frame_index(unsigned char const* file,
+    UffsMftHeader const& header, std::vector<UffsMftFrame>& frames)
+{
+    uint64_t const count = uffs_mft_frame_count(header);
+    frames.resize(static_cast<size_t>(count));
+    if (header.flags & kUffsMftFlagFramePrefixes)
+    {
+        uint64_t const data_end = sizeof(UffsMftHeader) + header.compressed_size;
+        uint64_t offset = sizeof(UffsMftHeader);
+        for (UffsMftFrame& frame : frames)
+        {
+            if (data_end - offset < sizeof(frame.encoded_size))
+            {
+                return "file is truncated";
+            }
+            memcpy(&frame.encoded_size, file + offset, sizeof(frame.encoded_size));
+            frame.offset = offset + sizeof(frame.encoded_size);
+            offset = frame.offset + std::min<uint64_t>(frame.encoded_size, data_end - frame.offset);
+        }
+    }
+    else if (count)
+    {
+        memcpy(frames.data(), file + sizeof(UffsMftHeader) + header.compressed_size,
+            static_cast<size_t>(count) * sizeof(UffsMftFrame));
+    }
+
+    for (uint64_t i = 0; i < count; ++i)
+    {
+        if (char const* const error = validate_uffs_mft_frame(header, frames[static_cast<size_t>(i)], i))
+        {
+            return error;
+        }
+    }
+
+    return nullptr;
+}
+
+// ============================================================================
+// Streaming Writer
+// ============================================================================
+
+/**
+ * @class UffsMftFrameWriter
+ * @brief Turns a raw record stream into encoded frames plus a frame index.
+ *
+ * Bytes passed to write() are buffered until a batch of one frame per
+ * thread is full, then the batch is encoded in parallel and handed to the
+ * sink in order. finish() flushes the tail and appends the frame index.
+ * The caller writes the 64-byte header before the first frame and patches
+ * it with complete_header() once finish() has returned.
+ *
+ * With frame prefixes the output needs no patching and can go to a pipe:
+ * call complete_header() before writing the header, and finish() writes
+ * no frame index.
+ */
+class UffsMftFrameWriter
+{
+public:
+    /// Receives output bytes in file order; returns false on I/O error.
+    using Sink = std::function<bool(void const* data, size_t size)>;
+
+    UffsMftFrameWriter(uint32_t frame_size, unsigned int threads, Sink sink, bool frame_prefixes = false)
+        : frame_size_(frame_size)
+        , threads_(threads ? threads : std::max(1U, std::thread::hardware_concurrency()))
+        , frame_prefixes_(frame_prefixes)
+        , sink_(std::move(sink))
+        , batch_(static_cast<size_t>(frame_size) * threads_)
+        , batch_used_(0)
+        , encoded_(threads_)
+        , next_offset_(sizeof(UffsMftHeader))
+    {
+    }
+
+    /// Appends raw record bytes. Returns false if the sink failed.
+    [[nodiscard]] bool write(void const* data, size_t size)
+    {
+        auto const* bytes = static_cast<unsigned char const*>(data);
+        while (size)
+        {
+            size_t const n = std::min(size, batch_.size() - batch_used_);
+            memcpy(batch_.data() + batch_used_, bytes, n);
+            batch_used_ += n;
+            bytes += n;
+            size -= n;
+
+            if (batch_used_ == batch_.size() && !this->flush())
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// Appends @p size zero bytes, e.g. a run of unused records. Returns false if the sink failed.
+    [[nodiscard]] bool write_zeros(unsigned long long size)
+    {
+        while (size)
+        {
+            size_t const n = static_cast<size_t>(std::min<unsigned long long>(size, batch_.size() - batch_used_));
+            memset(batch_.data() + batch_used_, 0, n);
+            batch_used_ += n;
+            size -= n;
+
+            if (batch_used_ == batch_.size() && !this->flush())
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// Encodes buffered bytes and writes the frame index. Returns false if the sink failed.
+    [[nodiscard]] bool finish()
+    {
+        if (!this->flush())
+        {
+            return false;
+        }
+        return frames_.empty() || frame_prefixes_ ||
+            sink_(frames_.data(), frames_.size() * sizeof(UffsMftFrame));
+    }
+
+    /// Marks @p header as block-compressed and records the frame data size.
+    void complete_header(UffsMftHeader& header) const noexcept
+    {
+        header.flags |= kUffsMftFlagLz4Frames | (frame_prefixes_ ? kUffsMftFlagFramePrefixes : 0);
+        header.frame_size = frame_size_;
+        header.compressed_size = next_offset_ - sizeof(UffsMftHeader);
+    }
+
+    [[nodiscard]] std::vector<UffsMftFrame> const& frames() const noexcept { return frames_; }
+
+    /// Bytes of encoded frame data written so far.
+    [[nodiscard]] uint64_t compressed_size() const noexcept { return next_offset_ - sizeof(UffsMftHeader); }
+
+private:
+    uint32_t frame_size_;
+    unsigned int threads_;
+    bool frame_prefixes_;
+    Sink sink_;
+    std::vector<unsigned char> batch_;
+    size_t batch_used_;
+    std::vector<std::vector<unsigned char>> encoded_;
+    std::vector<UffsMftFrame> frames_;
+    uint64_t next_offset_;
+
+    bool flush()
+    {
+        size_t const count = (batch_used_ + frame_size_ - 1) / frame_size_;
+
+        parallel_for_each_index(count, threads_, [&](size_t i)
+        {
+            size_t const begin = i * frame_size_;
+            encode_uffs_mft_frame(batch_.data() + begin,
+                std::min<size_t>(frame_size_, batch_used_ - begin), encoded_[i]);
+        });
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            UffsMftFrame frame = {};
+            frame.encoded_size = static_cast<uint32_t>(encoded_[i].size());
+            if (frame_prefixes_)
+            {
+                if (!sink_(&frame.encoded_size, sizeof(frame.encoded_size)))
+                {
+                    return false;
+                }
+                next_offset_ += sizeof(frame.encoded_size);
+            }
+            frame.offset = next_offset_;
+            frames_.push_back(frame);
+
+            if (!encoded_[i].empty() && !sink_(encoded_[i].data(), encoded_[i].size()))
+            {
+                return false;
+            }
+            next_offset_ += encoded_[i].size();
+        }
+
+        batch_used_ = 0;
+        return true;
+    }
+};
+
+// ============================================================================
+// Streaming Reader
+// ============================================================================
+
+/**
+ * @class UffsMftStreamReader
+ * @brief Reads a UFFS-MFT file front to back from a source that cannot seek.
+ *
+ * Hands out the record stream one slice at a time, in order: plain files
+ * in slices of about @p slice_size bytes, block-compressed files one frame
+ * per slice, still encoded so the caller can decode() them on any thread.
+ * Only files that is_streamable_uffs_mft() accepts can be read.
+ *
+ * ```cpp
+ * UffsMftStreamReader reader(source, 1 << 20);
+ * for (UffsMftStreamReader::Slice slice; reader.next(slice);)
+ * {
+ *     UffsMftStreamReader::decode(slice);
+ *     use(slice.offset, slice.bytes.data(), slice.bytes.size());
+ * }
+ * ```
+ */
+class UffsMftStreamReader
+{
+public:
+    /// Reads up to @p size bytes into @p data; returns 0 only at the end of the stream.
+    using Source = std::function<size_t(void* data, size_t size)>;
+
+    struct Slice
+    {
+        uint64_t offset = 0;               ///< Offset of the records in the decoded stream
+        size_t size = 0;                   ///< Decoded size
+        bool encoded = false;              ///< bytes holds an encoded frame
+        std::vector<unsigned char> bytes;  ///< Records, or the encoded frame
+    };
+
+    /**
+     * @brief Reads and checks the header.
+     * @throws std::runtime_error if the stream is not a streamable UFFS-MFT file
+     */
+    UffsMftStreamReader(Source source, size_t slice_size)
+        : source_(std::move(source))
+        , header_()
+        , next_offset_(0)
+    {
+        this->read_exactly(&header_, sizeof(header_));
+        if (char const* const error = validate_uffs_mft_header(header_, UINT64_MAX))
+        {
+            throw std::runtime_error(error);
+        }
+        if (!is_streamable_uffs_mft(header_))
+        {
+            throw std::runtime_error("frame index is at the end of the file; index the file instead of piping it");
+        }
+        size_t const record_size = header_.record_size;  // std::max must not bind to the packed header
+        slice_size_ = header_.flags & kUffsMftFlagLz4Frames
+            ? header_.frame_size
+            : std::max(slice_size - slice_size % record_size, record_size);
+    }
+
+    [[nodiscard]] UffsMftHeader const& header() const noexcept { return header_; }
+
+    /// Largest decoded slice size.
+    [[nodiscard]] size_t slice_size() const noexcept { return slice_size_; }
+
+    /**
+     * @brief Reads the next slice.
+     * @return false once every record has been read; trailing bytes are left unread
+     * @throws std::runtime_error if the stream ends early or a frame prefix is invalid
+     */
+    bool next(Slice& slice)
+    {
+        if (next_offset_ >= header_.original_size)
+        {
+            return false;
+        }
+
+        slice.offset = next_offset_;
+        slice.size = static_cast<size_t>(std::min<uint64_t>(slice_size_, header_.original_size - next_offset_));
+        slice.encoded = !!(header_.flags & kUffsMftFlagLz4Frames);
+
+        size_t encoded_size = slice.size;
+        if (slice.encoded)
+        {
+            uint32_t prefix;
+            this->read_exactly(&prefix, sizeof(prefix));
+            if (prefix > slice.size)
+            {
+                throw std::runtime_error("frame is larger than its decoded size");
+            }
+            encoded_size = prefix;
+        }
+
+        slice.bytes.resize(encoded_size);
+        if (encoded_size)
+        {
+            this->read_exactly(slice.bytes.data(), encoded_size);
+        }
+        next_offset_ += slice.size;
+        return true;
+    }
+
+    /**
+     * @brief Replaces an encoded slice by its records.
+     * @throws std::runtime_error if the frame is corrupt
+     */
+    static void decode(Slice& slice)
+    {
+        if (!slice.encoded)
+        {
+            return;
+        }
+
+        std::vector<unsigned char> decoded(slice.size);
+        if (!decode_uffs_mft_frame(slice.bytes.data(), slice.bytes.size(), decoded.data(), decoded.size()))
+        {
+            throw std::runtime_error("corrupt UFFS-MFT frame");
+        }
+        slice.bytes.swap(decoded);
+        slice.encoded = false;
+    }
+
+private:
+    Source source_;
+    UffsMftHeader header_;
+    size_t slice_size_;
+    uint64_t next_offset_;
+
+    void read_exactly(void* data, size_t size)
+    {
+        auto* bytes = static_cast<unsigned char*>(data);
+        while (size)
+        {
+            size_t const n = source_(bytes, size);
+            if (!n)
+            {
+                throw std::runtime_error("stream ended early");
+            }
+            bytes += n;
+            size -= n;
+        }
+    }
+};
+
+} // namespace uffs
+
+#endif // UFFS_UFFS_MFT_CODEC_HPP
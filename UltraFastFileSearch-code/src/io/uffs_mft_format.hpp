@@ -0,0 +1,311 @@
+/**
+ * @file uffs_mft_format.hpp
+ * @brief On-disk layout of UFFS-MFT dump files.
+ *
+ * A UFFS-MFT file is a raw copy of a volume's $MFT::$DATA stream preceded
+ * by a fixed 64-byte header. It is written by `--dump-mft` and read back by
+ * the offline index builder (`--index-from`), so both sides share the
+ * definitions in this header.
+ *
+ * ## File Layout (version 1, uncompressed)
+ *
+ * ```
+ * Offset 0                    64                                  64 + N
+ * ┌──────────────────────────┬───────────────────────────────────┐
+ * │ UffsMftHeader (64 bytes) │ record 0 | record 1 | ... | N - 1 │
+ * └──────────────────────────┴───────────────────────────────────┘
+ *                             N = record_size * record_count = original_size
+ * ```
+ *
+ * Records are stored exactly as read from disk, i.e. still protected by
+ * the multi-sector update sequence. Readers must run the normal fixup
+ * (NtfsIndex::preload_concurrent does this) before parsing them.
+ *
+ * ## Block-Compressed Layout (flags & kUffsMftFlagLz4Frames)
+ *
+ * ```
+ * ┌────────┬─────────┬─────────┬─────┬─────────────┬────────────────────┐
+ * │ header │ frame 0 │ frame 1 │ ... │ frame n - 1 │ frame index        │
+ * │ 64 B   │         │         │     │             │ n x UffsMftFrame   │
+ * └────────┴─────────┴─────────┴─────┴─────────────┴────────────────────┘
+ *           └──────────── compressed_size bytes ───┘
+ * ```
+ *
+ * The record stream is cut into frames of `frame_size` bytes (the last one
+ * may be shorter), and each frame is encoded on its own so any frame can be
+ * decoded without the others, in parallel. The frame index starts at
+ * 64 + compressed_size and gives each frame's file offset and encoded size:
+ *
+ * | encoded size          | frame contents                     |
+ * |-----------------------|------------------------------------|
+ * | 0                     | all zero bytes (nothing stored)    |
+ * | == decoded size       | stored uncompressed                |
+ * | anything else         | one LZ4 block (see lz4_block.hpp)  |
+ *
+ * ## Streamed Layout (flags & kUffsMftFlagFramePrefixes)
+ *
+ * A writer that cannot seek (stdout, a pipe) cannot put the frame index at
+ * the end nor patch the header afterwards. It prefixes every frame with its
+ * encoded size instead and writes no frame index, so a reader can decode
+ * the file front to back without seeking:
+ *
+ * ```
+ * ┌────────┬──────┬─────────┬──────┬─────────┬─────
+ * │ header │ size │ frame 0 │ size │ frame 1 │ ...      size: uint32, encoded size
+ * │ 64 B   │ 4 B  │         │ 4 B  │         │
+ * └────────┴──────┴─────────┴──────┴─────────┴─────
+ * ```
+ *
+ * compressed_size counts the prefixes, or is 0 if the writer did not know
+ * it when the header went out. Uncompressed files are streamable as they are.
+ *
+ * @note No Windows dependencies, so this header can be unit-tested.
+ *
+ * @see mft_diagnostics.cpp for the writer (dump_raw_mft)
+ * @see mft_dump_replay.hpp for the reader (offline index build)
+ * @see mft_stream_replay.hpp for the reader of piped dumps (`--index-from -`)
+ */
+
+#ifndef UFFS_UFFS_MFT_FORMAT_HPP
+#define UFFS_UFFS_MFT_FORMAT_HPP
+
+#include <cstdint>
+#include <cstring>
+
+namespace uffs {
+
+// ============================================================================
+// Format Constants
+// ============================================================================
+
+/// File signature stored in UffsMftHeader::magic (not NUL-terminated).
+static constexpr char kUffsMftMagic[8] = { 'U', 'F', 'F', 'S', '-', 'M', 'F', 'T' };
+
+/// Current format version written by dump_raw_mft.
+static constexpr uint32_t kUffsMftVersion = 1;
+
+/// UffsMftHeader::flags value for a plain, uncompressed record stream.
+static constexpr uint32_t kUffsMftFlagNone = 0;
+
+/// UffsMftHeader::flags bit: records are stored as independent LZ4 frames
+/// followed by a frame index.
+static constexpr uint32_t kUffsMftFlagLz4Frames = 0x00000001;
+
+/// UffsMftHeader::flags bit (with kUffsMftFlagLz4Frames): every frame is
+/// preceded by its encoded size and there is no frame index.
+static constexpr uint32_t kUffsMftFlagFramePrefixes = 0x00000002;
+
+/// Default decoded bytes per frame (a multiple of every legal record size).
+static constexpr uint32_t kUffsMftDefaultFrameSize = 4 << 20;
+
+/// Smallest and largest MFT record sizes accepted by readers.
+/// NTFS uses 1 KB records by default and 4 KB on 4Kn drives.
+static constexpr uint32_t kUffsMftMinRecordSize = 512;
+static constexpr uint32_t kUffsMftMaxRecordSize = 64 * 1024;
+
+// ============================================================================
+// UFFS-MFT Header structure (64 bytes)
+// ============================================================================
+#pragma pack(push, 1)
+struct UffsMftHeader
+{
+    char magic[8];           // "UFFS-MFT"
+    uint32_t version;        // 1
+    uint32_t flags;          // 0 = no compression
+    uint32_t record_size;    // e.g., 1024
+    uint64_t record_count;   // number of MFT records
+    uint64_t original_size;  // total bytes = record_size * record_count
+    uint64_t compressed_size;// 0 for uncompressed, else bytes of frame data
+    char volume_letter;      // source drive letter ('C'), 0 if unknown
+    uint32_t frame_size;     // decoded bytes per frame, 0 for uncompressed
+    uint8_t reserved[15];    // padding to 64 bytes
+};
+
+/// Frame index entry (block-compressed files only).
+struct UffsMftFrame
+{
+    uint64_t offset;         // file offset of the encoded frame
+    uint32_t encoded_size;   // 0 = zero frame, decoded size = stored raw
+    uint32_t reserved;       // 0
+};
+#pragma pack(pop)
+
+static_assert(sizeof(UffsMftHeader) == 64, "UffsMftHeader must be exactly 64 bytes");
+static_assert(sizeof(UffsMftFrame) == 16, "UffsMftFrame must be exactly 16 bytes");
+
+/**
+ * @brief Builds a header for an uncompressed dump.
+ *
+ * @param record_size    MFT record size in bytes
+ * @param record_count   Number of records that follow the header
+ * @param volume_letter  Source drive letter, or 0 if unknown
+ */
+[[nodiscard]] inline UffsMftHeader make_uffs_mft_header(
+    uint32_t record_size,
+    uint64_t record_count,
+    char volume_letter)
+{
+    UffsMftHeader header = {};
+    memcpy(header.magic, kUffsMftMagic, sizeof(header.magic));
+    header.version = kUffsMftVersion;
+    header.flags = kUffsMftFlagNone;
+    header.record_size = record_size;
+    header.record_count = record_count;
+    header.original_size = static_cast<uint64_t>(record_size) * record_count;
+    header.compressed_size = 0;
+    header.volume_letter = volume_letter;
+    return header;
+}
+
+/// Number of frames in a block-compressed file.
+[[nodiscard]] inline uint64_t uffs_mft_frame_count(UffsMftHeader const& header) noexcept
+{
+    return header.frame_size
+        ? (header.original_size + header.frame_size - 1) / header.frame_size
+        : 0;
+}
+
+/// Decoded size of frame @p i (only the last frame can be short).
+[[nodiscard]] inline uint32_t uffs_mft_frame_decoded_size(UffsMftHeader const& header, uint64_t i) noexcept
+{
+    uint64_t const begin = i * header.frame_size;
+    uint64_t const remaining = header.original_size > begin ? header.original_size - begin : 0;
+    return static_cast<uint32_t>(remaining < header.frame_size ? remaining : header.frame_size);
+}
+
+/// True if the file can be read front to back without seeking.
+[[nodiscard]] inline bool is_streamable_uffs_mft(UffsMftHeader const& header) noexcept
+{
+    return !(header.flags & kUffsMftFlagLz4Frames) || !!(header.flags & kUffsMftFlagFramePrefixes);
+}
+
+/**
+ * @brief Checks a header read from a file of the given size.
+ *
+ * Validates the signature, version, record geometry and that the file is
+ * large enough to hold every record (or, for block-compressed files, every
+ * frame and the frame index) the header announces. Trailing bytes are
+ * tolerated. Frame index entries are checked by validate_uffs_mft_frame().
+ *
+ * @param header     Header as read from offset 0
+ * @param file_size  Total size of the file in bytes (header included),
+ *                   UINT64_MAX for a stream of unknown length
+ * @return nullptr if the header is usable, otherwise a short description
+ *         of the first problem found
+ */
+[[nodiscard]] inline char const* validate_uffs_mft_header(
+    UffsMftHeader const& header,
+    uint64_t file_size)
+{
+    if (memcmp(header.magic, kUffsMftMagic, sizeof(header.magic)) != 0)
+    {
+        return "not a UFFS-MFT file (bad signature)";
+    }
+
+    if (header.version != kUffsMftVersion)
+    {
+        return "unsupported UFFS-MFT version";
+    }
+
+    if ((header.flags & ~(kUffsMftFlagLz4Frames | kUffsMftFlagFramePrefixes)) ||
+        (header.flags & (kUffsMftFlagLz4Frames | kUffsMftFlagFramePrefixes)) == kUffsMftFlagFramePrefixes)
+    {
+        return "unsupported UFFS-MFT flags";
+    }
+
+    // Record size must be a power of two: NtfsIndex::load divides by shifting
+    if (header.record_size < kUffsMftMinRecordSize ||
+        header.record_size > kUffsMftMaxRecordSize ||
+        (header.record_size & (header.record_size - 1)) != 0)
+    {
+        return "invalid MFT record size";
+    }
+
+    if (header.record_count > (UINT64_MAX - sizeof(UffsMftHeader)) / header.record_size ||
+        header.original_size != static_cast<uint64_t>(header.record_size) * header.record_count)
+    {
+        return "record count does not match original size";
+    }
+
+    // NtfsIndex addresses records with 32-bit FRS numbers
+    if (header.record_count > UINT32_MAX)
+    {
+        return "too many records";
+    }
+
+    if (!(header.flags & kUffsMftFlagLz4Frames))
+    {
+        if (file_size < sizeof(UffsMftHeader) ||
+            file_size - sizeof(UffsMftHeader) < header.original_size)
+        {
+            return "file is truncated";
+        }
+
+        return nullptr;
+    }
+
+    // Frames must hold whole records so each one can be parsed on its own
+    if (!header.frame_size || header.frame_size % header.record_size != 0)
+    {
+        return "invalid frame size";
+    }
+
+    // Prefixed frames are checked as they are read; there is no index to fit
+    if (header.flags & kUffsMftFlagFramePrefixes)
+    {
+        if (file_size < sizeof(UffsMftHeader) ||
+            file_size - sizeof(UffsMftHeader) < header.compressed_size)
+        {
+            return "file is truncated";
+        }
+
+        return nullptr;
+    }
+
+    uint64_t const frame_count = uffs_mft_frame_count(header);
+    if (file_size < sizeof(UffsMftHeader) ||
+        file_size - sizeof(UffsMftHeader) < header.compressed_size ||
+        (file_size - sizeof(UffsMftHeader) - header.compressed_size) / sizeof(UffsMftFrame) < frame_count)
+    {
+        return "file is truncated";
+    }
+
+    return nullptr;
+}
+
+/**
+ * @brief Checks one frame index entry against the header.
+ *
+ * @param header  Validated header of a block-compressed file
+ * @param frame   Entry @p i of the frame index
+ * @param i       Frame number
+ * @return nullptr if the entry is usable, otherwise a description
+ */
+[[nodiscard]] inline char const* validate_uffs_mft_frame(
+    UffsMftHeader const& header,
+    UffsMftFrame const& frame,
+    uint64_t i)
+{
+    uint64_t const data_begin = sizeof(UffsMftHeader);
+    uint64_t const data_end = data_begin + header.compressed_size;
+
+    if (frame.offset < data_begin || frame.offset > data_end ||
+        frame.encoded_size > data_end - frame.offset)
+    {
+        return "frame lies outside the frame data";
+    }
+
+    if (frame.encoded_size > uffs_mft_frame_decoded_size(header, i))
+    {
+        return "frame is larger than its decoded size";
+    }
+
+    return nullptr;
+}
+
+} // namespace uffs
+
+// Expose at global scope for backward compatibility
+using uffs::UffsMftHeader;
+
+#endif // UFFS_UFFS_MFT_FORMAT_HPP
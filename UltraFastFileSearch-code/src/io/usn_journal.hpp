@@ -0,0 +1,437 @@
+/**
+ * @file usn_journal.hpp
+ * @brief USN change journal ($Extend\$UsnJrnl:$J) record parser and event builder.
+ *
+ * NTFS logs every change to a file as a USN record appended to the $J
+ * stream of $UsnJrnl. Replaying those records against a finished index
+ * refreshes it without reading the MFT again. This header turns raw $J
+ * bytes (extracted to a file, or captured from FSCTL_READ_USN_JOURNAL)
+ * into index-level events; NtfsIndex::apply_usn_events applies them.
+ *
+ * ## Pipeline
+ *
+ * ```
+ *   $J bytes ──► parse_usn_records() ──► UsnRecord ──► UsnEventBuilder ──► UsnEvent
+ *                (V2 / V3, skips V4,                   (one per CLOSE,      Create, Delete,
+ *                 sparse zero runs)                     pairs renames)      Rename, Link, ...
+ * ```
+ *
+ * ## Record Layout
+ *
+ * ```
+ * Offset  V2                      V3
+ * 0x00    RecordLength u32        RecordLength u32
+ * 0x04    MajorVersion u16        MajorVersion u16
+ * 0x06    MinorVersion u16        MinorVersion u16
+ * 0x08    FileReference u64       FileReference u128
+ * 0x10    ParentReference u64     (0x18) ParentReference u128
+ * 0x18    Usn i64                 (0x28) Usn i64
+ * 0x20    TimeStamp i64           (0x30) TimeStamp i64
+ * 0x28    Reason u32              (0x38) Reason u32
+ * 0x2C    SourceInfo u32          (0x3C) SourceInfo u32
+ * 0x30    SecurityId u32          (0x40) SecurityId u32
+ * 0x34    FileAttributes u32      (0x44) FileAttributes u32
+ * 0x38    FileNameLength u16      (0x48) FileNameLength u16 (bytes)
+ * 0x3A    FileNameOffset u16      (0x4A) FileNameOffset u16
+ * ```
+ *
+ * On NTFS the low 64 bits of a V3 file ID are the classic file reference
+ * (48-bit FRS + 16-bit sequence number), so both versions map onto the
+ * same UsnRecord. Records are 8-byte aligned; $J is sparse and reads as
+ * zeros below the first valid USN, which the parser skips.
+ *
+ * ## Event Model
+ *
+ * NTFS writes several records per open handle, each carrying the reasons
+ * accumulated so far, and a final one with USN_REASON_CLOSE. The builder
+ * only acts on the close record (which holds every reason and the final
+ * name), except for renames: the old name appears only in the earlier
+ * RENAME_OLD_NAME record, so it is remembered per file until the close.
+ *
+ * The journal does not record file sizes. Size events therefore carry
+ * has_size = false unless the caller fills them in (e.g. from a live
+ * volume); NtfsIndex::apply_usn_events skips size events without sizes.
+ *
+ * @note No Windows dependencies, so this header can be unit-tested.
+ *
+ * @see ntfs_index_usn.hpp for NtfsIndex::apply_usn_events
+ */
+
+#ifndef UFFS_USN_JOURNAL_HPP
+#define UFFS_USN_JOURNAL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace uffs {
+
+// ============================================================================
+// Journal Constants
+// ============================================================================
+
+/// USN_REASON_* flags (winioctl.h), as stored in UsnRecord::reason.
+enum UsnReason : uint32_t
+{
+    kUsnReasonDataOverwrite       = 0x00000001,
+    kUsnReasonDataExtend          = 0x00000002,
+    kUsnReasonDataTruncation      = 0x00000004,
+    kUsnReasonNamedDataOverwrite  = 0x00000010,
+    kUsnReasonNamedDataExtend     = 0x00000020,
+    kUsnReasonNamedDataTruncation = 0x00000040,
+    kUsnReasonFileCreate          = 0x00000100,
+    kUsnReasonFileDelete          = 0x00000200,
+    kUsnReasonRenameOldName       = 0x00001000,
+    kUsnReasonRenameNewName       = 0x00002000,
+    kUsnReasonBasicInfoChange     = 0x00008000,
+    kUsnReasonHardLinkChange      = 0x00010000,
+    kUsnReasonClose               = 0x80000000,
+
+    /// Any reason that changes the size of a stream.
+    kUsnReasonSizeChangeMask      = kUsnReasonDataOverwrite | kUsnReasonDataExtend | kUsnReasonDataTruncation |
+                                    kUsnReasonNamedDataOverwrite | kUsnReasonNamedDataExtend |
+                                    kUsnReasonNamedDataTruncation,
+};
+
+/// FILE_ATTRIBUTE_DIRECTORY, as stored in UsnRecord::attributes.
+static constexpr uint32_t kUsnFileAttributeDirectory = 0x10;
+
+/// Size of the fixed part of a USN_RECORD_V2 (up to the file name).
+static constexpr uint32_t kUsnRecordV2HeaderSize = 0x3C;
+
+/// Size of the fixed part of a USN_RECORD_V3 (up to the file name).
+static constexpr uint32_t kUsnRecordV3HeaderSize = 0x4C;
+
+/// Mask extracting the FRS number from a 64-bit NTFS file reference.
+static constexpr uint64_t kUsnFrsMask = 0x0000FFFFFFFFFFFFULL;
+
+// ============================================================================
+// Parsed Records
+// ============================================================================
+
+/**
+ * @brief One V2 or V3 journal record, version-independent.
+ *
+ * The name is not copied: name_bytes points into the parsed buffer and
+ * holds name_length UTF-16LE code units (not necessarily 2-byte aligned).
+ */
+struct UsnRecord
+{
+    uint16_t major_version = 0;
+    uint64_t file_reference = 0;    ///< FRS in the low 48 bits, sequence number above
+    uint64_t parent_reference = 0;
+    int64_t usn = 0;
+    int64_t timestamp = 0;          ///< FILETIME (100 ns since 1601)
+    uint32_t reason = 0;            ///< UsnReason flags
+    uint32_t source_info = 0;
+    uint32_t attributes = 0;        ///< FILE_ATTRIBUTE_* flags
+    unsigned char const* name_bytes = nullptr;
+    size_t name_length = 0;         ///< In UTF-16 code units
+
+    uint64_t frs() const noexcept { return file_reference & kUsnFrsMask; }
+    uint64_t parent_frs() const noexcept { return parent_reference & kUsnFrsMask; }
+    uint16_t sequence() const noexcept { return static_cast<uint16_t>(file_reference >> 48); }
+
+    /// Copies the name out of the buffer.
+    std::u16string name() const
+    {
+        std::u16string result(name_length, u'\0');
+        if (name_length)
+        {
+            memcpy(&result[0], name_bytes, name_length * sizeof(char16_t));
+        }
+        return result;
+    }
+};
+
+/// Outcome of parse_usn_records().
+struct UsnParseResult
+{
+    size_t consumed = 0;            ///< Bytes fully processed (records and padding)
+    size_t records = 0;             ///< V2/V3 records passed to the callback
+    size_t skipped = 0;             ///< Well-formed records of other versions (e.g. V4 ranges)
+    char const* error = nullptr;    ///< Set if a malformed record stopped parsing
+};
+
+namespace usn_journal_detail {
+
+template<class T>
+inline T read(unsigned char const* p) noexcept
+{
+    T value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+} // namespace usn_journal_detail
+
+/**
+ * @brief Parses a buffer of USN records and calls @p on_record for each one.
+ *
+ * Zero bytes between records (sparse $J regions, page padding) are skipped
+ * in 8-byte steps. A record that runs past the end of the buffer stops
+ * parsing without an error, and consumed points at its start, so streaming
+ * callers can carry the tail over to the next read. A record that can never
+ * be valid (bad length, name outside the record) stops parsing with an error.
+ *
+ * @param data       Raw $J bytes, starting on a record boundary
+ * @param size       Number of bytes in @p data
+ * @param on_record  Called as on_record(UsnRecord const&)
+ */
+template<class F>
+UsnParseResult parse_usn_records(void const* const data, size_t const size, F&& on_record)
+{
+    using usn_journal_detail::read;
+    UsnParseResult result;
+    unsigned char const* const base = static_cast<unsigned char const*>(data);
+
+    size_t offset = 0;
+    while (size - offset >= sizeof(uint32_t))
+    {
+        unsigned char const* const p = base + offset;
+        uint32_t const record_length = read<uint32_t>(p);
+        if (record_length == 0)
+        {
+            offset += size - offset >= 8 ? 8 : size - offset;
+            result.consumed = offset;
+            continue;
+        }
+        if (record_length < 8 || record_length % 8 != 0)
+        {
+            result.error = "USN record has an invalid length";
+            break;
+        }
+        if (record_length > size - offset)
+        {
+            break;  // truncated; caller may supply the rest
+        }
+
+        uint16_t const major = read<uint16_t>(p + 4);
+        if (major == 2 || major == 3)
+        {
+            bool const v3 = major == 3;
+            uint32_t const header_size = v3 ? kUsnRecordV3HeaderSize : kUsnRecordV2HeaderSize;
+            if (record_length < header_size)
+            {
+                result.error = "USN record is shorter than its header";
+                break;
+            }
+
+            unsigned char const* const q = p + (v3 ? 0x28 : 0x18);
+            UsnRecord record;
+            record.major_version = major;
+            record.file_reference = read<uint64_t>(p + 0x08);
+            record.parent_reference = read<uint64_t>(p + (v3 ? 0x18 : 0x10));
+            record.usn = read<int64_t>(q + 0x00);
+            record.timestamp = read<int64_t>(q + 0x08);
+            record.reason = read<uint32_t>(q + 0x10);
+            record.source_info = read<uint32_t>(q + 0x14);
+            record.attributes = read<uint32_t>(q + 0x1C);
+            uint16_t const name_bytes = read<uint16_t>(q + 0x20);
+            uint16_t const name_offset = read<uint16_t>(q + 0x22);
+            if (name_bytes % 2 != 0 || name_offset < header_size ||
+                static_cast<uint32_t>(name_offset) + name_bytes > record_length)
+            {
+                result.error = "USN record file name is out of bounds";
+                break;
+            }
+            record.name_bytes = p + name_offset;
+            record.name_length = name_bytes / 2;
+
+            on_record(static_cast<UsnRecord const&>(record));
+            ++result.records;
+        }
+        else
+        {
+            ++result.skipped;
+        }
+
+        offset += record_length;
+        result.consumed = offset;
+    }
+    return result;
+}
+
+// ============================================================================
+// Index Events
+// ============================================================================
+
+/// What an event does to the index.
+enum class UsnEventType : uint8_t
+{
+    Create,           ///< New file or directory with one name
+    Delete,           ///< File removed with all of its names
+    Rename,           ///< One name moved (old_parent/old_name -> parent/name)
+    Link,             ///< Hard link added, or removed if it exists
+    SizeChange,       ///< Stream contents changed
+    AttributeChange,  ///< Attributes or timestamps changed
+};
+
+/**
+ * @brief One change to apply to an index.
+ *
+ * FRS numbers have the sequence number stripped; sequence is kept so a
+ * reused record can be told apart from the file that used it before.
+ */
+struct UsnEvent
+{
+    UsnEventType type = UsnEventType::Create;
+    uint32_t frs = 0;
+    uint16_t sequence = 0;
+    uint32_t parent = 0;
+    uint32_t old_parent = ~0U;      ///< Rename only; ~0 if the old name was not seen
+    int64_t usn = 0;
+    int64_t timestamp = 0;
+    uint32_t reason = 0;
+    uint32_t attributes = 0;
+    std::u16string name;
+    std::u16string old_name;        ///< Rename only
+    bool has_size = false;          ///< SizeChange/Create: length and allocated are valid
+    uint64_t length = 0;
+    uint64_t allocated = 0;
+
+    bool is_directory() const noexcept { return !!(attributes & kUsnFileAttributeDirectory); }
+};
+
+/**
+ * @brief Folds journal records into UsnEvents.
+ *
+ * Feed records in USN order with add(); events accumulate in events().
+ * The builder keeps pending rename state between calls, so a journal may
+ * be fed in pieces (e.g. one FSCTL_READ_USN_JOURNAL buffer at a time).
+ */
+class UsnEventBuilder
+{
+public:
+    /// Processes one record, appending zero or more events.
+    void add(UsnRecord const& record)
+    {
+        if (record.frs() > 0xFFFFFFFFULL || record.parent_frs() > 0xFFFFFFFFULL)
+        {
+            ++ignored_;  // outside what a 32-bit FRS index can hold
+            return;
+        }
+
+        uint32_t const reason = record.reason;
+        if (reason & kUsnReasonRenameOldName)
+        {
+            // Only the first old name of a handle matters: later ones are
+            // intermediate names the index never saw.
+            pending_renames_.emplace(record.file_reference,
+                std::make_pair(static_cast<uint32_t>(record.parent_frs()), record.name()));
+        }
+        if (!(reason & kUsnReasonClose))
+        {
+            return;
+        }
+
+        auto const pending = pending_renames_.find(record.file_reference);
+        bool const has_old_name = pending != pending_renames_.end();
+
+        if (reason & kUsnReasonFileDelete)
+        {
+            if (!(reason & kUsnReasonFileCreate))
+            {
+                events_.push_back(make_event(UsnEventType::Delete, record));
+            }
+            // else: created and deleted under one handle, never visible
+        }
+        else if (reason & kUsnReasonFileCreate)
+        {
+            events_.push_back(make_event(UsnEventType::Create, record));
+        }
+        else
+        {
+            if (reason & kUsnReasonRenameNewName)
+            {
+                UsnEvent event = make_event(UsnEventType::Rename, record);
+                if (has_old_name)
+                {
+                    event.old_parent = pending->second.first;
+                    event.old_name = pending->second.second;
+                }
+                events_.push_back(std::move(event));
+            }
+            if (reason & kUsnReasonHardLinkChange)
+            {
+                events_.push_back(make_event(UsnEventType::Link, record));
+            }
+            if (reason & kUsnReasonSizeChangeMask)
+            {
+                events_.push_back(make_event(UsnEventType::SizeChange, record));
+            }
+            if (reason & kUsnReasonBasicInfoChange)
+            {
+                events_.push_back(make_event(UsnEventType::AttributeChange, record));
+            }
+        }
+
+        if (has_old_name)
+        {
+            pending_renames_.erase(pending);
+        }
+    }
+
+    /// Events built so far, in journal order.
+    std::vector<UsnEvent>& events() noexcept { return events_; }
+    std::vector<UsnEvent> const& events() const noexcept { return events_; }
+
+    /// Records that were not turned into events because their FRS is out of range.
+    size_t ignored() const noexcept { return ignored_; }
+
+    /// Handles that logged RENAME_OLD_NAME but have not closed yet.
+    size_t pending() const noexcept { return pending_renames_.size(); }
+
+private:
+    static UsnEvent make_event(UsnEventType const type, UsnRecord const& record)
+    {
+        UsnEvent event;
+        event.type = type;
+        event.frs = static_cast<uint32_t>(record.frs());
+        event.sequence = record.sequence();
+        event.parent = static_cast<uint32_t>(record.parent_frs());
+        event.usn = record.usn;
+        event.timestamp = record.timestamp;
+        event.reason = record.reason;
+        event.attributes = record.attributes;
+        event.name = record.name();
+        return event;
+    }
+
+    std::vector<UsnEvent> events_;
+    std::unordered_map<uint64_t, std::pair<uint32_t, std::u16string>> pending_renames_;
+    size_t ignored_ = 0;
+};
+
+/**
+ * @brief Parses a whole journal buffer into events.
+ *
+ * @param data   Raw $J bytes
+ * @param size   Number of bytes
+ * @param events Receives the events (appended)
+ * @return Error message, or nullptr if the buffer parsed completely
+ */
+inline char const* read_usn_events(void const* const data, size_t const size, std::vector<UsnEvent>& events)
+{
+    UsnEventBuilder builder;
+    builder.events().swap(events);
+    UsnParseResult const result = parse_usn_records(data, size,
+        [&builder](UsnRecord const& record) { builder.add(record); });
+    builder.events().swap(events);
+    if (result.error)
+    {
+        return result.error;
+    }
+    return result.consumed == size ? nullptr : "USN journal ends inside a record";
+}
+
+} // namespace uffs
+
+using uffs::UsnEvent;
+using uffs::UsnEventType;
+
+#endif // UFFS_USN_JOURNAL_HPP
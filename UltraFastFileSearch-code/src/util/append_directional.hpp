@@ -13,21 +13,19 @@
 #include "core_types.hpp"
 #include "allocators.hpp"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define UFFS_APPEND_DIRECTIONAL_SSE2 1
+#endif
+
 namespace uffs {
 
-/**
- * @brief Append characters to a string with optional ASCII compression/decompression
- * @param str Target string to append to
- * @param sz Source characters
- * @param cch Number of characters
- * @param ascii_mode -1 = decompress ASCII, 0 = no change, +1 = compress ASCII
- * @param reverse If true, append in reverse order
- */
-inline void append_directional(std::tvstring& str, TCHAR const sz[], size_t const cch,
-    int const ascii_mode, bool const reverse = false)
+namespace append_directional_detail {
+
+/// Grows @p str by @p cch_in_str characters and returns the first new one.
+inline TCHAR* extend(std::tvstring& str, size_t const cch_in_str)
 {
     typedef std::tvstring Str;
-    size_t const cch_in_str = ascii_mode > 0 ? (cch + 1) / 2 : cch;
     size_t const n = str.size();
 
 #if defined(_MSC_VER) && !defined(_CPPLIB_VER)
@@ -69,9 +67,27 @@ inline void append_directional(std::tvstring& str, TCHAR const sz[], size_t cons
     str.resize(n + cch_in_str);
 #endif
 
+    return cch_in_str ? &str[n] : nullptr;
+}
+
+} // namespace append_directional_detail
+
+/**
+ * @brief Append characters to a string with optional ASCII compression/decompression
+ * @param str Target string to append to
+ * @param sz Source characters
+ * @param cch Number of characters
+ * @param ascii_mode -1 = decompress ASCII, 0 = no change, +1 = compress ASCII
+ * @param reverse If true, append in reverse order
+ */
+inline void append_directional(std::tvstring& str, TCHAR const sz[], size_t const cch,
+    int const ascii_mode, bool const reverse = false)
+{
+    size_t const cch_in_str = ascii_mode > 0 ? (cch + 1) / 2 : cch;
+    TCHAR* const o = append_directional_detail::extend(str, cch_in_str);
+
     if (cch)
     {
-        TCHAR* const o = &str[n];
         if (reverse)
         {
             if (ascii_mode < 0)
@@ -117,10 +133,75 @@ inline void append_directional(std::tvstring& str, TCHAR const sz[], size_t cons
     }
 }
 
+/**
+ * @brief Append a name, packed to one byte per character if it is ASCII
+ *
+ * Does what is_ascii() followed by append_directional(str, sz, cch,
+ * ascii ? 1 : 0) does, in one pass over the name: characters are packed
+ * as they are checked, and only a name that turns out not to be ASCII is
+ * copied again, verbatim. A packed name of odd length is padded with a
+ * zero byte to a whole TCHAR.
+ *
+ * @param str Target string to append to
+ * @param sz Source characters
+ * @param cch Number of characters
+ * @return true if the name was packed, i.e. its NameInfo is ascii()
+ */
+inline bool append_name(std::tvstring& str, TCHAR const sz[], size_t const cch)
+{
+    size_t const n = str.size();
+    TCHAR* const o = append_directional_detail::extend(str, cch);  // room for the name verbatim
+    char* const packed = static_cast<char*>(static_cast<void*>(o));
+
+    size_t i = 0;
+    bool ascii = true;
+#ifdef UFFS_APPEND_DIRECTIONAL_SSE2
+    if (sizeof(TCHAR) == sizeof(short))
+    {
+        __m128i seen = _mm_setzero_si128();  // OR of every character
+        for (; i + 16 <= cch; i += 16)
+        {
+            __m128i const a = _mm_loadu_si128(reinterpret_cast<__m128i const*>(sz + i));
+            __m128i const b = _mm_loadu_si128(reinterpret_cast<__m128i const*>(sz + i + 8));
+            seen = _mm_or_si128(seen, _mm_or_si128(a, b));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(packed + i), _mm_packus_epi16(a, b));
+        }
+        if (i + 8 <= cch)
+        {
+            __m128i const a = _mm_loadu_si128(reinterpret_cast<__m128i const*>(sz + i));
+            seen = _mm_or_si128(seen, a);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(packed + i), _mm_packus_epi16(a, a));
+            i += 8;
+        }
+        __m128i const high = _mm_and_si128(seen, _mm_set1_epi16(static_cast<short>(0xFF80)));
+        ascii = _mm_movemask_epi8(_mm_cmpeq_epi16(high, _mm_setzero_si128())) == 0xFFFF;
+    }
+#endif
+    for (; i != cch; ++i)
+    {
+        ascii &= static_cast<unsigned int>(sz[i]) <= 0x7F;
+        packed[i] = static_cast<char>(sz[i]);
+    }
+
+    if (!ascii)
+    {
+        std::copy(sz, sz + static_cast<ptrdiff_t>(cch), o);
+        return false;
+    }
+
+    if (cch % 2)
+    {
+        packed[cch] = '\0';
+    }
+    str.resize(n + (cch + 1) / 2);
+    return true;
+}
+
 } // namespace uffs
 
 // Expose at global scope for backward compatibility
 using uffs::append_directional;
+using uffs::append_name;
 
 #endif // UFFS_APPEND_DIRECTIONAL_HPP
 
@@ -0,0 +1,179 @@
+#pragma once
+
+// ============================================================================
+// Copy-on-Write File Mapping
+// ============================================================================
+// RAII wrapper that maps a whole file into memory with private (copy-on-write)
+// pages. Writes through data() are visible to this process only and are never
+// flushed back to the file, which lets parsers that patch buffers in place
+// (e.g. NTFS multi-sector fixup) run directly on the mapping.
+//
+// ReadOnly mappings share their pages with every other process mapping the
+// same file (index snapshots); writing through data() faults.
+//
+// Works with both the Win32 API and POSIX mmap so dump files can be processed
+// on non-Windows analysis machines.
+// ============================================================================
+
+#ifndef UFFS_MAPPED_FILE_HPP
+#define UFFS_MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace uffs {
+
+class MappedFile
+{
+public:
+    enum Mode
+    {
+        CopyOnWrite,  ///< private writable pages, read sequentially
+        ReadOnly      ///< shared read-only pages, read in any order
+    };
+
+    MappedFile() noexcept : data_(nullptr), size_(0) {}
+
+    /**
+     * @brief Maps the entire file at @p path.
+     * @throws std::runtime_error if the file cannot be opened or mapped
+     */
+    explicit MappedFile(char const* path, Mode mode = CopyOnWrite) : data_(nullptr), size_(0)
+    {
+#ifdef _WIN32
+        HANDLE const file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr,
+            OPEN_EXISTING, mode == ReadOnly ? FILE_FLAG_RANDOM_ACCESS : FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            throw std::runtime_error(std::string("cannot open ") + path);
+        }
+
+        LARGE_INTEGER file_size = {};
+        if (!GetFileSizeEx(file, &file_size))
+        {
+            CloseHandle(file);
+            throw std::runtime_error(std::string("cannot stat ") + path);
+        }
+
+        if (file_size.QuadPart > 0)
+        {
+            HANDLE const mapping = CreateFileMappingA(file, nullptr,
+                mode == ReadOnly ? PAGE_READONLY : PAGE_WRITECOPY, 0, 0, nullptr);
+            CloseHandle(file);
+            if (!mapping)
+            {
+                throw std::runtime_error(std::string("cannot map ") + path);
+            }
+
+            void* const view = MapViewOfFile(mapping, mode == ReadOnly ? FILE_MAP_READ : FILE_MAP_COPY, 0, 0, 0);
+            CloseHandle(mapping);  // the view keeps the section alive
+            if (!view)
+            {
+                throw std::runtime_error(std::string("cannot map ") + path);
+            }
+
+            data_ = static_cast<unsigned char*>(view);
+            size_ = static_cast<size_t>(file_size.QuadPart);
+        }
+        else
+        {
+            CloseHandle(file);
+        }
+#else
+        int const fd = ::open(path, O_RDONLY);
+        if (fd < 0)
+        {
+            throw std::runtime_error(std::string("cannot open ") + path);
+        }
+
+        struct stat st = {};
+        if (::fstat(fd, &st) != 0)
+        {
+            ::close(fd);
+            throw std::runtime_error(std::string("cannot stat ") + path);
+        }
+
+        if (st.st_size > 0)
+        {
+            void* const view = mode == ReadOnly
+                ? ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0)
+                : ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+            ::close(fd);  // the mapping keeps the file alive
+            if (view == MAP_FAILED)
+            {
+                throw std::runtime_error(std::string("cannot map ") + path);
+            }
+
+            if (mode == CopyOnWrite)
+            {
+                ::madvise(view, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+            }
+            data_ = static_cast<unsigned char*>(view);
+            size_ = static_cast<size_t>(st.st_size);
+        }
+        else
+        {
+            ::close(fd);
+        }
+#endif
+    }
+
+    MappedFile(MappedFile const&) = delete;
+    MappedFile& operator=(MappedFile const&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept : data_(other.data_), size_(other.size_)
+    {
+        other.data_ = nullptr;
+        other.size_ = 0;
+    }
+
+    MappedFile& operator=(MappedFile other) noexcept
+    {
+        return other.swap(*this), *this;
+    }
+
+    ~MappedFile()
+    {
+        if (data_)
+        {
+#ifdef _WIN32
+            UnmapViewOfFile(data_);
+#else
+            ::munmap(data_, size_);
+#endif
+        }
+    }
+
+    [[nodiscard]] unsigned char* data() const noexcept { return data_; }
+    [[nodiscard]] size_t size() const noexcept { return size_; }
+    [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+
+    void swap(MappedFile& other) noexcept
+    {
+        using std::swap;
+        swap(data_, other.data_);
+        swap(size_, other.size_);
+    }
+
+private:
+    unsigned char* data_;
+    size_t size_;
+};
+
+} // namespace uffs
+
+// Expose at global scope for backward compatibility
+using uffs::MappedFile;
+
+#endif // UFFS_MAPPED_FILE_HPP
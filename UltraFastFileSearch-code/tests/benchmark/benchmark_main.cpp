@@ -64,9 +64,100 @@ TEST_SUITE("Benchmarks") {
     }
 }
 
+// ============================================================================
+// Synthetic MFT Benchmarks
+// ============================================================================
+
+#include "../../src/io/synthetic_mft.hpp"
+
+#include <vector>
+
+TEST_SUITE("Benchmarks") {
+    TEST_CASE("Synthetic MFT generation (100K records)") {
+        uffs::SyntheticMftOptions options;
+        options.record_count = 100000;
+        uffs::SyntheticMftGenerator generator(options);
+        std::vector<unsigned char> records(static_cast<size_t>(options.record_count) * options.record_size);
+
+        {
+            BENCHMARK("SyntheticMftGenerator::generate (1 thread)");
+            generator.generate(0, static_cast<size_t>(options.record_count), records.data());
+        }
+        CHECK(memcmp(records.data(), "FILE", 4) == 0);
+
+        std::vector<unsigned char> frame;
+        {
+            BENCHMARK("encode_uffs_mft_frame (100 MB of records)");
+            for (size_t i = 0; i < records.size(); i += uffs::kUffsMftDefaultFrameSize) {
+                uffs::encode_uffs_mft_frame(records.data() + i,
+                    std::min<size_t>(uffs::kUffsMftDefaultFrameSize, records.size() - i), frame);
+            }
+        }
+    }
+}
+
+// ============================================================================
+// Index Width Benchmarks
+// ============================================================================
+
+#include "../../src/core/ntfs_record_types.hpp"
+
+TEST_SUITE("Benchmarks") {
+    TEST_CASE("64-bit LinkInfo layout and walk (10M links)") {
+        // Writes and walks the 10M BasicLinkInfo<unsigned long long> entries
+        // a HugeNtfsIndex would hold for 10M names of 200..240 characters,
+        // with offsets past the 2G elements the compact layout can address.
+        // No names pool is allocated and no index is built or loaded; a
+        // HugeNtfsIndex over 4 GiB of names is only exercised by the
+        // --benchmark-width-from recipe below.
+        typedef unsigned long long Index;
+        size_t const count = 10000000;
+        std::vector<uffs::BasicLinkInfo<Index> > links(count);
+
+        Index offset = 0;
+        {
+            BENCHMARK("BasicLinkInfo<unsigned long long> layout (10M links)");
+            for (size_t i = 0; i != count; ++i) {
+                links[i].next_entry = i + 1 < count ? static_cast<Index>(i + 1) : ~Index();
+                links[i].name.offset(offset);
+                links[i].name.ascii((i & 1) != 0);
+                links[i].name.length = static_cast<unsigned char>(200 + i % 41);
+                links[i].parent = static_cast<unsigned int>(i / 16);
+                offset += links[i].name.length;
+            }
+        }
+        CHECK(offset > uffs::NameInfo::max_offset);             // past the compact layout
+        CHECK(offset * sizeof(char16_t) > 0x100000000ULL);    // over 4 GiB of UTF-16 names
+
+        Index walked = 0;
+        bool same = true;
+        {
+            BENCHMARK("walk the 64-bit name offsets");
+            Index expected = 0;
+            for (Index j = 0; j != ~Index(); j = links[static_cast<size_t>(j)].next_entry) {
+                uffs::BasicNameInfo<Index> const& name = links[static_cast<size_t>(j)].name;
+                same = same && name.offset() == expected && name.ascii() == ((j & 1) != 0);
+                expected += name.length;
+                walked = expected;
+            }
+        }
+        CHECK(same);
+        CHECK(walked == offset);
+    }
+}
+
 // ============================================================================
 // Future benchmarks (require Windows)
 // ============================================================================
+// Large reproducible inputs for these come from the synthetic generator:
+//   uffs --generate-mft=synthetic.uffs --generate-mft-options=records=10000000
+//   uffs --benchmark-index-from=synthetic.uffs
+//
+// and for the index widths, names past 4 GiB (the only run that loads a
+// HugeNtfsIndex over the 32-bit ceiling; it needs well over 8 GiB of RAM):
+//   uffs --generate-mft=huge.uffs --generate-mft-options=records=10000000,names=200..240,unicode=1,dos=0
+//   uffs --benchmark-width-from=huge.uffs
+//
 // TODO: Add when running on Windows:
 // - NtfsIndex::load() benchmark
 // - Search pattern matching benchmark
@@ -0,0 +1,107 @@
+// ============================================================================
+// Unit Tests for append_directional.hpp
+// ============================================================================
+// Tests the names-pool appenders the index uses for file and stream names.
+//
+// Key behaviors to verify:
+// - append_name() packs ASCII names to one byte per character and reports it
+// - A single non-ASCII character anywhere keeps the name verbatim
+// - Packed names of odd length are padded with a zero byte
+// - append_name() lays out the pool exactly like is_ascii() followed by
+//   append_directional(..., ascii ? 1 : 0), for every length around the
+//   vector block sizes
+// - append_directional(..., -1) unpacks what append_name() packed
+// ============================================================================
+
+#include "../doctest.h"
+#include "../../src/util/append_directional.hpp"
+
+#include <cstring>
+#include <vector>
+
+namespace {
+
+std::vector<TCHAR> make_name(size_t length, size_t seed)
+{
+    std::vector<TCHAR> name(length);
+    for (size_t i = 0; i != length; ++i)
+    {
+        name[i] = static_cast<TCHAR>(0x20 + (seed * 7 + i * 13) % 0x5F);
+    }
+    return name;
+}
+
+bool reference_is_ascii(std::vector<TCHAR> const& name)
+{
+    for (TCHAR const ch : name)
+    {
+        if (static_cast<unsigned int>(ch) > 0x7F)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+TEST_SUITE("append_directional") {
+
+TEST_CASE("append_name packs ASCII and keeps the rest verbatim") {
+    std::tvstring pool;
+    std::vector<TCHAR> const ascii = make_name(5, 1);
+    CHECK(append_name(pool, ascii.data(), ascii.size()));
+    CHECK(pool.size() == 3);
+    char const* const packed = reinterpret_cast<char const*>(pool.data());
+    for (size_t i = 0; i != ascii.size(); ++i)
+    {
+        CHECK(packed[i] == static_cast<char>(ascii[i]));
+    }
+    CHECK(packed[5] == '\0');
+
+    std::vector<TCHAR> wide = make_name(20, 2);
+    wide[17] = static_cast<TCHAR>(0x00E9);
+    CHECK_FALSE(append_name(pool, wide.data(), wide.size()));
+    CHECK(pool.size() == 3 + 20);
+    CHECK(memcmp(&pool[3], wide.data(), wide.size() * sizeof(TCHAR)) == 0);
+
+    CHECK(append_name(pool, nullptr, 0));
+    CHECK(pool.size() == 23);
+}
+
+TEST_CASE("append_name matches is_ascii plus append_directional") {
+    for (size_t length = 0; length != 70; ++length)
+    {
+        // Pure ASCII, then one character above 0x7F at every position
+        for (size_t wide_at = 0; wide_at <= length; ++wide_at)
+        {
+            std::vector<TCHAR> name = make_name(length, length);
+            if (wide_at != length)
+            {
+                name[wide_at] = static_cast<TCHAR>(wide_at % 2 ? 0x0080 : 0x4E2D);
+            }
+
+            std::tvstring expected(1, static_cast<TCHAR>('x'));
+            bool const ascii = reference_is_ascii(name);
+            append_directional(expected, name.data(), name.size(), ascii ? 1 : 0);
+            if (ascii && length % 2)
+            {
+                reinterpret_cast<char*>(&expected[1])[length] = '\0';
+            }
+
+            std::tvstring actual(1, static_cast<TCHAR>('x'));
+            CHECK(append_name(actual, name.data(), name.size()) == ascii);
+            REQUIRE(actual.size() == expected.size());
+            CHECK(memcmp(actual.data(), expected.data(), actual.size() * sizeof(TCHAR)) == 0);
+
+            if (ascii)
+            {
+                std::tvstring unpacked;
+                append_directional(unpacked, &actual[1], length, -1);
+                CHECK(memcmp(unpacked.data(), name.data(), length * sizeof(TCHAR)) == 0);
+            }
+        }
+    }
+}
+
+} // TEST_SUITE
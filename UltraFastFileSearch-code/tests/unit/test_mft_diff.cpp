@@ -0,0 +1,378 @@
+// ============================================================================
+// Unit Tests for the UFFS-MFT Record Diff
+// ============================================================================
+// Tests mft_diff.hpp on hand-built FILE records (with a real update
+// sequence array) and on dump files written in both UFFS-MFT layouts.
+//
+// Key behaviors to verify:
+// - mft_records_equal() finds a difference at any byte position
+// - summarize_mft_record() decodes names, parents, sizes and times and
+//   rejects torn records
+// - diff_mft_records() classifies added / removed / reused / renamed /
+//   moved / resized / retimed records and ignores LSN-only changes
+// - Extension record changes are reported under their base record
+// - MftDumpDiff gives the same answer for plain and compressed dumps of
+//   different lengths
+// ============================================================================
+
+#include "../doctest.h"
+#include "../../src/io/mft_diff.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t kRecordSize = 1024;
+
+template<class T>
+void put(unsigned char* p, T value)
+{
+    memcpy(p, &value, sizeof(value));
+}
+
+struct RecordSpec
+{
+    bool in_use = true;
+    uint16_t sequence = 1;
+    uint64_t base = 0;
+    uint64_t lsn = 1000;
+    uint64_t parent = 5;
+    std::u16string name = u"file.txt";
+    std::u16string dos_name;
+    bool has_data = true;
+    uint64_t size = 4096;
+    int64_t modified = 132000000000000000LL;
+};
+
+/// Writes a FILE record with $STANDARD_INFORMATION, $FILE_NAME(s) and a
+/// non-resident unnamed $DATA, protected by an update sequence array.
+void make_record(unsigned char* record, RecordSpec const& spec)
+{
+    memset(record, 0, kRecordSize);
+    memcpy(record, "FILE", 4);
+    put<uint16_t>(record + 0x04, 0x30);
+    put<uint16_t>(record + 0x06, 1 + kRecordSize / 512);
+    put<uint64_t>(record + 0x08, spec.lsn);
+    put<uint16_t>(record + 0x10, spec.sequence);
+    put<uint16_t>(record + 0x14, 0x38);
+    put<uint16_t>(record + 0x16, spec.in_use ? 1 : 0);
+    put<uint32_t>(record + 0x1C, kRecordSize);
+    put<uint64_t>(record + 0x20, spec.base ? spec.base | (1ULL << 48) : 0);
+
+    uint32_t offset = 0x38;
+    if (!spec.base)
+    {
+        unsigned char* const a = record + offset;
+        put<uint32_t>(a, 0x10);
+        put<uint32_t>(a + 4, 0x60);
+        put<uint32_t>(a + 0x10, 0x48);
+        put<uint16_t>(a + 0x14, 0x18);
+        put<int64_t>(a + 0x18, spec.modified - 1000);
+        put<int64_t>(a + 0x20, spec.modified);
+        put<int64_t>(a + 0x28, spec.modified);
+        put<int64_t>(a + 0x30, spec.modified + 5);
+        put<uint32_t>(a + 0x38, 0x20);
+        offset += 0x60;
+    }
+
+    auto const add_name = [&](std::u16string const& name, unsigned char space)
+    {
+        unsigned char* const a = record + offset;
+        uint32_t const value_length = 0x42 + static_cast<uint32_t>(name.size()) * 2;
+        uint32_t const length = (0x18 + value_length + 7) & ~7U;
+        put<uint32_t>(a, 0x30);
+        put<uint32_t>(a + 4, length);
+        put<uint32_t>(a + 0x10, value_length);
+        put<uint16_t>(a + 0x14, 0x18);
+        put<uint64_t>(a + 0x18, spec.parent | (5ULL << 48));
+        a[0x18 + 0x40] = static_cast<unsigned char>(name.size());
+        a[0x18 + 0x41] = space;
+        memcpy(a + 0x18 + 0x42, name.data(), name.size() * 2);
+        offset += length;
+    };
+    add_name(spec.name, spec.dos_name.empty() ? 3 : 1);
+    if (!spec.dos_name.empty())
+    {
+        add_name(spec.dos_name, 2);
+    }
+
+    if (spec.has_data)
+    {
+        unsigned char* const a = record + offset;
+        put<uint32_t>(a, 0x80);
+        put<uint32_t>(a + 4, 0x48);
+        a[8] = 1;
+        put<uint16_t>(a + 0x20, 0x40);
+        put<int64_t>(a + 0x18, -1);
+        put<uint64_t>(a + 0x28, (spec.size + 4095) & ~4095ULL);
+        put<uint64_t>(a + 0x30, spec.size);
+        put<uint64_t>(a + 0x38, spec.size);
+        offset += 0x48;
+    }
+
+    put<uint32_t>(record + offset, 0xFFFFFFFF);
+    put<uint32_t>(record + 0x18, offset + 8);
+
+    uint16_t const usn = static_cast<uint16_t>(spec.lsn);
+    put<uint16_t>(record + 0x30, usn);
+    for (uint32_t i = 1; i <= kRecordSize / 512; ++i)
+    {
+        memcpy(record + 0x30 + 2 * i, record + i * 512 - 2, 2);
+        put<uint16_t>(record + i * 512 - 2, usn);
+    }
+}
+
+std::vector<unsigned char> make_records(std::vector<RecordSpec> const& specs)
+{
+    std::vector<unsigned char> records(specs.size() * kRecordSize);
+    for (size_t i = 0; i < specs.size(); ++i)
+    {
+        make_record(&records[i * kRecordSize], specs[i]);
+    }
+    return records;
+}
+
+struct Diff
+{
+    std::vector<uffs::MftDiffEntry> entries;
+    uffs::MftDiffStats stats;
+};
+
+Diff diff(std::vector<unsigned char> const& before, std::vector<unsigned char> const& after)
+{
+    Diff result;
+    uffs::diff_mft_records(before.data(), after.data(), 0, before.size() / kRecordSize, kRecordSize,
+        result.entries, result.stats);
+    uffs::merge_mft_diff_entries(result.entries);
+    return result;
+}
+
+uint32_t changes_of(Diff const& result, uint64_t frs)
+{
+    for (uffs::MftDiffEntry const& entry : result.entries)
+    {
+        if (entry.frs == frs)
+        {
+            return entry.changes;
+        }
+    }
+    return 0;
+}
+
+/// Writes a dump file removed when the object goes out of scope.
+struct TempDump
+{
+    std::string path;
+
+    TempDump(char const* name, std::vector<unsigned char> const& records, uint32_t frame_size)
+        : path((std::filesystem::temp_directory_path() / name).string())
+    {
+        std::ofstream out(path, std::ios::out | std::ios::binary | std::ios::trunc);
+        uffs::UffsMftHeader header = uffs::make_uffs_mft_header(kRecordSize, records.size() / kRecordSize, 'D');
+        out.write(reinterpret_cast<char const*>(&header), sizeof(header));
+        if (!frame_size)
+        {
+            out.write(reinterpret_cast<char const*>(records.data()), static_cast<std::streamsize>(records.size()));
+            return;
+        }
+
+        uffs::UffsMftFrameWriter writer(frame_size, 2, [&out](void const* data, size_t size)
+        {
+            return !!out.write(static_cast<char const*>(data), static_cast<std::streamsize>(size));
+        });
+        REQUIRE(writer.write(records.data(), records.size()));
+        REQUIRE(writer.finish());
+        writer.complete_header(header);
+        out.seekp(0);
+        out.write(reinterpret_cast<char const*>(&header), sizeof(header));
+    }
+
+    ~TempDump()
+    {
+        std::remove(path.c_str());
+    }
+};
+
+} // namespace
+
+TEST_SUITE("MftDiff") {
+
+    TEST_CASE("Record comparison finds every differing byte") {
+        for (size_t const size : { 1024, 4096, 100 })
+        {
+            std::vector<unsigned char> a(size), b;
+            for (size_t i = 0; i < size; ++i)
+            {
+                a[i] = static_cast<unsigned char>(i * 7);
+            }
+            CHECK(uffs::mft_records_equal(a.data(), a.data(), size));
+            for (size_t i = 0; i < size; ++i)
+            {
+                b = a;
+                b[i] ^= 0x80;
+                if (uffs::mft_records_equal(a.data(), b.data(), size))
+                {
+                    FAIL("difference at byte " << i << " of " << size << " missed");
+                }
+            }
+        }
+    }
+
+    TEST_CASE("Records are summarized after removing the update sequence") {
+        RecordSpec spec;
+        spec.name = u"Résumé with a long name.docx";
+        spec.dos_name = u"RSUM~1.DOC";
+        spec.parent = 1234;
+        spec.size = 123456789;
+        std::vector<unsigned char> record = make_records({ spec });
+
+        uffs::MftRecordSummary summary;
+        std::vector<unsigned char> copy = record;
+        uffs::summarize_mft_record(copy.data(), copy.size(), summary);
+        REQUIRE(summary.in_use);
+        CHECK(summary.sequence == 1);
+        CHECK(summary.base == 0);
+        REQUIRE(summary.links.size() == 1);   // DOS name excluded
+        CHECK(summary.links[0].parent == 1234);
+        CHECK(summary.links[0].name == spec.name);
+        CHECK(summary.has_size);
+        CHECK(summary.size == 123456789);
+        CHECK(summary.has_times);
+        CHECK(summary.modified == spec.modified);
+        CHECK(summary.attributes == 0x20);
+
+        // A torn write leaves a sector with the wrong update sequence number
+        copy = record;
+        copy[1022] ^= 1;
+        uffs::summarize_mft_record(copy.data(), copy.size(), summary);
+        CHECK_FALSE(summary.in_use);
+
+        // Free records are not decoded
+        spec.in_use = false;
+        copy = make_records({ spec });
+        uffs::summarize_mft_record(copy.data(), copy.size(), summary);
+        CHECK_FALSE(summary.in_use);
+    }
+
+    TEST_CASE("Changes are classified per record") {
+        std::vector<RecordSpec> before(10), after;
+        for (size_t i = 0; i < before.size(); ++i)
+        {
+            before[i].name = u"file" + std::u16string(1, static_cast<char16_t>(u'0' + i));
+        }
+        before[8].in_use = false;
+        before[9].in_use = false;
+        after = before;
+
+        after[1].lsn = 2000;                          // journal-only change: bytes differ, nothing to report
+        after[2].in_use = false;                      // deleted
+        after[3].sequence = 2;                        // deleted and reused
+        after[3].name = u"other";
+        after[4].name = u"renamed";
+        after[5].parent = 77;                         // moved
+        after[5].lsn = 2001;
+        after[6].size = 1;                            // truncated and touched
+        after[6].modified += 10000000;
+        after[7].modified += 1;                       // timestamp only
+        after[8].in_use = true;                       // created
+
+        Diff const result = diff(make_records(before), make_records(after));
+        CHECK(result.stats.records == 10);
+        CHECK(result.stats.free == 1);
+        CHECK(result.stats.identical == 1);
+        CHECK(result.stats.decoded == 8);
+
+        CHECK(changes_of(result, 0) == 0);
+        CHECK(changes_of(result, 1) == 0);
+        CHECK(changes_of(result, 2) == uffs::kMftChangeRemoved);
+        CHECK(changes_of(result, 3) == (uffs::kMftChangeRemoved | uffs::kMftChangeAdded));
+        CHECK(changes_of(result, 4) == uffs::kMftChangeRenamed);
+        CHECK(changes_of(result, 5) == uffs::kMftChangeMoved);
+        CHECK(changes_of(result, 6) == (uffs::kMftChangeResized | uffs::kMftChangeRetimed));
+        CHECK(changes_of(result, 7) == uffs::kMftChangeRetimed);
+        CHECK(changes_of(result, 8) == uffs::kMftChangeAdded);
+        CHECK(result.entries.size() == 7);
+
+        uffs::MftDiffEntry const& moved = result.entries[3];
+        REQUIRE(moved.frs == 5);
+        CHECK(moved.before.links[0].parent == 5);
+        CHECK(moved.after.links[0].parent == 77);
+    }
+
+    TEST_CASE("Extension record changes are reported under the base") {
+        std::vector<RecordSpec> before(4);
+        before[3].base = 1;           // extra hard link of record 1
+        before[3].name = u"link";
+        before[3].has_data = false;
+        std::vector<RecordSpec> after = before;
+        after[3].name = u"link2";
+
+        Diff const result = diff(make_records(before), make_records(after));
+        REQUIRE(result.entries.size() == 1);
+        CHECK(result.entries[0].frs == 1);
+        CHECK(result.entries[0].changes == uffs::kMftChangeRenamed);
+        CHECK(result.entries[0].after.links[0].name == u"link2");
+
+        // Base and extension changed: one merged entry
+        after[1].size = 99;
+        Diff const merged = diff(make_records(before), make_records(after));
+        REQUIRE(merged.entries.size() == 1);
+        CHECK(merged.entries[0].changes == (uffs::kMftChangeRenamed | uffs::kMftChangeResized));
+        CHECK(merged.entries[0].after.size == 99);
+
+        // An extension record appearing on its own is not a new file
+        before[3].in_use = false;
+        after = before;
+        after[3].in_use = true;
+        CHECK(diff(make_records(before), make_records(after)).entries.empty());
+    }
+
+    TEST_CASE("Dump files diff the same plain or compressed") {
+        std::vector<RecordSpec> before(3000);
+        for (size_t i = 0; i < before.size(); ++i)
+        {
+            before[i].in_use = i % 5 != 0;
+            before[i].parent = 5 + i / 100;
+        }
+        std::vector<RecordSpec> after = before;
+        after.resize(3100);                       // $MFT grew
+        for (size_t i = before.size(); i < after.size(); ++i)
+        {
+            after[i].in_use = false;
+        }
+        after[17].size = 1;
+        after[1501].name = u"moved.txt";
+        after[1501].parent = 6;
+        after[2999].in_use = false;
+        after[3050].in_use = true;
+
+        std::vector<unsigned char> const before_records = make_records(before);
+        std::vector<unsigned char> const after_records = make_records(after);
+
+        for (uint32_t const frame_size : { 0U, 16U * kRecordSize })
+        {
+            TempDump const old_dump("uffs_test_mft_diff_before.uffs", before_records, frame_size);
+            TempDump const new_dump("uffs_test_mft_diff_after.uffs", after_records, frame_size ? 0 : 64 * kRecordSize);
+            uffs::MftDumpDiff const dump_diff(old_dump.path.c_str(), new_dump.path.c_str());
+
+            std::vector<uffs::MftDiffEntry> entries;
+            uffs::MftDiffStats const stats = dump_diff(entries, 3);
+            CHECK(stats.records == 3100);
+            REQUIRE(entries.size() == 4);
+            CHECK(entries[0].frs == 17);
+            CHECK(entries[0].changes == uffs::kMftChangeResized);
+            CHECK(entries[1].frs == 1501);
+            CHECK(entries[1].changes == (uffs::kMftChangeRenamed | uffs::kMftChangeMoved));
+            CHECK(entries[2].frs == 2999);
+            CHECK(entries[2].changes == uffs::kMftChangeRemoved);
+            CHECK(entries[3].frs == 3050);
+            CHECK(entries[3].changes == uffs::kMftChangeAdded);
+        }
+    }
+}
@@ -0,0 +1,194 @@
+// ============================================================================
+// Unit Tests for Batched Multi-Sector Fixup
+// ============================================================================
+// Tests mft_fixup.hpp on hand-built FILE records protected the way NTFS
+// writes them, for both record sizes and every kernel this CPU supports.
+//
+// Key behaviors to verify:
+// - Intact records are restored byte for byte and marked valid
+// - A torn sector makes the record 'BAAD' and clears its bit
+// - Records that are not FILE records are left untouched
+// - Unusual update sequence arrays give the same result on every kernel
+// - The mask is exact for counts that are not a multiple of the batch
+// ============================================================================
+
+#include "../doctest.h"
+#include "../../src/io/mft_fixup.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+template<class T>
+void put(unsigned char* p, T value)
+{
+    memcpy(p, &value, sizeof(value));
+}
+
+template<class T>
+T get(unsigned char const* p)
+{
+    T value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+/// Random bytes behind a FILE header with its USA at @p usa_offset.
+std::vector<unsigned char> make_record(size_t record_size, std::mt19937& random, uint16_t usa_offset = 0x30)
+{
+    std::vector<unsigned char> record(record_size);
+    for (auto& b : record)
+    {
+        b = static_cast<unsigned char>(random());
+    }
+    memcpy(record.data(), "FILE", 4);
+    put<uint16_t>(&record[4], usa_offset);
+    put<uint16_t>(&record[6], static_cast<uint16_t>(record_size / 512 + 1));
+    return record;
+}
+
+/// Applies the update sequence as NTFS does before writing a record.
+void protect(unsigned char* record, size_t record_size, uint16_t usn)
+{
+    unsigned char* const usa = record + get<uint16_t>(record + 4);
+    put<uint16_t>(usa, usn);
+    for (size_t i = 1; i <= record_size / 512; ++i)
+    {
+        memcpy(usa + i * 2, record + i * 512 - 2, 2);
+        put<uint16_t>(record + i * 512 - 2, usn);
+    }
+}
+
+std::vector<MftFixupKernel> kernels()
+{
+    std::vector<MftFixupKernel> result(1, MftFixupKernel::kScalar);
+    if (mft_fixup_kernel_supported(MftFixupKernel::kAvx2))
+    {
+        result.push_back(MftFixupKernel::kAvx2);
+    }
+    return result;
+}
+
+bool bit(std::vector<uint64_t> const& mask, size_t r)
+{
+    return (mask[r / 64] >> (r % 64) & 1) != 0;
+}
+
+} // namespace
+
+TEST_SUITE("mft_fixup") {
+
+TEST_CASE("Intact records are restored and marked valid") {
+    for (size_t const record_size : { size_t(1024), size_t(4096) })
+    {
+        for (MftFixupKernel const kernel : kernels())
+        {
+            std::mt19937 random(7);
+            size_t const count = 21;
+            std::vector<unsigned char> original, chunk;
+            for (size_t r = 0; r != count; ++r)
+            {
+                std::vector<unsigned char> record = make_record(record_size, random);
+                original.insert(original.end(), record.begin(), record.end());
+                protect(record.data(), record_size, static_cast<uint16_t>(r + 1));
+                chunk.insert(chunk.end(), record.begin(), record.end());
+            }
+
+            std::vector<uint64_t> mask(1, ~0ULL);
+            CHECK(mft_fixup_records(chunk.data(), count, record_size, mask.data(), kernel) == count);
+            CHECK(mask[0] == (1ULL << count) - 1);
+
+            // Everything but the USA itself is back to what was protected
+            for (size_t r = 0; r != count; ++r)
+            {
+                unsigned char const* const a = &original[r * record_size];
+                unsigned char const* const b = &chunk[r * record_size];
+                CHECK(memcmp(a, b, 0x30) == 0);
+                CHECK(memcmp(a + 0x30 + (record_size / 512 + 1) * 2, b + 0x30 + (record_size / 512 + 1) * 2,
+                    record_size - 0x30 - (record_size / 512 + 1) * 2) == 0);
+            }
+        }
+    }
+}
+
+TEST_CASE("Torn and foreign records") {
+    size_t const record_size = 1024;
+    for (MftFixupKernel const kernel : kernels())
+    {
+        std::mt19937 random(11);
+        size_t const count = 16;
+        std::vector<unsigned char> chunk;
+        for (size_t r = 0; r != count; ++r)
+        {
+            std::vector<unsigned char> record = make_record(record_size, random);
+            protect(record.data(), record_size, 0x0101);
+            chunk.insert(chunk.end(), record.begin(), record.end());
+        }
+
+        chunk[3 * record_size + 1023] ^= 0xFF;   // torn last sector
+        chunk[9 * record_size + 511] ^= 0x01;    // torn first sector
+        memcpy(&chunk[5 * record_size], "INDX", 4);
+        memset(&chunk[12 * record_size], 0, record_size);
+        std::vector<unsigned char> const free_record(chunk.begin() + 5 * record_size, chunk.begin() + 6 * record_size);
+
+        std::vector<uint64_t> mask(1);
+        CHECK(mft_fixup_records(chunk.data(), count, record_size, mask.data(), kernel) == count - 4);
+        for (size_t r = 0; r != count; ++r)
+        {
+            CHECK(bit(mask, r) == (r != 3 && r != 5 && r != 9 && r != 12));
+        }
+        CHECK(memcmp(&chunk[3 * record_size], "BAAD", 4) == 0);
+        CHECK(memcmp(&chunk[9 * record_size], "BAAD", 4) == 0);
+        CHECK(memcmp(&chunk[5 * record_size], free_record.data(), record_size) == 0);
+    }
+}
+
+TEST_CASE("Every kernel agrees on arbitrary input") {
+    std::mt19937 random(3);
+    for (size_t const record_size : { size_t(1024), size_t(4096) })
+    {
+        size_t const count = 77;
+        std::vector<unsigned char> chunk;
+        for (size_t r = 0; r != count; ++r)
+        {
+            // Usual layouts, odd USA offsets and sizes, out-of-record USAs, damage
+            uint16_t const usa_offset = r % 7 == 0 ? 0x2A : r % 11 == 0 ? 0x1F0 : 0x30;
+            std::vector<unsigned char> record = make_record(record_size, random, usa_offset);
+            protect(record.data(), record_size, static_cast<uint16_t>(random()));
+            if (r % 5 == 1)
+            {
+                record[random() % record_size] ^= static_cast<unsigned char>(1 + random() % 255);
+            }
+            if (r % 13 == 4)
+            {
+                put<uint16_t>(&record[4], 0xFFF0);
+            }
+            if (r % 17 == 8)
+            {
+                put<uint16_t>(&record[6], static_cast<uint16_t>(record_size / 512 - 1));
+            }
+            chunk.insert(chunk.end(), record.begin(), record.end());
+        }
+
+        std::vector<unsigned char> expected = chunk;
+        std::vector<uint64_t> expected_mask(2);
+        size_t const expected_valid = mft_fixup_records(expected.data(), count, record_size,
+            expected_mask.data(), MftFixupKernel::kScalar);
+        CHECK(expected_valid > 0);
+        CHECK(expected_valid < count);
+
+        for (MftFixupKernel const kernel : kernels())
+        {
+            std::vector<unsigned char> actual = chunk;
+            std::vector<uint64_t> mask(2);
+            CHECK(mft_fixup_records(actual.data(), count, record_size, mask.data(), kernel) == expected_valid);
+            CHECK(mask == expected_mask);
+            CHECK(actual == expected);
+        }
+    }
+}
+
+} // TEST_SUITE
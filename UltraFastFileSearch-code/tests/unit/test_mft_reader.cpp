@@ -8,10 +8,12 @@
 // - Bit counting (popcount) works for various patterns
 // - Bitmap scanning finds first/last set bits correctly
 // - Skip range calculation handles edge cases
+// - split_mft_extents() / trim_unused_mft_records() build read plans
 //
 // These tests use the actual headers:
 // - mft_reader_constants.hpp: Constants (no Windows dependencies)
 // - bitmap_utils.hpp: Bitmap utilities (no Windows dependencies)
+// - mft_read_plan.hpp: Chunk planning (no Windows dependencies)
 //
 // Note: mft_reader_types.hpp and mft_reader.hpp are NOT included because
 // they depend on atomic_compat.hpp which has Windows-specific code.
@@ -22,6 +24,7 @@
 // Include the actual headers (no Windows dependencies)
 #include "../../src/io/mft_reader_constants.hpp"
 #include "../../src/io/bitmap_utils.hpp"
+#include "../../src/io/mft_read_plan.hpp"
 
 #include <vector>
 #include <cstring>
@@ -362,4 +365,78 @@ TEST_SUITE("mft_reader_extent_conversion") {
         CHECK(chunks[1].lcn == 1100);
         CHECK(chunks[2].lcn == 1200);
     }
-}
\ No newline at end of file
+}
+
+// ============================================================================
+// TESTS: Read Plan
+// ============================================================================
+
+TEST_SUITE("mft_read_plan") {
+
+    TEST_CASE("extents are split into chunks that never span two extents") {
+        // 250 clusters at LCN 1000, then 30 clusters at LCN 50
+        const uffs::MftExtentMap extents = { { 250, 1000 }, { 280, 50 } };
+        const std::vector<uffs::MftReadChunk> chunks =
+            uffs::split_mft_extents(extents, 4096, ~0ULL, 100 * 4096);
+
+        REQUIRE(chunks.size() == 4);
+        CHECK(chunks[0].vcn == 0);
+        CHECK(chunks[0].lcn == 1000);
+        CHECK(chunks[0].cluster_count == 100);
+        CHECK(chunks[2].vcn == 200);
+        CHECK(chunks[2].lcn == 1200);
+        CHECK(chunks[2].cluster_count == 50);
+        CHECK(chunks[3].vcn == 250);
+        CHECK(chunks[3].lcn == 50);
+        CHECK(chunks[3].cluster_count == 30);
+    }
+
+    TEST_CASE("clusters past the limit are not planned") {
+        const uffs::MftExtentMap extents = { { 250, 1000 }, { 280, 50 } };
+        const std::vector<uffs::MftReadChunk> chunks =
+            uffs::split_mft_extents(extents, 4096, 120, 100 * 4096);
+
+        REQUIRE(chunks.size() == 2);
+        CHECK(chunks[1].vcn == 100);
+        CHECK(chunks[1].cluster_count == 20);
+    }
+
+    TEST_CASE("unused records at either end of a chunk are trimmed") {
+        // 4 records per cluster, 2 chunks of 8 clusters (32 records each)
+        const uffs::MftExtentMap extents = { { 16, 100 } };
+        std::vector<uffs::MftReadChunk> chunks = uffs::split_mft_extents(extents, 4096, ~0ULL, 8 * 4096);
+        REQUIRE(chunks.size() == 2);
+
+        std::vector<unsigned char> bitmap(8, 0);
+        bitmap[1] = 0x20;   // record 13 -> cluster 3
+        bitmap[2] = 0x01;   // record 16 -> cluster 4
+        uffs::trim_unused_mft_records(chunks, bitmap, 4096, 1024);
+
+        CHECK(chunks[0].skip_begin == 3);
+        CHECK(chunks[0].skip_end == 3);
+        CHECK(chunks[0].read_clusters() == 2);
+
+        // Nothing in use: the whole chunk is skipped
+        CHECK(chunks[1].skip_begin == 8);
+        CHECK(chunks[1].skip_end == 0);
+        CHECK(chunks[1].read_clusters() == 0);
+    }
+
+    TEST_CASE("partial clusters of unused records are still read") {
+        // 4096-byte records on 512-byte clusters, and 1024-byte records on 4096-byte clusters
+        const uffs::MftExtentMap extents = { { 64, 0 } };
+        std::vector<uffs::MftReadChunk> small = uffs::split_mft_extents(extents, 512, ~0ULL);
+        std::vector<unsigned char> bitmap(1, 0x04);   // record 2
+        uffs::trim_unused_mft_records(small, bitmap, 512, 4096);
+        REQUIRE(small.size() == 1);
+        CHECK(small[0].skip_begin == 16);
+        CHECK(small[0].skip_end == 40);
+
+        std::vector<uffs::MftReadChunk> large = uffs::split_mft_extents(extents, 4096, ~0ULL);
+        bitmap.assign(32, 0);
+        bitmap[0] = 0x20;   // record 5, the second record of cluster 1
+        uffs::trim_unused_mft_records(large, bitmap, 4096, 1024);
+        CHECK(large[0].skip_begin == 1);
+        CHECK(large[0].skip_end == 62);
+    }
+}
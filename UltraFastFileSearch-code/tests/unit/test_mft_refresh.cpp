@@ -0,0 +1,203 @@
+// ============================================================================
+// Unit Tests for $MFT Re-scan Bookkeeping
+// ============================================================================
+// Tests mft_refresh.hpp on hand-built, already fixed-up FILE records laid out
+// in chunks the way the live reader delivers them.
+//
+// Key behaviors to verify:
+// - Chunk hashes change with any byte and with the skip ranges
+// - MftChunkHashes treats unknown chunks as changed
+// - Every record of a changed chunk is re-parsed, including skipped and
+//   free ones, while unchanged chunks contribute nothing by themselves
+// - A changed extension record re-parses its base in an unchanged chunk,
+//   and records of the file that were not kept are listed as missing
+// - Files whose records are still missing are not handed out
+// ============================================================================
+
+#include "../doctest.h"
+#include "../../src/io/mft_refresh.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t kRecordSize = 1024;
+constexpr uint32_t kRecordsPerChunk = 8;
+
+template<class T>
+void put(unsigned char* p, T value)
+{
+    memcpy(p, &value, sizeof(value));
+}
+
+/// A FILE record with an optional empty $ATTRIBUTE_LIST and nothing else.
+void make_record(unsigned char* record, bool in_use, uint64_t base = 0, bool attribute_list = false)
+{
+    memset(record, 0, kRecordSize);
+    memcpy(record, "FILE", 4);
+    put<uint16_t>(record + 0x14, 0x38);
+    put<uint16_t>(record + 0x16, in_use ? 1 : 0);
+    put<uint32_t>(record + 0x1C, kRecordSize);
+    put<uint64_t>(record + 0x20, base ? base | (1ULL << 48) : 0);
+
+    uint32_t offset = 0x38;
+    if (attribute_list)
+    {
+        put<uint32_t>(record + offset, 0x20);
+        put<uint32_t>(record + offset + 4, 0x18);
+        offset += 0x18;
+    }
+    put<uint32_t>(record + offset, 0xFFFFFFFF);
+    put<uint32_t>(record + 0x18, offset + 8);
+}
+
+/// A chunk of in-use single-record files starting at @p first_frs.
+std::vector<unsigned char> make_chunk(unsigned int first_frs)
+{
+    std::vector<unsigned char> chunk(kRecordsPerChunk * kRecordSize);
+    for (unsigned int i = 0; i < kRecordsPerChunk; ++i)
+    {
+        make_record(&chunk[i * kRecordSize], true);
+        chunk[i * kRecordSize + 0x100] = static_cast<unsigned char>(first_frs + i);
+    }
+    return chunk;
+}
+
+void add(uffs::MftRefreshSet& set, unsigned int first_frs, std::vector<unsigned char> const& chunk, bool changed)
+{
+    set.add_chunk(static_cast<unsigned long long>(first_frs) * kRecordSize, chunk.data(), chunk.size(), 0, 0, changed);
+}
+
+/// base -> FRS of its segments, from for_each_base()
+std::map<unsigned int, std::vector<unsigned int>> visit(uffs::MftRefreshSet const& set)
+{
+    std::map<unsigned int, std::vector<unsigned int>> result;
+    set.for_each_base([&](unsigned int base, uffs::MftRefreshSet::Segments const& segments)
+    {
+        std::vector<unsigned int>& frs = result[base];
+        for (auto const& segment : segments)
+        {
+            frs.push_back(segment.first);
+        }
+    });
+    return result;
+}
+
+} // namespace
+
+TEST_SUITE("MftChunkHash") {
+
+    TEST_CASE("Hash depends on every byte and on the skip ranges") {
+        std::vector<unsigned char> chunk = make_chunk(16);
+        uint64_t const h = uffs::mft_chunk_hash(chunk.data(), chunk.size(), 0, 0);
+        CHECK(h == uffs::mft_chunk_hash(chunk.data(), chunk.size(), 0, 0));
+        CHECK(h != uffs::mft_chunk_hash(chunk.data(), chunk.size(), kRecordSize, 0));
+        CHECK(h != uffs::mft_chunk_hash(chunk.data(), chunk.size(), 0, kRecordSize));
+        CHECK(uffs::mft_chunk_hash(chunk.data(), chunk.size(), kRecordSize, 0) !=
+            uffs::mft_chunk_hash(chunk.data(), chunk.size(), 0, kRecordSize));
+
+        chunk[chunk.size() - 1] ^= 1;
+        CHECK(h != uffs::mft_chunk_hash(chunk.data(), chunk.size(), 0, 0));
+    }
+
+    TEST_CASE("Unknown chunks count as changed") {
+        uffs::MftChunkHashes hashes;
+        CHECK(hashes.changed(0, 42));
+        hashes.set(0, 42);
+        hashes.set(1 << 20, 7);
+        CHECK_FALSE(hashes.changed(0, 42));
+        CHECK(hashes.changed(0, 43));
+        CHECK(hashes.changed(2 << 20, 42));
+        CHECK(hashes.size() == 2);
+    }
+}
+
+TEST_SUITE("MftRefreshSet") {
+
+    TEST_CASE("Only records of changed chunks are re-parsed") {
+        uffs::MftRefreshSet set(kRecordSize);
+        std::vector<unsigned char> unchanged = make_chunk(0);
+        std::vector<unsigned char> changed = make_chunk(8);
+        make_record(&changed[3 * kRecordSize], false);  // FRS 11 deleted
+        memcpy(&changed[5 * kRecordSize], "BAAD", 4);  // FRS 13 torn
+
+        add(set, 8, changed, true);
+        add(set, 0, unchanged, false);
+        set.finish();
+
+        CHECK(set.base_count() == 8);
+        CHECK(set.missing_records().empty());
+
+        auto const bases = visit(set);
+        REQUIRE(bases.size() == 8);
+        CHECK(bases.begin()->first == 8);
+        CHECK(bases.rbegin()->first == 15);
+        CHECK(bases.at(10) == std::vector<unsigned int>{ 10 });
+        CHECK(bases.at(11).empty());
+        CHECK(bases.at(13).empty());
+    }
+
+    TEST_CASE("Skipped records of a changed chunk count as free") {
+        uffs::MftRefreshSet set(kRecordSize);
+        std::vector<unsigned char> chunk = make_chunk(16);
+        // FRS 16..17 and 22..23 skipped; 18..21 read
+        set.add_chunk(18ULL * kRecordSize, &chunk[2 * kRecordSize], 4 * kRecordSize,
+            2 * kRecordSize, 2 * kRecordSize, true);
+        set.finish();
+
+        auto const bases = visit(set);
+        REQUIRE(bases.size() == 8);
+        CHECK(bases.at(16).empty());
+        CHECK(bases.at(19) == std::vector<unsigned int>{ 19 });
+        CHECK(bases.at(23).empty());
+    }
+
+    TEST_CASE("A changed extension record pulls in the rest of its file") {
+        uffs::MftRefreshSet set(kRecordSize);
+
+        // FRS 2 (unchanged chunk) is a base with an attribute list and
+        // extensions 4 (unchanged) and 12 (changed chunk).
+        std::vector<unsigned char> unchanged = make_chunk(0);
+        make_record(&unchanged[2 * kRecordSize], true, 0, true);
+        make_record(&unchanged[4 * kRecordSize], true, 2);
+        std::vector<unsigned char> changed = make_chunk(8);
+        make_record(&changed[4 * kRecordSize], true, 2);
+
+        add(set, 0, unchanged, false);
+        add(set, 8, changed, true);
+        set.finish();
+
+        CHECK(set.missing_records() == std::vector<unsigned int>{ 2, 4 });
+
+        // Until the missing records are supplied, the file is left alone
+        auto bases = visit(set);
+        CHECK(bases.count(2) == 0);
+        CHECK(bases.at(12).empty());  // FRS 12 is an extension record, not a file
+
+        set.provide(2, &unchanged[2 * kRecordSize]);
+        set.provide(4, &unchanged[4 * kRecordSize]);
+        bases = visit(set);
+        CHECK(bases.at(2) == std::vector<unsigned int>{ 2, 4, 12 });
+        CHECK(bases.count(4) == 0);
+        CHECK(bases.size() == 9);
+    }
+
+    TEST_CASE("A stale extension record does not touch a single-record file") {
+        uffs::MftRefreshSet set(kRecordSize);
+        std::vector<unsigned char> unchanged = make_chunk(0);
+        std::vector<unsigned char> changed = make_chunk(8);
+        make_record(&changed[0], true, 3);  // claims FRS 3, which has no attribute list
+
+        add(set, 0, unchanged, false);
+        add(set, 8, changed, true);
+        set.finish();
+
+        CHECK(set.missing_records().empty());
+        auto const bases = visit(set);
+        CHECK(bases.count(3) == 0);
+        CHECK(bases.size() == 8);
+    }
+}
@@ -0,0 +1,356 @@
+// ============================================================================
+// Unit Tests for the Raw NTFS Image Reader
+// ============================================================================
+// Tests NtfsImage on small hand-built volume images: a boot sector, a $MFT
+// whose record 0 is written here (so its run lists are known exactly) and
+// records 1 - 63 from SyntheticMftGenerator.
+//
+// Key behaviors to verify:
+// - Boot sector geometry and the $MFT start cluster are decoded
+// - Fragmented $DATA and non-resident $BITMAP run lists are followed
+// - $ATTRIBUTE_LIST extension records are read through $MFT itself
+// - read_plan() chunks, skips unused records and reads the right bytes
+// - Foreign, damaged and truncated images are rejected
+// ============================================================================
+
+#include "../doctest.h"
+#include "../../src/io/ntfs_image.hpp"
+#include "../../src/io/synthetic_mft.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t kClusterSize = 4096;
+constexpr uint32_t kRecordSize = 1024;
+constexpr uint32_t kRecordCount = 64;          // 16 clusters of $MFT
+constexpr uint64_t kTotalClusters = 64;
+constexpr uint64_t kMftExtents[][2] = { { 8, 4 }, { 16, 40 } };  // (next VCN, LCN)
+constexpr uint64_t kBitmapLcn = 30;
+constexpr uint32_t kExtensionRecord = 16;
+
+template<class T>
+void put(unsigned char* p, T value)
+{
+    memcpy(p, &value, sizeof(value));
+}
+
+/// Appends a non-resident attribute with one run per (length, LCN) pair.
+uint32_t put_non_resident(unsigned char* a, uint32_t type, uint64_t lowest_vcn,
+    std::vector<std::pair<uint64_t, uint64_t>> const& runs, uint64_t data_size)
+{
+    unsigned char* p = a + 0x40;
+    uint64_t vcn = lowest_vcn;
+    int64_t lcn = 0;
+    for (auto const& run : runs)
+    {
+        int64_t const delta = static_cast<int64_t>(run.second) - lcn;
+        *p++ = 0x11;
+        *p++ = static_cast<unsigned char>(run.first);
+        *p++ = static_cast<unsigned char>(static_cast<int8_t>(delta));
+        vcn += run.first;
+        lcn = static_cast<int64_t>(run.second);
+    }
+    *p++ = 0;
+    uint32_t const length = (static_cast<uint32_t>(p - a) + 7) & ~7U;
+
+    put<uint32_t>(a, type);
+    put<uint32_t>(a + 0x04, length);
+    a[0x08] = 1;
+    put<uint16_t>(a + 0x0A, 0x40);
+    put<int64_t>(a + 0x10, static_cast<int64_t>(lowest_vcn));
+    put<int64_t>(a + 0x18, static_cast<int64_t>(vcn) - 1);
+    put<uint16_t>(a + 0x20, 0x40);
+    if (lowest_vcn == 0)
+    {
+        put<int64_t>(a + 0x28, static_cast<int64_t>((vcn - lowest_vcn) * kClusterSize));
+        put<int64_t>(a + 0x30, static_cast<int64_t>(data_size));
+        put<int64_t>(a + 0x38, static_cast<int64_t>(data_size));
+    }
+    return length;
+}
+
+/// Appends a resident attribute holding @p value.
+uint32_t put_resident(unsigned char* a, uint32_t type, std::vector<unsigned char> const& value)
+{
+    uint32_t const length = (0x18 + static_cast<uint32_t>(value.size()) + 7) & ~7U;
+    put<uint32_t>(a, type);
+    put<uint32_t>(a + 0x04, length);
+    put<uint32_t>(a + 0x10, static_cast<uint32_t>(value.size()));
+    put<uint16_t>(a + 0x14, 0x18);
+    memcpy(a + 0x18, value.data(), value.size());
+    return length;
+}
+
+/// Starts an in-use FILE record; returns the offset of the first attribute.
+uint32_t begin_record(unsigned char* record, uint64_t base)
+{
+    memset(record, 0, kRecordSize);
+    memcpy(record, "FILE", 4);
+    put<uint16_t>(record + 0x04, 0x30);
+    put<uint16_t>(record + 0x06, 1 + kRecordSize / 512);
+    put<uint16_t>(record + 0x10, 1);
+    put<uint16_t>(record + 0x14, 0x38);
+    put<uint16_t>(record + 0x16, 1);
+    put<uint32_t>(record + 0x1C, kRecordSize);
+    put<uint64_t>(record + 0x20, base);
+    return 0x38;
+}
+
+/// Terminates the attribute chain at @p end and applies the update sequence array.
+void end_record(unsigned char* record, uint32_t end)
+{
+    put<uint32_t>(record + end, 0xFFFFFFFF);
+    put<uint32_t>(record + 0x18, end + 8);
+    uint16_t const usn = 0x0007;
+    put<uint16_t>(record + 0x30, usn);
+    for (uint32_t i = 1; i <= kRecordSize / 512; ++i)
+    {
+        memcpy(record + 0x30 + 2 * i, record + i * 512 - 2, 2);
+        put<uint16_t>(record + i * 512 - 2, usn);
+    }
+}
+
+struct TestImage
+{
+    std::vector<unsigned char> volume;
+    std::vector<unsigned char> mft;      ///< $MFT as a file, before fixups are removed
+    std::vector<unsigned char> bitmap;
+};
+
+/// Builds the volume; with @p attribute_list the second $DATA extent lives in
+/// extension record 16, listed by an $ATTRIBUTE_LIST in record 0.
+TestImage make_image(bool attribute_list)
+{
+    TestImage image;
+    image.volume.assign(kTotalClusters * kClusterSize, 0);
+
+    unsigned char* const boot = image.volume.data();
+    boot[0] = 0xEB;
+    memcpy(boot + 3, "NTFS    ", 8);
+    put<uint16_t>(boot + 0x0B, 512);
+    boot[0x0D] = kClusterSize / 512;
+    put<int64_t>(boot + 0x28, static_cast<int64_t>(kTotalClusters * kClusterSize / 512));
+    put<int64_t>(boot + 0x30, static_cast<int64_t>(kMftExtents[0][1]));
+    put<int64_t>(boot + 0x38, 2);
+    boot[0x40] = static_cast<unsigned char>(-10);   // 2^10 bytes per record
+    put<uint64_t>(boot + 0x48, 0x1234567890ABCDEFULL);
+    boot[510] = 0x55;
+    boot[511] = 0xAA;
+
+    uffs::SyntheticMftOptions options;
+    options.record_count = kRecordCount;
+    options.record_size = kRecordSize;
+    options.cluster_size = kClusterSize;
+    options.free_ratio = 0.2;
+    uffs::SyntheticMftGenerator const generator(options);
+    image.mft.resize(kRecordCount * kRecordSize);
+    generator.generate(0, kRecordCount, image.mft.data());
+
+    image.bitmap.assign(kRecordCount / 8, 0);
+    for (uint32_t frs = 0; frs < kRecordCount; ++frs)
+    {
+        if (generator.describe(frs).in_use || frs == 0 || (attribute_list && frs == kExtensionRecord))
+        {
+            image.bitmap[frs / 8] |= static_cast<unsigned char>(1U << (frs % 8));
+        }
+    }
+
+    uint64_t const first_run = kMftExtents[0][0];
+    uint64_t const second_run = kMftExtents[1][0] - kMftExtents[0][0];
+    unsigned char* const record0 = image.mft.data();
+    uint32_t offset = begin_record(record0, 0);
+    if (attribute_list)
+    {
+        // $DATA (VCN 0) and $BITMAP here, $DATA (VCN 8) in the extension record
+        std::vector<unsigned char> list(3 * 0x20, 0);
+        uint32_t const types[] = { 0x80, 0x80, 0xB0 };
+        uint64_t const vcns[] = { 0, first_run, 0 };
+        uint64_t const owners[] = { 1ULL << 48, kExtensionRecord | (1ULL << 48), 1ULL << 48 };
+        for (size_t i = 0; i < 3; ++i)
+        {
+            put<uint32_t>(&list[i * 0x20], types[i]);
+            put<uint16_t>(&list[i * 0x20 + 0x04], 0x20);
+            list[i * 0x20 + 0x07] = 0x1A;
+            put<uint64_t>(&list[i * 0x20 + 0x08], vcns[i]);
+            put<uint64_t>(&list[i * 0x20 + 0x10], owners[i]);
+        }
+        offset += put_resident(record0 + offset, 0x20, list);
+        offset += put_non_resident(record0 + offset, 0x80, 0, { { first_run, kMftExtents[0][1] } },
+            kRecordCount * kRecordSize);
+
+        unsigned char* const extension = image.mft.data() + kExtensionRecord * kRecordSize;
+        uint32_t const extension_end = begin_record(extension, 1ULL << 48) +
+            put_non_resident(extension + 0x38, 0x80, first_run, { { second_run, kMftExtents[1][1] } }, 0);
+        end_record(extension, extension_end);
+    }
+    else
+    {
+        offset += put_non_resident(record0 + offset, 0x80, 0,
+            { { first_run, kMftExtents[0][1] }, { second_run, kMftExtents[1][1] } }, kRecordCount * kRecordSize);
+    }
+    offset += put_non_resident(record0 + offset, 0xB0, 0, { { 1, kBitmapLcn } }, image.bitmap.size());
+    end_record(record0, offset);
+
+    // Scatter $MFT and its bitmap over the volume
+    uint64_t vcn = 0;
+    for (auto const& extent : kMftExtents)
+    {
+        memcpy(&image.volume[extent[1] * kClusterSize], &image.mft[vcn * kClusterSize],
+            (extent[0] - vcn) * kClusterSize);
+        vcn = extent[0];
+    }
+    memcpy(&image.volume[kBitmapLcn * kClusterSize], image.bitmap.data(), image.bitmap.size());
+    return image;
+}
+
+/// Writes @p bytes to a file removed when the object goes out of scope.
+struct TempFile
+{
+    std::string path;
+
+    explicit TempFile(std::vector<unsigned char> const& bytes, size_t prefix = 0)
+        : path((std::filesystem::temp_directory_path() / "uffs_test_ntfs_image.img").string())
+    {
+        std::ofstream out(path, std::ios::out | std::ios::binary | std::ios::trunc);
+        std::vector<char> const padding(prefix, 'x');
+        out.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+        out.write(reinterpret_cast<char const*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    }
+
+    ~TempFile()
+    {
+        std::remove(path.c_str());
+    }
+};
+
+} // namespace
+
+TEST_SUITE("NtfsImage") {
+
+    TEST_CASE("Boot sector and $MFT run lists are decoded") {
+        for (bool const attribute_list : { false, true })
+        {
+            TestImage const image = make_image(attribute_list);
+            TempFile const file(image.volume);
+            uffs::NtfsImage const ntfs(file.path.c_str());
+
+            CHECK(ntfs.cluster_size() == kClusterSize);
+            CHECK(ntfs.mft_record_size() == kRecordSize);
+            CHECK(ntfs.mft_lcn() == 4);
+            CHECK(ntfs.total_clusters() == kTotalClusters);
+            CHECK(ntfs.volume_serial_number() == 0x1234567890ABCDEFULL);
+            CHECK(ntfs.mft_capacity() == kRecordCount);
+
+            uffs::NtfsImage::ExtentMap const expected = { { 8, 4 }, { 16, 40 } };
+            CHECK(ntfs.mft_data_extents() == expected);
+            uffs::NtfsImage::ExtentMap const bitmap_extents = { { 1, 30 } };
+            CHECK(ntfs.mft_bitmap_extents() == bitmap_extents);
+            CHECK(ntfs.mft_bitmap() == image.bitmap);
+        }
+    }
+
+    TEST_CASE("Read plan skips unused records and reads $MFT bytes") {
+        TestImage const image = make_image(false);
+        TempFile const file(image.volume);
+        uffs::NtfsImage ntfs(file.path.c_str());
+
+        // Two clusters (8 records) per chunk
+        std::vector<uffs::MftReadChunk> const chunks = ntfs.read_plan(2 * kClusterSize);
+        REQUIRE(chunks.size() == 8);
+        CHECK(chunks[3].lcn == 10);
+        CHECK(chunks[4].vcn == 8);
+        CHECK(chunks[4].lcn == 40);   // chunks never straddle extents
+
+        // Records 12 - 23 are reserved and unused
+        CHECK(chunks[1].skip_begin == 0);
+        CHECK(chunks[1].skip_end == 1);
+        CHECK(chunks[2].read_clusters() == 0);
+
+        unsigned long long clusters = 0;
+        for (uffs::MftReadChunk const& chunk : chunks)
+        {
+            clusters += chunk.cluster_count;
+            std::vector<unsigned char> buffer(static_cast<size_t>(chunk.read_clusters() * kClusterSize) + 1);
+            size_t const size = ntfs.read_chunk(chunk, buffer.data());
+            REQUIRE(size == buffer.size() - 1);
+            CHECK(memcmp(buffer.data(), &image.mft[(chunk.vcn + chunk.skip_begin) * kClusterSize], size) == 0);
+
+            // Skipped clusters hold no in-use record
+            for (unsigned long long c = 0; c < chunk.cluster_count; ++c)
+            {
+                if (c >= chunk.skip_begin && c < chunk.cluster_count - chunk.skip_end)
+                {
+                    continue;
+                }
+                for (uint32_t r = 0; r < kClusterSize / kRecordSize; ++r)
+                {
+                    uint64_t const frs = ((chunk.vcn + c) * kClusterSize) / kRecordSize + r;
+                    CHECK((image.bitmap[frs / 8] & (1U << (frs % 8))) == 0);
+                }
+            }
+        }
+        CHECK(clusters == kRecordCount * kRecordSize / kClusterSize);
+
+        // The default plan uses 1 MB chunks, one per extent here
+        CHECK(ntfs.read_plan().size() == 2);
+    }
+
+    TEST_CASE("Volume offset selects a partition inside a disk image") {
+        TestImage const image = make_image(true);
+        TempFile const file(image.volume, 1 << 20);
+        CHECK_THROWS_AS(uffs::NtfsImage(file.path.c_str()), std::runtime_error);
+
+        uffs::NtfsImage const ntfs(file.path.c_str(), 1 << 20);
+        CHECK(ntfs.mft_capacity() == kRecordCount);
+        CHECK(ntfs.mft_data_extents().size() == 2);
+    }
+
+    TEST_CASE("Damaged images are rejected") {
+        TestImage const good = make_image(true);
+
+        TestImage image = good;
+        image.volume[3] = 'X';   // OEM ID
+        {
+            TempFile const file(image.volume);
+            CHECK_THROWS_AS(uffs::NtfsImage(file.path.c_str()), std::runtime_error);
+        }
+
+        image = good;
+        image.volume[0x0B] = 0x30;   // 560-byte sectors
+        {
+            TempFile const file(image.volume);
+            CHECK_THROWS_AS(uffs::NtfsImage(file.path.c_str()), std::runtime_error);
+        }
+
+        image = good;
+        image.volume[4 * kClusterSize + 510] ^= 0xFF;   // breaks the update sequence of record 0
+        {
+            TempFile const file(image.volume);
+            CHECK_THROWS_AS(uffs::NtfsImage(file.path.c_str()), std::runtime_error);
+        }
+
+        image = good;
+        image.volume[4 * kClusterSize + kExtensionRecord * kRecordSize] = 'B';   // extension record magic
+        {
+            TempFile const file(image.volume);
+            CHECK_THROWS_AS(uffs::NtfsImage(file.path.c_str()), std::runtime_error);
+        }
+
+        image = good;
+        image.volume.resize(40 * kClusterSize + kClusterSize / 2);   // ends inside the second extent
+        {
+            TempFile const file(image.volume);
+            uffs::NtfsImage ntfs(file.path.c_str());
+            std::vector<uffs::MftReadChunk> const chunks = ntfs.read_plan();
+            std::vector<unsigned char> buffer(static_cast<size_t>(chunks.back().read_clusters() * kClusterSize));
+            CHECK_THROWS_AS(ntfs.read_chunk(chunks.back(), buffer.data()), std::runtime_error);
+        }
+    }
+}
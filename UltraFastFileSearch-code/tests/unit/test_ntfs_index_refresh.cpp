@@ -0,0 +1,387 @@
+// ============================================================================
+// Unit Tests for NtfsIndex MFT Re-scans
+// ============================================================================
+// Loads an NtfsIndex from a synthetic MFT, changes a few records in a copy so
+// that only a few chunks hash differently, re-scans the copy the way
+// OverlappedNtfsMftReadPayload does, and compares every path, size and
+// directory total with a full load of the copy. NtfsIndex needs Windows.h.
+//
+// Key behaviors to verify:
+// - Deleted, moved, resized and new files, a moved directory and a deleted
+//   directory subtree leave the same length, allocated size and treesize
+//   as a full load
+//   (bulkiness is approximate after a refresh and is not compared)
+// - Only the records of changed chunks are re-parsed
+// - A re-scan of an unchanged MFT re-parses nothing and changes nothing
+// ============================================================================
+
+#include "../doctest.h"
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#include <tchar.h>
+
+#include "../../src/util/atomic_compat.hpp"
+#include "../../src/util/intrusive_ptr.hpp"
+#include "../../src/util/lock_ptr.hpp"
+#include "../../src/io/overlapped.hpp"
+#include "../../src/io/winnt_types.hpp"
+
+using namespace uffs::winnt;
+namespace winnt = uffs::winnt;
+
+#include "../../src/index/ntfs_index.hpp"
+#include "../../src/io/synthetic_mft.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t kRecordsPerChunk = 32;
+constexpr uint32_t kClusterSize = 4096;
+
+typedef std::vector<unsigned char> Mft;
+
+uffs::SyntheticMftOptions refresh_options()
+{
+    uffs::SyntheticMftOptions options;
+    options.record_count = 4096;
+    options.cluster_size = kClusterSize;
+    options.fanout = 8;
+    options.hardlink_ratio = 0.05;
+    options.ads_ratio = 0.1;
+    options.free_ratio = 0.05;
+    return options;
+}
+
+/// One line of a search over the whole index: a path and its sizes.
+struct Entry
+{
+    std::basic_string<TCHAR> path;
+    unsigned long long length;
+    unsigned long long allocated;
+    unsigned int treesize;
+    unsigned long attributes;
+
+    bool operator<(Entry const& other) const
+    {
+        return std::tie(path, length, allocated, treesize, attributes) <
+            std::tie(other.path, other.length, other.allocated, other.treesize, other.attributes);
+    }
+
+    bool operator==(Entry const& other) const
+    {
+        return std::tie(path, length, allocated, treesize, attributes) ==
+            std::tie(other.path, other.length, other.allocated, other.treesize, other.attributes);
+    }
+};
+
+/// Every path, stream and attribute the index reports, sorted.
+std::vector<Entry> listing(NtfsIndex const& index)
+{
+    std::vector<Entry> result;
+    std::tvstring path;
+    index.matches([&](TCHAR const* name, size_t length, bool ascii, NtfsIndex::key_type const& key, size_t)
+    {
+        Entry entry;
+        if (ascii)
+        {
+            char const* const chars = reinterpret_cast<char const*>(name);
+            entry.path.assign(chars, chars + length);
+        }
+        else
+        {
+            entry.path.assign(name, name + length);
+        }
+        NtfsIndex::size_info const& sizes = index.get_sizes(key);
+        entry.length = sizes.length;
+        entry.allocated = sizes.allocated;
+        entry.treesize = sizes.treesize;
+        entry.attributes = index.get_stdinfo(static_cast<unsigned int>(key.frs())).attributes();
+        result.push_back(entry);
+        return 1;
+    }, path, true, true, true);
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+/// Number of entries in one listing but not the other; 0 if they are equal.
+size_t differences(std::vector<Entry> const& a, std::vector<Entry> const& b)
+{
+    std::vector<Entry> difference;
+    std::set_symmetric_difference(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(difference));
+    return difference.size();
+}
+
+/// Feeds @p mft to @p index chunk by chunk, as the live reader does.
+/// @return Number of chunks chunk_changed() reported as changed
+size_t read_mft(NtfsIndex& index, Mft& mft, uint32_t record_size)
+{
+    size_t changed_chunks = 0;
+    size_t const chunk_size = static_cast<size_t>(kRecordsPerChunk) * record_size;
+    for (size_t offset = 0; offset < mft.size(); offset += chunk_size)
+    {
+        size_t const size = std::min(chunk_size, mft.size() - offset);
+        unsigned char* const buffer = &mft[offset];
+        uint64_t const hash = uffs::mft_chunk_hash(buffer, size, 0, 0);
+        index.preload_concurrent(offset, buffer, size);
+
+        bool const refreshing = index.refreshing();
+        NtfsIndex::Fragment fragment;
+        if (!refreshing)
+        {
+            index.parse(offset, buffer, size, fragment);
+        }
+
+        bool const changed = index.chunk_changed(offset, hash);
+        changed_chunks += changed;
+        if (!refreshing)
+        {
+            index.load(fragment, 0, 0);
+        }
+        else if (index.refresh(offset, buffer, size, 0, 0, changed))
+        {
+            index.finish_refresh([&](unsigned int frs, void* record)
+            {
+                memcpy(record, &mft[static_cast<size_t>(frs) * record_size], record_size);
+                return true;
+            });
+        }
+    }
+    return changed_chunks;
+}
+
+/// A finished index of @p mft, loaded from a copy (loading fixes records up in place).
+void load(NtfsIndex& index, Mft const& mft, uffs::SyntheticMftGenerator const& generator)
+{
+    index.set_mft_record_size(generator.record_size());
+    index.set_mft_capacity(static_cast<unsigned int>(generator.record_count()));
+    index.set_cluster_size(kClusterSize);
+    index.reserve(static_cast<unsigned int>(generator.record_count()));
+    Mft copy = mft;
+    read_mft(index, copy, generator.record_size());
+}
+
+/// Re-scans @p index from a copy of @p mft.
+/// @return Number of chunks that hashed differently from the last pass
+size_t refresh(NtfsIndex& index, Mft const& mft, uint32_t record_size)
+{
+    index.begin_refresh();
+    Mft copy = mft;
+    return read_mft(index, copy, record_size);
+}
+
+/// Lets @p edit change record @p frs, undoing and redoing the update sequence around it.
+template<class F>
+void edit_record(Mft& mft, uint32_t record_size, uint64_t frs, F&& edit)
+{
+    unsigned char* const record = &mft[static_cast<size_t>(frs) * record_size];
+    auto* const frsh = reinterpret_cast<ntfs::FILE_RECORD_SEGMENT_HEADER*>(record);
+    REQUIRE(frsh->MultiSectorHeader.unfixup(record_size));
+    edit(frsh);
+
+    unsigned char* const usa = record + frsh->MultiSectorHeader.USAOffset;
+    for (unsigned short i = 1; i < frsh->MultiSectorHeader.USACount && i * 512U <= record_size; ++i)
+    {
+        unsigned char* const check = record + i * 512U - sizeof(unsigned short);
+        memcpy(usa + i * sizeof(unsigned short), check, sizeof(unsigned short));
+        memcpy(check, usa, sizeof(unsigned short));
+    }
+}
+
+/// Attribute @p nth of @p type in @p frsh, or nullptr.
+ntfs::ATTRIBUTE_RECORD_HEADER* find_attribute(ntfs::FILE_RECORD_SEGMENT_HEADER* frsh,
+    uint32_t record_size, ntfs::AttributeTypeCode type, int nth = 0)
+{
+    void const* const end = frsh->end(record_size);
+    for (ntfs::ATTRIBUTE_RECORD_HEADER* ah = frsh->begin();
+        ah < end && ah->Type != ntfs::AttributeTypeCode::AttributeEnd; ah = ah->next())
+    {
+        if (ah->Type == type && nth-- == 0)
+        {
+            return ah;
+        }
+    }
+    return nullptr;
+}
+
+void mark_deleted(Mft& mft, uint32_t record_size, uint64_t frs)
+{
+    edit_record(mft, record_size, frs, [](ntfs::FILE_RECORD_SEGMENT_HEADER* frsh)
+    {
+        frsh->Flags &= static_cast<unsigned short>(~ntfs::FRH_IN_USE);
+    });
+}
+
+/// Gives every name of record @p frs the parent @p parent.
+void move_record(Mft& mft, uint32_t record_size, uint64_t frs, uint64_t parent)
+{
+    edit_record(mft, record_size, frs, [&](ntfs::FILE_RECORD_SEGMENT_HEADER* frsh)
+    {
+        for (int n = 0; ntfs::ATTRIBUTE_RECORD_HEADER* ah =
+            find_attribute(frsh, record_size, ntfs::AttributeTypeCode::AttributeFileName, n); ++n)
+        {
+            // The low 48 bits are the FRS, the high 16 the sequence number
+            memcpy(ah->Resident.GetValue(), &parent, 6);
+        }
+    });
+}
+
+} // namespace
+
+TEST_SUITE("NtfsIndexRefresh") {
+
+    TEST_CASE("Refreshed totals match a full load of the changed MFT") {
+        uffs::SyntheticMftGenerator const generator(refresh_options());
+        uint32_t const record_size = generator.record_size();
+        uint64_t const record_count = generator.record_count();
+        Mft before(static_cast<size_t>(record_count) * record_size);
+        generator.generate(0, static_cast<size_t>(record_count), before.data());
+
+        std::vector<uint64_t> files, directories, free_records;
+        for (uint64_t frs = uffs::kSyntheticFirstUserRecord; frs < record_count; ++frs)
+        {
+            uffs::SyntheticMftRecordInfo const info = generator.describe(frs);
+            (!info.in_use ? free_records : info.directory ? directories : files).push_back(frs);
+        }
+        REQUIRE(files.size() > 1000);
+        REQUIRE(directories.size() > 10);
+        REQUIRE(free_records.size() > 10);
+
+        Mft after = before;
+        std::vector<uint64_t> changed;
+
+        // A deleted file
+        uint64_t const deleted = files[100];
+        mark_deleted(after, record_size, deleted);
+        changed.push_back(deleted);
+
+        // A file moved to another directory, with all of its names
+        uint64_t const moved = files[500];
+        uint64_t const target = directories[directories.size() / 2];
+        REQUIRE(generator.parent_of(moved) != target);
+        move_record(after, record_size, moved, target);
+        changed.push_back(moved);
+
+        // A directory with subdirectories moved to the root: its record is
+        // re-parsed, so the totals of its subtree must be carried over
+        uint64_t moved_directory = 0;
+        for (size_t d = 1; d < directories.size() && !moved_directory; ++d)
+        {
+            bool has_subdirectories = false;
+            for (uint64_t const frs : directories)
+            {
+                has_subdirectories |= generator.parent_of(frs) == directories[d];
+            }
+            if (has_subdirectories && generator.parent_of(directories[d]) != uffs::kSyntheticRootRecord)
+            {
+                moved_directory = directories[d];
+            }
+        }
+        REQUIRE(moved_directory);
+        move_record(after, record_size, moved_directory, uffs::kSyntheticRootRecord);
+        changed.push_back(moved_directory);
+
+        // A file that grew by a cluster
+        uint64_t resized = 0;
+        for (size_t i = 900; i < files.size() && !resized; ++i)
+        {
+            uffs::SyntheticMftRecordInfo const info = generator.describe(files[i]);
+            if (info.data_size > kClusterSize * 4ULL)
+            {
+                resized = files[i];
+            }
+        }
+        REQUIRE(resized);
+        edit_record(after, record_size, resized, [&](ntfs::FILE_RECORD_SEGMENT_HEADER* frsh)
+        {
+            ntfs::ATTRIBUTE_RECORD_HEADER* const ah =
+                find_attribute(frsh, record_size, ntfs::AttributeTypeCode::AttributeData);
+            REQUIRE(ah);
+            REQUIRE(ah->IsNonResident);
+            ah->NonResident.DataSize += kClusterSize;
+            ah->NonResident.AllocatedSize += kClusterSize;
+        });
+        changed.push_back(resized);
+
+        // A new file in a record that was free: a copy of another file's record
+        uint64_t const created = free_records[free_records.size() / 2];
+        uint64_t const source = files[1300];
+        memcpy(&after[static_cast<size_t>(created) * record_size],
+            &after[static_cast<size_t>(source) * record_size], record_size);
+        changed.push_back(created);
+
+        // A whole directory subtree: a directory without subdirectories and its files
+        uint64_t removed_directory = 0;
+        for (size_t d = directories.size(); d-- > 1 && !removed_directory;)
+        {
+            bool leaf = true;
+            for (uint64_t const frs : directories)
+            {
+                leaf &= generator.parent_of(frs) != directories[d];
+            }
+            if (leaf && directories[d] != target && directories[d] != generator.parent_of(moved))
+            {
+                removed_directory = directories[d];
+            }
+        }
+        REQUIRE(removed_directory);
+        mark_deleted(after, record_size, removed_directory);
+        changed.push_back(removed_directory);
+        for (uint64_t const frs : files)
+        {
+            if (generator.parent_of(frs) == removed_directory && frs != moved && frs != source)
+            {
+                mark_deleted(after, record_size, frs);
+                changed.push_back(frs);
+            }
+        }
+
+        std::sort(changed.begin(), changed.end());
+        size_t changed_chunk_count = 0;
+        for (size_t i = 0; i != changed.size(); ++i)
+        {
+            changed_chunk_count += !i || changed[i] / kRecordsPerChunk != changed[i - 1] / kRecordsPerChunk;
+        }
+
+        NtfsIndex refreshed(std::tvstring(_T("C:\\")));
+        load(refreshed, before, generator);
+        REQUIRE(refreshed.get_finished() == 0);
+        std::vector<Entry> const original = listing(refreshed);
+
+        CHECK(refresh(refreshed, after, record_size) == changed_chunk_count);
+        CHECK(!refreshed.refreshing());
+        CHECK(refreshed.get_finished() == 0);
+        CHECK(refreshed.refreshed_files() >= changed.size());
+        CHECK(refreshed.refreshed_files() <= changed_chunk_count * kRecordsPerChunk);
+
+        NtfsIndex fresh(std::tvstring(_T("C:\\")));
+        load(fresh, after, generator);
+        std::vector<Entry> const expected = listing(fresh);
+        CHECK(differences(original, expected) != 0);
+        CHECK(differences(listing(refreshed), expected) == 0);
+    }
+
+    TEST_CASE("A re-scan of an unchanged MFT changes nothing") {
+        uffs::SyntheticMftGenerator const generator(refresh_options());
+        uint32_t const record_size = generator.record_size();
+        Mft mft(static_cast<size_t>(generator.record_count()) * record_size);
+        generator.generate(0, static_cast<size_t>(generator.record_count()), mft.data());
+
+        NtfsIndex index(std::tvstring(_T("C:\\")));
+        load(index, mft, generator);
+        std::vector<Entry> const expected = listing(index);
+
+        CHECK(refresh(index, mft, record_size) == 0);
+        CHECK(index.refreshed_files() == 0);
+        CHECK(differences(listing(index), expected) == 0);
+    }
+}
@@ -13,6 +13,7 @@
 // - Bitfields don't overlap or corrupt each other
 // - Sentinel values (~0) are handled correctly
 // - Equality ignores the index field (it's not part of identity)
+// - The 64-bit word of HugeNtfsIndex widens the fields to 16/24/24 bits
 // ============================================================================
 
 #include "../doctest.h"
@@ -115,3 +116,43 @@ TEST_SUITE("key_type_internal") {
     }
 }
 
+
+TEST_SUITE("basic_key_type_internal<unsigned long long>") {
+
+    typedef uffs::basic_key_type_internal<unsigned long long> wide_key;
+
+    TEST_CASE("a 64-bit word widens the small fields") {
+        CHECK(wide_key::name_info_bits == 16);
+        CHECK(wide_key::stream_info_bits == 24);
+        CHECK(wide_key::index_bits == 24);
+
+        CHECK(sizeof(uffs::key_type_internal) == 8);
+        CHECK(sizeof(wide_key) == 12);
+    }
+
+    TEST_CASE("values past the compact ceilings round trip") {
+        wide_key key(0xFFFFFFFE, 40000, 100000);
+        key.index(1000000);
+
+        CHECK(key.frs() == 0xFFFFFFFE);
+        CHECK(key.name_info() == 40000);
+        CHECK(key.stream_info() == 100000);
+        CHECK(key.index() == 1000000);
+
+        // Fields stay independent
+        key.stream_info(9000);
+        CHECK(key.name_info() == 40000);
+        CHECK(key.stream_info() == 9000);
+        CHECK(key.index() == 1000000);
+    }
+
+    TEST_CASE("all ones is still the sentinel") {
+        wide_key key(0, 0xFFFF, 0xFFFFFF);
+        CHECK(key.name_info() == static_cast<wide_key::name_info_type>(~wide_key::name_info_type()));
+        CHECK(key.stream_info() == static_cast<wide_key::stream_info_type>(~wide_key::stream_info_type()));
+
+        wide_key valid(0, 0xFFFE, 0xFFFFFE);
+        CHECK(valid.name_info() == 0xFFFE);
+        CHECK(valid.stream_info() == 0xFFFFFE);
+    }
+}
@@ -8,6 +8,7 @@
 // - NameInfo: offset and ASCII flag share a single field (bit 0 = ASCII)
 // - Sentinel values (~0) indicate "no next entry" in linked lists
 // - Structures are properly packed for memory efficiency
+// - The 64-bit layout (HugeNtfsIndex) holds offsets and links past 4G
 // ============================================================================
 
 #include "../doctest.h"
@@ -142,18 +143,31 @@ TEST_SUITE("Record") {
         CHECK(record.name_count == 0);
         CHECK(record.stream_count == 0);
         CHECK(record.first_child == static_cast<unsigned int>(~0U));  // No children
+        CHECK(record.attributes == 0);
     }
 
-    TEST_CASE("embedded first_name and first_stream are initialized") {
+    TEST_CASE("embedded first_name and the no_stream() column entry are initialized") {
         uffs::Record record;
 
         // first_name should have sentinel values
         CHECK(record.first_name.next_entry == static_cast<unsigned int>(~0U));
         CHECK(record.first_name.name.offset() == static_cast<unsigned int>(~0U));
 
-        // first_stream should have sentinel values
-        CHECK(record.first_stream.next_entry == static_cast<unsigned int>(~0U));
-        CHECK(record.first_stream.name.offset() == static_cast<unsigned int>(~0U));
+        // The first stream of a record without streams has sentinel values
+        uffs::StreamInfo const stream = uffs::Record::no_stream();
+        CHECK(stream.next_entry == static_cast<unsigned int>(~0U));
+        CHECK(stream.name.offset() == static_cast<unsigned int>(~0U));
+        CHECK(stream.length == 0);
+        CHECK(stream.allocated == 0);
+    }
+
+    TEST_CASE("timestamps live apart from the record") {
+        CHECK(sizeof(uffs::Record) == 4 + 2 + 2 + 4 + sizeof(uffs::LinkInfo));
+
+        uffs::RecordTimes times;
+        CHECK(times.created == 0);
+        CHECK(times.written == 0);
+        CHECK(times.accessed == 0);
     }
 
     TEST_CASE("name_count and stream_count track hardlinks and ADS") {
@@ -169,3 +183,60 @@ TEST_SUITE("Record") {
     }
 }
 
+
+TEST_SUITE("64-bit layout") {
+
+    typedef unsigned long long Index;
+
+    TEST_CASE("name offsets go past 4G and keep the ASCII flag") {
+        uffs::BasicNameInfo<Index> info{};
+
+        // A names pool of 5G elements
+        info.offset(5000000000ULL);
+        info.ascii(true);
+        CHECK(info.offset() == 5000000000ULL);
+        CHECK(info.ascii() == true);
+
+        info.ascii(false);
+        CHECK(info.offset() == 5000000000ULL);
+
+        // The largest offset is one below the sentinel
+        info.offset(uffs::BasicNameInfo<Index>::max_offset);
+        CHECK(info.offset() == uffs::BasicNameInfo<Index>::max_offset);
+        CHECK(uffs::BasicNameInfo<Index>::max_offset > 0xFFFFFFFFULL);
+    }
+
+    TEST_CASE("sentinel offset still means 'no name'") {
+        uffs::BasicLinkInfo<Index> link;
+        CHECK(link.next_entry == ~Index());
+        CHECK(link.name.offset() == ~Index());
+    }
+
+    TEST_CASE("the compact layout stops below 2G") {
+        CHECK(uffs::NameInfo::max_offset == 0x7FFFFFFEU);
+    }
+
+    TEST_CASE("list links go past 4G") {
+        uffs::BasicLinkInfo<Index> link;
+        link.next_entry = 6000000000ULL;
+        link.name.offset(4294967296ULL);
+        link.parent = 5;
+        CHECK(link.next_entry == 6000000000ULL);
+        CHECK(link.name.offset() == 4294967296ULL);
+        CHECK(link.parent == 5);
+
+        uffs::BasicChildInfo<Index> child;
+        child.next_entry = 4294967300ULL;
+        CHECK(child.next_entry == 4294967300ULL);
+        CHECK(child.record_number == static_cast<unsigned int>(~0U));  // FRS stays 32-bit
+    }
+
+    TEST_CASE("packed sizes of both widths") {
+        CHECK(sizeof(uffs::NameInfo) == 5);
+        CHECK(sizeof(uffs::BasicNameInfo<Index>) == 9);
+        CHECK(sizeof(uffs::LinkInfo) == 13);
+        CHECK(sizeof(uffs::BasicLinkInfo<Index>) == 21);
+        CHECK(sizeof(uffs::Record) == 25);
+        CHECK(sizeof(uffs::BasicRecord<Index>) == 37);
+    }
+}
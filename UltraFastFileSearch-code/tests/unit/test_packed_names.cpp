@@ -0,0 +1,154 @@
+// ============================================================================
+// Unit Tests for the LZ4-Packed Names Pool
+// ============================================================================
+// Tests PackedNames, which --pack-names uses to keep the index's names pool
+// in independently decodable 4 KB LZ4 blocks.
+//
+// Key behaviors to verify:
+// - Every range of the pool reads back as the original characters
+// - Names that run across the end of a block read back whole
+// - A cursor keeps serving blocks it decoded, and switches between them
+// - Repetitive pools get smaller; incompressible blocks are stored raw
+// - Ranges outside the pool, or longer than a block, are rejected
+// ============================================================================
+
+#include "../doctest.h"
+#include "../../src/io/packed_names.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+typedef uffs::PackedNames<char16_t> Pool;
+
+/// Something shaped like a directory listing: shared stems and extensions.
+std::vector<char16_t> make_listing(size_t names)
+{
+    static char const* const extensions[] = { ".dll", ".mui", ".txt", ".manifest" };
+    std::vector<char16_t> chars;
+    for (size_t i = 0; i != names; ++i)
+    {
+        std::string const name = "amd64_microsoft-windows-component" + std::to_string(i % 97) +
+            extensions[i % 4];
+        chars.insert(chars.end(), name.begin(), name.end());
+    }
+    return chars;
+}
+
+std::vector<char16_t> make_noise(size_t count, uint32_t seed)
+{
+    std::vector<char16_t> chars(count);
+    for (auto& c : chars)
+    {
+        seed = seed * 1103515245U + 12345U;
+        c = static_cast<char16_t>(seed >> 16);
+    }
+    return chars;
+}
+
+bool reads_back(Pool const& pool, std::vector<char16_t> const& chars, size_t offset, size_t count,
+    Pool::Cursor& cursor)
+{
+    char16_t const* const p = pool.at(offset, count, cursor);
+    return std::equal(p, p + count, chars.begin() + static_cast<ptrdiff_t>(offset));
+}
+
+} // namespace
+
+TEST_SUITE("PackedNames") {
+
+    TEST_CASE("Every name reads back, in order and at random") {
+        std::vector<char16_t> const chars = make_listing(5000);
+        Pool pool;
+        pool.pack(chars.data(), chars.size(), 3);
+        REQUIRE(pool.size() == chars.size());
+
+        Pool::Cursor cursor;
+        bool all = true;
+        for (size_t offset = 0; offset < chars.size(); offset += 37)
+        {
+            all = all && reads_back(pool, chars, offset, std::min<size_t>(37, chars.size() - offset), cursor);
+        }
+        CHECK(all);
+
+        uint32_t seed = 5;
+        for (int i = 0; i < 2000 && all; ++i)
+        {
+            seed = seed * 1103515245U + 12345U;
+            size_t const count = 1 + (seed >> 8) % 255;
+            size_t const offset = (seed >> 4) % (chars.size() - count);
+            all = reads_back(pool, chars, offset, count, cursor);
+        }
+        CHECK(all);
+    }
+
+    TEST_CASE("Names across a block boundary read back whole") {
+        std::vector<char16_t> const chars = make_listing(2000);
+        Pool pool;
+        pool.pack(chars.data(), chars.size(), 1);
+
+        Pool::Cursor cursor;
+        for (size_t boundary = Pool::kBlockChars; boundary + 10 < chars.size(); boundary += Pool::kBlockChars)
+        {
+            CHECK(reads_back(pool, chars, boundary - 10, 20, cursor));
+            CHECK(reads_back(pool, chars, boundary - 1, 2, cursor));
+            CHECK(reads_back(pool, chars, boundary - 10, 5, cursor));
+        }
+        CHECK(reads_back(pool, chars, Pool::kBlockChars - 1, Pool::kBlockChars + 1, cursor));
+    }
+
+    TEST_CASE("Cursors switch between blocks and stay independent") {
+        std::vector<char16_t> const chars = make_listing(4000);
+        Pool pool;
+        pool.pack(chars.data(), chars.size(), 2);
+        size_t const far = chars.size() - 50;
+
+        Pool::Cursor a, b;
+        for (int i = 0; i < 3; ++i)
+        {
+            CHECK(reads_back(pool, chars, 10, 30, a));
+            CHECK(reads_back(pool, chars, far, 30, a));
+            CHECK(reads_back(pool, chars, Pool::kBlockChars * 16 + 3, 30, a));
+            CHECK(reads_back(pool, chars, 3, 30, b));
+        }
+    }
+
+    TEST_CASE("Repetitive pools shrink; noise is stored raw") {
+        std::vector<char16_t> const listing = make_listing(20000);
+        Pool packed;
+        packed.pack(listing.data(), listing.size());
+        CHECK(packed.bytes() * 3 < listing.size() * sizeof(char16_t));
+
+        std::vector<char16_t> const noise = make_noise(3 * Pool::kBlockChars + 100, 11);
+        Pool raw;
+        raw.pack(noise.data(), noise.size());
+        CHECK(raw.bytes() >= noise.size() * sizeof(char16_t));
+        Pool::Cursor cursor;
+        CHECK(reads_back(raw, noise, Pool::kBlockChars - 50, 100, cursor));
+        CHECK(reads_back(raw, noise, noise.size() - 100, 100, cursor));
+    }
+
+    TEST_CASE("Empty pools and empty names") {
+        Pool pool;
+        pool.pack(nullptr, 0);
+        Pool::Cursor cursor;
+        CHECK(pool.size() == 0);
+        CHECK(pool.at(0, 0, cursor) != nullptr);
+        CHECK_THROWS_AS((void)pool.at(0, 1, cursor), std::out_of_range);
+    }
+
+    TEST_CASE("Ranges outside the pool or over two blocks are rejected") {
+        std::vector<char16_t> const chars = make_listing(3000);
+        Pool pool;
+        pool.pack(chars.data(), chars.size());
+        Pool::Cursor cursor;
+        CHECK_THROWS_AS((void)pool.at(chars.size() - 5, 6, cursor), std::out_of_range);
+        CHECK_THROWS_AS((void)pool.at(chars.size(), 1, cursor), std::out_of_range);
+        CHECK_THROWS_AS((void)pool.at(Pool::kBlockChars - 1, Pool::kBlockChars + 2, cursor), std::out_of_range);
+        CHECK(reads_back(pool, chars, chars.size() - 5, 5, cursor));
+    }
+}
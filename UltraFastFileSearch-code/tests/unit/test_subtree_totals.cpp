@@ -0,0 +1,590 @@
+// ============================================================================
+// Unit Tests for Directory Total Arithmetic
+// ============================================================================
+// Tests subtree_totals.hpp, the share and delta arithmetic that the
+// Preprocessor uses to compute directory totals and NtfsIndex::Patcher uses
+// to keep them up to date.
+//
+// The tests keep a model volume twice: once patched the way the Patcher
+// does it (withdraw a file's share from its ancestors, edit, add it back),
+// and once as plain records that a fresh walk, done the way the
+// Preprocessor does it, turns into totals. After every edit both must agree
+// on length, allocated and treesize of every stream. Bulkiness is not
+// additive and is only an approximation after a patch, so it is not compared.
+//
+// Key behaviors to verify:
+// - The shares of all links of a file add up to its size
+// - Create, delete, rename, move and resize events keep totals exact
+// - Adding or removing a hard link re-splits the file across its links
+// - A directory re-read by a re-scan keeps the totals of its subtree
+// - WofCompressedData allocation is merged into the default stream once
+// - Children of 1% or more of the allocation drop out of bulkiness
+// ============================================================================
+
+#include "../doctest.h"
+#include "../../src/io/subtree_totals.hpp"
+
+#include <cstddef>
+#include <map>
+#include <vector>
+
+namespace {
+
+struct Sizes
+{
+    unsigned long long length;
+    unsigned long long allocated;
+    unsigned long long bulkiness;
+    unsigned int treesize;
+};
+
+struct Stream : Sizes
+{
+    unsigned char type_name_id;  // 0 for the $I30 stream of a directory
+    unsigned int is_allocated_size_accounted_for_in_main_stream;
+    bool named;
+    bool wof;                    // ::$DATA:WofCompressedData
+};
+
+struct File
+{
+    std::vector<unsigned int> parents;  // one per link; the root is its own parent
+    std::vector<Stream> streams;
+};
+
+typedef std::map<unsigned int, File> Volume;
+
+constexpr unsigned int kRoot = 5;
+constexpr unsigned char kData = 0x80 >> 4;     // AttributeData, as type_name_id stores it
+constexpr unsigned long long kClusterSize = 4096;
+
+/// A directory's $I30 stream as load() leaves it.
+Stream directory_index()
+{
+    Stream k = Stream();
+    k.treesize = 1;
+    return k;
+}
+
+/// A data stream as load() leaves it: bulkiness starts as the allocation.
+Stream data(unsigned long long length, unsigned long long allocated, bool named = false)
+{
+    Stream k = Stream();
+    k.type_name_id = kData;
+    k.length = length;
+    k.allocated = allocated;
+    k.bulkiness = allocated;
+    k.named = named;
+    return k;
+}
+
+Stream wof_data(unsigned long long length, unsigned long long allocated)
+{
+    Stream k = data(length, allocated, true);
+    k.wof = true;
+    return k;
+}
+
+File directory(unsigned int parent)
+{
+    File f;
+    f.parents.push_back(parent);
+    f.streams.push_back(directory_index());
+    return f;
+}
+
+File file(std::vector<unsigned int> parents, std::vector<Stream> streams)
+{
+    File f;
+    f.parents = parents;
+    f.streams = streams;
+    return f;
+}
+
+/// Merges the WofCompressedData stream of @p f into its default stream, as load() leaves it to.
+void merge_streams(File& f)
+{
+    Stream* default_stream = nullptr;
+    Stream* compressed = nullptr;
+    for (Stream& k : f.streams)
+    {
+        if (k.type_name_id == kData && !k.named)
+        {
+            default_stream = &k;
+        }
+        else if (k.wof)
+        {
+            compressed = &k;
+        }
+    }
+    if (default_stream && compressed)
+    {
+        uffs::merge_wof(*default_stream, *compressed);
+    }
+}
+
+/// Directory totals of @p volume computed from scratch, the way the Preprocessor walks the tree.
+class FreshWalk
+{
+    Volume v_;
+    long long reserved_clusters_;
+
+    Sizes visit(unsigned int frs, unsigned short link, bool is_root)
+    {
+        std::vector<Sizes> shares;
+        for (auto& child : v_)
+        {
+            for (size_t l = 0; l != child.second.parents.size(); ++l)
+            {
+                if (child.second.parents[l] == frs && child.first != frs)
+                {
+                    shares.push_back(this->visit(child.first, static_cast<unsigned short>(l), false));
+                }
+            }
+        }
+        bool const has_children = !shares.empty() || is_root;
+        Sizes children = uffs::children_totals(shares);
+        if (is_root)
+        {
+            children.allocated += static_cast<unsigned long long>(reserved_clusters_) * kClusterSize;
+        }
+
+        // As Preprocessor::finish(): shares of the streams before the merge, then the merge
+        File& f = v_[frs];
+        unsigned short const n = static_cast<unsigned short>(f.parents.size());
+        Sizes result = children;
+        Stream* default_stream = nullptr;
+        Stream* compressed = nullptr;
+        unsigned long long default_allocated = 0, compressed_allocated = 0;
+        for (Stream& k : f.streams)
+        {
+            unsigned long long const allocated = uffs::link_share(
+                k.is_allocated_size_accounted_for_in_main_stream ? 0 : k.allocated, link, n);
+            if (k.type_name_id == kData && !k.named)
+            {
+                default_stream = &k;
+                default_allocated += allocated;
+            }
+            if (k.wof && !k.is_allocated_size_accounted_for_in_main_stream)
+            {
+                compressed = &k;
+                compressed_allocated += allocated;
+            }
+            result.length += uffs::link_share(k.wof ? 0 : k.length, link, n);
+            result.allocated += allocated;
+            result.bulkiness += uffs::link_share(k.bulkiness, link, n);
+            result.treesize += 1;
+            if (!k.type_name_id && has_children)
+            {
+                uffs::apply_delta(k, children, false);
+            }
+        }
+        if (default_stream && compressed)
+        {
+            unsigned long long const merged = default_stream->allocated + compressed->allocated;
+            uffs::merge_wof(*default_stream, *compressed);
+            result.allocated -= default_allocated + compressed_allocated;
+            result.allocated += uffs::link_share(merged, link, n);
+        }
+        return result;
+    }
+
+public:
+    FreshWalk(Volume const& volume, long long reserved_clusters)
+        : v_(volume), reserved_clusters_(reserved_clusters)
+    {
+        this->visit(kRoot, 0, true);
+    }
+
+    Volume const& volume() const { return v_; }
+};
+
+/// The volume of @p plain with totals kept up to date edit by edit, as the Patcher does.
+class Scenario
+{
+    Volume plain_;              // records only; totals come from a fresh walk
+    Volume patched_;
+    long long reserved_clusters_;
+
+    Sizes contribution(File const& f, unsigned short link) const
+    {
+        Sizes result = Sizes();
+        for (Stream const& k : f.streams)
+        {
+            uffs::add_link_share(result, k, k.wof, link, static_cast<unsigned short>(f.parents.size()));
+        }
+        return result;
+    }
+
+    void propagate(unsigned int dir, Sizes const& delta, bool withdraw)
+    {
+        for (size_t steps = 0; steps != patched_.size(); ++steps)
+        {
+            auto const i = patched_.find(dir);
+            if (i == patched_.end())
+            {
+                break;
+            }
+            for (Stream& k : i->second.streams)
+            {
+                if (!k.type_name_id)
+                {
+                    uffs::apply_delta(k, delta, withdraw);
+                    break;
+                }
+            }
+            if (i->second.parents.empty() || i->second.parents[0] == dir)
+            {
+                break;
+            }
+            dir = i->second.parents[0];
+        }
+    }
+
+    void contribute(unsigned int frs, bool withdraw)
+    {
+        File const f = patched_.at(frs);
+        for (size_t l = 0; l != f.parents.size(); ++l)
+        {
+            if (f.parents[l] != frs)
+            {
+                this->propagate(f.parents[l], this->contribution(f, static_cast<unsigned short>(l)), withdraw);
+            }
+        }
+    }
+
+    Sizes children(unsigned int dir) const
+    {
+        std::vector<Sizes> shares;
+        for (auto const& child : patched_)
+        {
+            for (size_t l = 0; l != child.second.parents.size(); ++l)
+            {
+                if (child.second.parents[l] == dir && child.first != dir)
+                {
+                    shares.push_back(this->contribution(child.second, static_cast<unsigned short>(l)));
+                }
+            }
+        }
+        return uffs::children_totals(shares);
+    }
+
+    /// Withdraws @p frs, applies @p edit to both volumes, adds it back.
+    template <class Edit>
+    void edit(unsigned int frs, Edit&& edit)
+    {
+        this->contribute(frs, true);
+        edit(plain_[frs]);
+        edit(patched_[frs]);
+        this->contribute(frs, false);
+    }
+
+public:
+    explicit Scenario(Volume const& volume, long long reserved_clusters = 0)
+        : plain_(volume), patched_(FreshWalk(volume, reserved_clusters).volume()),
+          reserved_clusters_(reserved_clusters)
+    {
+    }
+
+    void create(unsigned int frs, File const& f)
+    {
+        plain_[frs] = f;
+        patched_[frs] = f;
+        merge_streams(patched_[frs]);
+        this->contribute(frs, false);
+    }
+
+    void remove(unsigned int frs)
+    {
+        this->contribute(frs, true);
+        plain_.erase(frs);
+        patched_.erase(frs);
+    }
+
+    void rename(unsigned int frs)
+    {
+        // Names do not count; the link is detached and attached again in place
+        this->edit(frs, [](File&) {});
+    }
+
+    void move(unsigned int frs, size_t link, unsigned int parent)
+    {
+        this->edit(frs, [&](File& f) { f.parents[link] = parent; });
+    }
+
+    void add_link(unsigned int frs, unsigned int parent)
+    {
+        // A new hard link becomes the first name, as in load()
+        this->edit(frs, [&](File& f) { f.parents.insert(f.parents.begin(), parent); });
+    }
+
+    void remove_link(unsigned int frs, size_t link)
+    {
+        this->edit(frs, [&](File& f) { f.parents.erase(f.parents.begin() + static_cast<ptrdiff_t>(link)); });
+    }
+
+    void resize(unsigned int frs, unsigned long long length, unsigned long long allocated)
+    {
+        this->edit(frs, [&](File& f)
+        {
+            for (Stream& k : f.streams)
+            {
+                if (k.type_name_id == kData && !k.named)
+                {
+                    k.length = length;
+                    k.allocated = allocated;
+                    k.bulkiness = allocated;
+                }
+            }
+        });
+    }
+
+    /// A directory whose record a re-scan parses again: its own totals restart, its children's stay.
+    void reparse(unsigned int dir)
+    {
+        Sizes const kept = this->children(dir);
+        this->contribute(dir, true);
+        File& f = patched_[dir];
+        f.streams.assign(1, directory_index());
+        if (dir == kRoot)
+        {
+            Sizes reserved = Sizes();
+            reserved.allocated = static_cast<unsigned long long>(reserved_clusters_) * kClusterSize;
+            uffs::apply_delta(f.streams[0], reserved, false);
+        }
+        uffs::apply_delta(f.streams[0], kept, false);
+        this->contribute(dir, false);
+    }
+
+    /// The volume reserves @p clusters now; only the root's allocation changes.
+    void reserve(long long clusters)
+    {
+        Sizes delta = Sizes();
+        delta.allocated = static_cast<unsigned long long>(
+            clusters > reserved_clusters_ ? clusters - reserved_clusters_ : reserved_clusters_ - clusters) * kClusterSize;
+        this->propagate(kRoot, delta, clusters < reserved_clusters_);
+        reserved_clusters_ = clusters;
+    }
+
+    Volume const& patched() const { return patched_; }
+
+    /// Patched totals against a fresh walk of the edited records.
+    void check() const
+    {
+        Volume const expected = FreshWalk(plain_, reserved_clusters_).volume();
+        REQUIRE(expected.size() == patched_.size());
+        for (auto const& e : expected)
+        {
+            File const& actual = patched_.at(e.first);
+            REQUIRE(actual.streams.size() == e.second.streams.size());
+            for (size_t s = 0; s != e.second.streams.size(); ++s)
+            {
+                INFO("frs ", e.first, ", stream ", s);
+                CHECK(actual.streams[s].length == e.second.streams[s].length);
+                CHECK(actual.streams[s].allocated == e.second.streams[s].allocated);
+                CHECK(actual.streams[s].treesize == e.second.streams[s].treesize);
+            }
+        }
+    }
+};
+
+/// Directories, a hard-linked file with an odd size, a file with three links, and a WOF file.
+Volume make_volume()
+{
+    Volume v;
+    v[kRoot] = directory(kRoot);
+    v[16] = directory(kRoot);
+    v[17] = directory(kRoot);
+    v[18] = directory(16);
+    v[20] = file({ 16 }, { data(1000, 4096) });
+    v[21] = file({ 18 }, { data(5000, 8192), data(300, 4096, true) });
+    v[22] = file({ 16, 17 }, { data(10007, 12288) });
+    v[23] = file({ 17 }, { data(70000, 0), wof_data(20000, 24576) });
+    v[24] = file({ kRoot, 18, 17 }, { data(1000001, 1003520) });
+    return v;
+}
+
+Stream const& index_of(Volume const& v, unsigned int dir)
+{
+    return v.at(dir).streams.at(0);
+}
+
+} // namespace
+
+TEST_SUITE("SubtreeTotals") {
+
+    TEST_CASE("the shares of all links add up to the size") {
+        for (unsigned short n = 1; n != 6; ++n)
+        {
+            for (unsigned long long value : { 0ULL, 1ULL, 10ULL, 10007ULL, 0xFFFFFFFFFFULL })
+            {
+                unsigned long long sum = 0;
+                for (unsigned short i = 0; i != n; ++i)
+                {
+                    sum += uffs::link_share(value, i, n);
+                }
+                CHECK(sum == value);
+            }
+        }
+        CHECK(uffs::link_share(10, 0, 3) == 3);
+        CHECK(uffs::link_share(10, 1, 3) == 3);
+        CHECK(uffs::link_share(10, 2, 3) == 4);
+    }
+
+    TEST_CASE("a link passes its share of every stream; $I30 passes its treesize") {
+        Sizes share = Sizes();
+        uffs::add_link_share(share, data(10007, 12288), false, 1, 2);
+        CHECK(share.length == 5004);
+        CHECK(share.allocated == 6144);
+        CHECK(share.bulkiness == 6144);
+        CHECK(share.treesize == 1);
+
+        Stream wof = wof_data(20000, 24576);
+        wof.is_allocated_size_accounted_for_in_main_stream = 1;
+        uffs::add_link_share(share, wof, true, 0, 1);
+        CHECK(share.length == 5004);      // WOF streams add no length
+        CHECK(share.allocated == 6144);   // and, once merged, no allocation
+        CHECK(share.treesize == 2);
+
+        Stream index = directory_index();
+        index.treesize = 42;
+        uffs::add_link_share(share, index, false, 0, 1);
+        CHECK(share.treesize == 44);
+    }
+
+    TEST_CASE("WOF allocation is merged into the default stream once") {
+        Stream main = data(70000, 0);
+        Stream wof = wof_data(20000, 24576);
+        CHECK(uffs::merge_wof(main, wof));
+        CHECK(main.allocated == 24576);
+        CHECK_FALSE(uffs::merge_wof(main, wof));
+        CHECK(main.allocated == 24576);
+    }
+
+    TEST_CASE("children of 1% or more of the allocation drop out of bulkiness") {
+        std::vector<Sizes> shares(3, Sizes());
+        shares[0].allocated = shares[0].bulkiness = 100000;
+        shares[1].allocated = shares[1].bulkiness = 500;    // below 1% of 100600
+        shares[2].allocated = shares[2].bulkiness = 100;
+        Sizes const total = uffs::children_totals(shares);
+        CHECK(total.allocated == 100600);
+        CHECK(total.bulkiness == 600);
+
+        CHECK(uffs::children_totals(std::vector<Sizes>()).allocated == 0);
+    }
+
+    TEST_CASE("deltas withdraw exactly what they add") {
+        Stream k = directory_index();
+        Sizes delta = Sizes();
+        delta.length = 7;
+        delta.allocated = 4096;
+        delta.bulkiness = 4096;
+        delta.treesize = 3;
+        uffs::apply_delta(k, delta, false);
+        CHECK(k.treesize == 4);
+        uffs::apply_delta(k, delta, true);
+        CHECK(k.length == 0);
+        CHECK(k.allocated == 0);
+        CHECK(k.bulkiness == 0);
+        CHECK(k.treesize == 1);
+    }
+
+    TEST_CASE("a fresh walk and the patched copy start out equal") {
+        Scenario s(make_volume());
+        s.check();
+
+        Volume const& v = s.patched();
+        // Every link counts its file's streams: root 1, 24 1, 17 1+1+2+1, 16 1+1+1+(18: 1+2+1)
+        CHECK(index_of(v, kRoot).treesize == 14);
+        CHECK(v.at(23).streams[0].allocated == 24576);           // WOF merged
+    }
+
+    TEST_CASE("create events") {
+        Scenario s(make_volume());
+        s.create(30, file({ 18 }, { data(123, 4096) }));
+        s.check();
+        s.create(31, directory(17));
+        s.create(32, file({ 31 }, { data(9, 4096), wof_data(4000, 8192) }));
+        s.check();
+        s.create(33, file({ 31, 16 }, { data(333, 4096) }));
+        s.check();
+    }
+
+    TEST_CASE("delete events") {
+        Scenario s(make_volume());
+        s.remove(21);
+        s.check();
+        s.remove(24);
+        s.check();
+        s.remove(18);  // now empty
+        s.check();
+        s.remove(23);
+        s.check();
+    }
+
+    TEST_CASE("rename events leave the totals alone") {
+        Scenario s(make_volume());
+        Volume const before = s.patched();
+        s.rename(20);
+        s.rename(22);
+        s.rename(18);
+        s.check();
+        CHECK(index_of(s.patched(), kRoot).length == index_of(before, kRoot).length);
+        CHECK(index_of(s.patched(), 16).allocated == index_of(before, 16).allocated);
+    }
+
+    TEST_CASE("move events, of files and of a directory with its subtree") {
+        Scenario s(make_volume());
+        s.move(21, 0, 17);
+        s.check();
+        s.move(24, 1, 16);
+        s.check();
+        s.move(18, 0, 17);
+        s.check();
+        s.move(16, 0, 18);  // 16 under 18, which is now under 17
+        s.check();
+    }
+
+    TEST_CASE("resize events") {
+        Scenario s(make_volume());
+        s.resize(22, 1, 4096);
+        s.check();
+        s.resize(24, 7777777, 7782400);
+        s.check();
+    }
+
+    TEST_CASE("hard links added and removed re-split the file") {
+        Scenario s(make_volume());
+        s.add_link(20, 17);
+        s.check();
+        s.add_link(20, 18);
+        s.check();
+        s.remove_link(24, 1);
+        s.check();
+        s.remove_link(22, 0);
+        s.check();
+        s.add_link(23, kRoot);
+        s.check();
+    }
+
+    TEST_CASE("a re-scanned directory keeps its subtree") {
+        Scenario s(make_volume(), 10);
+        s.reparse(18);
+        s.check();
+        s.reparse(16);
+        s.check();
+        s.reparse(kRoot);
+        s.check();
+    }
+
+    TEST_CASE("reserved clusters only change the root") {
+        Scenario s(make_volume(), 10);
+        Volume const before = s.patched();
+        s.reserve(25);
+        s.check();
+        CHECK(index_of(s.patched(), kRoot).allocated == index_of(before, kRoot).allocated + 15 * kClusterSize);
+        CHECK(index_of(s.patched(), 16).allocated == index_of(before, 16).allocated);
+        s.reserve(3);
+        s.check();
+    }
+}
@@ -0,0 +1,332 @@
+// ============================================================================
+// Unit Tests for the Synthetic MFT Generator
+// ============================================================================
+// Tests synthetic_mft.hpp against the real NTFS structures in ntfs_types.hpp
+// (which needs Windows.h), so the records are checked with the same
+// unfixup() and attribute layout that NtfsIndex::load uses.
+//
+// Key behaviors to verify:
+// - Every record passes MULTI_SECTOR_HEADER::unfixup()
+// - Attribute chains are well formed, sorted and end inside the record
+// - $FILE_NAME parents, DOS names, hard links and $I30 match describe()
+// - Non-resident mapping pairs cover exactly the allocated clusters
+// - Output is deterministic and independent of chunking and threads
+// - The UFFS-MFT writer produces a valid (optionally compressed) file
+// - Output that cannot seek gets the streamed layout
+// ============================================================================
+
+#include "../doctest.h"
+#include "../../src/core/ntfs_types.hpp"
+#include "../../src/index/mapping_pair_iterator.hpp"
+#include "../../src/io/synthetic_mft.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+/// Collects output like a pipe: no seeking, so tellp() fails.
+class PipeBuf : public std::streambuf
+{
+public:
+    std::string bytes;
+
+protected:
+    int_type overflow(int_type c) override
+    {
+        if (c != traits_type::eof())
+        {
+            bytes.push_back(static_cast<char>(c));
+        }
+        return traits_type::not_eof(c);
+    }
+
+    std::streamsize xsputn(char const* s, std::streamsize n) override
+    {
+        bytes.append(s, static_cast<size_t>(n));
+        return n;
+    }
+};
+
+uffs::SyntheticMftOptions small_options()
+{
+    uffs::SyntheticMftOptions options;
+    options.record_count = 4000;
+    options.fanout = 8;
+    options.unicode_ratio = 0.2;
+    options.hardlink_ratio = 0.1;
+    options.dos_name_ratio = 0.5;
+    options.ads_ratio = 0.1;
+    options.free_ratio = 0.05;
+    options.name_length_max = 60;
+    return options;
+}
+
+std::vector<unsigned char> generate_all(uffs::SyntheticMftGenerator const& generator)
+{
+    std::vector<unsigned char> mft(static_cast<size_t>(generator.record_count()) * generator.record_size());
+    generator.generate(0, static_cast<size_t>(generator.record_count()), mft.data());
+    return mft;
+}
+
+/// Name of a $FILE_NAME value as UTF-16 code units.
+std::u16string file_name_of(ntfs::FILENAME_INFORMATION const* fn)
+{
+    std::u16string name(fn->FileNameLength, u'\0');
+    memcpy(&name[0], reinterpret_cast<unsigned char const*>(fn) + 0x42, fn->FileNameLength * sizeof(char16_t));
+    return name;
+}
+
+} // namespace
+
+TEST_SUITE("SyntheticMft") {
+
+    TEST_CASE("Options parse and validate") {
+        uffs::SyntheticMftOptions options;
+        REQUIRE(uffs::parse_synthetic_mft_options(
+            "records=100000,shape=balanced,fanout=32,names=3..40,unicode=0.25,seed=9", options) == nullptr);
+        CHECK(options.record_count == 100000);
+        CHECK(options.shape == uffs::SyntheticTreeShape::Balanced);
+        CHECK(options.fanout == 32);
+        CHECK(options.name_length_min == 3);
+        CHECK(options.name_length_max == 40);
+        CHECK(options.unicode_ratio == 0.25);
+        CHECK(options.seed == 9);
+        CHECK(uffs::validate_synthetic_mft_options(options) == nullptr);
+
+        CHECK(uffs::parse_synthetic_mft_options("bogus=1", options) != nullptr);
+        CHECK(uffs::parse_synthetic_mft_options("unicode=2", options) != nullptr);
+        CHECK(uffs::parse_synthetic_mft_options("records", options) != nullptr);
+        CHECK(options.record_count == 100000);  // untouched on error
+
+        options.record_size = 2048;
+        CHECK(uffs::validate_synthetic_mft_options(options) != nullptr);
+        options.record_size = 1024;
+        options.fanout = 1;
+        CHECK(uffs::validate_synthetic_mft_options(options) != nullptr);
+        options.fanout = 2;
+        options.record_count = 10;
+        CHECK(uffs::validate_synthetic_mft_options(options) != nullptr);
+    }
+
+    TEST_CASE("Every record passes unfixup and parses cleanly") {
+        for (uint32_t record_size : { 1024U, 4096U })
+        {
+            uffs::SyntheticMftOptions options = small_options();
+            options.record_size = record_size;
+            uffs::SyntheticMftGenerator const generator(options);
+            std::vector<unsigned char> mft = generate_all(generator);
+
+            size_t unicode_names = 0, dos_names = 0, hard_links = 0, non_resident = 0, ads = 0;
+            for (uint64_t frs = 0; frs < generator.record_count(); ++frs)
+            {
+                auto* const frsh = reinterpret_cast<ntfs::FILE_RECORD_SEGMENT_HEADER*>(&mft[frs * record_size]);
+                REQUIRE(frsh->MultiSectorHeader.Magic == 'ELIF');
+                REQUIRE(frsh->MultiSectorHeader.unfixup(record_size));
+                REQUIRE(frsh->BytesInUse <= record_size);
+                CHECK(frsh->SegmentNumberLower == frs);
+
+                uffs::SyntheticMftRecordInfo const info = generator.describe(frs);
+                CHECK(!!(frsh->Flags & ntfs::FRH_IN_USE) == info.in_use);
+                CHECK(!!(frsh->Flags & ntfs::FRH_DIRECTORY) == info.directory);
+
+                unsigned int links = 0, index_roots = 0;
+                int last_type = 0;
+                void const* const end = frsh->end(record_size);
+                ntfs::ATTRIBUTE_RECORD_HEADER const* ah = frsh->begin();
+                for (; ah < end && ah->Type != ntfs::AttributeTypeCode::AttributeEnd; ah = ah->next())
+                {
+                    REQUIRE(ah->Length >= 0x18);
+                    REQUIRE(reinterpret_cast<unsigned char const*>(ah) + ah->Length <=
+                        reinterpret_cast<unsigned char const*>(end));
+                    CHECK(static_cast<int>(ah->Type) >= last_type);
+                    last_type = static_cast<int>(ah->Type);
+
+                    if (ah->IsNonResident)
+                    {
+                        ++non_resident;
+                        long long clusters = 0;
+                        mapping_pair_iterator::vcn_type vcn = ah->NonResident.LowestVCN;
+                        for (mapping_pair_iterator mpi(ah); !mpi.is_final();)
+                        {
+                            ++mpi;
+                            clusters += mpi->next_vcn - vcn;
+                            vcn = mpi->next_vcn;
+                            CHECK(mpi->current_lcn >= 0);
+                        }
+                        CHECK(clusters * options.cluster_size == ah->NonResident.AllocatedSize);
+                        CHECK(ah->NonResident.HighestVCN == vcn - 1);
+                        CHECK(ah->NonResident.DataSize <= ah->NonResident.AllocatedSize);
+                        continue;
+                    }
+
+                    REQUIRE(ah->Resident.ValueOffset + ah->Resident.ValueLength <= ah->Length);
+                    if (ah->Type == ntfs::AttributeTypeCode::AttributeFileName)
+                    {
+                        auto const* fn = static_cast<ntfs::FILENAME_INFORMATION const*>(ah->Resident.GetValue());
+                        REQUIRE(ah->Resident.ValueLength == 0x42 + 2U * fn->FileNameLength);
+                        std::u16string const name = file_name_of(fn);
+                        bool const has_unicode = name.find_first_not_of(
+                            u"abcdefghijklmnopqrstuvwxyz0123456789_-. $ABCDEFGHIJKLMNOPQRSTUVWXYZ~") != std::u16string::npos;
+                        if (fn->Flags == 0x02)
+                        {
+                            ++dos_names;
+                            CHECK(name.size() <= 12);
+                            CHECK_FALSE(has_unicode);
+                            continue;
+                        }
+                        unicode_names += has_unicode;
+                        if (links++ == 0)
+                        {
+                            CHECK(static_cast<uint32_t>(fn->ParentDirectory) == info.parent);
+                        }
+                        else
+                        {
+                            ++hard_links;
+                        }
+                        if (info.in_use)
+                        {
+                            CHECK(generator.describe(static_cast<uint32_t>(fn->ParentDirectory)).directory);
+                        }
+                    }
+                    if (ah->Type == ntfs::AttributeTypeCode::AttributeIndexRoot)
+                    {
+                        ++index_roots;
+                        CHECK(ah->NameLength == 4);
+                    }
+                    if (ah->Type == ntfs::AttributeTypeCode::AttributeData && ah->NameLength)
+                    {
+                        ++ads;
+                    }
+                }
+                REQUIRE(ah < end);
+                CHECK(ah->Type == ntfs::AttributeTypeCode::AttributeEnd);
+                CHECK(links == info.link_count);
+                CHECK(frsh->LinkCount == info.link_count);
+                CHECK(index_roots == (info.directory ? 1U : 0U));
+            }
+
+            CHECK(unicode_names > 200);
+            CHECK(dos_names > 200);
+            CHECK(hard_links > 100);
+            CHECK(non_resident > 1000);
+            CHECK(ads > 100);
+        }
+    }
+
+    TEST_CASE("Tree shape is a rooted tree") {
+        for (auto shape : { uffs::SyntheticTreeShape::Balanced, uffs::SyntheticTreeShape::Random })
+        {
+            uffs::SyntheticMftOptions options = small_options();
+            options.shape = shape;
+            uffs::SyntheticMftGenerator const generator(options);
+            CHECK(generator.directory_count() == (options.record_count - 24) / options.fanout + 1);
+
+            std::vector<unsigned int> children(static_cast<size_t>(generator.record_count()));
+            for (uint64_t frs = uffs::kSyntheticFirstUserRecord; frs < generator.record_count(); ++frs)
+            {
+                uint32_t const parent = generator.parent_of(frs);
+                CHECK((parent == uffs::kSyntheticRootRecord || parent < frs));
+                CHECK(generator.describe(parent).directory);
+                ++children[parent];
+            }
+
+            if (shape == uffs::SyntheticTreeShape::Balanced)
+            {
+                CHECK(children[uffs::kSyntheticRootRecord] == options.fanout);
+                CHECK(children[uffs::kSyntheticFirstUserRecord] == options.fanout);
+            }
+        }
+    }
+
+    TEST_CASE("Output is deterministic and independent of chunking") {
+        uffs::SyntheticMftGenerator const generator(small_options());
+        std::vector<unsigned char> const whole = generate_all(generator);
+        CHECK(whole == generate_all(uffs::SyntheticMftGenerator(small_options())));
+
+        std::vector<unsigned char> pieces(whole.size());
+        for (uint64_t first = 0; first < generator.record_count(); first += 333)
+        {
+            size_t const count = static_cast<size_t>(std::min<uint64_t>(333, generator.record_count() - first));
+            generator.generate(first, count, &pieces[first * generator.record_size()]);
+        }
+        CHECK(pieces == whole);
+
+        uffs::SyntheticMftOptions other = small_options();
+        other.seed = 2;
+        CHECK(generate_all(uffs::SyntheticMftGenerator(other)) != whole);
+    }
+
+    TEST_CASE("Writer produces a valid UFFS-MFT file") {
+        uffs::SyntheticMftGenerator const generator(small_options());
+        std::vector<unsigned char> const records = generate_all(generator);
+
+        for (bool compress : { false, true })
+        {
+            std::stringstream out(std::ios::in | std::ios::out | std::ios::binary);
+            uint64_t last_progress = 0;
+            REQUIRE(uffs::write_synthetic_uffs_mft(generator, out, compress, 3,
+                [&](uint64_t done) { last_progress = done; }));
+            CHECK(last_progress == generator.record_count());
+
+            std::string const file = out.str();
+            auto const* bytes = reinterpret_cast<unsigned char const*>(file.data());
+            uffs::UffsMftHeader header;
+            memcpy(&header, bytes, sizeof(header));
+            REQUIRE(uffs::validate_uffs_mft_header(header, file.size()) == nullptr);
+            uint64_t const record_count = header.record_count;  // not a reference into the packed header
+            CHECK(record_count == generator.record_count());
+            CHECK(!!(header.flags & uffs::kUffsMftFlagLz4Frames) == compress);
+
+            std::vector<unsigned char> decoded(records.size());
+            if (!compress)
+            {
+                memcpy(decoded.data(), bytes + sizeof(header), decoded.size());
+            }
+            else
+            {
+                std::vector<uffs::UffsMftFrame> frames;
+                REQUIRE(uffs::read_uffs_mft_frame_index(bytes, header, frames) == nullptr);
+                for (size_t i = 0; i < frames.size(); ++i)
+                {
+                    REQUIRE(uffs::decode_uffs_mft_frame(bytes + frames[i].offset, frames[i].encoded_size,
+                        &decoded[i * header.frame_size], uffs::uffs_mft_frame_decoded_size(header, i)));
+                }
+            }
+            CHECK(decoded == records);
+        }
+    }
+
+    TEST_CASE("Writer streams to output that cannot seek") {
+        uffs::SyntheticMftGenerator const generator(small_options());
+        std::vector<unsigned char> const records = generate_all(generator);
+
+        PipeBuf pipe;
+        std::ostream out(&pipe);
+        REQUIRE(uffs::write_synthetic_uffs_mft(generator, out, true, 3, [](uint64_t) {}));
+        CHECK(out.good());
+
+        size_t position = 0;
+        uffs::UffsMftStreamReader reader([&](void* data, size_t size)
+        {
+            size_t const n = std::min(size, pipe.bytes.size() - position);
+            memcpy(data, pipe.bytes.data() + position, n);
+            position += n;
+            return n;
+        }, 1 << 20);
+        CHECK(!!(reader.header().flags & uffs::kUffsMftFlagFramePrefixes));
+
+        std::vector<unsigned char> decoded;
+        for (uffs::UffsMftStreamReader::Slice slice; reader.next(slice);)
+        {
+            uffs::UffsMftStreamReader::decode(slice);
+            decoded.insert(decoded.end(), slice.bytes.begin(), slice.bytes.end());
+        }
+        CHECK(decoded == records);
+        CHECK(position == pipe.bytes.size());  // nothing after the last frame
+    }
+}
@@ -0,0 +1,194 @@
+// ============================================================================
+// Unit Tests for UFFS-IDX Index Snapshot Format
+// ============================================================================
+// Tests the UffsIndexHeader layout, checksum and writer shared by
+// NtfsIndex::save_snapshot and NtfsIndex::open_snapshot.
+//
+// Key behaviors to verify:
+// - Header is exactly 512 bytes with fields at their documented offsets
+// - uffs_index_checksum() is XXH64 (reference vectors)
+// - write_uffs_index() output validates, is page aligned and round-trips
+// - Corrupt headers, sections and truncated files are detected
+// ============================================================================
+
+#include "../doctest.h"
+#include "../../src/io/uffs_index_format.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct SampleIndex
+{
+    std::vector<unsigned char> records;
+    std::vector<uint32_t> lookup;
+    std::u16string names;
+    std::vector<unsigned char> nameinfos;
+    std::vector<unsigned char> streaminfos;
+    std::vector<unsigned char> childinfos;
+    std::vector<unsigned char> first_streams;
+    std::vector<unsigned char> timestamps;
+};
+
+SampleIndex make_sample()
+{
+    SampleIndex sample;
+    for (uint32_t i = 0; i < 1000; ++i)
+    {
+        sample.lookup.push_back(i % 7 ? i : ~0U);
+    }
+    sample.records.resize(62 * 900);
+    for (size_t i = 0; i < sample.records.size(); ++i)
+    {
+        sample.records[i] = static_cast<unsigned char>(i * 31);
+    }
+    sample.names = u"file.txtédir$MFTx";
+    sample.nameinfos.assign(15 * 3, 0x5A);
+    // streaminfos left empty: sections may hold no elements
+    sample.childinfos.assign(8 * 1200, 0xC3);
+    sample.first_streams.assign(40 * 900, 0x3C);
+    sample.timestamps.assign(24 * 900, 0x77);
+    return sample;
+}
+
+std::string write_sample(SampleIndex const& sample, uffs::UffsIndexHeader& header)
+{
+    header = uffs::make_uffs_index_header();
+    header.volume_letter = 'D';
+    uint32_t const element_sizes[] = { 62, 4, 2, 15, 40, 8, 40, 24 };
+    uint64_t const counts[] = { sample.records.size() / 62, sample.lookup.size(), sample.names.size(),
+        sample.nameinfos.size() / 15, 0, sample.childinfos.size() / 8, sample.first_streams.size() / 40,
+        sample.timestamps.size() / 24 };
+    for (uint32_t i = 0; i != uffs::kUffsIndexSectionCount; ++i)
+    {
+        header.sections[i].element_size = element_sizes[i];
+        header.sections[i].count = counts[i];
+    }
+    void const* const data[uffs::kUffsIndexSectionCount] = { sample.records.data(), sample.lookup.data(),
+        sample.names.data(), sample.nameinfos.data(), nullptr, sample.childinfos.data(), sample.first_streams.data(),
+        sample.timestamps.data() };
+
+    std::ostringstream out(std::ios::out | std::ios::binary);
+    REQUIRE(uffs::write_uffs_index(out, header, data));
+    return out.str();
+}
+
+uffs::UffsIndexHeader read_header(std::string const& file)
+{
+    uffs::UffsIndexHeader header;
+    memcpy(&header, file.data(), sizeof(header));
+    return header;
+}
+
+} // namespace
+
+TEST_SUITE("UffsIndexFormat") {
+
+    TEST_CASE("Header layout is stable") {
+        CHECK(sizeof(uffs::UffsIndexHeader) == 512);
+        CHECK(sizeof(uffs::UffsIndexSectionEntry) == 32);
+        CHECK(offsetof(uffs::UffsIndexHeader, magic) == 0);
+        CHECK(offsetof(uffs::UffsIndexHeader, version) == 8);
+        CHECK(offsetof(uffs::UffsIndexHeader, header_size) == 16);
+        CHECK(offsetof(uffs::UffsIndexHeader, volume_letter) == 20);
+        CHECK(offsetof(uffs::UffsIndexHeader, cluster_size) == 24);
+        CHECK(offsetof(uffs::UffsIndexHeader, records_so_far) == 40);
+        CHECK(offsetof(uffs::UffsIndexHeader, created_time) == 88);
+        CHECK(offsetof(uffs::UffsIndexHeader, sections) == 96);
+        CHECK(offsetof(uffs::UffsIndexHeader, header_checksum) == 504);
+    }
+
+    TEST_CASE("Checksum is XXH64") {
+        CHECK(uffs::uffs_index_checksum("", 0) == 0xEF46DB3751D8E999ULL);
+        CHECK(uffs::uffs_index_checksum("a", 1) == 0xD24EC4F1A98C6E5BULL);
+        CHECK(uffs::uffs_index_checksum("abc", 3) == 0x44BC2CF5AD770999ULL);
+        char const text[] = "Nobody inspects the spammish repetition";
+        CHECK(uffs::uffs_index_checksum(text, sizeof(text) - 1) == 0xFBCEA83C8A378BF1ULL);
+        CHECK(uffs::uffs_index_checksum("abc", 3, 1) != uffs::uffs_index_checksum("abc", 3));
+    }
+
+    TEST_CASE("Written snapshot validates and round-trips") {
+        SampleIndex const sample = make_sample();
+        uffs::UffsIndexHeader header;
+        std::string const file = write_sample(sample, header);
+
+        uffs::UffsIndexHeader const stored = read_header(file);
+        REQUIRE(uffs::validate_uffs_index_header(stored, file.size()) == nullptr);
+        CHECK(memcmp(&stored, &header, sizeof(header)) == 0);
+        CHECK(stored.volume_letter == 'D');
+        CHECK(uffs::verify_uffs_index_sections(file.data(), stored) == nullptr);
+
+        for (auto const& section : stored.sections)
+        {
+            CHECK(section.offset % uffs::kUffsIndexSectionAlignment == 0);
+        }
+        uffs::UffsIndexSectionEntry const& last = stored.sections[uffs::kUffsIndexTimestamps];
+        CHECK(file.size() == last.offset + uffs::uffs_index_section_size(last));
+
+        // Arrays are stored verbatim and can be used in place
+        auto const& lookup = stored.sections[uffs::kUffsIndexRecordsLookup];
+        REQUIRE(lookup.count == sample.lookup.size());
+        CHECK(memcmp(file.data() + lookup.offset, sample.lookup.data(), sample.lookup.size() * 4) == 0);
+        auto const& names = stored.sections[uffs::kUffsIndexNames];
+        CHECK(memcmp(file.data() + names.offset, sample.names.data(), sample.names.size() * 2) == 0);
+        CHECK(stored.sections[uffs::kUffsIndexStreamInfos].count == 0);
+        auto const& timestamps = stored.sections[uffs::kUffsIndexTimestamps];
+        REQUIRE(timestamps.count == 900);
+        CHECK(memcmp(file.data() + timestamps.offset, sample.timestamps.data(), sample.timestamps.size()) == 0);
+    }
+
+    TEST_CASE("Corrupt section data is caught by verification only") {
+        SampleIndex const sample = make_sample();
+        uffs::UffsIndexHeader header;
+        std::string file = write_sample(sample, header);
+        file[static_cast<size_t>(header.sections[uffs::kUffsIndexRecords].offset) + 100] ^= 1;
+
+        uffs::UffsIndexHeader const stored = read_header(file);
+        CHECK(uffs::validate_uffs_index_header(stored, file.size()) == nullptr);
+        CHECK(uffs::verify_uffs_index_sections(file.data(), stored) != nullptr);
+    }
+
+    TEST_CASE("Bad headers and truncated files are rejected") {
+        SampleIndex const sample = make_sample();
+        uffs::UffsIndexHeader header;
+        std::string const file = write_sample(sample, header);
+
+        uffs::UffsIndexHeader h = read_header(file);
+        h.mft_capacity += 1;  // any change breaks the header checksum
+        CHECK(uffs::validate_uffs_index_header(h, file.size()) != nullptr);
+
+        h = read_header(file);
+        h.magic[7] = 'Y';
+        CHECK(uffs::validate_uffs_index_header(h, file.size()) != nullptr);
+
+        h = read_header(file);
+        h.version = 99;
+        h.header_checksum = uffs::uffs_index_header_checksum(h);
+        CHECK(uffs::validate_uffs_index_header(h, file.size()) != nullptr);
+
+        h = read_header(file);
+        CHECK(uffs::validate_uffs_index_header(h, file.size() - 1) != nullptr);
+        CHECK(uffs::validate_uffs_index_header(h, 100) != nullptr);
+
+        // Misaligned or overlapping sections, even with a valid checksum
+        h = read_header(file);
+        h.sections[uffs::kUffsIndexNames].offset += 8;
+        h.header_checksum = uffs::uffs_index_header_checksum(h);
+        CHECK(uffs::validate_uffs_index_header(h, file.size()) != nullptr);
+
+        h = read_header(file);
+        h.sections[uffs::kUffsIndexRecordsLookup].offset = h.sections[uffs::kUffsIndexRecords].offset;
+        h.header_checksum = uffs::uffs_index_header_checksum(h);
+        CHECK(uffs::validate_uffs_index_header(h, file.size()) != nullptr);
+
+        h = read_header(file);
+        h.sections[uffs::kUffsIndexRecords].element_size = 0;
+        h.header_checksum = uffs::uffs_index_header_checksum(h);
+        CHECK(uffs::validate_uffs_index_header(h, file.size()) != nullptr);
+    }
+}
@@ -0,0 +1,406 @@
+// ============================================================================
+// Unit Tests for Block-Compressed UFFS-MFT Frames
+// ============================================================================
+// Tests the LZ4 block codec and the parallel frame writer/decoder used by
+// --dump-mft-compress and --index-from.
+//
+// Key behaviors to verify:
+// - LZ4 blocks round-trip for empty, tiny, zero, repetitive and random data
+// - Known reference blocks decode (format compatibility with liblz4)
+// - Truncated or malformed blocks are rejected, never overrun
+// - Frame writer output validates and decodes back to the original stream
+// - All-zero frames are not stored; incompressible frames are stored raw
+// - Streamed files (frame prefixes, no index) read front to back
+// ============================================================================
+
+#include "../doctest.h"
+#include "../../src/io/lz4_block.hpp"
+#include "../../src/io/uffs_mft_codec.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+std::vector<unsigned char> make_noise(size_t size, uint32_t seed)
+{
+    std::vector<unsigned char> data(size);
+    for (auto& b : data)
+    {
+        seed = seed * 1103515245U + 12345U;
+        b = static_cast<unsigned char>(seed >> 16);
+    }
+    return data;
+}
+
+/// Something shaped like an MFT: header-ish bytes at the start of each
+/// record, zero padding after, and a run of completely unused records.
+std::vector<unsigned char> make_mft_like(size_t records, size_t record_size)
+{
+    std::vector<unsigned char> data(records * record_size, 0);
+    std::vector<unsigned char> const noise = make_noise(records * 64, 7);
+    for (size_t r = 0; r < records * 2 / 3; ++r)
+    {
+        unsigned char* const rec = &data[r * record_size];
+        memcpy(rec, "FILE0\0\3\0", 8);
+        memcpy(rec + 8, &noise[r * 64], 64);
+        rec[200] = static_cast<unsigned char>(r);
+    }
+    return data;
+}
+
+bool round_trip(std::vector<unsigned char> const& input)
+{
+    std::vector<unsigned char> encoded(uffs::lz4::compress_bound(input.size()));
+    size_t const n = uffs::lz4::compress(input.data(), input.size(), encoded.data(), encoded.size());
+    if (!n)
+    {
+        return false;
+    }
+    std::vector<unsigned char> decoded(input.size());
+    return uffs::lz4::decompress(encoded.data(), n, decoded.data(), decoded.size()) && decoded == input;
+}
+
+/// Source over @p data that returns at most @p chunk bytes per call, like a pipe.
+uffs::UffsMftStreamReader::Source memory_source(std::vector<unsigned char> const& data, size_t chunk)
+{
+    size_t position = 0;
+    return [&data, chunk, position](void* out, size_t size) mutable
+    {
+        size_t const n = std::min(std::min(size, chunk), data.size() - position);
+        if (n)
+        {
+            memcpy(out, data.data() + position, n);
+        }
+        position += n;
+        return n;
+    };
+}
+
+/// Writes @p records as a streamed file: header first, frame prefixes, no index.
+std::vector<unsigned char> make_streamed_file(std::vector<unsigned char> const& records,
+    uint32_t record_size, uint32_t frame_size)
+{
+    uffs::UffsMftHeader header = uffs::make_uffs_mft_header(record_size,
+        records.size() / record_size, 'D');
+    std::vector<unsigned char> file;
+    uffs::UffsMftFrameWriter writer(frame_size, 2, [&](void const* data, size_t size)
+    {
+        auto const* bytes = static_cast<unsigned char const*>(data);
+        file.insert(file.end(), bytes, bytes + size);
+        return true;
+    }, true);
+    writer.complete_header(header);
+    file.insert(file.end(), reinterpret_cast<unsigned char const*>(&header),
+        reinterpret_cast<unsigned char const*>(&header) + sizeof(header));
+    REQUIRE(writer.write(records.data(), records.size()));
+    REQUIRE(writer.finish());
+    return file;
+}
+
+} // namespace
+
+TEST_SUITE("Lz4Block") {
+
+    TEST_CASE("Round trip of assorted inputs") {
+        CHECK(round_trip({}));
+        CHECK(round_trip({ 'a' }));
+        CHECK(round_trip(std::vector<unsigned char>(13, 'x')));
+        CHECK(round_trip(std::vector<unsigned char>(1 << 20, 0)));
+        CHECK(round_trip(make_noise(100000, 1)));
+        CHECK(round_trip(make_mft_like(1000, 1024)));
+
+        std::vector<unsigned char> text;
+        for (int i = 0; i < 5000; ++i)
+        {
+            text.insert(text.end(), { 'a', 'b', 'c', static_cast<unsigned char>('0' + i % 10) });
+        }
+        CHECK(round_trip(text));
+    }
+
+    TEST_CASE("Zero-filled data compresses by orders of magnitude") {
+        std::vector<unsigned char> const zeros(1 << 20, 0);
+        std::vector<unsigned char> encoded(uffs::lz4::compress_bound(zeros.size()));
+        size_t const n = uffs::lz4::compress(zeros.data(), zeros.size(), encoded.data(), encoded.size());
+        CHECK(n > 0);
+        CHECK(n < zeros.size() / 200);
+    }
+
+    TEST_CASE("Decodes a reference block") {
+        // "aaaaaaaaaaaaaaaaaaaa" as produced by liblz4: 1 literal, match offset 1 len 14, 5 literals
+        unsigned char const block[] = { 0x1A, 'a', 0x01, 0x00, 0x50, 'a', 'a', 'a', 'a', 'a' };
+        unsigned char out[20];
+        REQUIRE(uffs::lz4::decompress(block, sizeof(block), out, sizeof(out)));
+        for (unsigned char c : out)
+        {
+            CHECK(c == 'a');
+        }
+    }
+
+    TEST_CASE("Malformed blocks are rejected") {
+        std::vector<unsigned char> const input = make_mft_like(64, 1024);
+        std::vector<unsigned char> encoded(uffs::lz4::compress_bound(input.size()));
+        size_t const n = uffs::lz4::compress(input.data(), input.size(), encoded.data(), encoded.size());
+        REQUIRE(n > 8);
+
+        std::vector<unsigned char> out(input.size());
+        CHECK_FALSE(uffs::lz4::decompress(encoded.data(), n - 1, out.data(), out.size()));
+        CHECK_FALSE(uffs::lz4::decompress(encoded.data(), n, out.data(), out.size() - 1));
+        CHECK_FALSE(uffs::lz4::decompress(encoded.data(), 0, out.data(), out.size()));
+
+        // Offset pointing before the start of the output
+        unsigned char const bad_offset[] = { 0x10, 'a', 0x09, 0x00, 0x50, 'a', 'a', 'a', 'a', 'a' };
+        unsigned char small[20];
+        CHECK_FALSE(uffs::lz4::decompress(bad_offset, sizeof(bad_offset), small, sizeof(small)));
+    }
+
+    TEST_CASE("Output capacity is honored") {
+        std::vector<unsigned char> const input = make_noise(4096, 3);
+        std::vector<unsigned char> encoded(100);
+        CHECK(uffs::lz4::compress(input.data(), input.size(), encoded.data(), encoded.size()) == 0);
+    }
+}
+
+TEST_SUITE("UffsMftCodec") {
+
+    TEST_CASE("Frame writer output decodes to the original records") {
+        uint32_t const record_size = 1024;
+        uint32_t const frame_size = 64 * 1024;
+        std::vector<unsigned char> const records = make_mft_like(1000, record_size);
+
+        uffs::UffsMftHeader header = uffs::make_uffs_mft_header(record_size, 1000, 'C');
+        std::vector<unsigned char> file(reinterpret_cast<unsigned char const*>(&header),
+            reinterpret_cast<unsigned char const*>(&header) + sizeof(header));
+
+        uffs::UffsMftFrameWriter writer(frame_size, 4, [&](void const* data, size_t size)
+        {
+            auto const* bytes = static_cast<unsigned char const*>(data);
+            file.insert(file.end(), bytes, bytes + size);
+            return true;
+        });
+
+        // Uneven write sizes must not matter
+        REQUIRE(writer.write(records.data(), 1000));
+        REQUIRE(writer.write(records.data() + 1000, records.size() - 1000));
+        REQUIRE(writer.finish());
+        writer.complete_header(header);
+        memcpy(file.data(), &header, sizeof(header));
+
+        CHECK(header.flags == uffs::kUffsMftFlagLz4Frames);
+        // Copies: CHECK must not bind references to members of the packed header
+        uint32_t const header_frame_size = header.frame_size;
+        uint64_t const compressed_size = header.compressed_size;
+        CHECK(header_frame_size == frame_size);
+        CHECK(uffs::uffs_mft_frame_count(header) == (records.size() + frame_size - 1) / frame_size);
+        CHECK(compressed_size < records.size() / 4);
+        REQUIRE(uffs::validate_uffs_mft_header(header, file.size()) == nullptr);
+
+        std::vector<uffs::UffsMftFrame> frames;
+        REQUIRE(uffs::read_uffs_mft_frame_index(file.data(), header, frames) == nullptr);
+        REQUIRE(frames.size() == uffs::uffs_mft_frame_count(header));
+
+        // The last third of the records is unused and must cost nothing
+        CHECK(frames.back().encoded_size == 0);
+
+        std::vector<unsigned char> decoded(records.size());
+        uffs::parallel_for_each_index(frames.size(), 3, [&](size_t i)
+        {
+            uint32_t const size = uffs::uffs_mft_frame_decoded_size(header, i);
+            REQUIRE(uffs::decode_uffs_mft_frame(file.data() + frames[i].offset, frames[i].encoded_size,
+                decoded.data() + i * frame_size, size));
+        });
+        CHECK(decoded == records);
+    }
+
+    TEST_CASE("Zero runs interleave with record data") {
+        uint32_t const frame_size = 16 * 1024;
+        std::vector<unsigned char> const records = make_mft_like(100, 1024);
+
+        // Records 10..59 written as a hole, straddling several frames and batches
+        std::vector<unsigned char> expected = records;
+        std::fill(expected.begin() + 10 * 1024, expected.begin() + 60 * 1024, 0);
+
+        std::vector<unsigned char> file(sizeof(uffs::UffsMftHeader));
+        uffs::UffsMftFrameWriter writer(frame_size, 2, [&](void const* data, size_t size)
+        {
+            auto const* bytes = static_cast<unsigned char const*>(data);
+            file.insert(file.end(), bytes, bytes + size);
+            return true;
+        });
+        REQUIRE(writer.write(records.data(), 10 * 1024));
+        REQUIRE(writer.write_zeros(50 * 1024));
+        REQUIRE(writer.write(records.data() + 60 * 1024, 40 * 1024));
+        REQUIRE(writer.finish());
+
+        uffs::UffsMftHeader header = uffs::make_uffs_mft_header(1024, 100, 'C');
+        writer.complete_header(header);
+        memcpy(file.data(), &header, sizeof(header));
+
+        std::vector<uffs::UffsMftFrame> frames;
+        REQUIRE(uffs::read_uffs_mft_frame_index(file.data(), header, frames) == nullptr);
+        std::vector<unsigned char> decoded(records.size());
+        for (size_t i = 0; i < frames.size(); ++i)
+        {
+            REQUIRE(uffs::decode_uffs_mft_frame(file.data() + frames[i].offset, frames[i].encoded_size,
+                decoded.data() + i * frame_size, uffs::uffs_mft_frame_decoded_size(header, i)));
+        }
+        CHECK(decoded == expected);
+
+        // Frames 1 and 2 lie entirely inside the hole
+        CHECK(frames[1].encoded_size == 0);
+        CHECK(frames[2].encoded_size == 0);
+    }
+
+    TEST_CASE("Incompressible frames are stored raw") {
+        std::vector<unsigned char> const noise = make_noise(8192, 11);
+        std::vector<unsigned char> encoded;
+        uffs::encode_uffs_mft_frame(noise.data(), noise.size(), encoded);
+        CHECK(encoded == noise);
+
+        std::vector<unsigned char> decoded(noise.size());
+        CHECK(uffs::decode_uffs_mft_frame(encoded.data(), encoded.size(), decoded.data(), decoded.size()));
+        CHECK(decoded == noise);
+    }
+
+    TEST_CASE("Frame index entries outside the frame data are rejected") {
+        uffs::UffsMftHeader header = uffs::make_uffs_mft_header(1024, 128, 0);
+        header.flags = uffs::kUffsMftFlagLz4Frames;
+        header.frame_size = 64 * 1024;
+        header.compressed_size = 1000;
+
+        uffs::UffsMftFrame frame = { 64, 1000, 0 };
+        CHECK(uffs::validate_uffs_mft_frame(header, frame, 0) == nullptr);
+
+        frame.encoded_size = 1001;
+        CHECK(uffs::validate_uffs_mft_frame(header, frame, 0) != nullptr);
+
+        frame = { 10, 10, 0 };
+        CHECK(uffs::validate_uffs_mft_frame(header, frame, 0) != nullptr);
+
+        // Frames may not claim more bytes than they decode to
+        header.compressed_size = 1 << 20;
+        frame = { 64, 64 * 1024 + 1, 0 };
+        CHECK(uffs::validate_uffs_mft_frame(header, frame, 0) != nullptr);
+    }
+
+    TEST_CASE("Frame size must hold whole records") {
+        uffs::UffsMftHeader header = uffs::make_uffs_mft_header(4096, 16, 0);
+        header.flags = uffs::kUffsMftFlagLz4Frames;
+        header.frame_size = 6000;
+        CHECK(uffs::validate_uffs_mft_header(header, 1 << 20) != nullptr);
+        header.frame_size = 0;
+        CHECK(uffs::validate_uffs_mft_header(header, 1 << 20) != nullptr);
+        header.frame_size = 8192;
+        CHECK(uffs::validate_uffs_mft_header(header, 1 << 20) == nullptr);
+    }
+
+    TEST_CASE("Streamed files read front to back") {
+        uint32_t const record_size = 1024;
+        uint32_t const frame_size = 16 * 1024;
+        std::vector<unsigned char> const records = make_mft_like(100, record_size);
+        std::vector<unsigned char> const file = make_streamed_file(records, record_size, frame_size);
+
+        uffs::UffsMftHeader header;
+        memcpy(&header, file.data(), sizeof(header));
+        CHECK(header.flags == (uffs::kUffsMftFlagLz4Frames | uffs::kUffsMftFlagFramePrefixes));
+        uint64_t const compressed_size = header.compressed_size;  // not a reference into the packed header
+        CHECK(compressed_size == 0);  // unknown when the header was written
+
+        uffs::UffsMftStreamReader reader(memory_source(file, 1000), 1 << 20);
+        CHECK(reader.header().volume_letter == 'D');
+        CHECK(reader.slice_size() == frame_size);
+
+        std::vector<unsigned char> decoded;
+        size_t slices = 0;
+        for (uffs::UffsMftStreamReader::Slice slice; reader.next(slice); ++slices)
+        {
+            CHECK(slice.encoded);
+            CHECK(slice.offset == decoded.size());
+            uffs::UffsMftStreamReader::decode(slice);
+            CHECK(slice.bytes.size() == slice.size);
+            decoded.insert(decoded.end(), slice.bytes.begin(), slice.bytes.end());
+        }
+        CHECK(slices == uffs::uffs_mft_frame_count(header));
+        CHECK(decoded == records);
+    }
+
+    TEST_CASE("Streamed files also open as files") {
+        std::vector<unsigned char> const records = make_mft_like(100, 1024);
+        std::vector<unsigned char> const file = make_streamed_file(records, 1024, 16 * 1024);
+
+        uffs::UffsMftHeader header;
+        memcpy(&header, file.data(), sizeof(header));
+        REQUIRE(uffs::validate_uffs_mft_header(header, file.size()) == nullptr);
+
+        // The prefixes take the place of the frame index
+        header.compressed_size = file.size() - sizeof(header);
+        std::vector<uffs::UffsMftFrame> frames;
+        REQUIRE(uffs::read_uffs_mft_frame_index(file.data(), header, frames) == nullptr);
+        REQUIRE(frames.size() == uffs::uffs_mft_frame_count(header));
+
+        std::vector<unsigned char> decoded(records.size());
+        for (size_t i = 0; i < frames.size(); ++i)
+        {
+            REQUIRE(uffs::decode_uffs_mft_frame(file.data() + frames[i].offset, frames[i].encoded_size,
+                decoded.data() + i * header.frame_size, uffs::uffs_mft_frame_decoded_size(header, i)));
+        }
+        CHECK(decoded == records);
+
+        // A file cut short inside the frames is caught by the prefix walk
+        header.compressed_size -= 100;
+        CHECK(uffs::read_uffs_mft_frame_index(file.data(), header, frames) != nullptr);
+    }
+
+    TEST_CASE("Plain files stream in whole records") {
+        std::vector<unsigned char> const records = make_mft_like(10, 1024);
+        uffs::UffsMftHeader const header = uffs::make_uffs_mft_header(1024, 10, 'C');
+        std::vector<unsigned char> file(reinterpret_cast<unsigned char const*>(&header),
+            reinterpret_cast<unsigned char const*>(&header) + sizeof(header));
+        file.insert(file.end(), records.begin(), records.end());
+
+        uffs::UffsMftStreamReader reader(memory_source(file, 777), 3000);
+        CHECK(reader.slice_size() == 2048);
+
+        std::vector<unsigned char> decoded;
+        for (uffs::UffsMftStreamReader::Slice slice; reader.next(slice);)
+        {
+            CHECK_FALSE(slice.encoded);
+            decoded.insert(decoded.end(), slice.bytes.begin(), slice.bytes.end());
+        }
+        CHECK(decoded == records);
+    }
+
+    TEST_CASE("Streams that cannot be read front to back are rejected") {
+        std::vector<unsigned char> const records = make_mft_like(100, 1024);
+
+        // Frame index at the end
+        uffs::UffsMftHeader header = uffs::make_uffs_mft_header(1024, 100, 'C');
+        std::vector<unsigned char> file(sizeof(header));
+        uffs::UffsMftFrameWriter writer(16 * 1024, 2, [&](void const* data, size_t size)
+        {
+            auto const* bytes = static_cast<unsigned char const*>(data);
+            file.insert(file.end(), bytes, bytes + size);
+            return true;
+        });
+        REQUIRE(writer.write(records.data(), records.size()));
+        REQUIRE(writer.finish());
+        writer.complete_header(header);
+        memcpy(file.data(), &header, sizeof(header));
+        CHECK_THROWS_AS(uffs::UffsMftStreamReader(memory_source(file, 4096), 1 << 20), std::runtime_error);
+
+        // Truncated in the middle of a frame
+        std::vector<unsigned char> streamed = make_streamed_file(records, 1024, 16 * 1024);
+        streamed.resize(streamed.size() - 10);
+        uffs::UffsMftStreamReader reader(memory_source(streamed, 4096), 1 << 20);
+        uffs::UffsMftStreamReader::Slice slice;
+        auto const drain = [&]() { while (reader.next(slice)) {} };
+        CHECK_THROWS_AS(drain(), std::runtime_error);
+
+        // Not even a header
+        std::vector<unsigned char> const empty;
+        CHECK_THROWS_AS(uffs::UffsMftStreamReader(memory_source(empty, 4096), 1 << 20), std::runtime_error);
+    }
+}
@@ -0,0 +1,122 @@
+// ============================================================================
+// Unit Tests for UFFS-MFT Dump Format
+// ============================================================================
+// Tests the UffsMftHeader layout shared by --dump-mft and --index-from.
+//
+// Key behaviors to verify:
+// - Header is exactly 64 bytes with fields at their documented offsets
+// - make_uffs_mft_header() produces a header that validates
+// - validate_uffs_mft_header() rejects bad signatures, versions, flags,
+//   record sizes, inconsistent sizes and truncated files
+// ============================================================================
+
+#include "../doctest.h"
+#include "../../src/io/uffs_mft_format.hpp"
+
+#include <cstddef>
+#include <cstring>
+
+TEST_SUITE("UffsMftFormat") {
+
+    TEST_CASE("Header layout is stable") {
+        CHECK(sizeof(uffs::UffsMftHeader) == 64);
+        CHECK(offsetof(uffs::UffsMftHeader, magic) == 0);
+        CHECK(offsetof(uffs::UffsMftHeader, version) == 8);
+        CHECK(offsetof(uffs::UffsMftHeader, flags) == 12);
+        CHECK(offsetof(uffs::UffsMftHeader, record_size) == 16);
+        CHECK(offsetof(uffs::UffsMftHeader, record_count) == 20);
+        CHECK(offsetof(uffs::UffsMftHeader, original_size) == 28);
+        CHECK(offsetof(uffs::UffsMftHeader, compressed_size) == 36);
+        CHECK(offsetof(uffs::UffsMftHeader, volume_letter) == 44);
+        CHECK(offsetof(uffs::UffsMftHeader, frame_size) == 45);
+        CHECK(sizeof(uffs::UffsMftFrame) == 16);
+    }
+
+    TEST_CASE("make_uffs_mft_header fills every field") {
+        uffs::UffsMftHeader const h = uffs::make_uffs_mft_header(1024, 1000, 'C');
+        CHECK(memcmp(h.magic, "UFFS-MFT", 8) == 0);
+        CHECK(h.version == uffs::kUffsMftVersion);
+        CHECK(h.flags == uffs::kUffsMftFlagNone);
+        CHECK(h.record_size == 1024);
+        // Copies: CHECK must not bind references to members of the packed header
+        uint64_t const record_count = h.record_count;
+        uint64_t const original_size = h.original_size;
+        uint64_t const compressed_size = h.compressed_size;
+        CHECK(record_count == 1000);
+        CHECK(original_size == 1024 * 1000);
+        CHECK(compressed_size == 0);
+        CHECK(h.volume_letter == 'C');
+    }
+
+    TEST_CASE("Valid header is accepted") {
+        uffs::UffsMftHeader const h = uffs::make_uffs_mft_header(1024, 16, 'D');
+        CHECK(uffs::validate_uffs_mft_header(h, 64 + 1024 * 16) == nullptr);
+
+        // Trailing bytes after the last record are tolerated
+        CHECK(uffs::validate_uffs_mft_header(h, 64 + 1024 * 16 + 100) == nullptr);
+
+        // Empty dumps are legal
+        uffs::UffsMftHeader const empty = uffs::make_uffs_mft_header(4096, 0, 0);
+        CHECK(uffs::validate_uffs_mft_header(empty, 64) == nullptr);
+    }
+
+    TEST_CASE("Bad signature, version and flags are rejected") {
+        uffs::UffsMftHeader h = uffs::make_uffs_mft_header(1024, 1, 'C');
+        h.magic[0] = 'X';
+        CHECK(uffs::validate_uffs_mft_header(h, 64 + 1024) != nullptr);
+
+        h = uffs::make_uffs_mft_header(1024, 1, 'C');
+        h.version = 99;
+        CHECK(uffs::validate_uffs_mft_header(h, 64 + 1024) != nullptr);
+
+        h = uffs::make_uffs_mft_header(1024, 1, 'C');
+        h.flags = 0x80000000u;
+        CHECK(uffs::validate_uffs_mft_header(h, 64 + 1024) != nullptr);
+
+        // Frame prefixes only exist in block-compressed files
+        h = uffs::make_uffs_mft_header(1024, 1, 'C');
+        h.flags = uffs::kUffsMftFlagFramePrefixes;
+        CHECK(uffs::validate_uffs_mft_header(h, 64 + 1024) != nullptr);
+    }
+
+    TEST_CASE("Only files without a trailing frame index are streamable") {
+        uffs::UffsMftHeader h = uffs::make_uffs_mft_header(1024, 64, 'C');
+        CHECK(uffs::is_streamable_uffs_mft(h));
+
+        h.flags = uffs::kUffsMftFlagLz4Frames;
+        h.frame_size = 64 * 1024;
+        CHECK_FALSE(uffs::is_streamable_uffs_mft(h));
+
+        // Size of a stream is unknown; compressed size is not known up front either
+        h.flags |= uffs::kUffsMftFlagFramePrefixes;
+        h.compressed_size = 0;
+        CHECK(uffs::is_streamable_uffs_mft(h));
+        CHECK(uffs::validate_uffs_mft_header(h, UINT64_MAX) == nullptr);
+        CHECK(uffs::validate_uffs_mft_header(h, 64) == nullptr);
+        h.compressed_size = 1000;
+        CHECK(uffs::validate_uffs_mft_header(h, 64 + 999) != nullptr);
+    }
+
+    TEST_CASE("Record size must be a supported power of two") {
+        CHECK(uffs::validate_uffs_mft_header(uffs::make_uffs_mft_header(0, 1, 0), 1 << 20) != nullptr);
+        CHECK(uffs::validate_uffs_mft_header(uffs::make_uffs_mft_header(256, 1, 0), 1 << 20) != nullptr);
+        CHECK(uffs::validate_uffs_mft_header(uffs::make_uffs_mft_header(1000, 1, 0), 1 << 20) != nullptr);
+        CHECK(uffs::validate_uffs_mft_header(uffs::make_uffs_mft_header(1u << 20, 1, 0), 1 << 21) != nullptr);
+        CHECK(uffs::validate_uffs_mft_header(uffs::make_uffs_mft_header(512, 1, 0), 1 << 20) == nullptr);
+        CHECK(uffs::validate_uffs_mft_header(uffs::make_uffs_mft_header(4096, 1, 0), 1 << 20) == nullptr);
+    }
+
+    TEST_CASE("Inconsistent or truncated sizes are rejected") {
+        uffs::UffsMftHeader h = uffs::make_uffs_mft_header(1024, 8, 'C');
+        h.original_size += 1;
+        CHECK(uffs::validate_uffs_mft_header(h, 1 << 20) != nullptr);
+
+        h = uffs::make_uffs_mft_header(1024, 8, 'C');
+        CHECK(uffs::validate_uffs_mft_header(h, 64 + 1024 * 8 - 1) != nullptr);
+        CHECK(uffs::validate_uffs_mft_header(h, 10) != nullptr);
+
+        // Record counts beyond the 32-bit FRS range cannot be indexed
+        h = uffs::make_uffs_mft_header(1024, 0x100000000ULL, 'C');
+        CHECK(uffs::validate_uffs_mft_header(h, ~0ULL) != nullptr);
+    }
+}
@@ -0,0 +1,234 @@
+// ============================================================================
+// Unit Tests for the USN Change Journal Parser
+// ============================================================================
+// Tests parse_usn_records() and UsnEventBuilder on synthetic $J buffers laid
+// out like USN_RECORD_V2 / USN_RECORD_V3.
+//
+// Key behaviors to verify:
+// - V2 and V3 records decode to the same UsnRecord fields
+// - Sparse zero runs and unknown versions are skipped
+// - Truncated records stop parsing without an error; malformed ones with one
+// - Only CLOSE records produce events, with renames paired across records
+// ============================================================================
+
+#include "../doctest.h"
+#include "../../src/io/usn_journal.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+uint64_t reference(uint64_t frs, uint16_t sequence)
+{
+    return frs | (static_cast<uint64_t>(sequence) << 48);
+}
+
+template<class T>
+void put(std::vector<unsigned char>& buffer, size_t offset, T value)
+{
+    memcpy(&buffer[offset], &value, sizeof(value));
+}
+
+/// Appends one USN_RECORD_V2 or V3 (8-byte aligned) to @p journal.
+void append_record(std::vector<unsigned char>& journal, uint16_t major, uint64_t file, uint64_t parent,
+    uint32_t reason, std::u16string const& name, uint32_t attributes = 0x20, int64_t usn = 0)
+{
+    bool const v3 = major == 3;
+    uint32_t const header = v3 ? uffs::kUsnRecordV3HeaderSize : uffs::kUsnRecordV2HeaderSize;
+    uint32_t const length = (header + static_cast<uint32_t>(name.size() * 2) + 7) & ~7U;
+    size_t const base = journal.size();
+    journal.resize(base + length);
+
+    size_t const tail = base + (v3 ? 0x28 : 0x18);
+    put<uint32_t>(journal, base, length);
+    put<uint16_t>(journal, base + 4, major);
+    put<uint64_t>(journal, base + 0x08, file);
+    put<uint64_t>(journal, base + (v3 ? 0x18 : 0x10), parent);
+    put<int64_t>(journal, tail + 0x00, usn ? usn : static_cast<int64_t>(base));
+    put<int64_t>(journal, tail + 0x08, 132000000000000000LL + static_cast<int64_t>(base));
+    put<uint32_t>(journal, tail + 0x10, reason);
+    put<uint32_t>(journal, tail + 0x1C, attributes);
+    put<uint16_t>(journal, tail + 0x20, static_cast<uint16_t>(name.size() * 2));
+    put<uint16_t>(journal, tail + 0x22, static_cast<uint16_t>(header));
+    memcpy(&journal[base + header], name.data(), name.size() * 2);
+}
+
+std::vector<uffs::UsnRecord> parse_all(std::vector<unsigned char> const& journal, uffs::UsnParseResult* out = nullptr)
+{
+    std::vector<uffs::UsnRecord> records;
+    uffs::UsnParseResult const result = uffs::parse_usn_records(journal.data(), journal.size(),
+        [&](uffs::UsnRecord const& record) { records.push_back(record); });
+    if (out)
+    {
+        *out = result;
+    }
+    return records;
+}
+
+} // namespace
+
+TEST_SUITE("UsnJournal") {
+
+    TEST_CASE("V2 and V3 records decode identically") {
+        for (uint16_t major : { 2, 3 })
+        {
+            std::vector<unsigned char> journal;
+            append_record(journal, major, reference(0x123456789AULL, 7), reference(5, 5),
+                uffs::kUsnReasonFileCreate | uffs::kUsnReasonClose, u"café.txt", 0x20, 4096);
+
+            uffs::UsnParseResult result;
+            std::vector<uffs::UsnRecord> const records = parse_all(journal, &result);
+            REQUIRE(records.size() == 1);
+            CHECK(result.error == nullptr);
+            CHECK(result.consumed == journal.size());
+
+            uffs::UsnRecord const& record = records[0];
+            CHECK(record.major_version == major);
+            CHECK(record.frs() == 0x123456789AULL);
+            CHECK(record.sequence() == 7);
+            CHECK(record.parent_frs() == 5);
+            CHECK(record.usn == 4096);
+            CHECK(record.reason == (uffs::kUsnReasonFileCreate | uffs::kUsnReasonClose));
+            CHECK(record.attributes == 0x20);
+            CHECK(record.name() == u"café.txt");
+        }
+    }
+
+    TEST_CASE("Zero padding and unknown versions are skipped") {
+        std::vector<unsigned char> journal(4096, 0);  // sparse region below the first USN
+        append_record(journal, 2, reference(40, 1), reference(5, 5), uffs::kUsnReasonClose, u"a");
+        size_t const v4 = journal.size();
+        journal.resize(v4 + 64);
+        put<uint32_t>(journal, v4, 64);
+        put<uint16_t>(journal, v4 + 4, 4);
+        journal.resize(journal.size() + 24, 0);
+        append_record(journal, 3, reference(41, 1), reference(5, 5), uffs::kUsnReasonClose, u"b");
+
+        uffs::UsnParseResult result;
+        std::vector<uffs::UsnRecord> const records = parse_all(journal, &result);
+        REQUIRE(records.size() == 2);
+        CHECK(records[0].frs() == 40);
+        CHECK(records[1].frs() == 41);
+        CHECK(result.skipped == 1);
+        CHECK(result.error == nullptr);
+        CHECK(result.consumed == journal.size());
+    }
+
+    TEST_CASE("Truncated and malformed records") {
+        std::vector<unsigned char> journal;
+        append_record(journal, 2, reference(40, 1), reference(5, 5), uffs::kUsnReasonClose, u"first");
+        size_t const first = journal.size();
+        append_record(journal, 2, reference(41, 1), reference(5, 5), uffs::kUsnReasonClose, u"second");
+
+        // Cut inside the second record: the first is delivered, the rest is left for later
+        std::vector<unsigned char> cut(journal.begin(), journal.end() - 10);
+        uffs::UsnParseResult result;
+        CHECK(parse_all(cut, &result).size() == 1);
+        CHECK(result.error == nullptr);
+        CHECK(result.consumed == first);
+
+        std::vector<UsnEvent> events;
+        CHECK(uffs::read_usn_events(cut.data(), cut.size(), events) != nullptr);
+
+        // Name running past the record
+        std::vector<unsigned char> bad = journal;
+        put<uint16_t>(bad, first + 0x38, 200);
+        CHECK(parse_all(bad, &result).size() == 1);
+        CHECK(result.error != nullptr);
+
+        // Length that is not a multiple of 8
+        bad = journal;
+        put<uint32_t>(bad, first, 0x3D);
+        parse_all(bad, &result);
+        CHECK(result.error != nullptr);
+    }
+
+    TEST_CASE("Events are built from CLOSE records") {
+        uint64_t const root = reference(5, 5);
+        uint64_t const dir = reference(64, 2);
+        uint64_t const file = reference(65, 3);
+        uint32_t const close = uffs::kUsnReasonClose;
+
+        std::vector<unsigned char> journal;
+        // mkdir, then create + write a file inside it
+        append_record(journal, 2, dir, root, uffs::kUsnReasonFileCreate, u"docs", 0x10);
+        append_record(journal, 2, dir, root, uffs::kUsnReasonFileCreate | close, u"docs", 0x10);
+        append_record(journal, 2, file, dir, uffs::kUsnReasonFileCreate, u"a.txt");
+        append_record(journal, 2, file, dir, uffs::kUsnReasonFileCreate | uffs::kUsnReasonDataExtend, u"a.txt");
+        append_record(journal, 2, file, dir, uffs::kUsnReasonFileCreate | uffs::kUsnReasonDataExtend | close, u"a.txt");
+        // Move the file to the root under a new name
+        append_record(journal, 3, file, dir, uffs::kUsnReasonRenameOldName, u"a.txt");
+        append_record(journal, 3, file, root, uffs::kUsnReasonRenameNewName, u"b.txt");
+        append_record(journal, 3, file, root, uffs::kUsnReasonRenameNewName | close, u"b.txt");
+        // Append and change attributes in one handle
+        append_record(journal, 2, file, root, uffs::kUsnReasonDataExtend | uffs::kUsnReasonBasicInfoChange | close,
+            u"b.txt", 0x21);
+        // Hard link, temporary file, delete
+        append_record(journal, 2, file, dir, uffs::kUsnReasonHardLinkChange | close, u"link.txt");
+        append_record(journal, 2, reference(66, 1), dir,
+            uffs::kUsnReasonFileCreate | uffs::kUsnReasonFileDelete | close, u"~tmp");
+        append_record(journal, 2, file, root, uffs::kUsnReasonFileDelete | close, u"b.txt");
+
+        std::vector<UsnEvent> events;
+        REQUIRE(uffs::read_usn_events(journal.data(), journal.size(), events) == nullptr);
+
+        std::vector<UsnEventType> types;
+        for (UsnEvent const& e : events)
+        {
+            types.push_back(e.type);
+        }
+        std::vector<UsnEventType> const expected = {
+            UsnEventType::Create, UsnEventType::Create, UsnEventType::Rename, UsnEventType::SizeChange,
+            UsnEventType::AttributeChange, UsnEventType::Link, UsnEventType::Delete };
+        REQUIRE(types == expected);
+
+        CHECK(events[0].frs == 64);
+        CHECK(events[0].is_directory());
+        CHECK(events[1].parent == 64);
+        CHECK(events[1].name == u"a.txt");
+        CHECK(events[1].sequence == 3);
+
+        UsnEvent const& rename = events[2];
+        CHECK(rename.frs == 65);
+        CHECK(rename.old_parent == 64);
+        CHECK(rename.old_name == u"a.txt");
+        CHECK(rename.parent == 5);
+        CHECK(rename.name == u"b.txt");
+
+        CHECK_FALSE(events[3].has_size);  // the journal records no sizes
+        CHECK(events[4].attributes == 0x21);
+        CHECK(events[5].name == u"link.txt");
+        CHECK(events[6].frs == 65);
+    }
+
+    TEST_CASE("Rename state carries across buffers") {
+        uint64_t const file = reference(70, 1);
+        std::vector<unsigned char> part1, part2;
+        append_record(part1, 2, file, reference(5, 5), uffs::kUsnReasonRenameOldName, u"old");
+        append_record(part2, 2, file, reference(5, 5), uffs::kUsnReasonRenameNewName | uffs::kUsnReasonClose, u"new");
+
+        uffs::UsnEventBuilder builder;
+        auto const feed = [&](std::vector<unsigned char> const& buffer) {
+            uffs::parse_usn_records(buffer.data(), buffer.size(),
+                [&](uffs::UsnRecord const& record) { builder.add(record); });
+        };
+        feed(part1);
+        CHECK(builder.pending() == 1);
+        CHECK(builder.events().empty());
+        feed(part2);
+        CHECK(builder.pending() == 0);
+        REQUIRE(builder.events().size() == 1);
+        CHECK(builder.events()[0].old_name == u"old");
+        CHECK(builder.events()[0].name == u"new");
+
+        // A rename whose old name was never seen still produces an event
+        uffs::UsnEventBuilder fresh;
+        uffs::parse_usn_records(part2.data(), part2.size(),
+            [&](uffs::UsnRecord const& record) { fresh.add(record); });
+        REQUIRE(fresh.events().size() == 1);
+        CHECK(fresh.events()[0].old_parent == ~0U);
+    }
+}